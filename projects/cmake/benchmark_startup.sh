@@ -0,0 +1,103 @@
+#!/bin/bash
+set -e
+
+#################
+# command line options
+# set default values
+runs=20
+exec_name="build/rb"
+baseline=""
+
+# parse command line arguments
+while echo $1 | grep ^- > /dev/null; do
+    # intercept help while parsing "-key value" pairs
+    if [ "$1" = "--help" ] || [ "$1" = "-h" ]
+    then
+        echo 'Measure how long RevBayes takes to start, which dominates the run time of many short jobs.
+
+Two scripts are timed, each run several times in a row:
+  startup    : starts RevBayes and quits immediately
+  short job  : starts RevBayes, builds a one-parameter model and runs 100 MCMC iterations
+
+Command line options are:
+-h                              : print this help and exit.
+-runs           integer         : the number of runs of each script. Defaults to 20.
+-exec_name      string          : the RevBayes executable to time. Defaults to build/rb.
+-baseline       string          : a second RevBayes executable (e.g., an older build) to time for comparison. Defaults to unset.
+
+Examples:
+  ./benchmark_startup.sh
+  ./benchmark_startup.sh -runs 50 -exec_name build/rb -baseline ~/revbayes-old/projects/cmake/build/rb'
+        exit
+    fi
+
+    # parse pairs
+    eval $( echo $1 | sed 's/-//g' | tr -d '\012')=$2
+    shift
+    shift
+done
+
+tmp_dir=$(mktemp -d)
+trap 'rm -rf "${tmp_dir}"' EXIT
+
+cat > "${tmp_dir}/startup.Rev" <<'EOF'
+q()
+EOF
+
+cat > "${tmp_dir}/short_job.Rev" <<'EOF'
+mu ~ dnUniform(-10.0, 10.0)
+x ~ dnNormal(mu, 1.0)
+x.clamp(0.5)
+
+moves = VectorMoves()
+moves.append( mvSlide(mu, delta=1.0, weight=1.0) )
+
+monitors = VectorMonitors()
+monitors.append( mnScreen(printgen=1000, mu) )
+
+mymcmc = mcmc(model(mu), monitors, moves)
+mymcmc.run(generations=100)
+
+q()
+EOF
+
+# time several runs of a script and print the average time per run
+time_script()
+{
+    local rb="$1"
+    local script="$2"
+
+    local start=$(date +%s%N)
+    for (( i=0; i<runs; i++ ))
+    do
+        "${rb}" "${script}" < /dev/null > /dev/null 2>&1
+    done
+    local end=$(date +%s%N)
+
+    echo "$(( (end - start) / runs / 1000000 ))"
+}
+
+for rb in "${exec_name}" "${baseline}"
+do
+    if [ -z "${rb}" ] ; then
+        continue
+    fi
+
+    if [ ! -x "${rb}" ] ; then
+        echo "Cannot execute '${rb}'"
+        exit 1
+    fi
+
+    # a script that fails would only time the error message
+    for script in "${tmp_dir}/startup.Rev" "${tmp_dir}/short_job.Rev"
+    do
+        if "${rb}" "${script}" < /dev/null 2>&1 | grep -q "Error:" ; then
+            echo "'${rb}' could not run $(basename "${script}")"
+            exit 1
+        fi
+    done
+
+    echo "${rb} (${runs} runs per script):"
+    echo "  startup    : $(time_script "${rb}" "${tmp_dir}/startup.Rev") ms per run"
+    echo "  short job  : $(time_script "${rb}" "${tmp_dir}/short_job.Rev") ms per run"
+done
@@ -1,6 +1,8 @@
 #include <stddef.h>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
 #include "DagNode.h"
@@ -9,6 +11,8 @@
 #include "Cloneable.h"
 #include "Model.h"
 #include "Parallelizable.h"
+#include "StringUtilities.h"
+#include "ThreadPool.h"
 
 
 using namespace RevBayesCore;
@@ -78,9 +82,6 @@ void BootstrapAnalysis::runAll(double epsilon)
     // disable all the screen monitors
     mle_analysis->disableScreenMonitors( true );
     
-    // start the monitors
-    mle_analysis->startMonitors();
-    
     // print some information to the screen but only if we are the active process
     if ( process_active )
     {
@@ -93,42 +94,115 @@ void BootstrapAnalysis::runAll(double epsilon)
     size_t run_block_end   = size_t(floor( (double(pid+1) / num_processes ) * num_runs) );
     //    size_t stone_block_size  = stone_block_end - stone_block_start;
     
-    // Run the chain
-    for (size_t i = run_block_start; i < run_block_end; ++i)
+    // the runs of this process are split into contiguous blocks, one for each thread.
+    // if there is more than one block, then each block uses its own copy of the analysis
+    // and its monitors write to their own files (with the extension '_worker_k').
+    size_t num_sims    = run_block_end - run_block_start;
+    size_t num_workers = std::min( ThreadPool::threadPoolInstance().getNumberOfThreads(), num_sims );
+    if ( ThreadPool::threadPoolInstance().isInsideParallelRegion() == true && num_workers > 1 )
+    {
+        // nested parallel regions run serially anyway
+        num_workers = 1;
+    }
+    
+    std::vector<MaximumLikelihoodAnalysis*> worker_analyses( std::max( num_workers, size_t(1) ), mle_analysis );
+    if ( num_workers > 1 )
+    {
+        for (size_t w = 0; w < num_workers; ++w)
+        {
+            worker_analyses[w] = mle_analysis->clone();
+            worker_analyses[w]->addFileMonitorExtension( "_worker_" + StringUtilities::to_string(w+1), false );
+        }
+    }
+    
+    try
     {
+        // start the monitors
+        for (size_t w = 0; w < worker_analyses.size(); ++w)
+        {
+            worker_analyses[w]->startMonitors();
+        }
         
-        // run the i-th stone
-        runSim(i, epsilon);
+        // Run the chain
+        runConcurrently( num_workers, [&](size_t w)
+        {
+            
+            size_t worker_block_start = run_block_start + (w * num_sims) / num_workers;
+            size_t worker_block_end   = run_block_start + ((w+1) * num_sims) / num_workers;
+            for (size_t i = worker_block_start; i < worker_block_end; ++i)
+            {
+                
+                // run the i-th stone
+                runSim(*worker_analyses[w], i, epsilon);
+                
+            }
+            
+        });
         
+        // close the monitors
+        for (size_t w = 0; w < worker_analyses.size(); ++w)
+        {
+            worker_analyses[w]->finishMonitors();
+        }
+    }
+    catch (...)
+    {
+        if ( num_workers > 1 )
+        {
+            for (size_t w = 0; w < num_workers; ++w)
+            {
+                delete worker_analyses[w];
+            }
+        }
+        throw;
     }
     
-    
-    // close the monitors
-    mle_analysis->finishMonitors();
+    if ( num_workers > 1 )
+    {
+        for (size_t w = 0; w < num_workers; ++w)
+        {
+            delete worker_analyses[w];
+        }
+    }
     
 }
 
 
 
 void BootstrapAnalysis::runSim(size_t idx, double epsilon)
+{
+    
+    runSim(*mle_analysis, idx, epsilon);
+    
+}
+
+
+/**
+ * Run the bootstrap replicate with index idx using the given analysis.
+ */
+void BootstrapAnalysis::runSim(MaximumLikelihoodAnalysis &analysis, size_t idx, double epsilon)
 {
     // print some info
+    // we write the line at once, so that the lines of concurrently running analyses do not interleave
     if ( process_active )
     {
         size_t digits = size_t( ceil( log10( num_runs ) ) );
-        std::cout << "Sim ";
+        std::stringstream ss;
+        ss << "Sim ";
         for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
         {
-            std::cout << " ";
+            ss << " ";
         }
-        std::cout << (idx+1) << " / " << num_runs;
-        std::cout << "\t\t";
+        ss << (idx+1) << " / " << num_runs;
+        ss << "\t\t";
         
-        std::cout << std::endl;
+        ss << "\n";
+        std::cout << ss.str();
+        std::cout.flush();
     }
     
     // get the model of the analysis
-    Model& current_model = mle_analysis->getModel();
+    Model& current_model = analysis.getModel();
     
     // get the DAG nodes of the model
     std::vector<DagNode *> current_ordered_nodes = current_model.getOrderedStochasticNodes();
@@ -147,10 +221,10 @@ void BootstrapAnalysis::runSim(size_t idx, double epsilon)
     
     
     // now run the analysis
-    mle_analysis->run(epsilon, false);
+    analysis.run(epsilon, false);
     
     // save the estimate
-    mle_analysis->monitor( idx );
+    analysis.monitor( idx );
     
     
 //    for (size_t j = 0; j < current_ordered_nodes.size(); ++j)
@@ -39,6 +39,8 @@ namespace RevBayesCore {
         
     private:
         
+        void                                    runSim(MaximumLikelihoodAnalysis &a, size_t idx, double e);
+        
         // members
         size_t                                  num_runs;
         MaximumLikelihoodAnalysis*              mle_analysis;
@@ -125,22 +125,22 @@ HillClimber& HillClimber::operator=(const HillClimber &m)
 }
 
 
-///**
-// * Add an extension to the name of the monitor.
-// * We tell this to all our monitors.
-// */
-//void HillClimber::addFileMonitorExtension(const std::string &s, bool dir)
-//{
-//
-//    // tell each monitor
-//    for (RbIterator<Monitor> it=monitors.begin(); it!=monitors.end(); ++it)
-//    {
-//        it->addFileExtension( s, dir );
-//    }
-//
-//}
-//
-//
+/**
+ * Add an extension to the name of the monitor.
+ * We tell this to all our monitors.
+ */
+void HillClimber::addFileMonitorExtension(const std::string &s, bool dir)
+{
+
+    // tell each monitor
+    for (RbIterator<Monitor> it=monitors.begin(); it!=monitors.end(); ++it)
+    {
+        it->addFileExtension( s, dir );
+    }
+
+}
+
+
 //void HillClimber::addMonitor(const Monitor &m)
 //{
 //
@@ -30,7 +30,7 @@ namespace RevBayesCore {
         HillClimber&                                        operator=(const HillClimber &m);                                                               //!< Overloaded assignment operator
         
         // public methods
-//        void                                                addFileMonitorExtension(const std::string &s, bool dir);
+        void                                                addFileMonitorExtension(const std::string &s, bool dir);
 //        void                                                addMonitor(const Monitor &m);
         void                                                disableScreenMonitor(void);                                                             //!< Disable/remove all screen monitors
         HillClimber*                                        clone(void) const;
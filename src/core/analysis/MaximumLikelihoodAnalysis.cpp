@@ -93,6 +93,17 @@ MaximumLikelihoodAnalysis* MaximumLikelihoodAnalysis::clone( void ) const
 }
 
 
+/**
+ * Add an extension to the file names of the monitors of the estimator.
+ */
+void MaximumLikelihoodAnalysis::addFileMonitorExtension(const std::string &s, bool dir)
+{
+    
+    estimator->addFileMonitorExtension( s, dir );
+    
+}
+
+
 void MaximumLikelihoodAnalysis::disableScreenMonitors(bool all)
 {
 
@@ -38,7 +38,7 @@ namespace RevBayesCore {
         MaximumLikelihoodAnalysis&                          operator=(const MaximumLikelihoodAnalysis &a);
         
         // public methods
-//        void                                                addFileMonitorExtension(const std::string &s, bool dir);
+        void                                                addFileMonitorExtension(const std::string &s, bool dir);
 //        void                                                addMonitor(const Monitor &m);
         MaximumLikelihoodAnalysis*                          clone(void) const;                                              //!< Clone function. This is similar to the copy constructor but useful in inheritance.
         void                                                disableScreenMonitors(bool all);
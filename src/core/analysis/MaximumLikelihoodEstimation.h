@@ -39,7 +39,7 @@ namespace RevBayesCore {
         virtual                                ~MaximumLikelihoodEstimation(void);                            //!< Virtual destructor
         
         // pure virtual public methods
-//        virtual void                            addFileMonitorExtension(const std::string &s, bool dir) = 0;
+        virtual void                            addFileMonitorExtension(const std::string &s, bool dir) = 0;
 //        virtual void                            addMonitor(const Monitor &m) = 0;
         virtual void                            disableScreenMonitor(void) = 0;                     //!< Disable/remove all screen monitors
         virtual MaximumLikelihoodEstimation*    clone(void) const = 0;
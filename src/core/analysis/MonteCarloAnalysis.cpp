@@ -58,6 +58,7 @@ MonteCarloAnalysis::MonteCarloAnalysis(MonteCarloSampler *m, size_t r, MonteCarl
 MonteCarloAnalysis::MonteCarloAnalysis(const MonteCarloAnalysis &a) : Cloneable(), Parallelizable(a),
     replicates( a.replicates ),
     runs(a.replicates,NULL),
+    replicate_rngs( a.replicate_rngs ),
     trace_combination( a.trace_combination )
 {
     
@@ -113,6 +114,7 @@ MonteCarloAnalysis& MonteCarloAnalysis::operator=(const MonteCarloAnalysis &a)
         runs = std::vector<MonteCarloSampler*>(a.replicates,NULL);
         
         replicates          = a.replicates;
+        replicate_rngs      = a.replicate_rngs;
         trace_combination   = a.trace_combination;
         
         // create replicate Monte Carlo samplers
@@ -218,7 +220,8 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
             progress.update(k);
         }
         
-        for (size_t i=0; i<replicates; ++i)
+        // the replicates are independent, so we advance them concurrently
+        runConcurrently( replicates, [&](size_t i)
         {
             
             if ( runs[i] != NULL )
@@ -233,7 +236,7 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
                 
             }
             
-        }
+        }, replicate_rngs );
         
     }
     
@@ -315,7 +318,8 @@ const Model& MonteCarloAnalysis::getModel( void ) const
 void MonteCarloAnalysis::initializeFromCheckpoint(const path &checkpoint_file)
 {
     
-    for (size_t i = 0; i < replicates; ++i)
+    // each replicate restores the state of its own random number stream
+    runConcurrently( replicates, [&](size_t i)
     {
         // first, set the checkpoint filename for the run
         if ( replicates > 1 && checkpoint_file != "" )
@@ -339,7 +343,7 @@ void MonteCarloAnalysis::initializeFromCheckpoint(const path &checkpoint_file)
         
         // then, initialize the sample for that replicate
         runs[i]->initializeSamplerFromCheckpoint();
-    }
+    }, replicate_rngs );
 }
 
 
@@ -463,6 +467,8 @@ void MonteCarloAnalysis::resetReplicates( void )
         
     }
     
+    // the random number streams will be reseeded when the replicates run next
+    replicate_rngs.clear();
     
     if ( m == NULL )
     {
@@ -732,15 +738,15 @@ void MonteCarloAnalysis::run( size_t kIterations, RbVector<StoppingRule> rules,
     do {
         
         ++gen;
-        for (size_t i=0; i<replicates; ++i)
+        
+        // the replicates are independent, so we advance them concurrently
+        // Sebastian: this call is very slow; a lot of work happens in nextCycle()
+        runConcurrently( replicates, [&](size_t i)
         {
             
             if ( runs[i] != NULL )
             {
                 
-                // @todo: #thread
-                // This part should be done on several threads if possible
-                // Sebastian: this call is very slow; a lot of work happens in nextCycle()
                 runs[i]->nextCycle(true);
                 
                 // Monitor
@@ -764,7 +770,7 @@ void MonteCarloAnalysis::run( size_t kIterations, RbVector<StoppingRule> rules,
                 
             }
             
-        }
+        }, replicate_rngs );
         
         converged = true;
         size_t numConvergenceRules = 0;
@@ -933,7 +939,9 @@ void MonteCarloAnalysis::runPriorSampler( size_t kIterations, RbVector<StoppingR
     bool converged = false;
     do {
         ++gen;
-        for (size_t i=0; i<replicates; ++i)
+        
+        // the replicates are independent, so we advance them concurrently
+        runConcurrently( replicates, [&](size_t i)
         {
             if ( runs[i] != NULL )
             {
@@ -951,7 +959,7 @@ void MonteCarloAnalysis::runPriorSampler( size_t kIterations, RbVector<StoppingR
                 }
             }
 
-        }
+        }, replicate_rngs );
         
         converged = true;
         size_t numConvergenceRules = 0;
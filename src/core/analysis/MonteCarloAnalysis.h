@@ -5,6 +5,7 @@
 #include "MonteCarloAnalysisOptions.h"
 #include "RbFileManager.h"
 #include "Parallelizable.h"
+#include "RandomNumberGenerator.h"
 #include "RbVector.h"
 #include "StoppingRule.h"
 #include "Trace.h"
@@ -26,6 +27,8 @@ namespace RevBayesCore {
      *
      * The Monte Carlo Analysis object is mostly used to run independent MonteCarloSamplers
      * and check for convergence between them.
+     * The replicates of this process are advanced concurrently on threads, one generation at a time,
+     * and each replicate uses its own random number stream.
      *
      *
      * @copyright Copyright 2009-
@@ -81,6 +84,7 @@ namespace RevBayesCore {
 
         size_t                                              replicates;
         std::vector<MonteCarloSampler*>                     runs;
+        std::vector<RandomNumberGenerator>                  replicate_rngs;                                                 //!< The random number streams of the replicates
         MonteCarloAnalysisOptions::TraceCombinationTypes    trace_combination;
     };
     
@@ -1,6 +1,8 @@
 #include <stddef.h>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -18,6 +20,7 @@
 #include "RbVector.h"
 #include "RbVectorImpl.h"
 #include "StoppingRule.h"
+#include "ThreadPool.h"
 
 #ifdef RB_MPI
 #include <mpi.h>
@@ -115,67 +118,104 @@ void PosteriorPredictiveAnalysis::runAll(size_t gen)
     MPI_Comm_split(MPI_COMM_WORLD, active_proc, pid, &analysis_comm);
 #endif
 
-    for ( size_t i = run_pid_start; i < run_pid_end; ++i)
+#ifdef RB_MPI
+    // the analyses share the communicator, so we run them one after the other
+    size_t batch_size = 1;
+#else
+    // we run a batch of analyses concurrently, one for each thread
+    size_t batch_size = std::max( size_t(1), ThreadPool::threadPoolInstance().getNumberOfThreads() );
+#endif
+    
+    for ( size_t batch_start = run_pid_start; batch_start < run_pid_end; batch_start += batch_size)
     {
+        size_t batch_end = std::min( batch_start + batch_size, run_pid_end );
         
-//        size_t run_pid_start = size_t(floor( double(i) / num_processes * num_runs ) );
-//        size_t run_pid_end   = std::max( int(run_pid_start), int(floor( double(i+1) / num_processes * num_runs ) ) - 1);
-        
-        // create an independent copy of the analysis
-        MonteCarloAnalysis *current_analysis = template_sampler.clone();
-
-        // get the model of the analysis
-        Model* current_model = current_analysis->getModel().clone();
-        
-        // get the DAG nodes of the model
-        std::vector<DagNode*> &current_nodes = current_model->getDagNodes();
-        
-        // initialize values from files
-        for (size_t j = 0; j < current_nodes.size(); ++j)
+        // the analyses are set up one after the other, because this draws random numbers
+        std::vector<MonteCarloAnalysis*> batch_analyses;
+        for ( size_t i = batch_start; i < batch_end; ++i)
         {
-            DagNode *the_node = current_nodes[j];
-            if ( the_node->isClamped() == true )
+            
+            // create an independent copy of the analysis
+            MonteCarloAnalysis *current_analysis = template_sampler.clone();
+            batch_analyses.push_back( current_analysis );
+            
+            // get the model of the analysis
+            Model* current_model = current_analysis->getModel().clone();
+            
+            // get the DAG nodes of the model
+            std::vector<DagNode*> &current_nodes = current_model->getDagNodes();
+            
+            // initialize values from files
+            for (size_t j = 0; j < current_nodes.size(); ++j)
             {
-                the_node->setValueFromFile( dir_names[i] );
-            }
+                DagNode *the_node = current_nodes[j];
+                if ( the_node->isClamped() == true )
+                {
+                    the_node->setValueFromFile( dir_names[i] );
+                }
                 
-        }
-
-        // now set the model of the current analysis
+            }
+            
+            // now set the model of the current analysis
 #ifdef RB_MPI
-        current_analysis->setModel( current_model, false, analysis_comm );
+            current_analysis->setModel( current_model, false, analysis_comm );
 #else
-        current_analysis->setModel( current_model, false );
+            current_analysis->setModel( current_model, false );
 #endif
+            
+            // disable the screen monitor
+            current_analysis->disableScreenMonitors( true );
+            
+            // set the monitor index
+            current_analysis->addFileMonitorExtension( dir_names[i].filename().string(), true);
+            
+        }
         
-        // disable the screen monitor
-        current_analysis->disableScreenMonitors( true );
-
-        // set the monitor index
-        current_analysis->addFileMonitorExtension( dir_names[i].filename().string(), true);
-                    
-        // print some info
-        if ( process_active == true )
+        try
         {
-            size_t digits = size_t( ceil( log10( num_runs ) ) );
-            std::cout << "Sim ";
-            for (size_t d = size_t( ceil( log10( i+1.1 ) ) ); d < digits; ++d )
+            runConcurrently( batch_end - batch_start, [&](size_t j)
             {
-                std::cout << " ";
-            }
-            std::cout << (i+1) << " / " << num_runs;
-            std::cout << std::endl;
-        }
-        
-        // run the i-th analysis
+                size_t i = batch_start + j;
+                
+                // print some info
+                // we write the line at once, so that the lines of concurrently running analyses do not interleave
+                if ( process_active == true )
+                {
+                    size_t digits = size_t( ceil( log10( num_runs ) ) );
+                    std::stringstream ss;
+                    ss << "Sim ";
+                    for (size_t d = size_t( ceil( log10( i+1.1 ) ) ); d < digits; ++d )
+                    {
+                        ss << " ";
+                    }
+                    ss << (i+1) << " / " << num_runs << "\n";
+                    std::cout << ss.str();
+                    std::cout.flush();
+                }
+                
+                // run the i-th analysis
 #ifdef RB_MPI
-        runSim(current_analysis, gen, analysis_comm);
+                runSim(batch_analyses[j], gen, analysis_comm);
 #else
-        runSim(current_analysis, gen);
+                runSim(batch_analyses[j], gen);
 #endif
                 
+            });
+        }
+        catch (...)
+        {
+            for (size_t j = 0; j < batch_analyses.size(); ++j)
+            {
+                delete batch_analyses[j];
+            }
+            throw;
+        }
+        
         // free memory
-        delete current_analysis;
+        for (size_t j = 0; j < batch_analyses.size(); ++j)
+        {
+            delete batch_analyses[j];
+        }
         
     }
     
@@ -1,6 +1,8 @@
 #include <stddef.h>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -15,6 +17,7 @@
 #include "MonteCarloAnalysisOptions.h"
 #include "Parallelizable.h"
 #include "StringUtilities.h"
+#include "ThreadPool.h"
 
 
 #ifdef RB_MPI
@@ -189,13 +192,53 @@ void PowerPosteriorAnalysis::runAll(size_t gen, double burnin_fraction, size_t p
     size_t stone_block_start =  floor( ( floor( pid   /double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * powers.size() );
     size_t stone_block_end   =  floor( ( ceil( (pid+1)/double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * powers.size() );
     
+    // the stones of this process are split into contiguous blocks, one for each thread.
+    // within a block, each stone starts from the last state of the previous stone, as before.
+    // the first block uses our sampler and the other blocks use copies of it.
+    size_t num_stones  = stone_block_end - stone_block_start;
+    size_t num_workers = std::min( ThreadPool::threadPoolInstance().getNumberOfThreads(), num_stones );
+    if ( ThreadPool::threadPoolInstance().isInsideParallelRegion() == true && num_workers > 1 )
+    {
+        // nested parallel regions run serially anyway
+        num_workers = 1;
+    }
+    
+    std::vector<MonteCarloSampler*> worker_samplers( num_workers, sampler );
+    for (size_t w = 1; w < num_workers; ++w)
+    {
+        worker_samplers[w] = sampler->clone();
+    }
+    
     // Run the chain
-    for (size_t i = stone_block_start; i < stone_block_end; ++i)
+    try
     {
+        runConcurrently( num_workers, [&](size_t w)
+        {
+            
+            size_t worker_block_start = stone_block_start + (w * num_stones) / num_workers;
+            size_t worker_block_end   = stone_block_start + ((w+1) * num_stones) / num_workers;
+            for (size_t i = worker_block_start; i < worker_block_end; ++i)
+            {
+                
+                // run the i-th stone
+                runStone(*worker_samplers[w], i, gen, burnin_fraction, pre_burnin_generations, tuning_interval, num_workers == 1);
+                
+            }
+            
+        });
+    }
+    catch (...)
+    {
+        for (size_t w = 1; w < num_workers; ++w)
+        {
+            delete worker_samplers[w];
+        }
+        throw;
+    }
     
-        // run the i-th stone
-        runStone(i, gen, burnin_fraction, pre_burnin_generations, tuning_interval);
-        
+    for (size_t w = 1; w < num_workers; ++w)
+    {
+        delete worker_samplers[w];
     }
     
 #ifdef RB_MPI
@@ -218,6 +261,18 @@ void PowerPosteriorAnalysis::runAll(size_t gen, double burnin_fraction, size_t p
 
 
 void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_fraction, size_t pre_burnin_generations, size_t tuning_interval)
+{
+    
+    runStone(*sampler, idx, gen, burnin_fraction, pre_burnin_generations, tuning_interval, true);
+    
+}
+
+
+/**
+ * Run the stone with index idx using the given sampler.
+ * If the stones run concurrently, then we do not print the progress bar but only a single line once the stone has finished.
+ */
+void PowerPosteriorAnalysis::runStone(MonteCarloSampler &stone_sampler, size_t idx, size_t gen, double burnin_fraction, size_t pre_burnin_generations, size_t tuning_interval, bool print_progress)
 {
     // create the directory if necessary
     if (filename.filename().empty() or filename.filename_is_dot() or filename.filename_is_dot_dot())
@@ -234,7 +289,7 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
     outStream << "state\t" << "power\t" << "likelihood" << std::endl;
 
     // reset the sampler
-    sampler->reset();
+    stone_sampler.reset();
 
     size_t burnin = size_t( ceil( burnin_fraction*gen ) );
     
@@ -242,47 +297,50 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
     size_t digits = size_t( ceil( log10( powers.size() ) ) );
     
     // print output for users
-    if ( process_active ==true )
+    std::stringstream step;
+    step << "Step ";
+    for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
     {
-        std::cout << "Step ";
-        for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
-        {
-            std::cout << " ";
-        }
-        std::cout << (idx+1) << " / " << powers.size();
-        std::cout << "\t\t";
+        step << " ";
+    }
+    step << (idx+1) << " / " << powers.size();
+    step << "\t\t";
+    
+    if ( process_active == true && print_progress == true )
+    {
+        std::cout << step.str();
         std::cout.flush();
     }
     
     // set the power of this sampler
-    sampler->setLikelihoodHeat( powers[idx] );
+    stone_sampler.setLikelihoodHeat( powers[idx] );
     
-    sampler->addFileMonitorExtension( stone_tag, false);
+    stone_sampler.addFileMonitorExtension( stone_tag, false);
     
     // let's do a pre-burnin
     for (size_t k=1; k<=pre_burnin_generations; k++)
     {
         
-        sampler->nextCycle(false);
+        stone_sampler.nextCycle(false);
         
         // check for autotuning
         if ( k % tuning_interval == 0 && k != pre_burnin_generations )
         {
-            sampler->tune();
+            stone_sampler.tune();
         }
         
     }
     
     // Monitor
-    sampler->startMonitors(gen, false);
-    sampler->writeMonitorHeaders( false );
-    sampler->monitor(0);
+    stone_sampler.startMonitors(gen, false);
+    stone_sampler.writeMonitorHeaders( false );
+    stone_sampler.monitor(0);
     
     double p = powers[idx];
     for (size_t k=1; k<=gen; ++k)
     {
         
-        if ( process_active == true )
+        if ( process_active == true && print_progress == true )
         {
             if ( k % printInterval == 0 )
             {
@@ -291,30 +349,37 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen, double burnin_frac
             }
         }
         
-        sampler->nextCycle( true );
+        stone_sampler.nextCycle( true );
 
         // Monitor
-        sampler->monitor(k);
+        stone_sampler.monitor(k);
         
         // sample the likelihood
         if ( k > burnin && k % sampleFreq == 0 )
         {
             // compute the joint likelihood
-            double likelihood = sampler->getModelLnProbability(true);
+            double likelihood = stone_sampler.getModelLnProbability(true);
             outStream << k << "\t" << p << "\t" << likelihood << std::endl;
         }
             
     }
     
-    if ( process_active == true )
+    if ( process_active == true && print_progress == true )
     {
         std::cout << std::endl;
     }
+    else if ( process_active == true )
+    {
+        // a single write, so that the lines of concurrently running stones do not interleave
+        step << "done\n";
+        std::cout << step.str();
+        std::cout.flush();
+    }
     
     outStream.close();
     
     // Monitor
-    sampler->finishMonitors( 1, MonteCarloAnalysisOptions::NONE );
+    stone_sampler.finishMonitors( 1, MonteCarloAnalysisOptions::NONE );
     
 }
 
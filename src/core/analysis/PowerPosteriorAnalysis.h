@@ -44,6 +44,7 @@ namespace RevBayesCore {
     private:
         
         void                                    initMPI(void);
+        void                                    runStone(MonteCarloSampler &s, size_t idx, size_t g, double burn_frac, size_t preburn_gen, size_t tune_int, bool print_progress);
         
         // members
         path                                    filename;
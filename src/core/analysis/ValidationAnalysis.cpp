@@ -1,7 +1,10 @@
 #include <stddef.h>
 #include <cmath>
 #include <algorithm>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -233,8 +236,11 @@ void ValidationAnalysis::burnin(size_t generations, size_t tuningInterval)
     }
     
     // Run the chain
-    for (size_t i = run_block_start; i <= run_block_end; ++i)
+    std::mutex progress_mutex;
+    size_t num_finished_runs = 0;
+    std::function<void(size_t)> burnin_run = [&](size_t j)
     {
+        size_t i = run_block_start + j;
         if ( runs[i] == NULL ) std::cerr << "Runing bad burnin (pid=" << pid <<", run="<< i << ") of runs.size()=" << runs.size() << "." << std::endl;
         // run the i-th analyses
 #ifdef RB_MPI
@@ -244,12 +250,25 @@ void ValidationAnalysis::burnin(size_t generations, size_t tuningInterval)
 #endif
         if ( process_active == true )
         {
-            progress.update( i );
+            std::lock_guard<std::mutex> lock( progress_mutex );
+            ++num_finished_runs;
+            progress.update( num_finished_runs );
             
         }
         
         
+    };
+    
+#ifdef RB_MPI
+    // the analyses synchronize on MPI_COMM_WORLD, so we run them one after the other
+    for (size_t j = 0; j <= run_block_end - run_block_start; ++j)
+    {
+        burnin_run( j );
     }
+#else
+    // the analyses are independent, so we run them concurrently, each one with its own random number stream
+    runConcurrently( run_block_end - run_block_start + 1, burnin_run );
+#endif
     
     if ( process_active == true )
     {
@@ -285,13 +304,25 @@ void ValidationAnalysis::runAll(size_t gen)
     size_t run_block_end   = std::max( int(run_block_start), int(floor( (double(pid+1) / num_processes ) * num_runs) ) - 1);
     
     // Run the chain
+#ifdef RB_MPI
+    // the analyses synchronize on MPI_COMM_WORLD, so we run them one after the other
     for (size_t i = run_block_start; i <= run_block_end; ++i)
     {
         
         // run the i-th stone
         runSim(i, gen);
         
-    }    
+    }
+#else
+    // the analyses are independent, so we run them concurrently, each one with its own random number stream
+    runConcurrently( run_block_end - run_block_start + 1, [&](size_t j)
+    {
+        
+        // run the i-th stone
+        runSim(run_block_start + j, gen);
+        
+    });
+#endif
     
 }
 
@@ -306,16 +337,20 @@ void ValidationAnalysis::runSim(size_t idx, size_t gen)
     // print some info
     if ( process_active )
     {
+        // we write the line at once, so that the lines of concurrently running analyses do not interleave
         size_t digits = size_t( ceil( log10( num_runs ) ) );
-        std::cout << "Sim ";
+        std::stringstream ss;
+        ss << "Sim ";
         for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
         {
-            std::cout << " ";
+            ss << " ";
         }
-        std::cout << (idx+1) << " / " << num_runs;
-        std::cout << "\t\t";
+        ss << (idx+1) << " / " << num_runs;
+        ss << "\t\t";
         
-        std::cout << std::endl;
+        ss << "\n";
+        std::cout << ss.str();
+        std::cout.flush();
     }
     
     // get the current sample
@@ -7,10 +7,13 @@
 #include <utility>
 #include <vector>
 
+#include "CheckpointFile.h"
 #include "DagNode.h"
 #include "Mcmc.h"
 #include "MoveSchedule.h"
 #include "RandomMoveSchedule.h"
+#include "RandomNumberFactory.h"
+#include "RandomNumberGenerator.h"
 #include "RbConstants.h"
 #include "RbException.h"
 #include "RbMathLogic.h"
@@ -30,7 +33,10 @@
 #include "RbIteratorImpl.h"
 #include "RbVector.h"
 #include "RbVectorImpl.h"
+#include "StochasticNode.h"
 #include "StringUtilities.h"
+#include "Tree.h"
+#include "TypedDagNode.h"
 
 #ifdef RB_MPI
 #include <mpi.h>
@@ -40,6 +46,14 @@
 using namespace RevBayesCore;
 
 
+namespace {
+
+    // how the value of a variable is stored in the checkpoint file
+    enum CheckpointValueType { CHECKPOINT_REAL = 0, CHECKPOINT_REAL_VECTOR = 1, CHECKPOINT_STRING = 2 };
+
+}
+
+
 /**
  * Constructor. We create an independent copy of the model and thus of all DAG nodes.
  * Someone might have wanted to run another MCMC with different settings on the same model.
@@ -198,102 +212,79 @@ Mcmc* Mcmc::clone( void ) const
 }
 
 
+/**
+ * Write the current state of the sampler into the binary checkpoint file.
+ *
+ * The checkpoint contains the generation, the heats of this chain, the state of the random number generator,
+ * the counters and tuning parameters of the moves, and the values of all variables.
+ * Real numbers and vectors of real numbers are stored in binary, all other values in their complex storing format.
+ * Thus, resuming from the checkpoint continues the run exactly where we stopped.
+ */
 void Mcmc::checkpoint( void ) const
 {
-    // initialize variables
-    std::string separator = "\t";
-    bool flatten = true;
     
-    createDirectoryForFile( checkpoint_file_name );
+    // the file is written to a temporary file first and only replaces the old checkpoint once it is complete
+    CheckpointFileWriter out( checkpoint_file_name );
     
-    // open the stream to the file
-    std::ofstream out_stream( checkpoint_file_name.string() );
-
-    // first, we write the names of the variables
-    for (std::vector<DagNode *>::const_iterator it=variable_nodes.begin(); it!=variable_nodes.end(); ++it)
+    // first, the state of the sampler
+    out.writeUnsigned( generation );
+    out.writeDouble( chain_likelihood_heat );
+    out.writeDouble( chain_posterior_heat );
+    out.writeDouble( chain_prior_heat );
+    out.writeString( GLOBAL_RNG->getState() );
+    
+    // second, the moves and their tuning information
+    out.writeUnsigned( moves.size() );
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        out.writeString( moves[i].getMoveName() );
+        out.writeString( moves[i].getDagNodes()[0]->getName() );
+        out.writeUnsigned( moves[i].getNumberTriedCurrentPeriod() );
+        out.writeUnsigned( moves[i].getNumberTriedTotal() );
+        out.writeUnsigned( moves[i].getNumberAcceptedCurrentPeriod() );
+        out.writeUnsigned( moves[i].getNumberAcceptedTotal() );
+        out.writeDouble( moves[i].getMoveTuningParameter() );
+    }
+    
+    // third, the values of the variables
+    out.writeUnsigned( variable_nodes.size() );
+    for (std::vector<DagNode*>::const_iterator it = variable_nodes.begin(); it != variable_nodes.end(); ++it)
     {
-        // add a separator before every new element
-        if ( it != variable_nodes.begin() )
+        const DagNode *the_node = *it;
+        out.writeString( the_node->getName() );
+        
+        const TypedDagNode<double> *real_node = dynamic_cast< const TypedDagNode<double>* >( the_node );
+        const TypedDagNode<RbVector<double> > *real_vector_node = dynamic_cast< const TypedDagNode<RbVector<double> >* >( the_node );
+        const TypedDagNode<Tree> *tree_node = dynamic_cast< const TypedDagNode<Tree>* >( the_node );
+        if ( real_node != NULL )
         {
-            out_stream << separator;
+            out.writeUnsigned( CHECKPOINT_REAL );
+            out.writeDouble( real_node->getValue() );
         }
-        
-        const DagNode* the_node = *it;
-        
-        // print the header
-        if (the_node->getName() != "")
+        else if ( real_vector_node != NULL )
         {
-            the_node->printName(out_stream,separator, -1, true, flatten);
+            out.writeUnsigned( CHECKPOINT_REAL_VECTOR );
+            out.writeDoubles( real_vector_node->getValue() );
         }
-        else
+        else if ( tree_node != NULL )
         {
-            out_stream << "Unnamed";
+            // the usual newick output is rounded, so we write the branch lengths with all digits
+            out.writeUnsigned( CHECKPOINT_STRING );
+            out.writeString( tree_node->getValue().getExactNewickRepresentation() );
         }
-        
-    }
-    out_stream << std::endl;
-    
-    
-    // second, we write the values of the variables
-    for (std::vector<DagNode*>::const_iterator it = variable_nodes.begin(); it != variable_nodes.end(); ++it)
-    {
-        // add a separator before every new element
-        if ( it != variable_nodes.begin() )
+        else
         {
-            out_stream << separator;
+            std::stringstream ss;
+            the_node->printValue(ss, ",", -1, false, false, false, false);
+            
+            out.writeUnsigned( CHECKPOINT_STRING );
+            out.writeString( ss.str() );
         }
-        
-        // get the node
-        DagNode *node = *it;
-        
-        // print the value
-        node->printValue(out_stream, separator, -1, false, false, false, flatten);
     }
     
+    // replace the old checkpoint file
+    out.commit();
     
-    // clean up
-    out_stream.close();
-    
-    
-    /////////
-    // Now we also write the MCMC information into a file
-    /////////
-
-    // assemble the new filename
-    path mcmc_checkpoint_file_name = appendToStem(checkpoint_file_name, "_mcmc");
-    
-    // open the stream to the file
-    std::ofstream out_stream_mcmc( mcmc_checkpoint_file_name.string() );
-    out_stream_mcmc << "iter = " << generation << std::endl;
-    
-    // clean up
-    out_stream_mcmc.close();
-    
-    
-    /////////
-    // Next we also write the moves information into a file
-    /////////
-    
-    // assemble the new filename
-    path moves_checkpoint_file_name = appendToStem(checkpoint_file_name, "_moves");
-    
-    // open the stream to the file
-    std::ofstream out_stream_moves( moves_checkpoint_file_name.string() );
-    
-    for (size_t i = 0; i < moves.size(); ++i)
-    {
-        out_stream_moves << moves[i].getMoveName();
-        out_stream_moves << "(variable="                << moves[i].getDagNodes()[0]->getName();
-        out_stream_moves << ",num_tried_current="       << moves[i].getNumberTriedCurrentPeriod();
-        out_stream_moves << ",num_tried_total="         << moves[i].getNumberTriedTotal();
-        out_stream_moves << ",num_accepted_current="    << moves[i].getNumberAcceptedCurrentPeriod();
-        out_stream_moves << ",num_accepted_total="      << moves[i].getNumberAcceptedTotal();
-        out_stream_moves << ",tuning_value="            << moves[i].getMoveTuningParameter();
-        out_stream_moves << ")" << std::endl;
-    }
-    
-    // clean up
-    out_stream_moves.close();
 }
 
 
@@ -687,7 +678,144 @@ void Mcmc::initializeSampler( bool prior_only )
 }
 
 
+/**
+ * Initialize the sampler from the checkpoint file written by checkpoint().
+ * We restore the values of the variables, the moves, the heats, the generation and the random number generator,
+ * and tell the file monitors to append to their files.
+ * Checkpoints in the older text format are still read, but these do not contain the state of the random number generator.
+ */
 void Mcmc::initializeSamplerFromCheckpoint( void )
+{
+    
+    // check that the file/path name has been correctly specified
+    if ( not is_regular_file( checkpoint_file_name) )
+    {
+        std::string errorStr = "";
+        formatError( checkpoint_file_name, errorStr );
+        throw RbException(errorStr);
+    }
+    
+    if ( CheckpointFileReader::isCheckpointFile( checkpoint_file_name ) == false )
+    {
+        initializeSamplerFromTextCheckpoint();
+        return;
+    }
+    
+    CheckpointFileReader in( checkpoint_file_name );
+    
+    // first, the state of the sampler
+    size_t last_generation = in.readUnsigned();
+    chain_likelihood_heat  = in.readDouble();
+    chain_posterior_heat   = in.readDouble();
+    chain_prior_heat       = in.readDouble();
+    std::string rng_state  = in.readString();
+    
+    // second, the moves and their tuning information
+    size_t num_stored_moves = in.readUnsigned();
+    if ( moves.size() != num_stored_moves )
+    {
+        throw RbException("The number of stored moves from the checkpoint file doesn't match the number of moves for this MCMC analysis.");
+    }
+    
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        std::string move_name = in.readString();
+        std::string node_name = in.readString();
+        if ( moves[i].getMoveName() != move_name )
+        {
+            throw RbException("The order of the moves from the checkpoint file does not match.");
+        }
+        if ( moves[i].getDagNodes()[0]->getName() != node_name )
+        {
+            throw RbException("The order of the moves from the checkpoint file does not match. A move working on node '" + moves[i].getDagNodes()[0]->getName() + "' received a stored counterpart working on node '" + node_name + "'.");
+        }
+        
+        moves[i].setNumberTriedCurrentPeriod( in.readUnsigned() );
+        moves[i].setNumberTriedTotal( in.readUnsigned() );
+        moves[i].setNumberAcceptedCurrentPeriod( in.readUnsigned() );
+        moves[i].setNumberAcceptedTotal( in.readUnsigned() );
+        moves[i].setMoveTuningParameter( in.readDouble() );
+    }
+    
+    // third, the values of the variables
+    // the variables are matched by their position, because several variables may have the same (e.g., an empty) name
+    size_t num_stored_variables = in.readUnsigned();
+    if ( variable_nodes.size() != num_stored_variables )
+    {
+        throw RbException("The number of stored variables from the checkpoint file doesn't match the number of variables for this MCMC analysis.");
+    }
+    
+    for (size_t i = 0; i < num_stored_variables; ++i)
+    {
+        std::string name = in.readString();
+        size_t value_type = in.readUnsigned();
+        
+        DagNode *the_node = variable_nodes[i];
+        if ( the_node->getName() != name )
+        {
+            throw RbException("The order of the variables from the checkpoint file does not match. The variable '" + the_node->getName() + "' received the stored value of variable '" + name + "'.");
+        }
+        
+        if ( value_type == CHECKPOINT_REAL )
+        {
+            double x = in.readDouble();
+            StochasticNode<double> *real_node = dynamic_cast< StochasticNode<double>* >( the_node );
+            if ( real_node == NULL )
+            {
+                throw RbException("The variable '" + name + "' from the checkpoint file is not a real number in this MCMC analysis.");
+            }
+            real_node->getValue() = x;
+            real_node->setValue( &real_node->getValue() );
+        }
+        else if ( value_type == CHECKPOINT_REAL_VECTOR )
+        {
+            std::vector<double> x = in.readDoubles();
+            StochasticNode<RbVector<double> > *real_vector_node = dynamic_cast< StochasticNode<RbVector<double> >* >( the_node );
+            if ( real_vector_node == NULL )
+            {
+                throw RbException("The variable '" + name + "' from the checkpoint file is not a vector of real numbers in this MCMC analysis.");
+            }
+            real_vector_node->getValue() = RbVector<double>( x );
+            real_vector_node->setValue( &real_vector_node->getValue() );
+        }
+        else if ( value_type == CHECKPOINT_STRING )
+        {
+            std::string x = in.readString();
+            the_node->setValueFromString( x );
+        }
+        else
+        {
+            throw RbException() << "Unknown type of the variable '" << name << "' in the checkpoint file " << checkpoint_file_name << ".";
+        }
+        
+        the_node->keep();
+    }
+    
+    // we also need to tell our monitors to append after the last sample
+    // set iteration num
+    setCurrentGeneration( last_generation );
+    
+    for (size_t j = 0; j < monitors.size(); ++j)
+    {
+        if ( monitors[j].isFileMonitor() )
+        {
+            // set file monitors to append
+            AbstractFileMonitor* m = dynamic_cast< AbstractFileMonitor *>( &monitors[j] );
+            m->setAppend(true);
+        }
+    }
+    
+    // finally, continue with the same random numbers
+    GLOBAL_RNG->setState( rng_state );
+    
+}
+
+
+/**
+ * Initialize the sampler from a checkpoint in the old text format.
+ * The values are stored in a tab-separated file and the generation and the moves in the "_mcmc" and "_moves" files.
+ */
+void Mcmc::initializeSamplerFromTextCheckpoint( void )
 {
     
     //    size_t n_samples = traces[0].size();
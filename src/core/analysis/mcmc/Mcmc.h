@@ -85,6 +85,7 @@ namespace RevBayesCore {
     protected:
         void                                                resetVariableDagNodes(void);                                                //!< Extract the variable to be monitored again.
         void                                                initializeMonitors(void);                                                               //!< Assign model and mcmc ptrs to monitors
+        void                                                initializeSamplerFromTextCheckpoint(void);                                              //!< Initialize the sampler from a checkpoint in the old text format
         void                                                replaceDag(const RbVector<Move> &mvs, const RbVector<Monitor> &mons);
         void                                                setActivePIDSpecialized(size_t a, size_t n);                                            //!< Set the number of processes for this class.
 
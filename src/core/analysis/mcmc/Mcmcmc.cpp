@@ -7,6 +7,7 @@
 #include <functional>
 #include <string>
 
+#include "CheckpointFile.h"
 #include "DagNode.h"
 #include "MetropolisHastingsMove.h"
 #include "Mcmcmc.h"
@@ -28,6 +29,7 @@
 #include "RbVector.h"
 #include "RbVectorImpl.h"
 #include "StringUtilities.h"
+#include "ThreadPool.h"
 
 #ifdef RB_MPI
 #include <mpi.h>
@@ -192,6 +194,7 @@ Mcmcmc::Mcmcmc(const Mcmcmc &m) : MonteCarloSampler(m)
     num_attempted_swaps = m.num_attempted_swaps;
     num_accepted_swaps  = m.num_accepted_swaps;
     generation          = m.generation;
+    checkpoint_file_name = m.checkpoint_file_name;
     
     
     chains.clear();
@@ -212,6 +215,12 @@ Mcmcmc::Mcmcmc(const Mcmcmc &m) : MonteCarloSampler(m)
     heat_visitors           = m.heat_visitors;
     chain_moves_tuningInfo  = m.chain_moves_tuningInfo;
     
+    // copy the states of the random number streams
+    for (size_t i = 0; i < m.chain_rngs.size(); ++i)
+    {
+        chain_rngs.push_back( new RandomNumberGenerator( *m.chain_rngs[i] ) );
+    }
+    
     burnin_generation       = m.burnin_generation;
     current_generation      = m.current_generation;
     base_chain              = m.base_chain->clone();
@@ -229,6 +238,8 @@ Mcmcmc::~Mcmcmc(void)
     }
     chains.clear();
     delete base_chain;
+    
+    clearChainRandomNumberGenerators();
 }
 
 
@@ -260,6 +271,18 @@ void Mcmcmc::addMonitor(const Monitor &m)
 }
 
 
+void Mcmcmc::clearChainRandomNumberGenerators(void)
+{
+    
+    for (size_t i = 0; i < chain_rngs.size(); ++i)
+    {
+        delete chain_rngs[i];
+    }
+    chain_rngs.clear();
+    
+}
+
+
 double Mcmcmc::computeBeta(double d, size_t idx)
 {
     
@@ -273,6 +296,10 @@ Mcmcmc* Mcmcmc::clone(void) const
 }
 
 
+/**
+ * Write the checkpoint files of all chains, and our own checkpoint file with the heats of the chains,
+ * the swap statistics and the states of the random number generators.
+ */
 void Mcmcmc::checkpoint( void ) const
 {
     
@@ -286,6 +313,43 @@ void Mcmcmc::checkpoint( void ) const
         
     }
     
+    if ( process_active == true )
+    {
+        CheckpointFileWriter out( appendToStem(checkpoint_file_name, "_mcmcmc") );
+        
+        out.writeUnsigned( num_chains );
+        out.writeUnsigned( generation );
+        out.writeUnsigned( current_generation );
+        out.writeUnsigned( burnin_generation );
+        out.writeUnsigned( active_chain_index );
+        
+        for (size_t i = 0; i < num_chains; ++i)
+        {
+            out.writeDouble( chain_heats[i] );
+            out.writeUnsigned( heat_ranks[i] );
+            out.writeUnsigned( size_t(chain_prev_boundary[i]) );
+            out.writeUnsigned( chain_half_trips[i] );
+            out.writeUnsigned( heat_visitors[i].first );
+            out.writeUnsigned( heat_visitors[i].second );
+            
+            for (size_t j = 0; j < num_chains; ++j)
+            {
+                out.writeUnsigned( num_attempted_swaps[i][j] );
+                out.writeUnsigned( num_accepted_swaps[i][j] );
+            }
+        }
+        
+        // the random number streams of the chains only exist once the chains have been run
+        out.writeUnsigned( chain_rngs.size() );
+        for (size_t i = 0; i < chain_rngs.size(); ++i)
+        {
+            out.writeString( chain_rngs[i]->getState() );
+        }
+        out.writeString( GLOBAL_RNG->getState() );
+        
+        out.commit();
+    }
+    
 }
 
 
@@ -451,9 +515,39 @@ void Mcmcmc::initializeChains(void)
 }
 
 
+/**
+ * Create the random number streams for the chains.
+ * The seeds are drawn from the global random number generator, for all chains and independent of the process,
+ * so that all processes stay synchronized and a chain shared by several processes uses the same stream everywhere.
+ */
+void Mcmcmc::initializeChainRandomNumberGenerators(void)
+{
+    
+    if ( chain_rngs.size() == num_chains )
+    {
+        return;
+    }
+    
+    clearChainRandomNumberGenerators();
+    
+    RandomNumberGenerator* rng = GLOBAL_RNG;
+    for (size_t i = 0; i < num_chains; ++i)
+    {
+        unsigned int chain_seed = (unsigned int)( rng->uniform01() * RbConstants::Integer::max );
+        RandomNumberGenerator* chain_rng = new RandomNumberGenerator();
+        chain_rng->setSeed( chain_seed );
+        chain_rngs.push_back( chain_rng );
+    }
+    
+}
+
+
 void Mcmcmc::initializeSampler( bool priorOnly )
 {
     
+    // the random number streams will be reseeded at the next cycle
+    clearChainRandomNumberGenerators();
+    
     // initialize each chain
     for (size_t i = 0; i < num_chains; ++i)
     {
@@ -468,6 +562,10 @@ void Mcmcmc::initializeSampler( bool priorOnly )
 
 
 
+/**
+ * Initialize all chains from their checkpoint files, and restore the heats, the swap statistics and the random number generators.
+ * Checkpoints written by older versions do not have our own checkpoint file, in which case we only restore the chains.
+ */
 void Mcmcmc::initializeSamplerFromCheckpoint( void )
 {
     
@@ -476,11 +574,72 @@ void Mcmcmc::initializeSamplerFromCheckpoint( void )
             
         if ( chains[i] != NULL )
         {
-            chains[i]->checkpoint();
+            chains[i]->initializeSamplerFromCheckpoint();
         }
         
     }
     
+    path mcmcmc_checkpoint_file_name = appendToStem(checkpoint_file_name, "_mcmcmc");
+    if ( is_regular_file( mcmcmc_checkpoint_file_name ) == false )
+    {
+        return;
+    }
+    
+    CheckpointFileReader in( mcmcmc_checkpoint_file_name );
+    
+    if ( in.readUnsigned() != num_chains )
+    {
+        throw RbException("The number of chains in the checkpoint file doesn't match the number of chains for this MCMCMC analysis.");
+    }
+    generation          = in.readUnsigned();
+    current_generation  = in.readUnsigned();
+    burnin_generation   = in.readUnsigned();
+    active_chain_index  = in.readUnsigned();
+    
+    for (size_t i = 0; i < num_chains; ++i)
+    {
+        chain_heats[i]          = in.readDouble();
+        heat_ranks[i]           = in.readUnsigned();
+        chain_prev_boundary[i]  = boundary( in.readUnsigned() );
+        chain_half_trips[i]     = int( in.readUnsigned() );
+        heat_visitors[i].first  = int( in.readUnsigned() );
+        heat_visitors[i].second = int( in.readUnsigned() );
+        
+        for (size_t j = 0; j < num_chains; ++j)
+        {
+            num_attempted_swaps[i][j] = in.readUnsigned();
+            num_accepted_swaps[i][j]  = in.readUnsigned();
+        }
+    }
+    
+    std::vector<std::string> chain_rng_states( in.readUnsigned() );
+    for (size_t i = 0; i < chain_rng_states.size(); ++i)
+    {
+        chain_rng_states[i] = in.readString();
+    }
+    std::string rng_state = in.readString();
+    
+    for (size_t i = 0; i < num_chains; ++i)
+    {
+        if ( chains[i] != NULL )
+        {
+            chains[i]->setChainPosteriorHeat( heatForChain(i) );
+            chains[i]->setChainActive( isColdChain(i) );
+            chain_moves_tuningInfo[i] = chains[i]->getMovesTuningInfo();
+        }
+    }
+    
+    // finally, continue with the same random numbers
+    // (the chains have restored the global random number generator too, but we are the last one to do so)
+    clearChainRandomNumberGenerators();
+    for (size_t i = 0; i < chain_rng_states.size(); ++i)
+    {
+        RandomNumberGenerator *rng = new RandomNumberGenerator();
+        rng->setState( chain_rng_states[i] );
+        chain_rngs.push_back( rng );
+    }
+    GLOBAL_RNG->setState( rng_state );
+    
 }
 
 
@@ -502,21 +661,36 @@ void Mcmcmc::monitor(unsigned long g)
 void Mcmcmc::nextCycle(bool advanceCycle)
 {
     
+    initializeChainRandomNumberGenerators();
+    
     // run each chain for this process
-    for (size_t i = 0; i < num_chains; ++i)
+    // the chains are independent until the next swap, so we advance them concurrently,
+    // each one using its own random number stream
+    ThreadPool::threadPoolInstance().parallelFor( num_chains, [&](size_t i)
     {
         
         if ( chains[i] != NULL )
         {
-            // @todo: #thread
-            // This part should be done on several threads if possible
-            // Sebastian: this call is very slow; a lot of work happens in nextCycle()
-
-            // advance chain j by a single cycle
-            chains[i]->nextCycle( advanceCycle );
+            // we restore the previous stream afterwards, because this analysis may itself run within another stream
+            RandomNumberFactory &rng_factory = RandomNumberFactory::randomNumberFactoryInstance();
+            RandomNumberGenerator *previous_rng = rng_factory.getThreadRandomNumberGenerator();
+            rng_factory.setThreadRandomNumberGenerator( chain_rngs[i] );
+            
+            try
+            {
+                // advance chain i by a single cycle
+                chains[i]->nextCycle( advanceCycle );
+            }
+            catch (...)
+            {
+                rng_factory.setThreadRandomNumberGenerator( previous_rng );
+                throw;
+            }
+            
+            rng_factory.setThreadRandomNumberGenerator( previous_rng );
         }
         
-    } // loop over chains for this process
+    }); // loop over chains for this process
     
     if ( advanceCycle == true )
     {
@@ -1250,6 +1424,8 @@ void Mcmcmc::startMonitors(size_t num_cycles, bool reopen)
 
 void Mcmcmc::setCheckpointFile(const path &f)
 {
+    checkpoint_file_name = f;
+    
     for (size_t j = 0; j < num_chains; ++j)
     {
         
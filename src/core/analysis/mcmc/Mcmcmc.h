@@ -11,13 +11,19 @@
 
 namespace RevBayesCore {
     
+    class RandomNumberGenerator;
+
     /**
      * @brief Parallel Metropolis-Coupled Markov chain Monte Carlo (MCMCMC) algorithm class.
      *
      * This file contains the declaration of the Markov chain Monte Carlo (MCMC) algorithm class.
      * An MCMC object manages the MCMC analysis by setting up the chain, calling the moves, the monitors and etc.
      *
-     *
+     * Between two swap attempts the chains are independent of each other. We therefore advance the chains
+     * of this process concurrently on the thread pool (see ThreadPool and the 'numThreads' setting).
+     * Each chain draws its random numbers from its own random number stream, which is seeded from the
+     * global random number generator. Hence, the result of an analysis does not depend on the number of threads.
+     * The chain swaps use the global random number generator and are performed only once all chains have finished their cycle.
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Michael Landis & Sebastian Hoehna)
@@ -80,6 +86,8 @@ namespace RevBayesCore {
         
     private:
         void                                    initializeChains(void);
+        void                                    initializeChainRandomNumberGenerators(void);                                    //!< Create and seed the random number streams of the chains (if not done yet)
+        void                                    clearChainRandomNumberGenerators(void);                                         //!< Delete the random number streams of the chains
         void                                    swapChains(const std::string swap_method);
         void                                    swapMovesTuningInfo(RbVector<Move> &mvsj, RbVector<Move> &mvsk);
         void                                    swapNeighborChains(void);
@@ -101,6 +109,7 @@ namespace RevBayesCore {
         std::vector<size_t>                     heat_ranks;
         std::vector<size_t>                     pid_per_chain;
         std::vector<Mcmc*>                      chains;
+        std::vector<RandomNumberGenerator*>     chain_rngs;                                         // the random number stream of each chain (empty until the first cycle)
         std::vector<double>                     chain_values;
         std::vector<double>                     chain_heats;
 
@@ -124,6 +133,7 @@ namespace RevBayesCore {
         std::string                             swap_mode;                                          // whether making a single attempt per swap interval or attempt multiple (= nchains or nchains^2 for neighbor or random swaps, respectively) times.
         
         Mcmc*                                   base_chain;
+        path                                    checkpoint_file_name;
         
         unsigned long                           generation;
         std::vector< std::vector<unsigned long> > num_attempted_swaps;
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <vector>
 #include <ostream>
+#include <utility>
 
 #include "AbstractTrace.h"
 #include "RbVector.h"
@@ -42,6 +43,7 @@ namespace RevBayesCore {
         virtual void                    addObject(valueType* d);
         virtual int                     isCoveredInInterval(const std::string &v, double i, bool verbose);
         bool                            isDirty(void) const                             { return dirty; };
+        size_t                          getValueRevision(void) const                    { return value_revision; }     //!< Changes whenever values are added or removed, but not when the burnin changes
         void                            setDirty(bool d)                                { dirty = d; };
         void                            removeLastObject();
         void                            removeObjectAtIndex(int index);
@@ -51,7 +53,7 @@ namespace RevBayesCore {
         const std::vector<valueType>&   getValues() const                               { return values; }
 
         virtual void                    setBurnin(long b);
-        void                            setValues(std::vector<valueType> v)             { values = v; }
+        void                            setValues(std::vector<valueType> v)             { values = std::move(v); dirty = true; value_revision++; }
         
 
         // getters and setters
@@ -69,6 +71,7 @@ namespace RevBayesCore {
         std::vector<valueType>          values;                                     //!< the values of this trace
 
         mutable bool                    dirty = true;
+        size_t                          value_revision = 0;
 
     };
 
@@ -116,6 +119,7 @@ void RevBayesCore::Trace<valueType>::addObject(const valueType& t)
 {
     values.push_back(t);
     dirty = true;
+    value_revision++;
 }
 
 
@@ -124,6 +128,7 @@ void RevBayesCore::Trace<valueType>::addObject(valueType&& t)
 {
     values.push_back( std::move(t) );
     dirty = true;
+    value_revision++;
 }
 
 
@@ -169,6 +174,7 @@ void RevBayesCore::Trace<valueType>::removeObjectAtIndex (int index)
     // remove the element
     values.erase(values.begin() + index);
     dirty = true;
+    value_revision++;
 }
 
 
@@ -178,6 +184,7 @@ void RevBayesCore::Trace<valueType>::removeLastObject()
     // remove object from list
     values.pop_back();
     dirty = true;
+    value_revision++;
 }
 
 
@@ -3,6 +3,7 @@
 #include <iomanip>
 #include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <iterator>
 #include <limits>
 #include <map>
@@ -29,12 +30,69 @@
 #include "RbBitSet.h"
 #include "Taxon.h"
 #include "TaxonMap.h"
+#include "ThreadPool.h"
 #include "Trace.h"
 #include "TraceTree.h"
 #include "Tree.h"
 
 using namespace RevBayesCore;
 
+// the constant is initialized in the class, but it needs a definition when it is passed by reference
+const size_t TreeSummary::NO_ENTRY;
+
+
+namespace {
+
+    /*
+     * The finalizer of splitmix64, which spreads the bits of keys and hashes
+     */
+    inline uint64_t mixHash(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    /*
+     * The hash of a split is the sum of the keys of its taxa (and of its sampled ancestors),
+     * so the hash of a node is the sum of the hashes of its children.
+     */
+    inline uint64_t taxonKey(size_t i)
+    {
+        return mixHash( i );
+    }
+
+    inline uint64_t mrcaKey(const Taxon &t)
+    {
+        return mixHash( std::hash<std::string>()( t.getName() ) ^ 0x5851F42D4C957F2DULL );
+    }
+
+    inline uint64_t conditionalCladeHash(uint64_t parent, uint64_t child)
+    {
+        return mixHash( parent ^ mixHash( child ) );
+    }
+
+    /*
+     * Concatenate the ages of all traces
+     */
+    std::vector<double> concatenateAges(const std::vector<std::vector<double> > &ages)
+    {
+        std::vector<double> all_ages;
+        for (size_t i = 0; i < ages.size(); ++i)
+        {
+            all_ages.insert( all_ages.end(), ages[i].begin(), ages[i].end() );
+        }
+        return all_ages;
+    }
+
+    /*
+     * The number of trees of which each worker extracts the splits, before the splits are added to the summary
+     */
+    const size_t TREES_PER_THREAD = 64;
+
+}
+
 
 /*
  * TreeSummary constructor
@@ -648,7 +706,7 @@ void TreeSummary::annotateTree( Tree &tree, AnnotationReport report, bool verbos
 
     RBOUT("Annotating tree ...");
 
-    std::string newick;
+    size_t topology = NO_ENTRY;
 
     if ( report.conditional_tree_ages )
     {
@@ -681,11 +739,11 @@ void TreeSummary::annotateTree( Tree &tree, AnnotationReport report, bool verbos
             throw(RbException("Rooting of input tree differs from the tree sample"));
         }
 
-        newick = tmp_tree->getPlainNewickRepresentation();
+        topology = findTopology( *tmp_tree );
 
         delete tmp_tree;
 
-        if ( tree_clade_ages.find(newick) == tree_clade_ages.end() )
+        if ( topology == NO_ENTRY || topologies[topology].count == 0 )
         {
             throw(RbException("Could not find input tree in tree sample"));
         }
@@ -701,6 +759,7 @@ void TreeSummary::annotateTree( Tree &tree, AnnotationReport report, bool verbos
 
         Clade clade = n->getClade();
         Split split( clade.getBitRepresentation(), clade.getMrca(), rooted);
+        size_t split_id = findSplit( split, splitHash(split) );
 
         // annotate clade posterior prob
         if ( ( !n->isTip() || ( n->isRoot() && !clade.getMrca().empty() ) ) && report.clade_probs )
@@ -729,25 +788,37 @@ void TreeSummary::annotateTree( Tree &tree, AnnotationReport report, bool verbos
             Clade parent_clade = n->getParent().getClade();
             Split parent_split = Split( parent_clade.getBitRepresentation(), parent_clade.getMrca(), rooted);
 
-            std::map<Split, std::vector<double> >& condCladeAges = conditional_clade_ages[parent_split];
-            node_ages = report.conditional_clade_ages ? condCladeAges[split] : clade_ages[split];
+            size_t conditional_clade = findConditionalClade( findSplit( parent_split, splitHash(parent_split) ), split_id );
+
+            if ( report.conditional_clade_ages == true )
+            {
+                if ( conditional_clade != NO_ENTRY )
+                {
+                    node_ages = concatenateAges( conditional_clades[conditional_clade].ages );
+                }
+            }
+            else if ( split_id != NO_ENTRY )
+            {
+                node_ages = concatenateAges( splits[split_id].ages );
+            }
 
             // annotate CCPs
             if ( !n->isTip() && report.conditional_clade_probs )
             {
                 double parentCladeFreq = splitFrequency( parent_split );
-                double ccp = condCladeAges[split].size() / parentCladeFreq;
+                double conditionalCladeFreq = ( conditional_clade != NO_ENTRY ? conditional_clades[conditional_clade].count : 0.0 );
+                double ccp = conditionalCladeFreq / parentCladeFreq;
                 n->addNodeParameter("ccp",ccp);
             }
         }
-        else
+        else if ( split_id != NO_ENTRY )
         {
-            node_ages = clade_ages[split];
+            node_ages = concatenateAges( splits[split_id].ages );
         }
 
         if ( report.conditional_tree_ages )
         {
-            node_ages = tree_clade_ages[newick][split];
+            node_ages = getTopologyAges( topology, split_id );
         }
 
         // set the node ages/branch lengths
@@ -885,22 +956,234 @@ double TreeSummary::cladeProbability(const RevBayesCore::Clade &c, bool verbose
 }
 
 
-TreeSummary::Split TreeSummary::collectTreeSample(const TopologyNode& n, RbBitSet& intaxa, std::string newick, std::map<Split, long>& cladeCountMap)
+/*
+ * Add the splits of a sample to the summary and return the id of its topology.
+ */
+size_t TreeSummary::addTreeSample(size_t trace, size_t sample, const std::vector<NodeSplit> &node_splits, const std::vector<Taxon> &sampled_ancestors)
+{
+    size_t num_nodes = node_splits.size();
+
+    std::vector<size_t> split_ids( num_nodes );
+
+    // find the splits
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        const NodeSplit& node_split = node_splits[i];
+
+        size_t split = findSplit( node_split.split, node_split.hash );
+
+        if ( split == NO_ENTRY )
+        {
+            split = splits.size();
+
+            SplitSample s = { node_split.split, node_split.hash, 0, std::vector<std::vector<double> >( traces.size() ) };
+            splits.push_back( s );
+            split_index.insert( node_split.hash, split );
+        }
+
+        split_ids[i] = split;
+    }
+
+    // the topology is the sorted list of the splits of its nodes
+    std::vector<size_t> nodes( num_nodes );
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        nodes[i] = i;
+    }
+    std::sort( nodes.begin(), nodes.end(), [&](size_t a, size_t b) { return split_ids[a] != split_ids[b] ? split_ids[a] < split_ids[b] : node_splits[a].age < node_splits[b].age; } );
+
+    std::vector<size_t> topology_splits( num_nodes );
+    uint64_t topology_hash = 0;
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        topology_splits[i] = split_ids[ nodes[i] ];
+        topology_hash += mixHash( splits[ topology_splits[i] ].hash );
+    }
+
+    size_t topology = topology_index.find( topology_hash, [&](size_t t) { return topologies[t].splits == topology_splits; } );
+
+    if ( topology == NO_ENTRY )
+    {
+        // the parent of every split is the same in all samples of a topology, so we only need to find the conditional clades once
+        std::vector<size_t> topology_conditional_clades( num_nodes, NO_ENTRY );
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            if ( node_splits[ nodes[i] ].parent == NO_ENTRY ) continue;
+
+            size_t parent = split_ids[ node_splits[ nodes[i] ].parent ];
+            size_t child  = topology_splits[i];
+
+            size_t conditional_clade = findConditionalClade( parent, child );
+
+            if ( conditional_clade == NO_ENTRY )
+            {
+                conditional_clade = conditional_clades.size();
+
+                ConditionalCladeSample c = { parent, child, 0, std::vector<std::vector<double> >( traces.size() ) };
+                conditional_clades.push_back( c );
+                conditional_clade_index.insert( conditionalCladeHash( splits[parent].hash, splits[child].hash ), conditional_clade );
+            }
+
+            topology_conditional_clades[i] = conditional_clade;
+        }
+
+        topology = topologies.size();
+
+        TopologySample t = { topology_hash, 0, trace, sample, topology_splits, topology_conditional_clades, sampled_ancestors, std::vector<std::vector<double> >( traces.size() ) };
+        topologies.push_back( t );
+        topology_index.insert( topology_hash, topology );
+    }
+
+    // count the splits and store their ages
+    TopologySample& t = topologies[topology];
+    t.count++;
+
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        double age = node_splits[ nodes[i] ].age;
+
+        SplitSample& split = splits[ t.splits[i] ];
+        split.count++;
+        split.ages[trace].push_back( age );
+
+        if ( t.conditional_clades[i] != NO_ENTRY )
+        {
+            ConditionalCladeSample& conditional_clade = conditional_clades[ t.conditional_clades[i] ];
+            conditional_clade.count++;
+            conditional_clade.ages[trace].push_back( age );
+        }
+
+        // store the age for this split, conditional on the tree topology
+        t.ages[trace].push_back( age );
+    }
+
+    for (size_t i = 0; i < t.sampled_ancestors.size(); ++i)
+    {
+        sampled_ancestor_counts[ t.sampled_ancestors[i] ]++;
+    }
+
+    return topology;
+}
+
+
+/*
+ * Add the samples first,...,last-1 of a trace to the summary.
+ * We extract the splits of a batch of trees in parallel and then add them to the summary in the order of the samples,
+ * so the summary does not depend on the number of threads.
+ */
+void TreeSummary::addTreeSamples(size_t t, size_t first, size_t last, ProgressBar &progress, size_t &count, bool verbose)
+{
+    TraceTree* trace = traces[t];
+    SummarizedTrace& summarized_trace = summarized_traces[t];
+
+    ThreadPool &pool = ThreadPool::threadPoolInstance();
+    size_t batch_size = pool.getNumberOfThreads() * TREES_PER_THREAD;
+
+    std::vector<std::vector<NodeSplit> > node_splits( std::min( batch_size, last - first ) );
+    std::vector<std::vector<Taxon> > sampled_ancestors( node_splits.size() );
+
+    std::vector<size_t> sample_topologies;
+    sample_topologies.reserve( last - first );
+
+    // if the new samples come before the samples we already summarized, we need to move their ages to the front later
+    bool prepend = ( first < summarized_trace.first );
+    std::vector<size_t> num_split_ages;
+    std::vector<size_t> num_conditional_clade_ages;
+    std::vector<size_t> num_topology_ages;
+    if ( prepend == true )
+    {
+        num_split_ages.reserve( splits.size() );
+        for (size_t i = 0; i < splits.size(); ++i)
+        {
+            num_split_ages.push_back( splits[i].ages[t].size() );
+        }
+        num_conditional_clade_ages.reserve( conditional_clades.size() );
+        for (size_t i = 0; i < conditional_clades.size(); ++i)
+        {
+            num_conditional_clade_ages.push_back( conditional_clades[i].ages[t].size() );
+        }
+        num_topology_ages.reserve( topologies.size() );
+        for (size_t i = 0; i < topologies.size(); ++i)
+        {
+            num_topology_ages.push_back( topologies[i].ages[t].size() );
+        }
+    }
+
+    for (size_t batch_start = first; batch_start < last; batch_start += batch_size)
+    {
+        size_t num_trees = std::min( batch_size, last - batch_start );
+        size_t num_blocks = std::min( num_trees, pool.getNumberOfThreads() );
+
+        pool.parallelFor( num_blocks, [&](size_t block)
+        {
+            for (size_t k = block * num_trees / num_blocks; k < (block + 1) * num_trees / num_blocks; ++k)
+            {
+                computeSampleSplits( trace->objectAt(batch_start + k), node_splits[k], sampled_ancestors[k] );
+            }
+        });
+
+        for (size_t k = 0; k < num_trees; ++k)
+        {
+            sample_topologies.push_back( addTreeSample( t, batch_start + k, node_splits[k], sampled_ancestors[k] ) );
+
+            if ( verbose )
+            {
+                progress.update(count);
+                count++;
+            }
+        }
+    }
+
+    // record the topologies of the new samples, which come either before or after the samples we already summarized
+    if ( prepend == true )
+    {
+        // addTreeSample() appended the ages of the new samples, so we rotate them in front of the ages of the later samples
+        // removeTreeSamples() relies on the ages being in the order of the samples
+        for (size_t i = 0; i < num_split_ages.size(); ++i)
+        {
+            std::vector<double>& ages = splits[i].ages[t];
+            std::rotate( ages.begin(), ages.begin() + num_split_ages[i], ages.end() );
+        }
+        for (size_t i = 0; i < num_conditional_clade_ages.size(); ++i)
+        {
+            std::vector<double>& ages = conditional_clades[i].ages[t];
+            std::rotate( ages.begin(), ages.begin() + num_conditional_clade_ages[i], ages.end() );
+        }
+        for (size_t i = 0; i < num_topology_ages.size(); ++i)
+        {
+            std::vector<double>& ages = topologies[i].ages[t];
+            std::rotate( ages.begin(), ages.begin() + num_topology_ages[i], ages.end() );
+        }
+
+        sample_topologies.insert( sample_topologies.end(), summarized_trace.topologies.begin(), summarized_trace.topologies.end() );
+        summarized_trace.topologies.swap( sample_topologies );
+        summarized_trace.first = first;
+    }
+    else
+    {
+        summarized_trace.topologies.insert( summarized_trace.topologies.end(), sample_topologies.begin(), sample_topologies.end() );
+    }
+}
+
+
+size_t TreeSummary::collectNodeSplits(const TopologyNode& n, RbBitSet& intaxa, uint64_t& inhash, uint64_t all_taxa_hash, std::vector<NodeSplit> &node_splits, std::vector<Taxon> &sampled_ancestors) const
 {
     double age = (clock ? n.getAge() : n.getBranchLength() );
 
-    std::vector<Split> child_splits;
+    std::vector<size_t> children;
 
     RbBitSet taxa(intaxa.size());
+    uint64_t hash = 0;
     std::set<Taxon> mrca;
 
     if ( n.isTip() )
     {
         n.getTaxa(taxa);
+        hash = taxonKey( taxa.find_first() );
 
         if ( rooted && n.isSampledAncestor() )
         {
-            sampled_ancestor_counts[n.getTaxon()]++;
+            sampled_ancestors.push_back( n.getTaxon() );
 
             mrca.insert( n.getTaxon() );
         }
@@ -911,7 +1194,7 @@ TreeSummary::Split TreeSummary::collectTreeSample(const TopologyNode& n, RbBitSe
         {
             const TopologyNode &child_node = n.getChild(i);
 
-            child_splits.push_back( collectTreeSample(child_node, taxa, newick, cladeCountMap) );
+            children.push_back( collectNodeSplits(child_node, taxa, hash, all_taxa_hash, node_splits, sampled_ancestors) );
 
             if ( rooted && child_node.isSampledAncestor() )
             {
@@ -921,29 +1204,80 @@ TreeSummary::Split TreeSummary::collectTreeSample(const TopologyNode& n, RbBitSe
     }
 
     intaxa |= taxa;
+    inhash += hash;
+
+    // unrooted splits containing the first taxon are flipped (see Split)
+    if ( rooted == false && taxa[0] == true )
+    {
+        hash = all_taxa_hash - hash;
+    }
+
+    for (std::set<Taxon>::const_iterator it = mrca.begin(); it != mrca.end(); ++it)
+    {
+        hash += mrcaKey( *it );
+    }
+
+    size_t index = node_splits.size();
+    node_splits.push_back( NodeSplit( Split(taxa, mrca, rooted), hash, age, NO_ENTRY ) );
+
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        node_splits[ children[i] ].parent = index;
+    }
+
+    return index;
+}
 
-    Split parent_split(taxa, mrca, rooted);
 
-    if ( taxa.size() > 0 )
+/*
+ * Compute the splits of all nodes of a tree in postorder, together with their hashes, ages and parents.
+ */
+void TreeSummary::computeNodeSplits(const Tree &tree, std::vector<NodeSplit> &node_splits, std::vector<Taxon> &sampled_ancestors) const
+{
+    node_splits.clear();
+    sampled_ancestors.clear();
+
+    size_t num_taxa = tree.getNumberOfTips();
+    node_splits.reserve( tree.getNumberOfNodes() );
+
+    uint64_t all_taxa_hash = 0;
+    for (size_t i = 0; i < num_taxa; ++i)
     {
-        // store the age for this split
-        clade_ages[parent_split].push_back( age );
+        all_taxa_hash += taxonKey( i );
+    }
+
+    RbBitSet b( num_taxa, false );
+    uint64_t h = 0;
+    collectNodeSplits(tree.getRoot(), b, h, all_taxa_hash, node_splits, sampled_ancestors);
+}
 
-        // increment split count
-        cladeCountMap[parent_split]++;
 
-        // add conditional clade ages
-        for (std::vector<Split>::iterator child=child_splits.begin(); child !=child_splits.end(); ++child )
+/*
+ * Compute the splits of a sampled tree. Unrooted trees are rerooted at the outgroup first.
+ */
+void TreeSummary::computeSampleSplits(const Tree &sample_tree, std::vector<NodeSplit> &node_splits, std::vector<Taxon> &sampled_ancestors) const
+{
+    // only unrooted trees need to be copied to reroot them
+    if ( rooted == false )
+    {
+        Tree tree = sample_tree;
+
+        if ( outgroup )
         {
-            // inserts new entries if doesn't already exist
-            conditional_clade_ages[parent_split][*child].push_back( clade_ages[*child].back() );
+            tree.reroot( *outgroup, false, true );
+        }
+        else
+        {
+            std::vector<std::string> tip_names = tree.getTipNames();
+            tree.reroot( *std::min_element(tip_names.begin(), tip_names.end()), false, true );
         }
 
-        // store the age for this split, conditional on the tree topology
-        tree_clade_ages[newick][parent_split].push_back( age );
+        computeNodeSplits( tree, node_splits, sampled_ancestors );
+    }
+    else
+    {
+        computeNodeSplits( sample_tree, node_splits, sampled_ancestors );
     }
-
-    return parent_split;
 }
 
 
@@ -956,15 +1290,15 @@ MatrixReal TreeSummary::computeConnectivity(double credible_interval_size, const
     NewickConverter converter;
     double total_prob = 0;
     double total_samples = sampleSize(true);
-    for (std::set<Sample<std::string> >::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
     {
-        double freq = it->second;
+        double freq = topologies[*it].count;
         double p = freq/total_samples;
         total_prob += p;
 
         sample_count.push_back( freq );
 
-        Tree* current_tree = converter.convertFromNewick( it->first );
+        Tree* current_tree = converter.convertFromNewick( getTopologyNewick(*it) );
         unique_trees.push_back( current_tree );
         
 //        std::vector<RbBitSet>* this_clade_bs = new std::vector<RbBitSet>();
@@ -1020,9 +1354,9 @@ double TreeSummary::computeEntropy( double credible_interval_size, int num_taxa,
     double total_samples = sampleSize(true);
     double entropy = 0.0;
     /*double tree_count = 0.0;*/
-    for (std::set<Sample<std::string> >::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
     {
-        double freq = it->second;
+        double freq = topologies[*it].count;
         double p = freq/total_samples;
         /*double p = freq/(total_samples);*/
         total_prob += p;
@@ -1051,15 +1385,15 @@ std::vector<double> TreeSummary::computePairwiseRFDistance( double credible_inte
     NewickConverter converter;
     double total_prob = 0;
     double total_samples = sampleSize(true);
-    for (std::set<Sample<std::string> >::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
     {
-        double freq = it->second;
+        double freq = topologies[*it].count;
         double p = freq/total_samples;
         total_prob += p;
 
         sample_count.push_back( freq );
 
-        Tree* current_tree = converter.convertFromNewick( it->first );
+        Tree* current_tree = converter.convertFromNewick( getTopologyNewick(*it) );
         unique_trees.push_back( current_tree );
         
         std::vector<RbBitSet>* this_clade_bs = new std::vector<RbBitSet>();
@@ -1149,20 +1483,94 @@ void TreeSummary::enforceNonnegativeBranchLengths(TopologyNode& node) const
 }
 
 
-long TreeSummary::splitFrequency(const Split &n) const
+size_t TreeSummary::findConditionalClade(size_t parent, size_t child) const
+{
+    if ( parent == NO_ENTRY || child == NO_ENTRY )
+    {
+        return NO_ENTRY;
+    }
+
+    uint64_t h = conditionalCladeHash( splits[parent].hash, splits[child].hash );
+
+    return conditional_clade_index.find( h, [&](size_t c) { return conditional_clades[c].parent == parent && conditional_clades[c].child == child; } );
+}
+
+
+size_t TreeSummary::findSplit(const Split &n, uint64_t h) const
 {
+    return split_index.find( h, [&](size_t s) { return splits[s].split == n; } );
+}
+
+
+/*
+ * Find the topology of a tree (rooted in the same way as the sampled trees) in the sampled topologies.
+ */
+size_t TreeSummary::findTopology(const Tree &tree) const
+{
+    std::vector<NodeSplit> node_splits;
+    std::vector<Taxon> sampled_ancestors;
+    computeNodeSplits( tree, node_splits, sampled_ancestors );
+
+    std::vector<size_t> split_ids;
+    uint64_t topology_hash = 0;
+    for (size_t i = 0; i < node_splits.size(); ++i)
+    {
+        size_t split = findSplit( node_splits[i].split, node_splits[i].hash );
+
+        // a topology with an unsampled split was not sampled either
+        if ( split == NO_ENTRY )
+        {
+            return NO_ENTRY;
+        }
 
-    std::set<Sample<Split> >::const_iterator it = find_if (clade_samples.begin(), clade_samples.end(), n );
+        split_ids.push_back( split );
+        topology_hash += mixHash( splits[split].hash );
+    }
+    std::sort( split_ids.begin(), split_ids.end() );
+
+    return topology_index.find( topology_hash, [&](size_t t) { return topologies[t].splits == split_ids; } );
+}
+
+
+long TreeSummary::splitCount(const Split &n) const
+{
+    size_t split = findSplit( n, splitHash(n) );
+
+    return ( split != NO_ENTRY ? splits[split].count : 0 );
+}
+
+
+long TreeSummary::splitFrequency(const Split &n) const
+{
+    size_t split = findSplit( n, splitHash(n) );
 
-    if ( it != clade_samples.end() )
+    if ( split != NO_ENTRY && splits[split].count > 0 )
     {
-        return it->second;
+        return splits[split].count;
     }
 
     throw RbException("Couldn't find split in set of samples");
 }
 
 
+uint64_t TreeSummary::splitHash(const Split &n) const
+{
+    uint64_t h = 0;
+
+    for (size_t i = n.first.find_first(); i != RbBitSet::npos; i = n.first.find_next(i))
+    {
+        h += taxonKey( i );
+    }
+
+    for (std::set<Taxon>::const_iterator it = n.second.begin(); it != n.second.end(); ++it)
+    {
+        h += mrcaKey( *it );
+    }
+
+    return h;
+}
+
+
 TopologyNode* TreeSummary::findParentNode(TopologyNode& n, const Split& split, std::vector<TopologyNode*>& children, RbBitSet& child_b ) const
 {
     size_t num_taxa = child_b.size();
@@ -1259,24 +1667,72 @@ int TreeSummary::getTopologyFrequency(const RevBayesCore::Tree &tree, bool verbo
         }
     }
 
-    std::string newick = t.getPlainNewickRepresentation();
+    size_t topology = findTopology( t );
+
+    double freq = ( topology != NO_ENTRY ? topologies[topology].count : 0 );
+
+    return freq;
+}
 
-    double freq = 0;
 
-    for (std::set<Sample<std::string> >::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
+/*
+ * Get the ages of a split in all samples of a topology.
+ */
+std::vector<double> TreeSummary::getTopologyAges(size_t topology, size_t split) const
+{
+    std::vector<double> ages;
+
+    if ( topology == NO_ENTRY || split == NO_ENTRY )
     {
+        return ages;
+    }
 
-        if ( newick == it->first )
-        {
-            freq = it->second;
+    const TopologySample& t = topologies[topology];
 
-            // now we found it
-            break;
+    // a split occurs more than once only at the root of unrooted trees
+    std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> nodes = std::equal_range( t.splits.begin(), t.splits.end(), split );
+    size_t first = nodes.first - t.splits.begin();
+    size_t last  = nodes.second - t.splits.begin();
+    size_t num_nodes = t.splits.size();
+
+    for (size_t k = 0; k < t.ages.size(); ++k)
+    {
+        for (size_t i = 0; i < t.ages[k].size(); i += num_nodes)
+        {
+            for (size_t j = first; j < last; ++j)
+            {
+                ages.push_back( t.ages[k][i + j] );
+            }
         }
+    }
+
+    return ages;
+}
+
+
+/*
+ * Compute the Newick string of a sampled topology from the first tree with that topology.
+ */
+std::string TreeSummary::getTopologyNewick(size_t topology) const
+{
+    const TopologySample& t = topologies[topology];
 
+    Tree tree = traces[t.trace]->objectAt(t.sample);
+
+    if ( rooted == false )
+    {
+        if ( outgroup )
+        {
+            tree.reroot( *outgroup, false, true );
+        }
+        else
+        {
+            std::vector<std::string> tip_names = tree.getTipNames();
+            tree.reroot( *std::min_element(tip_names.begin(), tip_names.end()), false, true );
+        }
     }
 
-    return freq;
+    return tree.getPlainNewickRepresentation();
 }
 
 
@@ -1291,10 +1747,10 @@ std::vector<Clade> TreeSummary::getUniqueClades( double min_clade_prob, bool non
     VectorUtilities::sort( ordered_taxa );
     size_t num_taxa = ordered_taxa.size();
 
-    for (std::set<Sample<Split> >::const_reverse_iterator it = clade_samples.rbegin(); it != clade_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = clade_samples.rbegin(); it != clade_samples.rend(); ++it)
     {
 
-        double freq = it->second;
+        double freq = splits[*it].count;
         double p    = freq/total_samples;
 
         // first we check if this clade is above the minimum level
@@ -1304,8 +1760,8 @@ std::vector<Clade> TreeSummary::getUniqueClades( double min_clade_prob, bool non
         }
 
         // now lets actually construct the clade
-        Clade current_clade(it->first.first, ordered_taxa);
-        current_clade.setMrca(it->first.second);
+        Clade current_clade(splits[*it].split.first, ordered_taxa);
+        current_clade.setMrca(splits[*it].split.second);
 
         if ( current_clade.size() <= 1 || current_clade.size() >= ( rooted ? num_taxa : (num_taxa-1) ) ) continue;
 
@@ -1325,13 +1781,13 @@ std::vector<Tree> TreeSummary::getUniqueTrees( double credible_interval_size, bo
     NewickConverter converter;
     double total_prob = 0;
     double total_samples = sampleSize(true);
-    for (std::set<Sample<std::string> >::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
     {
-        double freq =it->second;
+        double freq = topologies[*it].count;
         double p =freq/total_samples;
         total_prob += p;
 
-        Tree* current_tree = converter.convertFromNewick( it->first );
+        Tree* current_tree = converter.convertFromNewick( getTopologyNewick(*it) );
         unique_trees.push_back( *current_tree );
         delete current_tree;
         if ( total_prob >= credible_interval_size )
@@ -1378,22 +1834,21 @@ bool TreeSummary::isCoveredInInterval(const Tree &tree, double ci_size, bool ver
 
     RandomNumberGenerator *rng = GLOBAL_RNG;
 
-    std::string newick = tree.getPlainNewickRepresentation();
+    size_t topology = findTopology( tree );
 
     double totalSamples = sampleSize(true);
     double totalProb = 0.0;
-    for (std::set<Sample<std::string> >::reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
     {
 
-        double p = it->second/totalSamples;
+        double p = topologies[*it].count/totalSamples;
 //        double include_prob = p / (1.0-totalProb) * (ci_size - totalProb) / (1.0-totalProb);
         double include_prob = (ci_size-totalProb)/p;
 //        double include_prob = p * ci_size;
 
         if ( include_prob > rng->uniform01() )
         {
-            const std::string &current_sample = it->first;
-            if ( newick == current_sample )
+            if ( topology == *it )
             {
                 return true;
             }
@@ -1439,47 +1894,47 @@ double TreeSummary::maxdiff( bool verbose )
         throw RbException("At least 2 traces are required to compute maxdiff");
     }
 
-    std::set<Sample<Split> > splits_union;
-
     for (std::vector<TraceTree* >::const_iterator trace = traces.begin(); trace != traces.end(); trace++)
     {
         (*trace)->summarize(verbose);
-
-        splits_union.insert((*trace)->clade_samples.begin(), (*trace)->clade_samples.end());
     }
 
 
     double maxdiff = 0;
 
-    for (std::set<Sample<Split> >::const_iterator split = splits_union.begin(); split != splits_union.end(); ++split)
+    // every split in the union of the traces is visited once for each trace it occurs in, which does not change the maximum
+    for (std::vector<TraceTree* >::const_iterator split_trace = traces.begin(); split_trace != traces.end(); split_trace++)
     {
-        std::vector<double> split_freqs;
-
-        for(std::vector<TraceTree* >::const_iterator trace = traces.begin(); trace != traces.end(); trace++)
+        for (std::vector<SplitSample>::const_iterator split = (*split_trace)->splits.begin(); split != (*split_trace)->splits.end(); ++split)
         {
-            double total_samples = (*trace)->size(true);
+            std::vector<double> split_freqs;
 
-            std::set<Sample<Split> >::const_iterator it = find_if((*trace)->clade_samples.begin(), (*trace)->clade_samples.end(), split->first );
+            for(std::vector<TraceTree* >::const_iterator trace = traces.begin(); trace != traces.end(); trace++)
+            {
+                double total_samples = (*trace)->size(true);
 
-            double freq = 0;
+                size_t it = (*trace)->findSplit( split->split, split->hash );
 
-            if ( it != (*trace)->clade_samples.end() )
-            {
-                freq = it->second/total_samples;
-            }
+                double freq = 0;
 
-            split_freqs.push_back(freq);
-        }
+                if ( it != NO_ENTRY )
+                {
+                    freq = (*trace)->splits[it].count/total_samples;
+                }
 
-        for(size_t i = 0; i < split_freqs.size(); i++)
-        {
-            for(size_t j = i+1; j < split_freqs.size(); j++)
-            {
-                double diff = abs(split_freqs[i] - split_freqs[j]);
+                split_freqs.push_back(freq);
+            }
 
-                if(diff > maxdiff)
+            for(size_t i = 0; i < split_freqs.size(); i++)
+            {
+                for(size_t j = i+1; j < split_freqs.size(); j++)
                 {
-                    maxdiff = diff;
+                    double diff = abs(split_freqs[i] - split_freqs[j]);
+
+                    if(diff > maxdiff)
+                    {
+                        maxdiff = diff;
+                    }
                 }
             }
         }
@@ -1498,7 +1953,7 @@ Tree* TreeSummary::mapTree( AnnotationReport report, bool verbose )
     summarize( verbose );
 
     // get the tree with the highest posterior probability
-    std::string bestNewick = tree_samples.rbegin()->first;
+    std::string bestNewick = getTopologyNewick( tree_samples.back() );
     NewickConverter converter;
     Tree* tmp_best_tree = converter.convertFromNewick( bestNewick );
 
@@ -1538,14 +1993,19 @@ Tree* TreeSummary::mccTree( AnnotationReport report, bool verbose )
     double max_cc = 0;
 
     // find the clade credibility score for each tree
-    for (std::set<Sample<std::string> >::reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
     {
-        const std::string& newick = it->first;
+        const std::vector<size_t>& topology_splits = topologies[*it].splits;
 
-        // find the product of the clade frequencies
+        // find the product of the clade frequencies (the splits are sorted, so we skip repeated splits)
         double cc = 0;
-        for (auto& clade: tree_clade_ages.at(newick))
-            cc += log( splitFrequency(clade.first) );
+        for (size_t i = 0; i < topology_splits.size(); ++i)
+        {
+            if ( i == 0 || topology_splits[i] != topology_splits[i-1] )
+            {
+                cc += log( splits[ topology_splits[i] ].count );
+            }
+        }
 
         if (cc > max_cc)
         {
@@ -1554,7 +2014,7 @@ Tree* TreeSummary::mccTree( AnnotationReport report, bool verbose )
             delete best_tree;
 
             NewickConverter converter;
-            Tree* tmp_tree = converter.convertFromNewick( newick );
+            Tree* tmp_tree = converter.convertFromNewick( getTopologyNewick(*it) );
             if ( clock == true )
             {
                 best_tree = TreeUtilities::convertTree( *tmp_tree );
@@ -1612,12 +2072,12 @@ Tree* TreeSummary::mrTree(AnnotationReport report, double cutoff, bool verbose)
 
     double totalSamples = sampleSize(true);
 
-    for (std::set<Sample<Split> >::reverse_iterator it = clade_samples.rbegin(); it != clade_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = clade_samples.rbegin(); it != clade_samples.rend(); ++it)
     {
-        float cladeFreq = it->second / totalSamples;
+        float cladeFreq = splits[*it].count / totalSamples;
         if (cladeFreq < cutoff)  break;
 
-        Split clade = it->first;
+        const Split& clade = splits[*it].split;
 
         //make sure we have an internal node
         size_t clade_size = clade.first.count();
@@ -1746,14 +2206,14 @@ void TreeSummary::printCladeSummary(std::ostream &o, double minCladeProbability,
     std::vector<Taxon> ordered_taxa = traces.front()->objectAt(0).getTaxa();
     VectorUtilities::sort( ordered_taxa );
 
-    for (std::set<Sample<Split> >::reverse_iterator it = clade_samples.rbegin(); it != clade_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = clade_samples.rbegin(); it != clade_samples.rend(); ++it)
     {
-        Clade c(it->first.first, ordered_taxa);
-        c.setMrca(it->first.second);
+        Clade c(splits[*it].split.first, ordered_taxa);
+        c.setMrca(splits[*it].split.second);
 
         if ( c.size() == 1 ) continue;
 
-        double freq = it->second;
+        double freq = splits[*it].count;
         double p = freq/totalSamples;
 
 
@@ -1834,9 +2294,9 @@ void TreeSummary::printTreeSummary(std::ostream &o, double credibleIntervalSize,
     o << "----------------------------------------------------------------" << std::endl;
     double totalSamples = sampleSize(true);
     double totalProb = 0.0;
-    for (std::set<Sample<std::string> >::reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
+    for (std::vector<size_t>::const_reverse_iterator it = tree_samples.rbegin(); it != tree_samples.rend(); ++it)
     {
-        double freq =it->second;
+        double freq = topologies[*it].count;
         double p = freq/totalSamples;
         totalProb += p;
 
@@ -1864,7 +2324,7 @@ void TreeSummary::printTreeSummary(std::ostream &o, double credibleIntervalSize,
          StringUtilities::fillWithSpaces(s, 16, true);
          o << s;*/
 
-        o << it->first;
+        o << getTopologyNewick(*it);
         o << std::endl;
 
         if ( totalProb >= credibleIntervalSize )
@@ -1883,6 +2343,13 @@ void TreeSummary::printTreeSummary(std::ostream &o, double credibleIntervalSize,
 void TreeSummary::setOutgroup(const RevBayesCore::Clade &c)
 {
     outgroup = c;
+
+    // the splits of unrooted trees depend on the outgroup
+    summarized_traces.clear();
+    for (std::vector<TraceTree* >::iterator trace = traces.begin(); trace != traces.end(); ++trace)
+    {
+        (*trace)->setDirty(true);
+    }
 }
 
 long TreeSummary::sampleSize(bool post) const
@@ -1898,30 +2365,139 @@ long TreeSummary::sampleSize(bool post) const
 }
 
 
+/*
+ * Remove the samples first,...,last-1 of a trace from the summary.
+ * These are the first samples we summarized, so their ages are at the beginning of the ages of the trace.
+ */
+void TreeSummary::removeTreeSamples(size_t t, size_t first, size_t last)
+{
+    SummarizedTrace& summarized_trace = summarized_traces[t];
+
+    std::vector<size_t> removed_splits( splits.size(), 0 );
+    std::vector<size_t> removed_conditional_clades( conditional_clades.size(), 0 );
+    std::vector<size_t> removed_topologies( topologies.size(), 0 );
+
+    // subtract the counts of the removed samples
+    for (size_t i = first; i < last; ++i)
+    {
+        size_t topology = summarized_trace.topologies[i - summarized_trace.first];
+        TopologySample& tree = topologies[topology];
+
+        tree.count--;
+        removed_topologies[topology]++;
+
+        for (size_t j = 0; j < tree.splits.size(); ++j)
+        {
+            splits[ tree.splits[j] ].count--;
+            removed_splits[ tree.splits[j] ]++;
+
+            if ( tree.conditional_clades[j] != NO_ENTRY )
+            {
+                conditional_clades[ tree.conditional_clades[j] ].count--;
+                removed_conditional_clades[ tree.conditional_clades[j] ]++;
+            }
+        }
+
+        for (size_t j = 0; j < tree.sampled_ancestors.size(); ++j)
+        {
+            sampled_ancestor_counts[ tree.sampled_ancestors[j] ]--;
+        }
+    }
+
+    // remove the ages of the removed samples
+    for (size_t i = 0; i < splits.size(); ++i)
+    {
+        std::vector<double>& ages = splits[i].ages[t];
+        ages.erase( ages.begin(), ages.begin() + removed_splits[i] );
+    }
+
+    for (size_t i = 0; i < conditional_clades.size(); ++i)
+    {
+        std::vector<double>& ages = conditional_clades[i].ages[t];
+        ages.erase( ages.begin(), ages.begin() + removed_conditional_clades[i] );
+    }
+
+    for (size_t i = 0; i < topologies.size(); ++i)
+    {
+        std::vector<double>& ages = topologies[i].ages[t];
+        ages.erase( ages.begin(), ages.begin() + removed_topologies[i] * topologies[i].splits.size() );
+    }
+
+    summarized_trace.topologies.erase( summarized_trace.topologies.begin(), summarized_trace.topologies.begin() + (last - first) );
+    summarized_trace.first = last;
+}
+
+
+/*
+ * Summarize the splits and topologies of the trees after the burnin.
+ * If only the burnin of a trace changed since the last summary, we only add or remove the samples in between.
+ */
 void TreeSummary::summarize( bool verbose )
 {
-    if ( isDirty() == false ) return;
+    // we can update the summary only if no trace gained or lost trees
+    bool update = ( summarized_traces.size() == traces.size() );
+    for (size_t t = 0; t < summarized_traces.size() && update == true; ++t)
+    {
+        update = ( summarized_traces[t].revision == traces[t]->getValueRevision() );
+    }
 
-    std::vector<std::string> tip_names = traces.front()->objectAt(0).getTipNames();
-    std::sort(tip_names.begin(),tip_names.end());
-    const std::string& this_outgroup = tip_names[0];
+    // several summaries may share a trace (and its dirty flag), so we check ourselves whether the burnin changed
+    bool up_to_date = update;
+    for (size_t t = 0; t < summarized_traces.size() && up_to_date == true; ++t)
+    {
+        up_to_date = ( summarized_traces[t].first == std::min( traces[t]->getBurnin(), size_t(traces[t]->size()) ) );
+    }
 
-    rooted = traces.front()->objectAt(0).isRooted();
+    if ( up_to_date == true ) return;
 
-    clade_samples.clear();
-    tree_samples.clear();
+    if ( update == false )
+    {
+        rooted = traces.front()->objectAt(0).isRooted();
 
-    sampled_ancestor_counts.clear();
+        clade_samples.clear();
+        tree_samples.clear();
 
-    clade_ages.clear();
-    conditional_clade_ages.clear();
-    tree_clade_ages.clear();
+        sampled_ancestor_counts.clear();
 
-    std::map<Split, long>       clade_counts;
-    std::map<std::string, long> tree_counts;
+        splits.clear();
+        split_index.clear();
+        conditional_clades.clear();
+        conditional_clade_index.clear();
+        topologies.clear();
+        topology_index.clear();
 
+        summarized_traces.clear();
+        for (size_t t = 0; t < traces.size(); ++t)
+        {
+            // nothing is summarized yet, so all samples after the burnin will be added
+            SummarizedTrace summarized_trace = { traces[t]->getValueRevision(), size_t(traces[t]->size()), std::vector<size_t>() };
+            summarized_traces.push_back( summarized_trace );
+        }
+    }
 
-    ProgressBar progress = ProgressBar(sampleSize(true));
+    // the samples we need to add and remove
+    std::vector<std::pair<size_t, size_t> > added( traces.size() );
+    std::vector<std::pair<size_t, size_t> > removed( traces.size() );
+    size_t num_added = 0;
+
+    for (size_t t = 0; t < traces.size(); ++t)
+    {
+        size_t first = std::min( traces[t]->getBurnin(), size_t(traces[t]->size()) );
+        size_t summarized_first = summarized_traces[t].first;
+
+        if ( first < summarized_first )
+        {
+            added[t] = std::make_pair( first, summarized_first );
+        }
+        else
+        {
+            removed[t] = std::make_pair( summarized_first, first );
+        }
+
+        num_added += added[t].second - added[t].first;
+    }
+
+    ProgressBar progress = ProgressBar(num_added);
 
     if ( verbose )
     {
@@ -1931,56 +2507,40 @@ void TreeSummary::summarize( bool verbose )
 
     size_t count = 0;
 
-    for (std::vector<TraceTree* >::iterator trace = traces.begin(); trace != traces.end(); ++trace)
+    for (size_t t = 0; t < traces.size(); ++t)
     {
-        for (size_t i = (*trace)->getBurnin(); i < (*trace)->size(); ++i)
+        if ( removed[t].first < removed[t].second )
         {
-            if ( verbose )
-            {
-                progress.update(count);
-                count++;
-            }
-
-            Tree tree = (*trace)->objectAt(i);
-
-            if ( rooted == false )
-            {
-                if ( outgroup )
-                {
-                    tree.reroot( *outgroup, false, true );
-                }
-                else
-                {
-                    tree.reroot( this_outgroup, false, true );
-                }
-            }
-
-            std::string newick = tree.getPlainNewickRepresentation();
-
-            tree_counts[newick]++;
+            removeTreeSamples( t, removed[t].first, removed[t].second );
+        }
 
-            // get the clades for this tree
-            RbBitSet b( tree.getNumberOfTips(), false );
-            collectTreeSample(tree.getRoot(), b, newick, clade_counts);
+        if ( added[t].first < added[t].second )
+        {
+            addTreeSamples( t, added[t].first, added[t].second, progress, count, verbose );
         }
     }
 
     // sort the clade samples in ascending frequency
-    for (std::map<Split, long>::iterator it = clade_counts.begin(); it != clade_counts.end(); ++it)
+    clade_samples.clear();
+    for (size_t i = 0; i < splits.size(); ++i)
     {
-//        if ( it->first.first.count() > 0 )
-//        if ( it->first.first.count() > 0 && it->first.first.count() < (num_taxa-1) )
+        if ( splits[i].count > 0 )
         {
-            clade_samples.insert( Sample<Split>(it->first, it->second) );
+            clade_samples.push_back( i );
         }
-
     }
+    std::sort( clade_samples.begin(), clade_samples.end(), [&](size_t a, size_t b) { return splits[a].count != splits[b].count ? splits[a].count < splits[b].count : splits[a].split < splits[b].split; } );
 
-    // sort the tree samples in ascending frequency
-    for (std::map<std::string, long>::iterator it = tree_counts.begin(); it != tree_counts.end(); ++it)
+    // sort the tree samples in ascending frequency (of equally frequent trees, the first sampled comes last)
+    tree_samples.clear();
+    for (size_t i = 0; i < topologies.size(); ++i)
     {
-        tree_samples.insert( Sample<std::string>(it->first, it->second) );
+        if ( topologies[i].count > 0 )
+        {
+            tree_samples.push_back( i );
+        }
     }
+    std::sort( tree_samples.begin(), tree_samples.end(), [&](size_t a, size_t b) { return topologies[a].count != topologies[b].count ? topologies[a].count < topologies[b].count : a > b; } );
 
     // finish progress bar
     if ( verbose )
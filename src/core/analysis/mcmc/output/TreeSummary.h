@@ -1,6 +1,10 @@
 #ifndef TreeSummary_H
 #define TreeSummary_H
 
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
 #include "Clade.h"
 #include "Trace.h"
 #include "Tree.h"
@@ -8,6 +12,7 @@
 namespace RevBayesCore {
 
     class MatrixReal;
+    class ProgressBar;
     class TraceTree;
 
     class TreeSummary {
@@ -35,15 +40,143 @@ namespace RevBayesCore {
         struct Split : public std::pair<RbBitSet, std::set<Taxon> >
         {
             Split( RbBitSet b, std::set<Taxon> m, bool r) : std::pair<RbBitSet, std::set<Taxon> >( !r && b[0] ? ~b : b, m) {}
+        };
+
+        /*
+         * This struct represents a sampled split with its number of samples and the ages (or branch lengths) of its nodes.
+         * The ages are kept separately for each trace and in the order of the samples, so that samples can be removed when the burnin changes.
+         */
+        struct SplitSample
+        {
+            Split                                   split;
+            uint64_t                                hash;
+            long                                    count;
+            std::vector<std::vector<double> >       ages;
+        };
+
+        /*
+         * This struct represents the ages of a split conditional on its parent split
+         */
+        struct ConditionalCladeSample
+        {
+            size_t                                  parent;
+            size_t                                  child;
+            long                                    count;
+            std::vector<std::vector<double> >       ages;
+        };
+
+        /*
+         * This struct represents a sampled tree topology.
+         * A topology is its (sorted) list of node splits, so we do not need to build a Newick string for every sample.
+         * We keep where we first sampled the topology to compute its Newick string when it is needed.
+         */
+        struct TopologySample
+        {
+            uint64_t                                hash;
+            long                                    count;
+            size_t                                  trace;
+            size_t                                  sample;
+            std::vector<size_t>                     splits;                 //!< the ids of the splits of the nodes, sorted
+            std::vector<size_t>                     conditional_clades;     //!< the ids of the conditional clades of the nodes (NO_ENTRY for the root)
+            std::vector<Taxon>                      sampled_ancestors;
+            std::vector<std::vector<double> >       ages;                   //!< the ages of the nodes in each trace, each sample in the order of splits
+        };
+
+        /*
+         * This struct records which samples of a trace we have summarized, so we only need to add or remove samples when the burnin changes
+         */
+        struct SummarizedTrace
+        {
+            size_t                                  revision;               //!< the value revision of the trace when we summarized it
+            size_t                                  first;                  //!< the first summarized sample
+            std::vector<size_t>                     topologies;             //!< the topologies of the summarized samples
+        };
+
+        /*
+         * This struct represents the split of a node of a single tree
+         */
+        struct NodeSplit
+        {
+            NodeSplit(const Split &s, uint64_t h, double a, size_t p) : split(s), hash(h), age(a), parent(p) {}
 
-            inline bool operator()(const Sample<Split>& s)
+            Split                   split;
+            uint64_t                hash;
+            double                  age;
+            size_t                  parent;         //!< the position of the parent node (or NO_ENTRY for the root)
+        };
+
+        /*
+         * Open-addressing hash index from 64-bit hashes to the positions of entries in a vector.
+         * Entries with the same hash are told apart by the comparison of the caller, so collisions are never confused.
+         */
+        class HashIndex
+        {
+        public:
+            HashIndex(void) : num_entries(0) {}
+
+            void clear(void)
+            {
+                slots.clear();
+                num_entries = 0;
+            }
+
+            template <class Equal>
+            size_t find(uint64_t h, const Equal &equal) const
+            {
+                if ( slots.empty() == true ) return NO_ENTRY;
+
+                size_t mask = slots.size() - 1;
+                for (size_t i = size_t(h) & mask; slots[i].entry != NO_ENTRY; i = (i + 1) & mask)
+                {
+                    if ( slots[i].hash == h && equal( slots[i].entry ) == true ) return slots[i].entry;
+                }
+                return NO_ENTRY;
+            }
+
+            void insert(uint64_t h, size_t entry)
             {
-                return (*this) == s.first;
+                // keep the table at most half full
+                if ( 2 * (num_entries + 1) > slots.size() )
+                {
+                    std::vector<Slot> old_slots( std::max( size_t(16), 2 * slots.size() ), Slot() );
+                    old_slots.swap( slots );
+                    for (size_t i = 0; i < old_slots.size(); ++i)
+                    {
+                        if ( old_slots[i].entry != NO_ENTRY ) place( old_slots[i] );
+                    }
+                }
+                Slot s;
+                s.hash = h;
+                s.entry = entry;
+                place( s );
+                ++num_entries;
             }
+
+        private:
+            struct Slot
+            {
+                Slot(void) : hash(0), entry(NO_ENTRY) {}
+
+                uint64_t            hash;
+                size_t              entry;
+            };
+
+            void place(const Slot &s)
+            {
+                size_t mask = slots.size() - 1;
+                size_t i = size_t(s.hash) & mask;
+                while ( slots[i].entry != NO_ENTRY ) i = (i + 1) & mask;
+                slots[i] = s;
+            }
+
+            std::vector<Slot>       slots;
+            size_t                  num_entries;
         };
 
     public:
 
+        static const size_t NO_ENTRY = size_t(-1);
+
         /*
          * This struct determines which annotations are reported in the summary tree
          */
@@ -95,13 +228,25 @@ namespace RevBayesCore {
 
     protected:
 
-        Split                                      collectTreeSample(const TopologyNode&, RbBitSet&, std::string, std::map<Split, long>&);
+        size_t                                     addTreeSample(size_t trace, size_t sample, const std::vector<NodeSplit> &node_splits, const std::vector<Taxon> &sampled_ancestors);
+        void                                       addTreeSamples(size_t trace, size_t first, size_t last, ProgressBar &progress, size_t &count, bool verbose);
+        size_t                                     collectNodeSplits(const TopologyNode& n, RbBitSet& intaxa, uint64_t& inhash, uint64_t all_taxa_hash, std::vector<NodeSplit> &node_splits, std::vector<Taxon> &sampled_ancestors) const;
+        void                                       computeNodeSplits(const Tree &t, std::vector<NodeSplit> &node_splits, std::vector<Taxon> &sampled_ancestors) const;
+        void                                       computeSampleSplits(const Tree &t, std::vector<NodeSplit> &node_splits, std::vector<Taxon> &sampled_ancestors) const;
         void                                       enforceNonnegativeBranchLengths(TopologyNode& tree) const;
-        long                                       splitFrequency(const Split &n) const;
+        size_t                                     findConditionalClade(size_t parent, size_t child) const;
+        size_t                                     findSplit(const Split &s, uint64_t h) const;
+        size_t                                     findTopology(const Tree &t) const;
         TopologyNode*                              findParentNode(TopologyNode&, const Split &, std::vector<TopologyNode*>&, RbBitSet& ) const;
+        std::vector<double>                        getTopologyAges(size_t topology, size_t split) const;
+        std::string                                getTopologyNewick(size_t topology) const;
         void                                       mapContinuous(Tree &inputTree, const std::string &n, size_t paramIndex, double hpd, bool np, bool verbose ) const;
         void                                       mapDiscrete(Tree &inputTree, const std::string &n, size_t paramIndex, size_t num, bool np, bool verbose ) const;
         void                                       mapParameters(Tree &inputTree, bool verbose) const;
+        void                                       removeTreeSamples(size_t trace, size_t first, size_t last);
+        long                                       splitCount(const Split &n) const;
+        long                                       splitFrequency(const Split &n) const;
+        uint64_t                                   splitHash(const Split &n) const;
         void                                       summarize(bool verbose);
 
         std::vector<TraceTree* >                   traces;
@@ -109,13 +254,17 @@ namespace RevBayesCore {
         bool                                       clock;
         bool                                       rooted;
 
-        std::set<Sample<Split> >                   clade_samples;
-        std::map<Taxon, long >                     sampled_ancestor_counts;
-        std::set<Sample<std::string> >             tree_samples;
+        std::vector<SplitSample>                   splits;                     //!< the sampled splits
+        HashIndex                                  split_index;
+        std::vector<ConditionalCladeSample>        conditional_clades;         //!< the ages of the splits conditional on their parent splits
+        HashIndex                                  conditional_clade_index;
+        std::vector<TopologySample>                topologies;                 //!< the sampled topologies
+        HashIndex                                  topology_index;
 
-        std::map<Split, std::vector<double> >                           clade_ages;
-        std::map<Split, std::map<Split, std::vector<double> > >         conditional_clade_ages;
-        std::map<std::string, std::map<Split, std::vector<double> > >   tree_clade_ages;
+        std::vector<size_t>                        clade_samples;              //!< the splits in ascending frequency
+        std::map<Taxon, long >                     sampled_ancestor_counts;
+        std::vector<size_t>                        tree_samples;               //!< the topologies in ascending frequency
+        std::vector<SummarizedTrace>               summarized_traces;
 
         boost::optional<Clade>                     outgroup;
     };
@@ -90,10 +90,10 @@ void TypedDagNode<double>::printValue(std::ostream &o, const std::string & /*sep
 {
     std::stringstream ss;
 
-    // if simple == FALSE, print with maximum precision allowed
+    // if simple == FALSE, print with the precision needed to read the exact value back in
     if (!simple)
     {
-        ss.precision(std::numeric_limits<double>::digits10);
+        ss.precision(std::numeric_limits<double>::max_digits10);
     }
 
     // otherwise, use standard RB precision
@@ -1,5 +1,9 @@
 #include "Parallelizable.h"
 
+#include "RandomNumberFactory.h"
+#include "RandomNumberGenerator.h"
+#include "RbConstants.h"
+#include "ThreadPool.h"
 
 #ifdef RB_MPI
 #include <mpi.h>
@@ -103,3 +107,70 @@ void Parallelizable::setActivePIDSpecialized(size_t a, size_t n )
     
     // nothing done here.
 }
+
+
+/**
+ * Run the jobs 0,...,n-1 concurrently on the threads of this process.
+ * Every job gets a fresh random number stream (see the overload below).
+ */
+void Parallelizable::runConcurrently(size_t n, const std::function<void(size_t)> &job) const
+{
+    
+    std::vector<RandomNumberGenerator> streams;
+    runConcurrently( n, job, streams );
+    
+}
+
+
+/**
+ * Run the jobs 0,...,n-1 concurrently on the threads of this process (see ThreadPool for the number of threads).
+ * Job i uses streams[i] as its random number generator, so that the results do not depend on the number of threads.
+ * Missing streams are seeded from the current random number generator, and the streams are kept by the caller,
+ * so repeated calls (e.g., one per generation) continue the same streams.
+ * A single job runs directly on the current random number generator, as it did before.
+ * The first exception thrown by a job is rethrown once all jobs have finished.
+ */
+void Parallelizable::runConcurrently(size_t n, const std::function<void(size_t)> &job, std::vector<RandomNumberGenerator> &streams) const
+{
+    
+    if ( n < 2 )
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            job(i);
+        }
+        return;
+    }
+    
+    // seed the missing streams, in the same way as the chains of an MCMCMC analysis
+    RandomNumberGenerator *rng = GLOBAL_RNG;
+    while ( streams.size() < n )
+    {
+        unsigned int seed = (unsigned int)( rng->uniform01() * RbConstants::Integer::max );
+        streams.push_back( RandomNumberGenerator() );
+        streams.back().setSeed( seed );
+    }
+    
+    ThreadPool::threadPoolInstance().parallelFor( n, [&](size_t i)
+    {
+        
+        // we restore the previous stream afterwards, because the pool may run nested jobs on the calling thread
+        RandomNumberFactory &rng_factory = RandomNumberFactory::randomNumberFactoryInstance();
+        RandomNumberGenerator *previous_rng = rng_factory.getThreadRandomNumberGenerator();
+        rng_factory.setThreadRandomNumberGenerator( &streams[i] );
+        
+        try
+        {
+            job(i);
+        }
+        catch (...)
+        {
+            rng_factory.setThreadRandomNumberGenerator( previous_rng );
+            throw;
+        }
+        
+        rng_factory.setThreadRandomNumberGenerator( previous_rng );
+        
+    });
+    
+}
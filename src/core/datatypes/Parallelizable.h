@@ -2,14 +2,20 @@
 #define Parallelizable_H
 
 #include <stddef.h>
+#include <functional>
+#include <vector>
 
 namespace RevBayesCore {
     
+    class RandomNumberGenerator;
     
     /**
      * Interace for Parallelizable classes.
      *
      * The Parallelizable interface provides a mechanism for code parallelization.
+     * The work is distributed over processes (MPI) using the active PID and the number of processes.
+     * Within a process, independent jobs (e.g., replicates or stones) can be run concurrently on threads
+     * using runConcurrently(). Each job then uses its own random number stream.
      *
      *
      * @copyright Copyright 2009-
@@ -34,6 +40,9 @@ namespace RevBayesCore {
         Parallelizable&                 operator=(const Parallelizable &p);                                     //!< Overloaded assignment operator
         
         
+        void                            runConcurrently(size_t n, const std::function<void(size_t)> &job) const;                                                            //!< Run the jobs 0,...,n-1 on the threads of this process.
+        void                            runConcurrently(size_t n, const std::function<void(size_t)> &job, std::vector<RandomNumberGenerator> &streams) const;               //!< Run the jobs 0,...,n-1 on the threads of this process, continuing the given random number streams.
+        
         // protected methods that derived classes can overwrite
         virtual void                    setActivePIDSpecialized(size_t a, size_t n);                            //!< Set the active PID in a specialized way for derived classes.
         
@@ -61,7 +61,7 @@ namespace RevBayesCore {
         {
             std::stringstream ss;
             // set precision of stringstream to max
-            ss.precision(std::numeric_limits<double>::digits10);
+            ss.precision(std::numeric_limits<double>::max_digits10);
             ss << a;
             std::string s = ss.str();
             if ( l > 0 )
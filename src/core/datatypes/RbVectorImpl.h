@@ -136,7 +136,7 @@ namespace RevBayesCore {
         }
         void                                                printForComplexStoring( std::ostream &o, const std::string &sep, int l, bool left, bool flatten = true ) const
         {
-            o.precision( std::numeric_limits<double>::digits10 );
+            o.precision( std::numeric_limits<double>::max_digits10 );
 
             if (flatten) {
                 for (size_t i=0; i<size(); ++i)
@@ -299,7 +299,7 @@ namespace RevBayesCore {
         void                                                printForComplexStoring( std::ostream &o, const std::string &sep, int l, bool left, bool flatten = true ) const
         {
             // set precision to maximum
-            o.precision( std::numeric_limits<double>::digits10 );
+            o.precision( std::numeric_limits<double>::max_digits10 );
 
             // if flatten == TRUE, save each element of vector separately
             if (flatten) {
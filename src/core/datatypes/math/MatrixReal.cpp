@@ -8,6 +8,7 @@
 #include "CholeskyDecomposition.h"
 #include "EigenSystem.h"
 #include "MatrixReal.h"
+#include "MatrixRealKernels.h"
 #include "RbException.h"
 #include "RbVector.h"
 #include "RbConstants.h"
@@ -35,7 +36,7 @@ MatrixReal::MatrixReal( size_t n, size_t k)
 
 
 MatrixReal::MatrixReal( size_t n, size_t k, double v) :
-    elements( RbVector<RbVector<double> >(n, RbVector<double>(k,v) ) ),
+    elements( n*k, v ),
     n_rows( n ),
     n_cols( k )
 {
@@ -76,6 +77,14 @@ MatrixReal& MatrixReal::operator=(const MatrixReal &m)
         
         eigen_needs_update = true;
         cholesky_needs_update = true;
+        
+        // if both matrices use a cholesky decomposition, we copy a current one instead of recomputing it later
+        if ( use_cholesky_decomp == true && m.use_cholesky_decomp == true && m.cholesky_decomp != NULL && m.cholesky_needs_update == false )
+        {
+            delete cholesky_decomp;
+            cholesky_decomp = new CholeskyDecomposition( this, *m.cholesky_decomp );
+            cholesky_needs_update = false;
+        }
     }
     
     return *this;
@@ -96,38 +105,30 @@ MatrixReal& MatrixReal::operator=(MatrixReal &&m)
 }
 
 
-RbVector<double>& MatrixReal::operator[]( size_t index )
-{
-    // to be safe
-    eigen_needs_update = true;
-    cholesky_needs_update = true;
-    
-    return elements[index];
-}
-
-
-
-const RbVector<double>& MatrixReal::operator[]( size_t index ) const
-{
-    return elements[index];
-}
-
-
 void MatrixReal::addColumn( void )
 {
 
+    // the rows move, so we copy them into a new buffer
+    std::vector<double, AlignedAllocator<double> > new_elements( n_rows * (n_cols+1), 0.0 );
     for (size_t i=0; i<n_rows; ++i)
     {
-        elements[i].push_back( 0.0 );
+        std::copy( elements.begin() + i*n_cols, elements.begin() + (i+1)*n_cols, new_elements.begin() + i*(n_cols+1) );
     }
+    elements.swap( new_elements );
     ++n_cols;
+    
+    eigen_needs_update = true;
+    cholesky_needs_update = true;
 }
 
 
 void MatrixReal::addRow( void )
 {
-    elements.push_back( RbVector<double>(n_cols, 0.0) );
+    elements.resize( (n_rows+1) * n_cols, 0.0 );
     ++n_rows;
+    
+    eigen_needs_update = true;
+    cholesky_needs_update = true;
 }
 
 
@@ -138,6 +139,8 @@ void MatrixReal::clear( void )
     cholesky_needs_update = true;
     
     elements.clear();
+    n_rows = 0;
+    n_cols = 0;
 }
 
 
@@ -180,18 +183,33 @@ MatrixReal* MatrixReal::clone(void) const
 void MatrixReal::deleteColumn(size_t index)
 {
 
+    // we move the remaining elements forward, row by row
+    size_t k = 0;
     for (size_t i=0; i<n_rows; ++i)
     {
-        elements[i].erase( elements[i].begin()+index );
+        for (size_t j=0; j<n_cols; ++j)
+        {
+            if ( j != index )
+            {
+                elements[k++] = elements[i*n_cols+j];
+            }
+        }
     }
     --n_cols;
+    elements.resize( n_rows * n_cols );
+    
+    eigen_needs_update = true;
+    cholesky_needs_update = true;
 }
 
 
 void MatrixReal::deleteRow(size_t index)
 {
-    elements.erase( elements.begin()+index );
+    elements.erase( elements.begin() + index*n_cols, elements.begin() + (index+1)*n_cols );
     --n_rows;
+    
+    eigen_needs_update = true;
+    cholesky_needs_update = true;
 }
 
 
@@ -201,7 +219,7 @@ void MatrixReal::executeMethod(const std::string &n, const std::vector<const Dag
     if ( n == "[]" )
     {
         int index = (int)static_cast<const TypedDagNode<long> *>( args[0] )->getValue()-1;
-        rv = elements[index];
+        rv = (*this)[index];
     }
     else if ( n == "upperTriangle" )
     {
@@ -248,7 +266,7 @@ RbVector<double> MatrixReal::getColumn( size_t columnIndex ) const
 
     for (size_t i = 0; i < n_rows; ++i)
     {
-        col[i] = elements[i][columnIndex];
+        col[i] = elements[i*n_cols+columnIndex];
     }
     
     return col;
@@ -265,7 +283,7 @@ RbVector<double> MatrixReal::getDiagonal( void ) const
     
     for (size_t i = 0; i < n_rows; ++i)
     {
-        diagonal_elements[i] = elements[i][i];
+        diagonal_elements[i] = elements[i*n_cols+i];
     }
     
     return diagonal_elements;
@@ -322,7 +340,7 @@ double MatrixReal::getDet() const
     {
         for (int i=0; i<n_rows; ++i)
         {
-            logDet += log(elements[i][i]);
+            logDet += log(elements[i*n_cols+i]);
         }
     }
     else
@@ -361,9 +379,9 @@ void MatrixReal::getIndexOfMin(size_t& row, size_t& col) const
     {
         for (size_t j = 0; j < n_cols; ++j)
         {
-            if ( min > elements[i][j] )
+            if ( min > elements[i*n_cols+j] )
             {
-                min = elements[i][j];
+                min = elements[i*n_cols+j];
                 row = i;
                 col = j;
             }
@@ -381,7 +399,7 @@ double MatrixReal::getLogDet() const
         double logDet = 0;
         for (int i = 0; i < n_rows; ++i)
         {
-            logDet += log(elements[i][i]);
+            logDet += log(elements[i*n_cols+i]);
         }
         return logDet;
     }
@@ -421,9 +439,9 @@ double MatrixReal::getMax( void ) const
     {
         for (size_t j = 0; j < n_cols; ++j)
         {
-            if ( max < elements[i][j] )
+            if ( max < elements[i*n_cols+j] )
             {
-                max = elements[i][j];
+                max = elements[i*n_cols+j];
             }
         }
     }
@@ -441,9 +459,9 @@ double MatrixReal::getMin( void ) const
     {
         for (size_t j = 0; j < n_cols; ++j)
         {
-            if ( min > elements[i][j] )
+            if ( min > elements[i*n_cols+j] )
             {
-                min = elements[i][j];
+                min = elements[i*n_cols+j];
             }
         }
     }
@@ -473,7 +491,7 @@ MatrixReal MatrixReal::getTranspose( void )
     {
         for (size_t j = 0; j < n_cols; ++j)
         {
-            T[j][i] = elements[i][j];
+            T[j][i] = elements[i*n_cols+j];
         }
     }
     
@@ -495,7 +513,7 @@ RbVector<double> MatrixReal::getUpperTriangle( void ) const
     {
         for (size_t j = i + 1; j < n_cols; ++j)
         {
-            upper_triangle_elements[k++] = elements[i][j];
+            upper_triangle_elements[k++] = elements[i*n_cols+j];
         }
     }
     
@@ -516,7 +534,7 @@ bool MatrixReal::isDiagonal(void) const
     {
         for (int j = i + 1; j < n_cols; ++j)
         {
-            if (elements[i][j] != 0.0 || elements[j][i] != 0.0)
+            if (elements[i*n_cols+j] != 0.0 || elements[j*n_cols+i] != 0.0)
             {
                 return false;
             }
@@ -561,7 +579,7 @@ bool MatrixReal::isSymmetric( void ) const
     {
         for (int j = i + 1; j < n_cols; ++j)
         {
-            if (elements[i][j] != elements[j][i])
+            if (elements[i*n_cols+j] != elements[j*n_cols+i])
             {
                 return false;
             }
@@ -571,13 +589,51 @@ bool MatrixReal::isSymmetric( void ) const
     return symm;
 }
 
+/**
+ * Add the rank-one matrix alpha x x^T.
+ * If the cholesky decomposition is used and current, we modify it in O(n^2) instead of recomputing it.
+ */
+void MatrixReal::rankOneUpdate(const std::vector<double> &x, double alpha)
+{
+    
+    if ( n_rows != n_cols || x.size() != n_rows )
+    {
+        throw RbException() << "Cannot add a rank-one matrix of dimension " << x.size() << " to a " << n_rows << " x " << n_cols << " matrix.";
+    }
+    
+    for (size_t i = 0; i < n_rows; ++i)
+    {
+        if ( x[i] != 0.0 )
+        {
+            double* row = elements.data() + i*n_cols;
+            double alpha_x_i = alpha * x[i];
+            for (size_t j = 0; j < n_cols; ++j)
+            {
+                row[j] += alpha_x_i * x[j];
+            }
+        }
+    }
+    
+    eigen_needs_update = true;
+    if ( use_cholesky_decomp == true && cholesky_decomp != NULL && cholesky_needs_update == false )
+    {
+        cholesky_decomp->rankOneUpdate( x, alpha );
+    }
+    else
+    {
+        cholesky_needs_update = true;
+    }
+    
+}
+
+
 void MatrixReal::resize(size_t r, size_t c)
 {
     
-    elements = RbVector<RbVector<double> >(r, RbVector<double>(c,0.0) );
+    elements.assign( r*c, 0.0 );
     
     n_rows = r;
-    n_rows = c;
+    n_cols = c;
     
     eigen_needs_update = true;
     cholesky_needs_update = true;
@@ -987,7 +1043,7 @@ MatrixReal& MatrixReal::operator+=(double b)
     {
 		for (size_t j=0; j<n_cols; j++)
         {
-			elements[i][j] += b;
+			elements[i*n_cols+j] += b;
         }
     }
     
@@ -1011,7 +1067,7 @@ MatrixReal& MatrixReal::operator-=(double b)
     {
 		for (size_t j=0; j<n_cols; j++)
         {
-			elements[i][j] -= b;
+			elements[i*n_cols+j] -= b;
         }
     }
     
@@ -1035,7 +1091,7 @@ MatrixReal& MatrixReal::operator*=(double b)
     {
 		for (size_t j=0; j<n_cols; j++)
         {
-			elements[i][j] *= b;
+			elements[i*n_cols+j] *= b;
         }
     }
     
@@ -1147,7 +1203,7 @@ MatrixReal&  MatrixReal::operator+=(const MatrixReal& B)
         {
 			for (size_t j=0; j<n_cols; j++)
             {
-				elements[i][j] += B[i][j];
+				elements[i*n_cols+j] += B[i][j];
             }
         }
     }
@@ -1179,7 +1235,7 @@ MatrixReal& MatrixReal::operator-=(const MatrixReal& B)
         {
 			for (size_t j=0; j<n_cols; j++)
             {
-				elements[i][j] -= B[i][j];
+				elements[i*n_cols+j] -= B[i][j];
             }
         }
     }
@@ -1210,20 +1266,14 @@ MatrixReal& MatrixReal::operator*=(const MatrixReal& B)
 	if ( n_cols == b_rows )
     {
 		MatrixReal C(n_rows, b_cols, 0.0 );
-		for (size_t i=0; i<n_rows; i++)
-        {
-			for (size_t j=0; j<b_cols; j++)
-            {
-				double sum = 0.0;
-				for (size_t k=0; k<n_cols; k++)
-					sum += elements[i][k] * B[k][j];
-				C[i][j] = sum;
-            }
-        }
+        MatrixRealKernels::multiply( elements.data(), B.elements.data(), C.elements.data(), n_rows, n_cols, b_cols );
         
         n_cols = C.n_cols;
         n_rows = C.n_rows;
-        elements = C.elements;
+        elements.swap( C.elements );
+        
+        eigen_needs_update = true;
+        cholesky_needs_update = true;
     }
     else
     {
@@ -1242,7 +1292,7 @@ std::vector<double> MatrixReal::operator*(const std::vector<double> &V) const
     {
         for (unsigned int j = 0; j < V.size(); j++)
         {
-            E[i] = E[i] + elements[i][j] * V[j];
+            E[i] = E[i] + elements[i*n_cols+j] * V[j];
         }
     }
     
@@ -18,10 +18,13 @@
 #ifndef MatrixReal_H
 #define MatrixReal_H
 
+#include "AlignedAllocator.h"
 #include "Cloneable.h"
 #include "MemberObject.h"
+#include "RbException.h"
 #include "RbVector.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <vector>
@@ -31,6 +34,56 @@ namespace RevBayesCore {
     class EigenSystem;
     class CholeskyDecomposition;
     
+    
+    /**
+     * A row of a MatrixReal, i.e., a view of the contiguous elements of that row.
+     *
+     * A row can be indexed, iterated and assigned like the RbVector<double> that the matrix used to store per row,
+     * and it converts into an RbVector<double> where a copy is needed.
+     * Assigning to a row copies the values into the matrix (the number of values must match).
+     */
+    template <class valueType>
+    class MatrixRealRow {
+        
+    public:
+        MatrixRealRow(valueType *v, size_t n) : values( v ), num_values( n ) {}
+        MatrixRealRow(const MatrixRealRow &r) = default;
+        
+        MatrixRealRow&                          operator=(const MatrixRealRow &r) { assign( r.begin(), r.size() ); return *this; }
+        template <class otherType>
+        MatrixRealRow&                          operator=(const MatrixRealRow<otherType> &r) { assign( r.begin(), r.size() ); return *this; }
+        MatrixRealRow&                          operator=(const std::vector<double> &v) { assign( v.data(), v.size() ); return *this; }
+        valueType&                              operator[](size_t i) const { return values[i]; }
+                                                operator RbVector<double>() const { return RbVector<double>( std::vector<double>( values, values + num_values ) ); }
+        
+        valueType*                              begin(void) const { return values; }
+        valueType*                              data(void) const { return values; }
+        bool                                    empty(void) const { return num_values == 0; }
+        valueType*                              end(void) const { return values + num_values; }
+        size_t                                  size(void) const { return num_values; }
+        
+    private:
+        void                                    assign(const double *v, size_t n)
+                                                {
+                                                    if ( n != num_values )
+                                                    {
+                                                        throw RbException() << "Cannot assign " << n << " values to a matrix row with " << num_values << " columns.";
+                                                    }
+                                                    std::copy( v, v + n, values );
+                                                }
+        
+        valueType*                              values;
+        size_t                                  num_values;
+    };
+    
+    
+    /**
+     * A dense matrix of real numbers.
+     *
+     * The elements are stored in a single contiguous, row-major buffer that is aligned to a cache line.
+     * Thus, m[i][j] is the element m.data()[i*n_cols+j], and m[i] is a view of the i-th row.
+     * The matrix products, the inverse and the Cholesky decomposition use the blocked, vectorized kernels of MatrixRealKernels.
+     */
     class MatrixReal : public Cloneable, public MemberObject<RbVector<double> >, public MemberObject<MatrixReal> {
         
     public:
@@ -46,8 +99,8 @@ namespace RevBayesCore {
         // overloaded operators
         MatrixReal&                             operator=(const MatrixReal& m);
         MatrixReal&                             operator=(MatrixReal&& m);
-        RbVector<double>&                       operator[](size_t index);
-        const RbVector<double>&                 operator[](size_t index) const;
+        MatrixRealRow<double>                   operator[](size_t index);
+        MatrixRealRow<const double>             operator[](size_t index) const;
 
         bool                                    operator==(const MatrixReal &m) const { return this == &m; }
         bool                                    operator!=(const MatrixReal &m) const { return !operator==(m); }
@@ -81,6 +134,8 @@ namespace RevBayesCore {
         void                                    clear(void);
         MatrixReal*                             clone(void) const;
         MatrixReal                              computeInverse(void) const;
+        double*                                 data(void);                                                                                             //!< The elements in row-major order
+        const double*                           data(void) const;                                                                                       //!< The elements in row-major order
         void                                    deleteColumn(size_t index);
         void                                    deleteRow(size_t index);
         void                                    executeMethod(const std::string &n, const std::vector<const DagNode*> &args, RbVector<double> &rv) const;       //!< Map the member methods to internal function calls
@@ -106,6 +161,7 @@ namespace RevBayesCore {
         bool                                    isSquareMatrix(void) const;
         bool                                    isSymmetric(void) const;
         bool                                    isUsingCholesky(void) const { return use_cholesky_decomp; }
+        void                                    rankOneUpdate(const std::vector<double> &x, double alpha);                                              //!< Add alpha x x^T, keeping a current Cholesky decomposition current
         void                                    setCholesky(bool c) const;
 
         size_t                                  size(void) const;
@@ -116,7 +172,7 @@ namespace RevBayesCore {
         void                                    update(void) const;
 
         // members
-        RbVector<RbVector<double> >             elements;
+        std::vector<double, AlignedAllocator<double> >  elements;                                                                                 //!< The elements in row-major order
 
         size_t                                  n_rows = 0;
         size_t                                  n_cols = 0;
@@ -129,6 +185,39 @@ namespace RevBayesCore {
 
     };
     
+    
+    inline MatrixRealRow<double> MatrixReal::operator[]( size_t index )
+    {
+        // to be safe
+        eigen_needs_update = true;
+        cholesky_needs_update = true;
+        
+        return MatrixRealRow<double>( elements.data() + index * n_cols, n_cols );
+    }
+    
+    
+    inline MatrixRealRow<const double> MatrixReal::operator[]( size_t index ) const
+    {
+        return MatrixRealRow<const double>( elements.data() + index * n_cols, n_cols );
+    }
+    
+    
+    inline double* MatrixReal::data( void )
+    {
+        // to be safe
+        eigen_needs_update = true;
+        cholesky_needs_update = true;
+        
+        return elements.data();
+    }
+    
+    
+    inline const double* MatrixReal::data( void ) const
+    {
+        return elements.data();
+    }
+    
+    
     // Global functions using the class
     std::ostream&                       operator<<(std::ostream& o, const MatrixReal& x);                                           //!< Overloaded output operator
 
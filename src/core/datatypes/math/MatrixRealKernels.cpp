@@ -0,0 +1,197 @@
+#include "MatrixRealKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if ( defined(__x86_64__) || defined(__i386__) ) && defined(__GNUC__)
+#define RB_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // the block sizes are chosen so that the blocks being reused fit into a 256 KB cache
+    const size_t BLOCK_INNER    = 128;                  //!< The number of rows of b applied together in a product
+    const size_t BLOCK_COLUMNS  = 256;                  //!< The number of columns of a product computed together
+    const size_t BLOCK_ROWS     = 32;                   //!< The number of rows of a factorization (or of a result) kept together
+
+    enum InstructionSet { SCALAR, SSE, AVX2 };
+
+    /*
+     * Scalar kernels
+     */
+    namespace scalar {
+
+        typedef double Vector;
+        const size_t WIDTH = 1;
+
+        inline Vector set1(double x)                                        { return x; }
+        inline Vector load(const double* p)                                 { return *p; }
+        inline void   store(double* p, Vector v)                            { *p = v; }
+        inline Vector add(Vector a, Vector b)                               { return a + b; }
+        inline Vector mul(Vector a, Vector b)                               { return a * b; }
+
+#       include "MatrixRealKernelsImpl.h"
+
+    }
+
+#if defined( RB_X86_KERNELS )
+
+    /*
+     * SSE2 kernels
+     */
+#if defined(__clang__)
+#   pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#else
+#   pragma GCC push_options
+#   pragma GCC target("sse2")
+#endif
+
+    namespace sse {
+
+        typedef __m128d Vector;
+        const size_t WIDTH = 2;
+
+        inline Vector set1(double x)                                        { return _mm_set1_pd(x); }
+        inline Vector load(const double* p)                                 { return _mm_loadu_pd(p); }
+        inline void   store(double* p, Vector v)                            { _mm_storeu_pd(p, v); }
+        inline Vector add(Vector a, Vector b)                               { return _mm_add_pd(a, b); }
+        inline Vector mul(Vector a, Vector b)                               { return _mm_mul_pd(a, b); }
+
+#       include "MatrixRealKernelsImpl.h"
+
+    }
+
+#if defined(__clang__)
+#   pragma clang attribute pop
+#else
+#   pragma GCC pop_options
+#endif
+
+
+    /*
+     * AVX2 kernels
+     * Note, we do not enable FMA so that the compiler cannot fuse the multiplications and additions.
+     */
+#if defined(__clang__)
+#   pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#   pragma GCC push_options
+#   pragma GCC target("avx2")
+#endif
+
+    namespace avx2 {
+
+        typedef __m256d Vector;
+        const size_t WIDTH = 4;
+
+        inline Vector set1(double x)                                        { return _mm256_set1_pd(x); }
+        inline Vector load(const double* p)                                 { return _mm256_loadu_pd(p); }
+        inline void   store(double* p, Vector v)                            { _mm256_storeu_pd(p, v); }
+        inline Vector add(Vector a, Vector b)                               { return _mm256_add_pd(a, b); }
+        inline Vector mul(Vector a, Vector b)                               { return _mm256_mul_pd(a, b); }
+
+#       include "MatrixRealKernelsImpl.h"
+
+    }
+
+#if defined(__clang__)
+#   pragma clang attribute pop
+#else
+#   pragma GCC pop_options
+#endif
+
+#endif
+
+
+    InstructionSet detectInstructionSet(void)
+    {
+
+#if defined( RB_X86_KERNELS )
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx2") )
+        {
+            return AVX2;
+        }
+        if ( __builtin_cpu_supports("sse2") )
+        {
+            return SSE;
+        }
+#endif
+
+        return SCALAR;
+    }
+
+
+    InstructionSet getInstructionSet(void)
+    {
+
+        static const InstructionSet best_instruction_set = detectInstructionSet();
+
+        return best_instruction_set;
+    }
+
+}
+
+
+void MatrixRealKernels::multiply(const double* a, const double* b, double* c, size_t m, size_t n, size_t p)
+{
+
+    switch ( getInstructionSet() )
+    {
+#if defined( RB_X86_KERNELS )
+        case AVX2:      avx2::multiply(a, b, c, m, n, p); break;
+        case SSE:       sse::multiply(a, b, c, m, n, p); break;
+#endif
+        default:        scalar::multiply(a, b, c, m, n, p); break;
+    }
+
+}
+
+
+void MatrixRealKernels::choleskyUpper(double* a, size_t n, bool &positive_definite, bool &positive_semidefinite)
+{
+
+    switch ( getInstructionSet() )
+    {
+#if defined( RB_X86_KERNELS )
+        case AVX2:      avx2::choleskyUpper(a, n, positive_definite, positive_semidefinite); break;
+        case SSE:       sse::choleskyUpper(a, n, positive_definite, positive_semidefinite); break;
+#endif
+        default:        scalar::choleskyUpper(a, n, positive_definite, positive_semidefinite); break;
+    }
+
+}
+
+
+void MatrixRealKernels::invertLowerTriangular(const double* l, double* x, size_t n)
+{
+
+    switch ( getInstructionSet() )
+    {
+#if defined( RB_X86_KERNELS )
+        case AVX2:      avx2::invertLowerTriangular(l, x, n); break;
+        case SSE:       sse::invertLowerTriangular(l, x, n); break;
+#endif
+        default:        scalar::invertLowerTriangular(l, x, n); break;
+    }
+
+}
+
+
+void MatrixRealKernels::multiplyLowerTransposed(const double* x, double* c, size_t n)
+{
+
+    switch ( getInstructionSet() )
+    {
+#if defined( RB_X86_KERNELS )
+        case AVX2:      avx2::multiplyLowerTransposed(x, c, n); break;
+        case SSE:       sse::multiplyLowerTransposed(x, c, n); break;
+#endif
+        default:        scalar::multiplyLowerTransposed(x, c, n); break;
+    }
+
+}
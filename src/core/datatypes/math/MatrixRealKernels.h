@@ -0,0 +1,40 @@
+#ifndef MatrixRealKernels_H
+#define MatrixRealKernels_H
+
+#include <stddef.h>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Cache-blocked, vectorized kernels for the dense linear algebra of MatrixReal.
+     *
+     * All matrices are contiguous and row-major. The kernels are written as row updates (y += a*x), so the
+     * inner loops run over contiguous memory. They are blocked so that the rows being updated stay in the cache
+     * while several updates are applied to them. The kernels are compiled for plain scalar code, SSE2 and AVX2;
+     * the best instruction set supported by the CPU is detected once at runtime (with function-specific target
+     * attributes, so no special compiler flags are needed).
+     *
+     * Every element is updated in the same order by all instruction sets and no multiply-adds are fused,
+     * so the results are bit-identical on every machine. The matrix product accumulates in the same order
+     * as the plain triple loop (c[i][j] = 0 + a[i][0]*b[0][j] + a[i][1]*b[1][j] + ...).
+     */
+    namespace MatrixRealKernels {
+
+        // c (m x p) = a (m x n) * b (n x p); c must not overlap a or b
+        void                        multiply(const double* a, const double* b, double* c, size_t m, size_t n, size_t p);
+
+        // in-place Cholesky factorization of the upper triangle of a (n x n): on return, the upper triangle holds U with U^T U = A
+        // the lower triangle is not used; the flags tell whether all pivots were positive (definite) or non-negative (semidefinite)
+        void                        choleskyUpper(double* a, size_t n, bool &positive_definite, bool &positive_semidefinite);
+
+        // x = l^-1 for a lower triangular matrix l (n x n); the upper triangle of x is set to 0
+        void                        invertLowerTriangular(const double* l, double* x, size_t n);
+
+        // c = x^T x for a lower triangular matrix x (n x n)
+        void                        multiplyLowerTransposed(const double* x, double* c, size_t n);
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ * The bodies of the MatrixReal kernels.
+ *
+ * This file is included once per instruction set by MatrixRealKernels.cpp, each time inside its own namespace
+ * and with the target of the surrounding functions set accordingly. Before the inclusion, the namespace has to provide
+ *
+ *    Vector                                    the vector type
+ *    WIDTH                                     the number of doubles in a vector
+ *    set1(x)                                   initialization
+ *    load(p), store(p,v)                       unaligned loads and stores of WIDTH values
+ *    add(a,b), mul(a,b)                        the arithmetic (which must not be fused)
+ *
+ * There are deliberately no include guards.
+ */
+
+
+/**
+ * y[0,n) += a * x[0,n)
+ * The remaining values after the last full vector are updated with the same (unfused) arithmetic.
+ */
+inline void axpy(double* y, double a, const double* x, size_t n)
+{
+
+    Vector va = set1( a );
+
+    size_t i = 0;
+    for (; i + 2*WIDTH <= n; i += 2*WIDTH)
+    {
+        Vector y0 = add( load( y + i ), mul( va, load( x + i ) ) );
+        Vector y1 = add( load( y + i + WIDTH ), mul( va, load( x + i + WIDTH ) ) );
+        store( y + i, y0 );
+        store( y + i + WIDTH, y1 );
+    }
+    for (; i + WIDTH <= n; i += WIDTH)
+    {
+        store( y + i, add( load( y + i ), mul( va, load( x + i ) ) ) );
+    }
+    for (; i < n; ++i)
+    {
+        double ax = a * x[i];
+        y[i] = y[i] + ax;
+    }
+
+}
+
+
+/**
+ * c = a * b, computed as row updates c[i] += a[i][k] * b[k] with k ascending.
+ * We block over k and over the columns, so that a block of b stays in the cache while it is applied to all rows of c.
+ */
+inline void multiply(const double* a, const double* b, double* c, size_t m, size_t n, size_t p)
+{
+
+    for (size_t i = 0; i < m*p; ++i)
+    {
+        c[i] = 0.0;
+    }
+
+    for (size_t k_begin = 0; k_begin < n; k_begin += BLOCK_INNER)
+    {
+        size_t k_end = std::min( k_begin + BLOCK_INNER, n );
+        for (size_t j_begin = 0; j_begin < p; j_begin += BLOCK_COLUMNS)
+        {
+            size_t j_end = std::min( j_begin + BLOCK_COLUMNS, p );
+            for (size_t i = 0; i < m; ++i)
+            {
+                const double* a_row = a + i*n;
+                double* c_row = c + i*p + j_begin;
+                for (size_t k = k_begin; k < k_end; ++k)
+                {
+                    axpy( c_row, a_row[k], b + k*p + j_begin, j_end - j_begin );
+                }
+            }
+        }
+    }
+
+}
+
+
+/**
+ * Right-looking Cholesky factorization of the upper triangle (A = U^T U), in place.
+ * Once row j of U is known, it is subtracted from all later rows: a[r][c] -= u[j][r] * u[j][c] for c >= r.
+ * We factor panels of BLOCK_ROWS rows and then apply the whole panel to each later row, so that this row stays in the cache.
+ * Every element receives its updates in the order of j, exactly as in the unblocked algorithm.
+ */
+inline void choleskyUpper(double* a, size_t n, bool &positive_definite, bool &positive_semidefinite)
+{
+
+    positive_definite = true;
+    positive_semidefinite = true;
+
+    for (size_t j_begin = 0; j_begin < n; j_begin += BLOCK_ROWS)
+    {
+        size_t j_end = std::min( j_begin + BLOCK_ROWS, n );
+
+        // factor the rows of the panel
+        for (size_t j = j_begin; j < j_end; ++j)
+        {
+            double* row_j = a + j*n;
+
+            double pivot = row_j[j];
+            if ( pivot < 0.0 )
+            {
+                positive_semidefinite = false;
+            }
+            if ( pivot <= 0.0 )
+            {
+                positive_definite = false;
+            }
+
+            row_j[j] = std::sqrt( pivot );
+            double inverse_pivot = 1.0 / row_j[j];
+            for (size_t c = j+1; c < n; ++c)
+            {
+                row_j[c] = inverse_pivot * row_j[c];
+            }
+
+            // update the remaining rows of the panel
+            for (size_t r = j+1; r < j_end; ++r)
+            {
+                axpy( a + r*n + r, -row_j[r], row_j + r, n - r );
+            }
+        }
+
+        // update the later rows with the whole panel
+        for (size_t r = j_end; r < n; ++r)
+        {
+            double* row_r = a + r*n + r;
+            for (size_t j = j_begin; j < j_end; ++j)
+            {
+                const double* row_j = a + j*n;
+                axpy( row_r, -row_j[r], row_j + r, n - r );
+            }
+        }
+    }
+
+}
+
+
+/**
+ * Invert a lower triangular matrix row by row: x[i][j] = -(sum_{k=j}^{i-1} l[i][k] * x[k][j]) / l[i][i].
+ * The sum for the whole row is accumulated with row updates x[i] += l[i][k] * x[k], k ascending.
+ */
+inline void invertLowerTriangular(const double* l, double* x, size_t n)
+{
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        double* x_i = x + i*n;
+        const double* l_i = l + i*n;
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            x_i[j] = 0.0;
+        }
+
+        // row k of x is zero after the diagonal
+        for (size_t k = 0; k < i; ++k)
+        {
+            axpy( x_i, l_i[k], x + k*n, k+1 );
+        }
+
+        double inverse_diagonal = 1.0 / l_i[i];
+        for (size_t j = 0; j < i; ++j)
+        {
+            x_i[j] = -x_i[j] * inverse_diagonal;
+        }
+        x_i[i] = inverse_diagonal;
+    }
+
+}
+
+
+/**
+ * c = x^T x for a lower triangular x, i.e., c[a][b] = sum_{i >= max(a,b)} x[i][a] * x[i][b], with i ascending.
+ * We accumulate a block of BLOCK_ROWS rows of c at a time over all rows of x, so that the block stays in the cache.
+ * The result is exactly symmetric.
+ */
+inline void multiplyLowerTransposed(const double* x, double* c, size_t n)
+{
+
+    for (size_t i = 0; i < n*n; ++i)
+    {
+        c[i] = 0.0;
+    }
+
+    for (size_t a_begin = 0; a_begin < n; a_begin += BLOCK_ROWS)
+    {
+        size_t a_end = std::min( a_begin + BLOCK_ROWS, n );
+        for (size_t i = a_begin; i < n; ++i)
+        {
+            const double* x_i = x + i*n;
+            size_t a_last = std::min( a_end, i+1 );
+            for (size_t a = a_begin; a < a_last; ++a)
+            {
+                // row i of x is zero after the diagonal
+                axpy( c + a*n, x_i[a], x_i, i+1 );
+            }
+        }
+    }
+
+}
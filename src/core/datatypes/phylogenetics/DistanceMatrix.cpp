@@ -100,14 +100,14 @@ size_t DistanceMatrix::size(void) const
 }
 
 
-RbVector<double>& DistanceMatrix::operator[]( size_t index )
+MatrixRealRow<double> DistanceMatrix::operator[]( size_t index )
 {
 	
 	return matrix[index];
 }
 
 
-const RbVector<double>& DistanceMatrix::operator[]( size_t index ) const
+MatrixRealRow<const double> DistanceMatrix::operator[]( size_t index ) const
 {
 	return matrix[index];
 }
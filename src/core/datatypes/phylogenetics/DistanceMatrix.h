@@ -41,8 +41,8 @@ template <class valueType> class RbVector;
 		size_t                                          getSize(void) const;                 //!< Get the number of tips of the tree associated with the matrix
         const path&                                     getFilename(void) const;
         //std::string                                     getDatatype(void) const;
-        RbVector<double>&                       		operator[](size_t index);            //!< Overloaded subsetting operator
-        const RbVector<double>&                 		operator[](size_t index) const;
+        MatrixRealRow<double>                   		operator[](size_t index);            //!< Overloaded subsetting operator
+        MatrixRealRow<const double>             		operator[](size_t index) const;
         double& 										getElement( size_t i, size_t j ) ;   //!< Get the element in the i-th row and the j-th column
         void                                            setTaxon(const Taxon &t, size_t i);  //!< Set taxon t as the i-th taxon in the matrix
         size_t 											size(void) const;                    //!< Get the number of elements in a row or column of the matrix
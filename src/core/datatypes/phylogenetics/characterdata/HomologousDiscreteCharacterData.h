@@ -304,7 +304,7 @@ RevBayesCore::MatrixReal RevBayesCore::HomologousDiscreteCharacterData<charType>
         } // finished loop over sequence
         
         // set the observed state frequencies for this sequence into the matrix
-        std::vector<double> &observedFreqs = m[i];
+        MatrixRealRow<double> observedFreqs = m[i];
         for (size_t j = 0; j < num_states; ++j)
         {
             observedFreqs[j] = stateCounts[j] / (nonGapSeqLength+20*MIN_THRESHOLD);
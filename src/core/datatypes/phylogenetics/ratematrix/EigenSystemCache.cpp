@@ -0,0 +1,168 @@
+#include "EigenSystemCache.h"
+
+#include <cmath>
+
+#include "MatrixComplex.h"
+#include "MatrixReal.h"
+#include "TransitionProbabilityMatrix.h"
+
+using namespace RevBayesCore;
+
+
+EigenSystemCache::EigenSystemCache(size_t c) :
+    capacity( c < 1 ? 1 : c )
+{
+
+}
+
+
+/**
+ * Calculate the transition probabilities P[b] for the times t[b] from the current eigen system, which must be real.
+ * The matrices are computed together, so that each row of the precalculated c_ijk is read only once for all of them.
+ * This matters for large state spaces, where c_ijk does not fit into the cache.
+ * The sums are formed in the same order as for a single matrix, so the results are identical.
+ * If normalize is true, then each row is divided by its sum.
+ */
+void EigenSystemCache::calculateTransitionProbabilities(const std::vector<double> &t, const std::vector<TransitionProbabilityMatrix*> &P, bool normalize) const
+{
+
+    const Entry& e = getCurrent();
+    const std::vector<double>& eigen_value = e.eigen_system.getRealEigenvalues();
+    size_t num_states = eigen_value.size();
+    size_t num_matrices = t.size();
+
+    // precalculate the product of the eigenvalue and the branch length
+    std::vector<double> eig_val_exp(num_matrices * num_states);
+    for (size_t b=0; b<num_matrices; b++)
+    {
+        for (size_t s=0; s<num_states; s++)
+        {
+            eig_val_exp[b*num_states+s] = exp(eigen_value[s] * t[b]);
+        }
+    }
+
+    // calculate the transition probabilities
+    const double* ptr = &e.c_ijk[0];
+    for (size_t i=0; i<num_states; i++)
+    {
+        for (size_t j=0; j<num_states; j++, ptr += num_states)
+        {
+            for (size_t b=0; b<num_matrices; b++)
+            {
+                const double* ev = &eig_val_exp[b*num_states];
+                double sum = 0.0;
+                for (size_t s=0; s<num_states; s++)
+                {
+                    sum += ptr[s] * ev[s];
+                }
+
+                P[b]->getElements()[i*num_states+j] = (sum < 0.0) ? 0.0 : sum;
+            }
+        }
+
+        if ( normalize == true )
+        {
+            // Normalize transition probabilities for row to sum to 1.0
+            for (size_t b=0; b<num_matrices; b++)
+            {
+                double* p = P[b]->getElements() + i*num_states;
+                double rowsum = 0.0;
+                for (size_t j=0; j<num_states; j++)
+                {
+                    rowsum += p[j];
+                }
+                for (size_t j=0; j<num_states; j++)
+                {
+                    p[j] /= rowsum;
+                }
+            }
+        }
+    }
+
+}
+
+
+/** Do precalculations on eigenvectors */
+void EigenSystemCache::calculateCijk(Entry &e) const
+{
+
+    size_t num_states = e.eigen_system.getRealEigenvalues().size();
+
+    if ( e.eigen_system.isComplex() == false )
+    {
+        // real case
+        e.c_ijk.resize(num_states * num_states * num_states);
+
+        const MatrixReal& ev  = e.eigen_system.getEigenvectors();
+        const MatrixReal& iev = e.eigen_system.getInverseEigenvectors();
+        double* pc = &e.c_ijk[0];
+        for (size_t i=0; i<num_states; i++)
+        {
+            for (size_t j=0; j<num_states; j++)
+            {
+                for (size_t k=0; k<num_states; k++)
+                {
+                    *(pc++) = ev[i][k] * iev[k][j];
+                }
+            }
+        }
+    }
+    else
+    {
+        // complex case
+        e.cc_ijk.resize(num_states * num_states * num_states);
+
+        const MatrixComplex& cev  = e.eigen_system.getComplexEigenvectors();
+        const MatrixComplex& ciev = e.eigen_system.getComplexInverseEigenvectors();
+        std::complex<double>* pc = &e.cc_ijk[0];
+        for (size_t i=0; i<num_states; i++)
+        {
+            for (size_t j=0; j<num_states; j++)
+            {
+                for (size_t k=0; k<num_states; k++)
+                {
+                    *(pc++) = cev[i][k] * ciev[k][j];
+                }
+            }
+        }
+    }
+
+}
+
+
+/**
+ * Make the eigen system for the given parameters the current one.
+ * If we have seen these parameters recently, we simply move their eigen system to the front.
+ * Otherwise, we decompose the rate matrix m, reusing the least recently used entry if the cache is full.
+ */
+void EigenSystemCache::update(const std::vector<double> &key, const MatrixReal *m)
+{
+
+    for (std::list<Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+    {
+        if ( it->key == key )
+        {
+            entries.splice( entries.begin(), entries, it );
+            return;
+        }
+    }
+
+    if ( entries.size() < capacity )
+    {
+        entries.push_front( Entry( m ) );
+    }
+    else
+    {
+        // recycle the least recently used eigen system
+        entries.splice( entries.begin(), entries, --entries.end() );
+    }
+
+    // we only set the key once the eigen system is complete
+    Entry &e = entries.front();
+    e.key.clear();
+    e.eigen_system.setRateMatrixPtr( m );
+    e.eigen_system.update();
+    calculateCijk( e );
+    e.key = key;
+
+}
@@ -0,0 +1,59 @@
+#ifndef EigenSystemCache_H
+#define EigenSystemCache_H
+
+#include <stddef.h>
+#include <complex>
+#include <list>
+#include <vector>
+
+#include "EigenSystem.h"
+
+
+namespace RevBayesCore {
+
+    class MatrixReal;
+    class TransitionProbabilityMatrix;
+
+    /**
+     * @brief Cache of the eigen systems of a rate matrix for the most recently used parameter values.
+     *
+     * Rate matrices that compute their transition probabilities from the eigen decomposition (e.g., the GTR or codon matrices)
+     * need a new decomposition and new products of the eigenvectors (c_ijk) whenever their parameters change.
+     * During an MCMC most proposals are rejected, and then the matrix is updated again with the previous parameter values.
+     * This cache keeps the decompositions for the last few parameter vectors, so that going back to the previous values
+     * only needs a lookup instead of the O(n^3) decomposition.
+     *
+     * The key is the vector of parameters from which the rate matrix was computed (e.g., the exchangeability rates
+     * followed by the stationary frequencies). The current eigen system is always the most recently used entry.
+     */
+    class EigenSystemCache {
+
+    public:
+
+        struct Entry {
+
+            Entry(const MatrixReal *m) : eigen_system( m ) {}
+
+            std::vector<double>                     key;                                                        //!< The parameters of the rate matrix
+            EigenSystem                             eigen_system;                                               //!< The eigen system of the rate matrix
+            std::vector<double>                     c_ijk;                                                      //!< Precalculated product of the eigenvectors and their inverse (real case)
+            std::vector<std::complex<double> >      cc_ijk;                                                     //!< Precalculated product of the eigenvectors and their inverse (complex case)
+        };
+
+        EigenSystemCache(size_t c = 4);                                                                         //!< Construct a cache holding at most c eigen systems
+
+        void                                        calculateTransitionProbabilities(const std::vector<double> &t, const std::vector<TransitionProbabilityMatrix*> &P, bool normalize) const;   //!< Compute P[b] = exp(Q t[b]) from the current (real) eigen system
+        const Entry&                                getCurrent(void) const { return entries.front(); }          //!< The eigen system of the most recent update
+        bool                                        isEmpty(void) const { return entries.empty(); }
+        void                                        update(const std::vector<double> &key, const MatrixReal *m); //!< Make the eigen system of m (with parameters key) the current one
+
+    private:
+        void                                        calculateCijk(Entry &e) const;                              //!< Do precalculations on eigenvectors and their inverse
+
+        size_t                                      capacity;
+        std::list<Entry>                            entries;                                                    //!< The eigen systems, the most recently used one first
+    };
+
+}
+
+#endif
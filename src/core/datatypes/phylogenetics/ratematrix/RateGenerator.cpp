@@ -53,6 +53,24 @@ void RateGenerator::calculateTransitionProbabilities(double t, TransitionProbabi
     calculateTransitionProbabilities(t, 0.0, 1.0, P);
 }
 
+
+/**
+ * Calculate the transition probability matrices P[i] for the branches from start_ages[i] to end_ages[i] with the rates rates[i].
+ * This is used to recompute the matrices of many branches and rate categories after the rate matrix has changed.
+ * By default we simply compute one matrix after the other, but derived classes may compute all matrices in a single pass
+ * (e.g., by reusing their eigen system).
+ */
+void RateGenerator::calculateTransitionProbabilitiesForBranches(const std::vector<double> &start_ages, const std::vector<double> &end_ages, const std::vector<double> &rates, const std::vector<TransitionProbabilityMatrix*> &P) const
+{
+    
+    for (size_t i = 0; i < P.size(); ++i)
+    {
+        calculateTransitionProbabilities(start_ages[i], end_ages[i], rates[i], *P[i]);
+    }
+    
+}
+
+
 size_t RateGenerator::getNumberOfStates( void ) const
 {
     return num_states;
@@ -37,6 +37,7 @@ namespace RevBayesCore {
         virtual double                      getSumOfRatesDifferential(std::vector<CharacterEvent*> from, CharacterEventDiscrete* to, double age=0.0, double rate=1.0) const;
 
         // virtual methods that may need to overwritten
+        virtual void                        calculateTransitionProbabilitiesForBranches(const std::vector<double> &start_ages, const std::vector<double> &end_ages, const std::vector<double> &rates, const std::vector<TransitionProbabilityMatrix*> &P) const;   //!< Calculate the transition matrices for many branches (and rates) at once
         virtual bool                        simulateStochasticMapping(double startAge, double endAge, double rate,std::vector<size_t>& transition_states, std::vector<double>& transition_times);
         virtual void                        update(void) {};
 
@@ -6,6 +6,7 @@
 
 #include "CodonState.h"
 #include "EigenSystem.h"
+#include "EigenSystemCache.h"
 #include "MatrixComplex.h"
 #include "MatrixReal.h"
 #include "RateMatrix_CodonSynonymousNonsynonymous.h"
@@ -23,27 +24,21 @@ using namespace RevBayesCore;
 
 /** Construct rate matrix with n states */
 RateMatrix_CodonSynonymousNonsynonymous::RateMatrix_CodonSynonymousNonsynonymous( void ) : TimeReversibleRateMatrix( 61 ),
+    omega( 1.0 ),
     codon_freqs(61,1.0/61)
 {
     
-    eigen_system       = new EigenSystem(the_rate_matrix);
-    c_ijk.resize(num_states * num_states * num_states);
-    cc_ijk.resize(num_states * num_states * num_states);
-    
     update();
 }
 
 
 /** Copy constructor */
 RateMatrix_CodonSynonymousNonsynonymous::RateMatrix_CodonSynonymousNonsynonymous(const RateMatrix_CodonSynonymousNonsynonymous& m) : TimeReversibleRateMatrix( m ),
+    eigen_systems( m.eigen_systems ),
+    omega( m.omega ),
     codon_freqs( m.codon_freqs )
 {
     
-    eigen_system        = new EigenSystem( *m.eigen_system );
-    c_ijk               = m.c_ijk;
-    cc_ijk              = m.cc_ijk;
-    
-    eigen_system->setRateMatrixPtr(the_rate_matrix);
 }
 
 
@@ -51,7 +46,6 @@ RateMatrix_CodonSynonymousNonsynonymous::RateMatrix_CodonSynonymousNonsynonymous
 RateMatrix_CodonSynonymousNonsynonymous::~RateMatrix_CodonSynonymousNonsynonymous(void)
 {
     
-    delete eigen_system;
 }
 
 
@@ -62,14 +56,9 @@ RateMatrix_CodonSynonymousNonsynonymous& RateMatrix_CodonSynonymousNonsynonymous
     {
         TimeReversibleRateMatrix::operator=( r );
         
-        delete eigen_system;
-        
-        eigen_system        = new EigenSystem( *r.eigen_system );
-        c_ijk               = r.c_ijk;
-        cc_ijk              = r.cc_ijk;
+        eigen_systems       = r.eigen_systems;
+        omega               = r.omega;
         codon_freqs         = r.codon_freqs;
-        
-        eigen_system->setRateMatrixPtr(the_rate_matrix);
     }
     
     return *this;
@@ -93,59 +82,42 @@ RateMatrix_CodonSynonymousNonsynonymous& RateMatrix_CodonSynonymousNonsynonymous
 
 
 
-/** Do precalculations on eigenvectors */
-void RateMatrix_CodonSynonymousNonsynonymous::calculateCijk(void)
+/** Calculate the transition probabilities */
+void RateMatrix_CodonSynonymousNonsynonymous::calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const
 {
-    
-    if ( eigen_system->isComplex() == false )
+    double t = rate * (startAge - endAge);
+    if ( eigen_systems.getCurrent().eigen_system.isComplex() == false )
     {
-        // real case
-        const MatrixReal& ev  = eigen_system->getEigenvectors();
-        const MatrixReal& iev = eigen_system->getInverseEigenvectors();
-        double* pc = &c_ijk[0];
-        for (size_t i=0; i<num_states; i++)
-        {
-            for (size_t j=0; j<num_states; j++)
-            {
-                for (size_t k=0; k<num_states; k++)
-                {
-                    *(pc++) = ev[i][k] * iev[k][j];
-                }
-            }
-        }
+        tiProbsEigens(t, P);
     }
     else
     {
-        // complex case
-        const MatrixComplex& cev  = eigen_system->getComplexEigenvectors();
-        const MatrixComplex& ciev = eigen_system->getComplexInverseEigenvectors();
-        std::complex<double>* pc = &cc_ijk[0];
-        for (size_t i=0; i<num_states; i++)
-        {
-            for (size_t j=0; j<num_states; j++)
-            {
-                for (size_t k=0; k<num_states; k++)
-                {
-                    *(pc++) = cev[i][k] * ciev[k][j];
-                }
-            }
-        }
+        tiProbsComplexEigens(t, P);
     }
 }
 
 
-/** Calculate the transition probabilities */
-void RateMatrix_CodonSynonymousNonsynonymous::calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const
+/**
+ * Calculate the transition probabilities for many branches (and rates) at once.
+ * In the real case we compute all matrices in one pass over the eigen system.
+ */
+void RateMatrix_CodonSynonymousNonsynonymous::calculateTransitionProbabilitiesForBranches(const std::vector<double> &start_ages, const std::vector<double> &end_ages, const std::vector<double> &rates, const std::vector<TransitionProbabilityMatrix*> &P) const
 {
-    double t = rate * (startAge - endAge);
-    if ( eigen_system->isComplex() == false )
+    
+    if ( eigen_systems.getCurrent().eigen_system.isComplex() == true )
     {
-        tiProbsEigens(t, P);
+        RateGenerator::calculateTransitionProbabilitiesForBranches(start_ages, end_ages, rates, P);
+        return;
     }
-    else
+    
+    std::vector<double> t = std::vector<double>(P.size(), 0.0);
+    for (size_t i = 0; i < P.size(); ++i)
     {
-        tiProbsComplexEigens(t, P);
+        t[i] = rates[i] * (start_ages[i] - end_ages[i]);
     }
+    
+    eigen_systems.calculateTransitionProbabilities(t, P, false);
+    
 }
 
 
@@ -263,7 +235,8 @@ void RateMatrix_CodonSynonymousNonsynonymous::tiProbsEigens(double t, Transition
 {
     
     // get a reference to the eigenvalues
-    const std::vector<double>& eigenValue = eigen_system->getRealEigenvalues();
+    const EigenSystemCache::Entry& eigen = eigen_systems.getCurrent();
+    const std::vector<double>& eigenValue = eigen.eigen_system.getRealEigenvalues();
     
     // precalculate the product of the eigenvalue and the branch length
     std::vector<double> eigValExp(num_states);
@@ -273,7 +246,7 @@ void RateMatrix_CodonSynonymousNonsynonymous::tiProbsEigens(double t, Transition
     }
     
     // calculate the transition probabilities
-    const double* ptr = &c_ijk[0];
+    const double* ptr = &eigen.c_ijk[0];
     double*         p = P.theMatrix;
     for (size_t i=0; i<num_states; i++)
     {
@@ -297,8 +270,9 @@ void RateMatrix_CodonSynonymousNonsynonymous::tiProbsComplexEigens(double t, Tra
 {
     
     // get a reference to the eigenvalues
-    const std::vector<double>& eigenValueReal = eigen_system->getRealEigenvalues();
-    const std::vector<double>& eigenValueComp = eigen_system->getImagEigenvalues();
+    const EigenSystemCache::Entry& eigen = eigen_systems.getCurrent();
+    const std::vector<double>& eigenValueReal = eigen.eigen_system.getRealEigenvalues();
+    const std::vector<double>& eigenValueComp = eigen.eigen_system.getImagEigenvalues();
     
     // precalculate the product of the eigenvalue and the branch length
     std::vector<std::complex<double> > ceigValExp(num_states);
@@ -309,7 +283,7 @@ void RateMatrix_CodonSynonymousNonsynonymous::tiProbsComplexEigens(double t, Tra
     }
     
     // calculate the transition probabilities
-    const std::complex<double>* ptr = &cc_ijk[0];
+    const std::complex<double>* ptr = &eigen.cc_ijk[0];
     for (size_t i=0; i<num_states; i++)
     {
         for (size_t j=0; j<num_states; j++)
@@ -343,12 +317,18 @@ void RateMatrix_CodonSynonymousNonsynonymous::setCodonFrequencies( const std::ve
 }
 
 
-/** Update the eigen system */
+/**
+ * Update the eigen system.
+ * The rate matrix is fully determined by omega and the codon frequencies,
+ * so we only need a new decomposition if we have not seen these values recently (e.g., after a rejected move).
+ */
 void RateMatrix_CodonSynonymousNonsynonymous::updateEigenSystem(void)
 {
     
-    eigen_system->update();
-    calculateCijk();
+    std::vector<double> parameters = codon_freqs;
+    parameters.push_back( omega );
+    
+    eigen_systems.update( parameters, the_rate_matrix );
     
 }
 
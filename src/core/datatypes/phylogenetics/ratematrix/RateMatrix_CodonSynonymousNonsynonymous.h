@@ -1,6 +1,7 @@
 #ifndef RateMatrix_CodonSynonymousNonsynonymous_H
 #define RateMatrix_CodonSynonymousNonsynonymous_H
 
+#include "EigenSystemCache.h"
 #include "TimeReversibleRateMatrix.h"
 #include <complex>
 #include <vector>
@@ -8,7 +9,6 @@
 
 namespace RevBayesCore {
     
-    class EigenSystem;
     class TransitionProbabilityMatrix;
     
     
@@ -42,21 +42,19 @@ namespace RevBayesCore {
         // RateMatrix functions
         virtual RateMatrix_CodonSynonymousNonsynonymous&        assign(const Assignable &m);                                                                                            //!< Assign operation that can be called on a base class instance.
         void                                                    calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const;    //!< Calculate the transition matrix
+        void                                                    calculateTransitionProbabilitiesForBranches(const std::vector<double> &start_ages, const std::vector<double> &end_ages, const std::vector<double> &rates, const std::vector<TransitionProbabilityMatrix*> &P) const;   //!< Calculate the transition matrices for many branches at once
         RateMatrix_CodonSynonymousNonsynonymous*                clone(void) const;
         void                                                    setCodonFrequencies(const std::vector<double> &f);                                 //!< Set the nucleotide frequencies
         void                                                    setOmega(double o);
         void                                                    update(void);
         
     private:
-        void                                                    calculateCijk(void);                                                                //!< Do precalculations on eigenvectors and their inverse
         void                                                    computeOffDiagonal( void );
         void                                                    tiProbsEigens(double t, TransitionProbabilityMatrix& P) const;                      //!< Calculate transition probabilities for real case
         void                                                    tiProbsComplexEigens(double t, TransitionProbabilityMatrix& P) const;               //!< Calculate transition probabilities for complex case
         void                                                    updateEigenSystem(void);                                                            //!< Update the system of eigenvalues and eigenvectors
         
-        EigenSystem*                                            eigen_system;                                                                       //!< Holds the eigen system
-        std::vector<double>                                     c_ijk;                                                                              //!< Vector of precalculated product of eigenvectors and their inverse
-        std::vector<std::complex<double> >                      cc_ijk;                                                                             //!< Vector of precalculated product of eigenvectors and thier inverse for complex case
+        EigenSystemCache                                        eigen_systems;                                                                      //!< Holds the eigen systems (and products of the eigenvectors) of the recent parameter values
         
         double                                                  omega;
         std::vector<double>                                     codon_freqs; 
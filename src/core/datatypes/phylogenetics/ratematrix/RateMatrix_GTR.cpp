@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "EigenSystem.h"
+#include "EigenSystemCache.h"
 #include "MatrixComplex.h"
 #include "MatrixReal.h"
 #include "RateMatrix_GTR.h"
@@ -23,23 +24,15 @@ using namespace RevBayesCore;
 RateMatrix_GTR::RateMatrix_GTR(size_t n) : TimeReversibleRateMatrix( n )
 {
     
-    theEigenSystem       = new EigenSystem(the_rate_matrix);
-    c_ijk.resize(num_states * num_states * num_states);
-    cc_ijk.resize(num_states * num_states * num_states);
-    
     update();
 }
 
 
 /** Copy constructor */
-RateMatrix_GTR::RateMatrix_GTR(const RateMatrix_GTR& m) : TimeReversibleRateMatrix( m )
+RateMatrix_GTR::RateMatrix_GTR(const RateMatrix_GTR& m) : TimeReversibleRateMatrix( m ),
+    eigen_systems( m.eigen_systems )
 {
     
-    theEigenSystem       = new EigenSystem( *m.theEigenSystem );
-    c_ijk                = m.c_ijk;
-    cc_ijk               = m.cc_ijk;
-    
-    theEigenSystem->setRateMatrixPtr(the_rate_matrix);
 }
 
 
@@ -47,7 +40,6 @@ RateMatrix_GTR::RateMatrix_GTR(const RateMatrix_GTR& m) : TimeReversibleRateMatr
 RateMatrix_GTR::~RateMatrix_GTR(void)
 {
     
-    delete theEigenSystem;
 }
 
 
@@ -58,13 +50,7 @@ RateMatrix_GTR& RateMatrix_GTR::operator=(const RateMatrix_GTR &r)
     {
         TimeReversibleRateMatrix::operator=( r );
         
-        delete theEigenSystem;
-        
-        theEigenSystem       = new EigenSystem( *r.theEigenSystem );
-        c_ijk                = r.c_ijk;
-        cc_ijk               = r.cc_ijk;
-        
-        theEigenSystem->setRateMatrixPtr(the_rate_matrix);
+        eigen_systems        = r.eigen_systems;
     }
     
     return *this;
@@ -88,59 +74,42 @@ RateMatrix_GTR& RateMatrix_GTR::assign(const Assignable &m)
 
 
 
-/** Do precalculations on eigenvectors */
-void RateMatrix_GTR::calculateCijk(void)
+/** Calculate the transition probabilities */
+void RateMatrix_GTR::calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const
 {
-    
-    if ( theEigenSystem->isComplex() == false )
+    double t = rate * (startAge - endAge);
+    if ( eigen_systems.getCurrent().eigen_system.isComplex() == false )
     {
-        // real case
-        const MatrixReal& ev  = theEigenSystem->getEigenvectors();
-        const MatrixReal& iev = theEigenSystem->getInverseEigenvectors();
-        double* pc = &c_ijk[0];
-        for (size_t i=0; i<num_states; i++)
-        {
-            for (size_t j=0; j<num_states; j++)
-            {
-                for (size_t k=0; k<num_states; k++)
-                {
-                    *(pc++) = ev[i][k] * iev[k][j];
-                }
-            }
-        }
+        tiProbsEigens(t, P);
     }
     else
     {
-        // complex case
-        const MatrixComplex& cev  = theEigenSystem->getComplexEigenvectors();
-        const MatrixComplex& ciev = theEigenSystem->getComplexInverseEigenvectors();
-        std::complex<double>* pc = &cc_ijk[0];
-        for (size_t i=0; i<num_states; i++)
-        {
-            for (size_t j=0; j<num_states; j++)
-            {
-                for (size_t k=0; k<num_states; k++)
-                {
-                    *(pc++) = cev[i][k] * ciev[k][j];
-                }
-            }
-        }
+        tiProbsComplexEigens(t, P);
     }
 }
 
 
-/** Calculate the transition probabilities */
-void RateMatrix_GTR::calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const
+/**
+ * Calculate the transition probabilities for many branches (and rates) at once.
+ * In the real case we compute all matrices in one pass over the eigen system.
+ */
+void RateMatrix_GTR::calculateTransitionProbabilitiesForBranches(const std::vector<double> &start_ages, const std::vector<double> &end_ages, const std::vector<double> &rates, const std::vector<TransitionProbabilityMatrix*> &P) const
 {
-    double t = rate * (startAge - endAge);
-    if ( theEigenSystem->isComplex() == false )
+    
+    if ( eigen_systems.getCurrent().eigen_system.isComplex() == true )
     {
-        tiProbsEigens(t, P);
+        RateGenerator::calculateTransitionProbabilitiesForBranches(start_ages, end_ages, rates, P);
+        return;
     }
-    else
+    
+    std::vector<double> t = std::vector<double>(P.size(), 0.0);
+    for (size_t i = 0; i < P.size(); ++i)
     {
-        tiProbsComplexEigens(t, P);
+        t[i] = rates[i] * (start_ages[i] - end_ages[i]);
     }
+    
+    eigen_systems.calculateTransitionProbabilities(t, P, true);
+    
 }
 
 
@@ -155,7 +124,8 @@ void RateMatrix_GTR::tiProbsEigens(double t, TransitionProbabilityMatrix& P) con
 {
     
     // get a reference to the eigenvalues
-    const std::vector<double>& eigenValue = theEigenSystem->getRealEigenvalues();
+    const EigenSystemCache::Entry& eigen = eigen_systems.getCurrent();
+    const std::vector<double>& eigenValue = eigen.eigen_system.getRealEigenvalues();
     
     // precalculate the product of the eigenvalue and the branch length
     std::vector<double> eigValExp(num_states);
@@ -165,7 +135,7 @@ void RateMatrix_GTR::tiProbsEigens(double t, TransitionProbabilityMatrix& P) con
     }
     
     // calculate the transition probabilities
-    const double* ptr = &c_ijk[0];
+    const double* ptr = &eigen.c_ijk[0];
     double*         p = P.theMatrix;
     for (size_t i=0; i<num_states; i++) 
     {
@@ -244,8 +214,9 @@ void RateMatrix_GTR::tiProbsComplexEigens(double t, TransitionProbabilityMatrix&
 {
     
     // get a reference to the eigenvalues
-    const std::vector<double>& eigenValueReal = theEigenSystem->getRealEigenvalues();
-    const std::vector<double>& eigenValueComp = theEigenSystem->getImagEigenvalues();
+    const EigenSystemCache::Entry& eigen = eigen_systems.getCurrent();
+    const std::vector<double>& eigenValueReal = eigen.eigen_system.getRealEigenvalues();
+    const std::vector<double>& eigenValueComp = eigen.eigen_system.getImagEigenvalues();
     
     // precalculate the product of the eigenvalue and the branch length
     std::vector<std::complex<double> > ceigValExp(num_states);
@@ -256,7 +227,7 @@ void RateMatrix_GTR::tiProbsComplexEigens(double t, TransitionProbabilityMatrix&
     }
     
     // calculate the transition probabilities
-    const std::complex<double>* ptr = &cc_ijk[0];
+    const std::complex<double>* ptr = &eigen.cc_ijk[0];
     for (size_t i=0; i<num_states; i++) 
     {
         double rowsum = 0.0;
@@ -277,12 +248,18 @@ void RateMatrix_GTR::tiProbsComplexEigens(double t, TransitionProbabilityMatrix&
 }
 
 
-/** Update the eigen system */
+/**
+ * Update the eigen system.
+ * The rate matrix is fully determined by the exchangeability rates and the stationary frequencies,
+ * so we only need a new decomposition if we have not seen these values recently (e.g., after a rejected move).
+ */
 void RateMatrix_GTR::updateEigenSystem(void)
 {
     
-    theEigenSystem->update();
-    calculateCijk();
+    std::vector<double> parameters = exchangeability_rates;
+    parameters.insert( parameters.end(), stationary_freqs.begin(), stationary_freqs.end() );
+    
+    eigen_systems.update( parameters, the_rate_matrix );
     
 }
 
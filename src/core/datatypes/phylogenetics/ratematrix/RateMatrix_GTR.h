@@ -2,7 +2,7 @@
 #define RateMatrix_GTR_H
 
 #include "TimeReversibleRateMatrix.h"
-#include "EigenSystem.h"
+#include "EigenSystemCache.h"
 #include <complex>
 #include <vector>
 
@@ -32,19 +32,17 @@ namespace RevBayesCore {
         // RateMatrix functions
         virtual RateMatrix_GTR&             assign(const Assignable &m);                                                                                            //!< Assign operation that can be called on a base class instance.
         void                                calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const;    //!< Calculate the transition matrix
+        void                                calculateTransitionProbabilitiesForBranches(const std::vector<double> &start_ages, const std::vector<double> &end_ages, const std::vector<double> &rates, const std::vector<TransitionProbabilityMatrix*> &P) const;   //!< Calculate the transition matrices for many branches at once
         RateMatrix_GTR*                     clone(void) const;
         void                                update(void);
         virtual void                        initFromString( const std::string &s );                                             //!< Serialize (resurrect) the object from a string value
         
     private:
-        void                                calculateCijk(void);                                                                //!< Do precalculations on eigenvectors and their inverse
         void                                tiProbsEigens(double t, TransitionProbabilityMatrix& P) const;                      //!< Calculate transition probabilities for real case
         void                                tiProbsComplexEigens(double t, TransitionProbabilityMatrix& P) const;               //!< Calculate transition probabilities for complex case
         void                                updateEigenSystem(void);                                                            //!< Update the system of eigenvalues and eigenvectors
         
-        EigenSystem*                        theEigenSystem;                                                                     //!< Holds the eigen system
-        std::vector<double>                 c_ijk;                                                                              //!< Vector of precalculated product of eigenvectors and their inverse
-        std::vector<std::complex<double> >  cc_ijk;                                                                             //!< Vector of precalculated product of eigenvectors and thier inverse for complex case
+        EigenSystemCache                    eigen_systems;                                                                      //!< Holds the eigen systems (and products of the eigenvectors) of the recent parameter values
         
                 
     };
@@ -315,22 +315,30 @@ void TopologyNode::addNodeParameters(std::string const &n, const std::vector<std
 /*
  * Build newick string.
  * If simmap = true build a newick string compatible with SIMMAP and phytools.
+ * If exact = true the branch lengths are written with the digits needed to read the exact values back in (used for checkpointing).
  */
-std::string TopologyNode::buildNewickString( bool simmap = false, bool round = true )
+std::string TopologyNode::buildNewickString( bool simmap = false, bool round = true, bool exact = false )
 {
 
     // create the newick string
     std::stringstream o;
 
-    std::fixed(o);
-    // depending on the value of round, get standard precision or maximum
-    if (round)
+    if ( exact == true )
     {
-        o.precision( 6 );
+        o.precision( std::numeric_limits<double>::max_digits10 );
     }
     else
     {
-        o.precision( std::numeric_limits<double>::digits10 );
+        std::fixed(o);
+        // depending on the value of round, get standard precision or maximum
+        if (round)
+        {
+            o.precision( 6 );
+        }
+        else
+        {
+            o.precision( std::numeric_limits<double>::digits10 );
+        }
     }
 
     std::vector<std::string> fossil_comments;
@@ -370,7 +378,7 @@ std::string TopologyNode::buildNewickString( bool simmap = false, bool round = t
                     o << ",";
                 }
                 j++;
-                o << children[i]->buildNewickString( simmap, round );
+                o << children[i]->buildNewickString( simmap, round, exact );
             }
         }
 
@@ -528,6 +536,14 @@ std::string TopologyNode::computeNewick( bool round )
 }
 
 
+/* Build the newick string with the digits needed to read the exact branch lengths back in */
+std::string TopologyNode::computeExactNewick( void )
+{
+
+    return buildNewickString(false, false, true);
+}
+
+
 /* Build newick string */
 std::string TopologyNode::computePlainNewick( void ) const
 {
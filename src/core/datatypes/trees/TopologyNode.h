@@ -82,6 +82,7 @@ namespace RevBayesCore {
         void                                        clearBranchParameters(void);
 	void                                        clearNodeParameters(void);
         virtual std::string                         computeNewick(bool round = true);                                                   //!< Compute the newick string for this clade
+        std::string                                 computeExactNewick(void);                                                           //!< Compute the newick string for this clade with exact branch lengths (for checkpointing)
         std::string                                 computePlainNewick(void) const;                                                     //!< Compute the newick string for this clade as a plain string without branch length
         std::string                                 computeSimmapNewick(bool round = true);                                             //!< Compute the newick string compatible with SIMMAP and phytools
         bool                                        containsClade(const TopologyNode* c, bool strict) const;
@@ -179,7 +180,7 @@ namespace RevBayesCore {
         bool serial_speciation = false;
 
         // helper methods
-        virtual std::string                         buildNewickString(bool simmap, bool round);                                                     //!< compute the newick string for a tree rooting at this node
+        virtual std::string                         buildNewickString(bool simmap, bool round, bool exact);                                         //!< compute the newick string for a tree rooting at this node
 
         // protected members
         bool                                        use_ages = true;
@@ -681,6 +681,25 @@ const TopologyNode& Tree::getMrca(const TopologyNode &n) const
 }
 
 
+/**
+ * Get the newick representation with the digits needed to read the exact branch lengths back in.
+ * This is only used for checkpoints, all other output uses the rounded or fixed representation from getNewickRepresentation().
+ */
+std::string Tree::getExactNewickRepresentation( void ) const
+{
+
+    if ( root == NULL )
+    {
+        return "";
+    }
+    else
+    {
+        return root->computeExactNewick();
+    }
+
+}
+
+
 std::string Tree::getNewickRepresentation(bool round ) const
 {
 
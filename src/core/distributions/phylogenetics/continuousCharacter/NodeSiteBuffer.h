@@ -0,0 +1,42 @@
+#ifndef NodeSiteBuffer_H
+#define NodeSiteBuffer_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "AlignedAllocator.h"
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Flat storage of one value per site for every node (and for each of several copies, e.g., the active and the stored likelihoods).
+     *
+     * All values live in a single buffer aligned to a cache line. The sites of a node are contiguous and every node starts
+     * on a new cache line, so that the per-site loops of the REML algorithms run over contiguous, aligned memory.
+     * The values of node n in copy c are returned by (c,n).
+     */
+    class NodeSiteBuffer {
+
+    public:
+        NodeSiteBuffer(void) : num_nodes( 0 ), num_sites( 0 ), stride( 0 ) {}
+        NodeSiteBuffer(size_t c, size_t n, size_t s, double v = 0.0) : values( c * n * paddedSize(s), v ), num_nodes( n ), num_sites( s ), stride( paddedSize(s) ) {}
+
+        double*                                 operator()(size_t copy, size_t node) { return values.data() + (copy * num_nodes + node) * stride; }
+        const double*                           operator()(size_t copy, size_t node) const { return values.data() + (copy * num_nodes + node) * stride; }
+
+        void                                    clear(void) { values.clear(); num_nodes = 0; num_sites = 0; stride = 0; }
+        bool                                    empty(void) const { return values.empty(); }
+        size_t                                  getNumberOfSites(void) const { return num_sites; }
+
+    private:
+        static size_t                           paddedSize(size_t s) { return (s + 7) / 8 * 8; }                        //!< Round up to a full cache line of doubles
+
+        std::vector<double, AlignedAllocator<double> >  values;
+        size_t                                  num_nodes;
+        size_t                                  num_sites;
+        size_t                                  stride;
+    };
+
+}
+
+#endif
@@ -1,12 +1,14 @@
+#include <cmath>
 #include <cstddef>
 #include <iosfwd>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "CholeskyDecomposition.h"
 #include "ConstantNode.h"
 #include "PhyloBrownianProcessMVN.h"
-#include "DistributionMultivariateNormal.h"
+#include "RbConstants.h"
 #include "RbException.h"
 #include "StochasticNode.h"
 #include "TopologyNode.h"
@@ -25,12 +27,20 @@ namespace RevBayesCore { class DagNode; }
 
 using namespace RevBayesCore;
 
+namespace {
+
+    // the number of incremental updates after which we compute the covariance matrix from scratch again,
+    // so that the rounding errors of the updates do not accumulate in the matrix
+    const size_t COVARIANCE_RECOMPUTATION_INTERVAL = 100;
+
+}
+
 PhyloBrownianProcessMVN::PhyloBrownianProcessMVN(const TypedDagNode<Tree> *t, size_t ns) : AbstractPhyloBrownianProcess( t, ns ),
     num_tips( t->getValue().getNumberOfTips() ),
     obs( std::vector<std::vector<double> >(this->num_sites, std::vector<double>(num_tips, 0.0) ) ),
     phylogenetic_covariance_matrix( new MatrixReal(num_tips, num_tips) ),
     stored_phylogenetic_covariance_matrix( new MatrixReal(num_tips, num_tips) ),
-    inverse_phylogenetic_covariance_matrix( num_tips, num_tips ),
+    num_covariance_updates( 0 ),
     changed_covariance(false),
     needs_covariance_recomputation( true ),
     needs_scale_recomputation( true )
@@ -54,12 +64,19 @@ PhyloBrownianProcessMVN::PhyloBrownianProcessMVN(const PhyloBrownianProcessMVN &
     obs( p.obs ),
     phylogenetic_covariance_matrix( p.phylogenetic_covariance_matrix->clone() ),
     stored_phylogenetic_covariance_matrix( p.stored_phylogenetic_covariance_matrix->clone() ),
-    inverse_phylogenetic_covariance_matrix( p.inverse_phylogenetic_covariance_matrix ),
+    branch_times( p.branch_times ),
+    stored_branch_times( p.stored_branch_times ),
+    parent_indices( p.parent_indices ),
+    stored_parent_indices( p.stored_parent_indices ),
+    num_covariance_updates( p.num_covariance_updates ),
     changed_covariance( p.changed_covariance ),
     needs_covariance_recomputation( p.needs_covariance_recomputation ),
     needs_scale_recomputation( p.needs_scale_recomputation )
 {
     
+    phylogenetic_covariance_matrix->setCholesky( true );
+    stored_phylogenetic_covariance_matrix->setCholesky( true );
+    
 }
 
 
@@ -95,10 +112,17 @@ PhyloBrownianProcessMVN& PhyloBrownianProcessMVN::operator=(const PhyloBrownianP
         obs                                         = p.obs;
         phylogenetic_covariance_matrix              = p.phylogenetic_covariance_matrix->clone();
         stored_phylogenetic_covariance_matrix       = p.stored_phylogenetic_covariance_matrix->clone();
-        inverse_phylogenetic_covariance_matrix      = p.inverse_phylogenetic_covariance_matrix;
+        branch_times                                = p.branch_times;
+        stored_branch_times                         = p.stored_branch_times;
+        parent_indices                              = p.parent_indices;
+        stored_parent_indices                       = p.stored_parent_indices;
+        num_covariance_updates                      = p.num_covariance_updates;
         changed_covariance                          = p.changed_covariance;
         needs_covariance_recomputation              = p.needs_covariance_recomputation;
         needs_scale_recomputation                   = p.needs_scale_recomputation;
+        
+        phylogenetic_covariance_matrix->setCholesky( true );
+        stored_phylogenetic_covariance_matrix->setCholesky( true );
     }
     
     return *this;
@@ -124,14 +148,21 @@ double PhyloBrownianProcessMVN::computeLnProbability( void )
     
     if ( needs_covariance_recomputation == true )
     {
-        // perhaps there is a more efficient way to reset the matrix to 0.
-        delete phylogenetic_covariance_matrix;
-        phylogenetic_covariance_matrix = new MatrixReal(num_tips, num_tips);
-        phylogenetic_covariance_matrix->setCholesky( true );
-        recursiveComputeCovarianceMatrix(*phylogenetic_covariance_matrix, root, rootIndex);
+        std::vector<double> times;
+        std::vector<size_t> parents;
+        computeBranchTimes(times, parents);
+        
+        // if only a few branches changed, we update the covariance matrix (and its cholesky decomposition) incrementally
+        if ( updateCovarianceMatrix(times, parents) == false )
+        {
+            phylogenetic_covariance_matrix->resize(num_tips, num_tips);
+            recursiveComputeCovarianceMatrix(*phylogenetic_covariance_matrix, root, rootIndex);
+            num_covariance_updates = 0;
+        }
+        
+        branch_times = times;
+        parent_indices = parents;
         needs_covariance_recomputation = false;
-        inverse_phylogenetic_covariance_matrix = phylogenetic_covariance_matrix->computeInverse();
-        inverse_phylogenetic_covariance_matrix.setCholesky( true );
     }
     
     // sum the partials up
@@ -141,6 +172,32 @@ double PhyloBrownianProcessMVN::computeLnProbability( void )
 }
 
 
+/**
+ * Compute the scaled branch time and the index of the parent of every node.
+ * The root gets a branch time of 0 and the number of nodes as its parent index.
+ */
+void PhyloBrownianProcessMVN::computeBranchTimes(std::vector<double> &times, std::vector<size_t> &parents)
+{
+    
+    const std::vector<TopologyNode*> &nodes = this->tau->getValue().getNodes();
+    size_t num_nodes = nodes.size();
+    
+    times = std::vector<double>(num_nodes, 0.0);
+    parents = std::vector<size_t>(num_nodes, num_nodes);
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        const TopologyNode &node = *nodes[i];
+        if ( node.isRoot() == false )
+        {
+            size_t node_index = node.getIndex();
+            times[node_index] = this->computeBranchTime(node_index, node.getBranchLength() );
+            parents[node_index] = node.getParent().getIndex();
+        }
+    }
+    
+}
+
+
 double PhyloBrownianProcessMVN::computeRootState(size_t siteIdx)
 {
     
@@ -275,6 +332,24 @@ std::set<size_t> PhyloBrownianProcessMVN::recursiveComputeCovarianceMatrix(Matri
 
 
 
+void PhyloBrownianProcessMVN::recursiveComputeTipIndicator(std::vector<double> &x, const TopologyNode &node)
+{
+    
+    if ( node.isTip() )
+    {
+        x[node.getIndex()] = 1.0;
+    }
+    else
+    {
+        for (size_t i = 0; i < node.getNumberOfChildren(); ++i)
+        {
+            recursiveComputeTipIndicator(x, node.getChild(i) );
+        }
+    }
+    
+}
+
+
 void PhyloBrownianProcessMVN::restoreSpecialization( const DagNode* affecter )
 {
     
@@ -288,6 +363,9 @@ void PhyloBrownianProcessMVN::restoreSpecialization( const DagNode* affecter )
         phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
         stored_phylogenetic_covariance_matrix = tmp;
         
+        branch_times.swap( stored_branch_times );
+        parent_indices.swap( stored_parent_indices );
+        
     }
     
 }
@@ -356,23 +434,100 @@ std::vector<double> PhyloBrownianProcessMVN::simulateRootCharacters(size_t n)
 }
 
 
+/**
+ * Sum the multivariate normal log-densities of all sites.
+ * We use the cholesky factor L of the covariance matrix directly: the log-determinant is 2 sum log L_ii,
+ * and the quadratic form of a site is |z|^2 with L z = x - mu, which we get by forward substitution.
+ */
 double PhyloBrownianProcessMVN::sumRootLikelihood( void )
 {
     
+    CholeskyDecomposition &cd = phylogenetic_covariance_matrix->getCholeskyDecomposition();
+    if ( cd.checkPositiveDefinite() == false )
+    {
+        return RbConstants::Double::neginf;
+    }
+    
+    double log_det = cd.computeLogDet();
+    const double* l = cd.getLowerCholeskyFactor().data();
+    double log_normalize = -0.5 * num_tips * std::log( RbConstants::TwoPI );
+    
     // sum the log-likelihoods for all sites together
     double sum_site_probs = 0.0;
+    std::vector<double> z = std::vector<double>(num_tips, 0.0);
     for (size_t site = 0; site < this->num_sites; ++site)
     {
-        std::vector<double> m = std::vector<double>(num_tips, computeRootState(site) );
+        double root_state = computeRootState(site);
+        const std::vector<double> &x = obs[site];
+        
+        double quadratic_form = 0.0;
+        for (size_t i = 0; i < num_tips; ++i)
+        {
+            const double* l_i = l + i*num_tips;
+            double tmp = x[i] - root_state;
+            for (size_t k = 0; k < i; ++k)
+            {
+                tmp -= l_i[k] * z[k];
+            }
+            z[i] = tmp / l_i[i];
+            quadratic_form += z[i] * z[i];
+        }
         
         double sr = this->computeSiteRate(site);
-        sum_site_probs += RbStatistics::MultivariateNormal::lnPdfPrecision(m, inverse_phylogenetic_covariance_matrix, obs[site], sr*sr);
+        sum_site_probs += log_normalize - 0.5 * ( log_det + num_tips * std::log( sr*sr ) + quadratic_form / (sr*sr) );
     }
     
     return sum_site_probs;
 }
 
 
+/**
+ * Update the covariance matrix for the new branch times, if the topology did not change and only a few branches did.
+ * A branch of node k contributes t_k 1_k 1_k^T to the covariance matrix, where 1_k indicates the tips below k.
+ * Thus, a change of a branch time adds a rank-one matrix, for which we update the cholesky decomposition in O(n^2).
+ * Returns false if the covariance matrix has to be computed from scratch.
+ */
+bool PhyloBrownianProcessMVN::updateCovarianceMatrix(const std::vector<double> &times, const std::vector<size_t> &parents)
+{
+    
+    if ( num_covariance_updates >= COVARIANCE_RECOMPUTATION_INTERVAL || parents != parent_indices || times.size() != branch_times.size() )
+    {
+        return false;
+    }
+    
+    // each update costs O(n^2), whereas the full computation costs O(n^3)
+    size_t num_changed_branches = 0;
+    for (size_t i = 0; i < times.size(); ++i)
+    {
+        if ( times[i] != branch_times[i] )
+        {
+            ++num_changed_branches;
+        }
+    }
+    if ( 4 * num_changed_branches > num_tips )
+    {
+        return false;
+    }
+    
+    const std::vector<TopologyNode*> &nodes = this->tau->getValue().getNodes();
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const TopologyNode &node = *nodes[i];
+        size_t node_index = node.getIndex();
+        if ( times[node_index] != branch_times[node_index] )
+        {
+            std::vector<double> x = std::vector<double>(num_tips, 0.0);
+            recursiveComputeTipIndicator(x, node);
+            phylogenetic_covariance_matrix->rankOneUpdate(x, times[node_index] - branch_times[node_index]);
+        }
+    }
+    
+    ++num_covariance_updates;
+    
+    return true;
+}
+
+
 void PhyloBrownianProcessMVN::touchSpecialization( const DagNode* affecter, bool touchAll )
 {
     
@@ -392,9 +547,7 @@ void PhyloBrownianProcessMVN::touchSpecialization( const DagNode* affecter, bool
         needs_covariance_recomputation = true;
         if ( changed_covariance == false )
         {
-            MatrixReal *tmp = phylogenetic_covariance_matrix;
-            phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-            stored_phylogenetic_covariance_matrix = tmp;
+            storeCovarianceMatrix();
         }
         changed_covariance = true;
         
@@ -404,9 +557,7 @@ void PhyloBrownianProcessMVN::touchSpecialization( const DagNode* affecter, bool
         needs_covariance_recomputation = true;
         if ( changed_covariance == false )
         {
-            MatrixReal *tmp = phylogenetic_covariance_matrix;
-            phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-            stored_phylogenetic_covariance_matrix = tmp;
+            storeCovarianceMatrix();
         }
         changed_covariance = true;
         
@@ -416,9 +567,7 @@ void PhyloBrownianProcessMVN::touchSpecialization( const DagNode* affecter, bool
         needs_covariance_recomputation = true;
         if ( changed_covariance == false )
         {
-            MatrixReal *tmp = phylogenetic_covariance_matrix;
-            phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-            stored_phylogenetic_covariance_matrix = tmp;
+            storeCovarianceMatrix();
         }
         changed_covariance = true;
         
@@ -431,6 +580,20 @@ void PhyloBrownianProcessMVN::touchSpecialization( const DagNode* affecter, bool
 }
 
 
+/**
+ * Keep a copy of the current covariance matrix (and of its cholesky decomposition) in case the change is rejected.
+ * We copy instead of swapping the matrices, because the new matrix is updated incrementally from the current one.
+ */
+void PhyloBrownianProcessMVN::storeCovarianceMatrix( void )
+{
+    
+    *stored_phylogenetic_covariance_matrix = *phylogenetic_covariance_matrix;
+    stored_branch_times = branch_times;
+    stored_parent_indices = parent_indices;
+    
+}
+
+
 /** Swap a parameter of the distribution */
 void PhyloBrownianProcessMVN::swapParameterInternal(const DagNode *oldP, const DagNode *newP)
 {
@@ -51,8 +51,12 @@ namespace RevBayesCore {
         virtual void                                                        swapParameterInternal(const DagNode *oldP, const DagNode *newP);                         //!< Swap a parameter
         
     private:
+        void                                                                computeBranchTimes(std::vector<double> &times, std::vector<size_t> &parents);
         double                                                              computeRootState(size_t siteIdx);
         std::set<size_t>                                                    recursiveComputeCovarianceMatrix( MatrixReal &m, const TopologyNode &node, size_t node_index );
+        void                                                                recursiveComputeTipIndicator( std::vector<double> &x, const TopologyNode &node );
+        void                                                                storeCovarianceMatrix(void);
+        bool                                                                updateCovarianceMatrix(const std::vector<double> &times, const std::vector<size_t> &parents);
         
         const TypedDagNode< double >*                                       homogeneous_root_state;
         const TypedDagNode< RbVector< double > >*                           heterogeneous_root_state;
@@ -61,7 +65,11 @@ namespace RevBayesCore {
         std::vector<std::vector<double> >                                   obs;
         MatrixReal*                                                         phylogenetic_covariance_matrix;
         MatrixReal*                                                         stored_phylogenetic_covariance_matrix;
-        MatrixReal                                                          inverse_phylogenetic_covariance_matrix;
+        std::vector<double>                                                 branch_times;                                           //!< The branch times the covariance matrix was computed for
+        std::vector<double>                                                 stored_branch_times;
+        std::vector<size_t>                                                 parent_indices;                                         //!< The topology the covariance matrix was computed for
+        std::vector<size_t>                                                 stored_parent_indices;
+        size_t                                                              num_covariance_updates;                                 //!< The number of incremental updates since the covariance matrix was last computed from scratch
         bool                                                                changed_covariance;
         bool                                                                needs_covariance_recomputation;
         bool                                                                needs_scale_recomputation;
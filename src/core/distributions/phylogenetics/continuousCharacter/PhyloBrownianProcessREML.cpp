@@ -5,6 +5,8 @@
 
 #include "DistributionNormal.h"
 #include "PhyloBrownianProcessREML.h"
+#include "PhyloContinuousCharacterKernels.h"
+#include "RbConstants.h"
 #include "RbException.h"
 #include "StochasticNode.h"
 #include "TopologyNode.h"
@@ -22,10 +24,10 @@ using namespace RevBayesCore;
 
 PhyloBrownianProcessREML::PhyloBrownianProcessREML(const TypedDagNode<Tree> *t, size_t ns) :
     AbstractPhyloBrownianProcess( t, ns ),
-    partial_likelihoods( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
-    contrasts( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
+    partial_likelihoods( 2, this->num_nodes, this->num_sites ),
+    contrasts( 2, this->num_nodes, this->num_sites ),
     contrast_uncertainty( std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) ) ),
-    contrast_uncertainty_per_site( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
+    contrast_uncertainty_per_site( 2, this->num_nodes, this->num_sites ),
     active_likelihood( std::vector<size_t>(this->num_nodes, 0) ),
     changed_nodes( std::vector<bool>(this->num_nodes, false) ),
     dirty_nodes( std::vector<bool>(this->num_nodes, true) ),
@@ -91,6 +93,15 @@ double PhyloBrownianProcessREML::computeLnProbability( void )
     if ( this->dirty_nodes[rootIndex] )
     {
         
+        // the site rates enter the density of a contrast only through -ln(r) and 1/r^2
+        site_offsets.resize( this->num_sites );
+        site_factors.resize( this->num_sites );
+        for (size_t site = 0; site < this->num_sites; ++site)
+        {
+            double r = this->computeSiteRate(site);
+            site_offsets[site] = -std::log( r );
+            site_factors[site] = 1.0 / (r * r);
+        }
         
         recursiveComputeLnProbability( root, rootIndex );
         
@@ -143,8 +154,8 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
     if ( node.isTip() == false && (dirty_nodes[node_index] == true || use_missing_data) )
     {
 
-        std::vector<double> &p_node   = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &mu_node  = this->contrasts[this->active_likelihood[node_index]][node_index];
+        double* p_node   = this->partial_likelihoods(this->active_likelihood[node_index], node_index);
+        double* mu_node  = this->contrasts(this->active_likelihood[node_index], node_index);
 
         
         // get the number of children
@@ -169,12 +180,12 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
             // mark as computed
             dirty_nodes[node_index] = false;
 
-            const std::vector<double> &p_left  = this->partial_likelihoods[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &p_right = this->partial_likelihoods[this->active_likelihood[right_index]][right_index];
+            const double* p_left  = this->partial_likelihoods(this->active_likelihood[left_index], left_index);
+            const double* p_right = this->partial_likelihoods(this->active_likelihood[right_index], right_index);
 
             // get the per node and site contrasts
-            const std::vector<double> &mu_left  = this->contrasts[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &mu_right = this->contrasts[this->active_likelihood[right_index]][right_index];
+            const double* mu_left  = this->contrasts(this->active_likelihood[left_index], left_index);
+            const double* mu_right = this->contrasts(this->active_likelihood[right_index], right_index);
             
             // get the scaled branch lengths
             double v_left  = 0;
@@ -184,100 +195,91 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
             }
             double v_right = this->computeBranchTime(right_index, right.getBranchLength());
             
-            // get the propagated uncertainties
-            double delta_left   = 0.0;
-            double delta_right  = 0.0;
-            double t_left       = 0.0;
-            double t_right      = 0.0;
-            double stdev        = 0.0;
             if ( use_missing_data == false )
             {
-                delta_left  = this->contrast_uncertainty[this->active_likelihood[left_index]][left_index];
-                delta_right = this->contrast_uncertainty[this->active_likelihood[right_index]][right_index];
+                // get the propagated uncertainties
+                double delta_left  = this->contrast_uncertainty[this->active_likelihood[left_index]][left_index];
+                double delta_right = this->contrast_uncertainty[this->active_likelihood[right_index]][right_index];
 
                 // add the propagated uncertainty to the branch lengths
-                t_left  = v_left  + delta_left;
-                t_right = v_right + delta_right;
+                double t_left  = v_left  + delta_left;
+                double t_right = v_right + delta_right;
 
                 // set delta_node = (t_l*t_r)/(t_l+t_r);
                 this->contrast_uncertainty[this->active_likelihood[node_index]][node_index] = (t_left*t_right) / (t_left+t_right);
 
-                stdev = sqrt(t_left+t_right);
+                double stdev = sqrt(t_left+t_right);
+                
+                // the log-density of the contrast c at a site with rate r is -ln(sqrt(2 pi)) - ln(stdev) - ln(r) - c^2 / (2 stdev^2 r^2)
+                PhyloContinuousCharacterKernels::computeContrasts(mu_left, mu_right, p_left, p_right, 1.0, 0.0, 1.0, 0.0, t_left, t_right,
+                                                                  -RbConstants::LN_SQRT_2PI - std::log(stdev), 0.5 / (stdev*stdev),
+                                                                  site_offsets.data(), site_factors.data(), mu_node, p_node, this->num_sites);
             }
-
-            for (int site=0; site<this->num_sites; ++site)
+            else
             {
+                // the propagated uncertainties differ between the sites
+                const double* delta_left  = this->contrast_uncertainty_per_site(this->active_likelihood[left_index], left_index);
+                const double* delta_right = this->contrast_uncertainty_per_site(this->active_likelihood[right_index], right_index);
+                double*       delta_node  = this->contrast_uncertainty_per_site(this->active_likelihood[node_index], node_index);
 
-                if ( use_missing_data == true )
+                for (int site=0; site<this->num_sites; ++site)
                 {
-                    delta_left  = this->contrast_uncertainty_per_site[this->active_likelihood[left_index]][left_index][site];
-                    delta_right = this->contrast_uncertainty_per_site[this->active_likelihood[right_index]][right_index][site];
 
                     // add the propagated uncertainty to the branch lengths
-                    t_left  = v_left  + delta_left;
-                    t_right = v_right + delta_right;
-
-                    // set delta_node = (t_l*t_r)/(t_l+t_r);
-                    this->contrast_uncertainty_per_site[this->active_likelihood[node_index]][node_index][site] = (t_left*t_right) / (t_left+t_right);
-                    
-                    stdev = sqrt(t_left+t_right);
-                }
-                
-                if ( use_missing_data == true && missing_data[left_index][site] == true && missing_data[right_index][site] == true )
-                {
-                    missing_data[node_index][site] = true;
-                    
-                    p_node[site]  = p_left[site] + p_right[site];
-                    mu_node[site] = RbConstants::Double::nan;
+                    double t_left  = v_left  + delta_left[site];
+                    double t_right = v_right + delta_right[site];
 
-                    this->contrast_uncertainty_per_site[this->active_likelihood[node_index]][node_index][site] = 0.0;
-                }
-                else if ( use_missing_data == true && missing_data[left_index][site] == true && missing_data[right_index][site] == false )
-                {
-                    missing_data[node_index][site] = false;
-                    
-                    p_node[site]  = p_left[site] + p_right[site];
-                    mu_node[site] = mu_right[site];
-                    
-                    this->contrast_uncertainty_per_site[this->active_likelihood[node_index]][node_index][site] = t_right;
+                    if ( missing_data[left_index][site] == true && missing_data[right_index][site] == true )
+                    {
+                        missing_data[node_index][site] = true;
+                        
+                        p_node[site]  = p_left[site] + p_right[site];
+                        mu_node[site] = RbConstants::Double::nan;
 
-                }
-                else if ( use_missing_data == true && missing_data[left_index][site] == false && missing_data[right_index][site] == true )
-                {
-                    missing_data[node_index][site] = false;
-                    
-                    p_node[site]  = p_left[site] + p_right[site];
-                    mu_node[site] = mu_left[site];
-                    
-                    this->contrast_uncertainty_per_site[this->active_likelihood[node_index]][node_index][site] = t_left;
-                }
-                else
-                {
+                        delta_node[site] = 0.0;
+                    }
+                    else if ( missing_data[left_index][site] == true && missing_data[right_index][site] == false )
+                    {
+                        missing_data[node_index][site] = false;
+                        
+                        p_node[site]  = p_left[site] + p_right[site];
+                        mu_node[site] = mu_right[site];
+                        
+                        delta_node[site] = t_right;
+                    }
+                    else if ( missing_data[left_index][site] == false && missing_data[right_index][site] == true )
+                    {
+                        missing_data[node_index][site] = false;
+                        
+                        p_node[site]  = p_left[site] + p_right[site];
+                        mu_node[site] = mu_left[site];
+                        
+                        delta_node[site] = t_left;
+                    }
+                    else
+                    {
+                        double stdev = sqrt(t_left+t_right);
 
-                    // get the site specific rate of evolution
-                    double standDev = this->computeSiteRate(site) * stdev;
+                        // get the site specific rate of evolution
+                        double standDev = this->computeSiteRate(site) * stdev;
 
-                    // compute the contrasts for this site and node
-                    double contrast = mu_left[site] - mu_right[site];
+                        // compute the contrasts for this site and node
+                        double contrast = mu_left[site] - mu_right[site];
 
-                    // compute the probability for the contrasts at this node
-                    double lnl_node = RbStatistics::Normal::lnPdf(0, standDev, contrast);
+                        // compute the probability for the contrasts at this node
+                        double lnl_node = RbStatistics::Normal::lnPdf(0, standDev, contrast);
 
-                    // sum up the probabilities of the contrasts
-                    p_node[site] = lnl_node + p_left[site] + p_right[site];
-                    
-                    mu_node[site] = (mu_left[site]*t_right + mu_right[site]*t_left) / (t_left+t_right);
-                    
-                    if ( use_missing_data == true )
-                    {
+                        // sum up the probabilities of the contrasts
+                        p_node[site] = lnl_node + p_left[site] + p_right[site];
+                        
+                        mu_node[site] = (mu_left[site]*t_right + mu_right[site]*t_left) / (t_left+t_right);
+                        
                         missing_data[node_index][site] = false;
-                        this->contrast_uncertainty_per_site[this->active_likelihood[node_index]][node_index][site] = (t_left*t_right) / (t_left+t_right);
+                        delta_node[site] = (t_left*t_right) / (t_left+t_right);
                     }
-                    
-                }
-                
 
-            } // end for-loop over all sites
+                } // end for-loop over all sites
+            }
 
         } // end for-loop over all children
         
@@ -321,8 +323,8 @@ void PhyloBrownianProcessREML::resetValue( void )
 {
     
     // check if the vectors need to be resized
-    partial_likelihoods     = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
-    contrasts               = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
+    partial_likelihoods     = NodeSiteBuffer(2, this->num_nodes, this->num_sites);
+    contrasts               = NodeSiteBuffer(2, this->num_nodes, this->num_sites);
     missing_data            = std::vector<std::vector<bool> >(this->num_nodes, std::vector<bool>(this->num_sites, false) );
 
     // create a vector with the correct site indices
@@ -370,7 +372,7 @@ void PhyloBrownianProcessREML::resetValue( void )
     if ( use_missing_data == true )
     {
         contrast_uncertainty.clear();
-        contrast_uncertainty_per_site   = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
+        contrast_uncertainty_per_site   = NodeSiteBuffer(2, this->num_nodes, this->num_sites);
     }
     else
     {
@@ -396,11 +398,11 @@ void PhyloBrownianProcessREML::resetValue( void )
                 }
                 else
                 {
-                    contrast_uncertainty_per_site[0][(*it)->getIndex()][site] = 0;
-                    contrast_uncertainty_per_site[1][(*it)->getIndex()][site] = 0;
+                    contrast_uncertainty_per_site(0, (*it)->getIndex())[site] = 0;
+                    contrast_uncertainty_per_site(1, (*it)->getIndex())[site] = 0;
                 }
-                contrasts[0][(*it)->getIndex()][site] = c;
-                contrasts[1][(*it)->getIndex()][site] = c;
+                contrasts(0, (*it)->getIndex())[site] = c;
+                contrasts(1, (*it)->getIndex())[site] = c;
             }
         }
     }
@@ -470,7 +472,7 @@ double PhyloBrownianProcessREML::sumRootLikelihood( void )
     size_t node_index = root.getIndex();
     
     // get the pointers to the partial likelihoods of the left and right subtree
-    std::vector<double> &p_node = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
+    const double* p_node = this->partial_likelihoods(this->active_likelihood[node_index], node_index);
     
     // sum the log-likelihoods for all sites together
     double sum_partial_probs = 0.0;
@@ -2,6 +2,7 @@
 #define PhyloBrownianProcessREML_H
 
 #include "AbstractPhyloBrownianProcess.h"
+#include "NodeSiteBuffer.h"
 #include "TreeChangeEventListener.h"
 
 namespace RevBayesCore {
@@ -45,11 +46,11 @@ namespace RevBayesCore {
         // Parameter management functions.
         virtual void                                                        swapParameterInternal(const DagNode *oldP, const DagNode *newP);                         //!< Swap a parameter
 
-        // the likelihoods
-        std::vector<std::vector<std::vector<double> > >                     partial_likelihoods;
-        std::vector<std::vector<std::vector<double> > >                     contrasts;
+        // the likelihoods, indexed by (active likelihood, node)
+        NodeSiteBuffer                                                      partial_likelihoods;
+        NodeSiteBuffer                                                      contrasts;
         std::vector<std::vector<double> >                                   contrast_uncertainty;
-        std::vector<std::vector<std::vector<double> > >                     contrast_uncertainty_per_site;
+        NodeSiteBuffer                                                      contrast_uncertainty_per_site;
         std::vector<size_t>                                                 active_likelihood;
         
         // convenience variables available for derived classes too
@@ -60,7 +61,10 @@ namespace RevBayesCore {
         
         
     private:
-                
+        
+        std::vector<double>                                                 site_offsets;                                   //!< -ln(r) for the rate r of each site
+        std::vector<double>                                                 site_factors;                                   //!< 1/r^2 for the rate r of each site
+        
     };
     
 }
@@ -0,0 +1,154 @@
+#include "PhyloContinuousCharacterKernels.h"
+
+#if ( defined(__x86_64__) || defined(__i386__) ) && defined(__GNUC__)
+#define RB_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    enum InstructionSet { SCALAR, SSE, AVX2 };
+
+    /*
+     * Scalar kernels
+     */
+    namespace scalar {
+
+        typedef double Vector;
+        const size_t WIDTH = 1;
+
+        inline Vector set1(double x)                                        { return x; }
+        inline Vector load(const double* p)                                 { return *p; }
+        inline void   store(double* p, Vector v)                            { *p = v; }
+        inline Vector add(Vector a, Vector b)                               { return a + b; }
+        inline Vector sub(Vector a, Vector b)                               { return a - b; }
+        inline Vector mul(Vector a, Vector b)                               { return a * b; }
+        inline Vector div(Vector a, Vector b)                               { return a / b; }
+
+#       include "PhyloContinuousCharacterKernelsImpl.h"
+
+    }
+
+#if defined( RB_X86_KERNELS )
+
+    /*
+     * SSE2 kernels
+     */
+#if defined(__clang__)
+#   pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#else
+#   pragma GCC push_options
+#   pragma GCC target("sse2")
+#endif
+
+    namespace sse {
+
+        typedef __m128d Vector;
+        const size_t WIDTH = 2;
+
+        inline Vector set1(double x)                                        { return _mm_set1_pd(x); }
+        inline Vector load(const double* p)                                 { return _mm_loadu_pd(p); }
+        inline void   store(double* p, Vector v)                            { _mm_storeu_pd(p, v); }
+        inline Vector add(Vector a, Vector b)                               { return _mm_add_pd(a, b); }
+        inline Vector sub(Vector a, Vector b)                               { return _mm_sub_pd(a, b); }
+        inline Vector mul(Vector a, Vector b)                               { return _mm_mul_pd(a, b); }
+        inline Vector div(Vector a, Vector b)                               { return _mm_div_pd(a, b); }
+
+#       include "PhyloContinuousCharacterKernelsImpl.h"
+
+    }
+
+#if defined(__clang__)
+#   pragma clang attribute pop
+#else
+#   pragma GCC pop_options
+#endif
+
+
+    /*
+     * AVX2 kernels
+     * Note, we do not enable FMA so that the compiler cannot fuse the multiplications and additions.
+     */
+#if defined(__clang__)
+#   pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#   pragma GCC push_options
+#   pragma GCC target("avx2")
+#endif
+
+    namespace avx2 {
+
+        typedef __m256d Vector;
+        const size_t WIDTH = 4;
+
+        inline Vector set1(double x)                                        { return _mm256_set1_pd(x); }
+        inline Vector load(const double* p)                                 { return _mm256_loadu_pd(p); }
+        inline void   store(double* p, Vector v)                            { _mm256_storeu_pd(p, v); }
+        inline Vector add(Vector a, Vector b)                               { return _mm256_add_pd(a, b); }
+        inline Vector sub(Vector a, Vector b)                               { return _mm256_sub_pd(a, b); }
+        inline Vector mul(Vector a, Vector b)                               { return _mm256_mul_pd(a, b); }
+        inline Vector div(Vector a, Vector b)                               { return _mm256_div_pd(a, b); }
+
+#       include "PhyloContinuousCharacterKernelsImpl.h"
+
+    }
+
+#if defined(__clang__)
+#   pragma clang attribute pop
+#else
+#   pragma GCC pop_options
+#endif
+
+#endif
+
+
+    InstructionSet detectInstructionSet(void)
+    {
+
+#if defined( RB_X86_KERNELS )
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx2") )
+        {
+            return AVX2;
+        }
+        if ( __builtin_cpu_supports("sse2") )
+        {
+            return SSE;
+        }
+#endif
+
+        return SCALAR;
+    }
+
+
+    InstructionSet getInstructionSet(void)
+    {
+
+        static const InstructionSet best_instruction_set = detectInstructionSet();
+
+        return best_instruction_set;
+    }
+
+}
+
+
+void PhyloContinuousCharacterKernels::computeContrasts(const double* mu_left, const double* mu_right, const double* p_left, const double* p_right,
+                                                       double scale_left, double shift_left, double scale_right, double shift_right,
+                                                       double t_left, double t_right, double ln_constant, double quadratic_factor,
+                                                       const double* site_offsets, const double* site_factors,
+                                                       double* mu_node, double* p_node, size_t num_sites)
+{
+
+    switch ( getInstructionSet() )
+    {
+#if defined( RB_X86_KERNELS )
+        case AVX2:      avx2::computeContrasts(mu_left, mu_right, p_left, p_right, scale_left, shift_left, scale_right, shift_right, t_left, t_right, ln_constant, quadratic_factor, site_offsets, site_factors, mu_node, p_node, num_sites); break;
+        case SSE:       sse::computeContrasts(mu_left, mu_right, p_left, p_right, scale_left, shift_left, scale_right, shift_right, t_left, t_right, ln_constant, quadratic_factor, site_offsets, site_factors, mu_node, p_node, num_sites); break;
+#endif
+        default:        scalar::computeContrasts(mu_left, mu_right, p_left, p_right, scale_left, shift_left, scale_right, shift_right, t_left, t_right, ln_constant, quadratic_factor, site_offsets, site_factors, mu_node, p_node, num_sites); break;
+    }
+
+}
@@ -0,0 +1,41 @@
+#ifndef PhyloContinuousCharacterKernels_H
+#define PhyloContinuousCharacterKernels_H
+
+#include <stddef.h>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Vectorized kernels for the per-site loops of the REML (independent contrasts) algorithms.
+     *
+     * As for the PhyloCTMC kernels, the loops are compiled for plain scalar code, SSE2 and AVX2, and the best
+     * instruction set supported by the CPU is picked once at runtime. No multiply-adds are fused, so all
+     * instruction sets give bit-identical results.
+     */
+    namespace PhyloContinuousCharacterKernels {
+
+        /*
+         * Combine the two children of a node for all sites. For each site, the children's values are first moved along their branches,
+         *
+         *    m_left  = scale_left  * mu_left  + shift_left
+         *    m_right = scale_right * mu_right + shift_right,
+         *
+         * (scale = 1 and shift = 0 for Brownian motion), and then
+         *
+         *    mu_node = (m_left * t_right + m_right * t_left) / (t_left + t_right)
+         *    p_node  = ln_constant + site_offset - site_factor * quadratic_factor * (m_left - m_right)^2 + p_left + p_right.
+         *
+         * site_offsets and site_factors may both be NULL, in which case they are 0 and 1 for every site.
+         * The node may be one of the children (mu_node == mu_left and p_node == p_left), but the arrays must not overlap otherwise.
+         */
+        void                        computeContrasts(const double* mu_left, const double* mu_right, const double* p_left, const double* p_right,
+                                                     double scale_left, double shift_left, double scale_right, double shift_right,
+                                                     double t_left, double t_right, double ln_constant, double quadratic_factor,
+                                                     const double* site_offsets, const double* site_factors,
+                                                     double* mu_node, double* p_node, size_t num_sites);
+
+    }
+
+}
+
+#endif
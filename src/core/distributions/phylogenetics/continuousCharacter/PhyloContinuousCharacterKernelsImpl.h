@@ -0,0 +1,88 @@
+/*
+ * The bodies of the REML kernels.
+ *
+ * This file is included once per instruction set by PhyloContinuousCharacterKernels.cpp, each time inside its own namespace
+ * and with the target of the surrounding functions set accordingly. Before the inclusion, the namespace has to provide
+ *
+ *    Vector                                    the vector type
+ *    WIDTH                                     the number of doubles in a vector
+ *    set1(x)                                   initialization
+ *    load(p), store(p,v)                       unaligned loads and stores of WIDTH values
+ *    add(a,b), sub(a,b), mul(a,b), div(a,b)    the arithmetic (which must not be fused)
+ *
+ * There are deliberately no include guards.
+ */
+
+
+/**
+ * Combine the two children of a node for all sites (see PhyloContinuousCharacterKernels.h).
+ * The remaining sites after the last full vector are computed with the same operations in the same order.
+ */
+inline void computeContrasts(const double* mu_left, const double* mu_right, const double* p_left, const double* p_right,
+                             double scale_left, double shift_left, double scale_right, double shift_right,
+                             double t_left, double t_right, double ln_constant, double quadratic_factor,
+                             const double* site_offsets, const double* site_factors,
+                             double* mu_node, double* p_node, size_t num_sites)
+{
+
+    double t_sum = t_left + t_right;
+
+    Vector v_scale_left         = set1( scale_left );
+    Vector v_shift_left         = set1( shift_left );
+    Vector v_scale_right        = set1( scale_right );
+    Vector v_shift_right        = set1( shift_right );
+    Vector v_t_left             = set1( t_left );
+    Vector v_t_right            = set1( t_right );
+    Vector v_t_sum              = set1( t_sum );
+    Vector v_ln_constant        = set1( ln_constant );
+    Vector v_quadratic_factor   = set1( quadratic_factor );
+
+    bool per_site = ( site_offsets != NULL );
+
+    size_t i = 0;
+    for (; i + WIDTH <= num_sites; i += WIDTH)
+    {
+        Vector m_left   = add( mul( v_scale_left, load( mu_left + i ) ), v_shift_left );
+        Vector m_right  = add( mul( v_scale_right, load( mu_right + i ) ), v_shift_right );
+        Vector mu       = div( add( mul( m_left, v_t_right ), mul( m_right, v_t_left ) ), v_t_sum );
+        Vector contrast = sub( m_left, m_right );
+        Vector q        = mul( v_quadratic_factor, mul( contrast, contrast ) );
+
+        Vector lnl;
+        if ( per_site == true )
+        {
+            lnl = sub( add( v_ln_constant, load( site_offsets + i ) ), mul( load( site_factors + i ), q ) );
+        }
+        else
+        {
+            lnl = sub( v_ln_constant, q );
+        }
+        Vector p = add( add( lnl, load( p_left + i ) ), load( p_right + i ) );
+
+        store( mu_node + i, mu );
+        store( p_node + i, p );
+    }
+    for (; i < num_sites; ++i)
+    {
+        double m_left   = scale_left * mu_left[i] + shift_left;
+        double m_right  = scale_right * mu_right[i] + shift_right;
+        double mu       = (m_left * t_right + m_right * t_left) / t_sum;
+        double contrast = m_left - m_right;
+        double q        = quadratic_factor * (contrast * contrast);
+
+        double lnl;
+        if ( per_site == true )
+        {
+            lnl = (ln_constant + site_offsets[i]) - site_factors[i] * q;
+        }
+        else
+        {
+            lnl = ln_constant - q;
+        }
+        double p = (lnl + p_left[i]) + p_right[i];
+
+        mu_node[i] = mu;
+        p_node[i] = p;
+    }
+
+}
@@ -7,6 +7,7 @@
 
 #include "ConstantNode.h"
 #include "DistributionNormal.h"
+#include "PhyloContinuousCharacterKernels.h"
 #include "PhyloMultiSampleOrnsteinUhlenbeckProcessREML.h"
 #include "RandomNumberFactory.h"
 #include "RbException.h"
@@ -35,10 +36,9 @@ PhyloMultiSampleOrnsteinUhlenbeckProcessREML::PhyloMultiSampleOrnsteinUhlenbeckP
     num_species( t->getValue().getNumberOfTips() ),
     num_individuals( ta.size() ),
     taxa( ta ),
-    partial_likelihoods( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
-    contrasts( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
+    partial_likelihoods( 2, this->num_nodes, this->num_sites ),
+    contrasts( 2, this->num_nodes, this->num_sites ),
     contrast_uncertainty( std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) ) ),
-    normalizing_constants( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 1.0) ) ) ),
     active_likelihood( std::vector<size_t>(this->num_nodes, 0) ),
     changed_nodes( std::vector<bool>(this->num_nodes, false) ),
     dirty_nodes( std::vector<bool>(this->num_nodes, true) )
@@ -292,8 +292,8 @@ void PhyloMultiSampleOrnsteinUhlenbeckProcessREML::recursiveComputeLnProbability
     if ( node.isTip() == true && dirty_nodes[node_index] == true )
     {
         
-        std::vector<double> &p_node  = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &mu_node  = this->contrasts[this->active_likelihood[node_index]][node_index];
+        double* p_node  = this->partial_likelihoods(this->active_likelihood[node_index], node_index);
+        double* mu_node = this->contrasts(this->active_likelihood[node_index], node_index);
         
         const std::string &name = this->tau->getValue().getNode( node_index ).getName();
         double num_samples = 0.0;
@@ -348,9 +348,8 @@ void PhyloMultiSampleOrnsteinUhlenbeckProcessREML::recursiveComputeLnProbability
         // mark as computed
         dirty_nodes[node_index] = false;
         
-        std::vector<double> &p_node             = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &mu_node            = this->contrasts[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &norm_const_node    = this->normalizing_constants[this->active_likelihood[node_index]][node_index];
+        double* p_node  = this->partial_likelihoods(this->active_likelihood[node_index], node_index);
+        double* mu_node = this->contrasts(this->active_likelihood[node_index], node_index);
         
         
         // get the number of children
@@ -372,16 +371,12 @@ void PhyloMultiSampleOrnsteinUhlenbeckProcessREML::recursiveComputeLnProbability
             size_t right_index = right.getIndex();
             recursiveComputeLnProbability( right, right_index );
             
-            const std::vector<double> &p_left  = this->partial_likelihoods[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &p_right = this->partial_likelihoods[this->active_likelihood[right_index]][right_index];
+            const double* p_left  = this->partial_likelihoods(this->active_likelihood[left_index], left_index);
+            const double* p_right = this->partial_likelihoods(this->active_likelihood[right_index], right_index);
             
             // get the per node and site contrasts
-            const std::vector<double> &mu_left  = this->contrasts[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &mu_right = this->contrasts[this->active_likelihood[right_index]][right_index];
-            
-            // get the per node and site normalizing constants
-            const std::vector<double> &norm_const_left  = this->normalizing_constants[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &norm_const_right = this->normalizing_constants[this->active_likelihood[right_index]][right_index];
+            const double* mu_left  = this->contrasts(this->active_likelihood[left_index], left_index);
+            const double* mu_right = this->contrasts(this->active_likelihood[right_index], right_index);
             
             // get the propagated uncertainties
             double delta_left  = this->contrast_uncertainty[this->active_likelihood[left_index]][left_index];
@@ -430,42 +425,27 @@ void PhyloMultiSampleOrnsteinUhlenbeckProcessREML::recursiveComputeLnProbability
             double theta_left   = computeBranchTheta( left_index );
             double theta_right  = computeBranchTheta( right_index );
             
-            double stdev = sqrt(var_left+var_right);
-            for (int i=0; i<this->num_sites; i++)
+            // the values of the children are moved along their branches, m = exp(alpha*bl) * (mu - theta) + theta,
+            // and the log-density of the contrast c = m_left - m_right is alpha_left*bl_left + alpha_right*bl_right - ln(sqrt(2 pi)) - ln(stdev) - c^2 / (2 stdev^2)
+            double scale_left   = exp(1.0 * bl_left  * alpha_left );
+            double scale_right  = exp(1.0 * bl_right * alpha_right);
+            double stdev        = sqrt(var_left+var_right);
+            double ln_constant  = alpha_left*bl_left + alpha_right*bl_right - RbConstants::LN_SQRT_2PI - log(stdev);
+            PhyloContinuousCharacterKernels::computeContrasts(mu_left, mu_right, p_left, p_right,
+                                                              scale_left, theta_left - scale_left * theta_left, scale_right, theta_right - scale_right * theta_right,
+                                                              var_left, var_right, ln_constant, 1.0 / ( 2.0 *(var_left+var_right) ),
+                                                              NULL, NULL, mu_node, p_node, this->num_sites);
+            
+            if ( node.isRoot() == true )
             {
-                
-                double m_left   = exp(1.0 * bl_left  * alpha_left ) * (mu_left[i]  - theta_left)  + theta_left;
-                double m_right  = exp(1.0 * bl_right * alpha_right) * (mu_right[i] - theta_right) + theta_right;
-                mu_node[i] = (m_left*var_right + m_right*var_left) / (var_left+var_right);
-                
-                // get the site specific rate of evolution
-                double standDev = this->computeSiteRate(i) * stdev;
-                
-                // compute the contrasts for this site and node
-                double contrast = m_left - m_right;
-                
-                // compute the probability for the contrasts at this node
-                double z_left  = norm_const_left[i];
-                double z_right = norm_const_right[i];
-                double z_node  = exp(alpha_left*bl_left+alpha_right*bl_right)/(z_left*z_right) * exp( -1.0 * contrast * contrast / ( 2.0 *(var_left+var_right) ) ) / RbConstants::SQRT_2PI / stdev;
-                norm_const_node[i] = 1.0;
-                
-                double lnl_node = log( z_node );
-                //                lnl_node -= RbConstants::LN_SQRT_2PI - log( sqrt( var_node ) );
-                //                lnl_node -= ( (contrast-mu_node[i])*(contrast-mu_node[i]) ) / (2.0*var_node);
-                //                lnl_node -= ( mu_node[i]*mu_node[i] ) / (2.0*var_node);
-                
-                if ( node.isRoot() == true )
+                double root_state = computeRootState();
+                double root_stdev = sqrt( var_node );
+                for (int i=0; i<this->num_sites; i++)
                 {
-                    double root_state = computeRootState();
                     // dnorm(root.x, vals[1], sqrt(vals[2]), TRUE)
-                    lnl_node += RbStatistics::Normal::lnPdf( root_state, sqrt((var_left*var_right) / (var_left+var_right)), mu_node[i]);
+                    p_node[i] += RbStatistics::Normal::lnPdf( root_state, root_stdev, mu_node[i]);
                 }
-                
-                // sum up the probabilities of the contrasts
-                p_node[i] = lnl_node + p_left[i] + p_right[i];
-                
-            } // end for-loop over all sites
+            }
             
         } // end for-loop over all children
         
@@ -509,10 +489,9 @@ void PhyloMultiSampleOrnsteinUhlenbeckProcessREML::resetValue( void )
 {
     
     // check if the vectors need to be resized
-    partial_likelihoods = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
-    contrasts = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
+    partial_likelihoods = NodeSiteBuffer(2, this->num_nodes, this->num_sites);
+    contrasts = NodeSiteBuffer(2, this->num_nodes, this->num_sites);
     contrast_uncertainty = std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) );
-    normalizing_constants = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 1.0) ) );
     
     // create a vector with the correct site indices
     // some of the sites may have been excluded
@@ -542,8 +521,8 @@ void PhyloMultiSampleOrnsteinUhlenbeckProcessREML::resetValue( void )
             {
                 const std::string &name = (*it)->getName();
                 double c = computeMeanForSpecies(name, site_indices[site]);
-                contrasts[0][(*it)->getIndex()][site] = c;
-                contrasts[1][(*it)->getIndex()][site] = c;
+                contrasts(0, (*it)->getIndex())[site] = c;
+                contrasts(1, (*it)->getIndex())[site] = c;
                 contrast_uncertainty[0][(*it)->getIndex()] = sqrt( getWithinSpeciesVariance(name) ) / getNumberOfSamplesForSpecies(name);
                 contrast_uncertainty[1][(*it)->getIndex()] = sqrt( getWithinSpeciesVariance(name) ) / getNumberOfSamplesForSpecies(name);
             }
@@ -909,7 +888,7 @@ double PhyloMultiSampleOrnsteinUhlenbeckProcessREML::sumRootLikelihood( void )
     size_t node_index = root.getIndex();
     
     // get the pointers to the partial likelihoods of the left and right subtree
-    std::vector<double> &p_node = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
+    const double* p_node = this->partial_likelihoods(this->active_likelihood[node_index], node_index);
     
     // sum the log-likelihoods for all sites together
     double sum_partial_probs = 0.0;
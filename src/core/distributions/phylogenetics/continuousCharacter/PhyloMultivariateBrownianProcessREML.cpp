@@ -26,7 +26,7 @@ using namespace RevBayesCore;
 PhyloMultivariateBrownianProcessREML::PhyloMultivariateBrownianProcessREML(const TypedDagNode<Tree> *t, const TypedDagNode<MatrixReal> *c, size_t ns) :
     AbstractPhyloBrownianProcess( t, ns ),
     partial_likelihoods( std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) ) ),
-    contrasts( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0.0) ) ) ),
+    contrasts( 2, this->num_nodes, this->num_sites ),
     contrast_uncertainty( std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) ) ),
     active_likelihood( std::vector<size_t>(this->num_nodes, 0) ),
     independent_contrasts( std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0.0) ) ),
@@ -35,7 +35,9 @@ PhyloMultivariateBrownianProcessREML::PhyloMultivariateBrownianProcessREML(const
     dirty_nodes( std::vector<bool>(this->num_nodes, true) ),
     rate_matrix( c ),
     active_matrix(0),
-    precision_matrices( std::vector<MatrixReal>( 2, MatrixReal(num_sites) ) )
+    precision_matrices( std::vector<MatrixReal>( 2, MatrixReal(num_sites) ) ),
+    node_contrasts( num_sites, 0.0 ),
+    zero_means( num_sites, 0.0 )
 {
     
     // add the parameters to our set
@@ -192,7 +194,7 @@ void PhyloMultivariateBrownianProcessREML::recursiveComputeLnProbability( const
         dirty_nodes[node_index] = false;
 
         double              &p_node  = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &mu_node = this->contrasts[this->active_likelihood[node_index]][node_index];
+        double*              mu_node = this->contrasts(this->active_likelihood[node_index], node_index);
 
         // get the number of children
         size_t num_children = node.getNumberOfChildren();
@@ -217,8 +219,8 @@ void PhyloMultivariateBrownianProcessREML::recursiveComputeLnProbability( const
             const double &p_right = this->partial_likelihoods[this->active_likelihood[right_index]][right_index];
 
             // get the per node and site contrasts
-            const std::vector<double> &mu_left  = this->contrasts[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &mu_right = this->contrasts[this->active_likelihood[right_index]][right_index];
+            const double* mu_left  = this->contrasts(this->active_likelihood[left_index], left_index);
+            const double* mu_right = this->contrasts(this->active_likelihood[right_index], right_index);
 
             // get the propagated uncertainties
             double delta_left  = this->contrast_uncertainty[this->active_likelihood[left_index]][left_index];
@@ -241,18 +243,16 @@ void PhyloMultivariateBrownianProcessREML::recursiveComputeLnProbability( const
 
             double branch_length = t_left + t_right;
             
-            std::vector<double> these_contrasts(num_sites);
-            std::vector<double> means(num_sites, 0.0);
             for (size_t i = 0; i < this->num_sites; ++i)
             {
                 // compute the contrasts for this site and node
-                these_contrasts[i] = mu_left[i] - mu_right[i];
+                node_contrasts[i] = mu_left[i] - mu_right[i];
 
                 // compute the estimate of mu for this site and node
                 mu_node[i] = (mu_left[i] * t_right + mu_right[i] * t_left) / (t_left + t_right);
             }
             
-            double lnl_contrast = RbStatistics::MultivariateNormal::lnPdfPrecision(means, precision_matrices[active_matrix], these_contrasts, branch_length);
+            double lnl_contrast = RbStatistics::MultivariateNormal::lnPdfPrecision(zero_means, precision_matrices[active_matrix], node_contrasts, branch_length);
             p_node = lnl_contrast + p_left + p_right;
             
         } // end for-loop over all children
@@ -292,8 +292,8 @@ void PhyloMultivariateBrownianProcessREML::recursiveComputeContrasts( const Topo
             recursiveComputeContrasts( right, right_index );
             
             // get the per node and site contrasts
-            const std::vector<double> &mu_left  = this->contrasts[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &mu_right = this->contrasts[this->active_likelihood[right_index]][right_index];
+            const double* mu_left  = this->contrasts(this->active_likelihood[left_index], left_index);
+            const double* mu_right = this->contrasts(this->active_likelihood[right_index], right_index);
             
             // get the propagated uncertainties
             double delta_left  = this->contrast_uncertainty[this->active_likelihood[left_index]][left_index];
@@ -362,7 +362,9 @@ void PhyloMultivariateBrownianProcessREML::resetValue( void )
     
     // check if the vectors need to be resized
     partial_likelihoods = std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) );
-    contrasts = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
+    contrasts = NodeSiteBuffer(2, this->num_nodes, this->num_sites);
+    node_contrasts = std::vector<double>(this->num_sites, 0.0);
+    zero_means = std::vector<double>(this->num_sites, 0.0);
     contrast_uncertainty = std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) );
     
     // create a vector with the correct site indices
@@ -393,8 +395,8 @@ void PhyloMultivariateBrownianProcessREML::resetValue( void )
             {
                 ContinuousTaxonData& taxon = this->value->getTaxonData( (*it)->getName() );
                 double &c = taxon.getCharacter(site_indices[site]);
-                contrasts[0][(*it)->getIndex()][site] = c;
-                contrasts[1][(*it)->getIndex()][site] = c;
+                contrasts(0, (*it)->getIndex())[site] = c;
+                contrasts(1, (*it)->getIndex())[site] = c;
                 contrast_uncertainty[0][(*it)->getIndex()] = 0;
                 contrast_uncertainty[1][(*it)->getIndex()] = 0;
             }
@@ -2,6 +2,7 @@
 #define PhyloMultivariateBrownianProcessREML_H
 
 #include "AbstractPhyloBrownianProcess.h"
+#include "NodeSiteBuffer.h"
 #include "TreeChangeEventListener.h"
 
 namespace RevBayesCore {
@@ -50,7 +51,7 @@ namespace RevBayesCore {
 
         // the likelihoods
         std::vector<std::vector<double> >                                   partial_likelihoods;
-        std::vector<std::vector<std::vector<double> > >                     contrasts;
+        NodeSiteBuffer                                                      contrasts;
         std::vector<std::vector<double> >                                   contrast_uncertainty;
         std::vector<size_t>                                                 active_likelihood;
         
@@ -66,6 +67,8 @@ namespace RevBayesCore {
         const TypedDagNode< MatrixReal >*                                   rate_matrix;
         size_t                                                              active_matrix;
         std::vector<MatrixReal>                                             precision_matrices;
+        std::vector<double>                                                 node_contrasts;                         //!< Scratch space for the contrasts at a node
+        std::vector<double>                                                 zero_means;                             //!< The (zero) mean of the contrasts
         
     };
     
@@ -2,6 +2,7 @@
 #define PhyloOrnsteinUhlenbeckREML_H
 
 #include "AbstractPhyloBrownianProcess.h"
+#include "NodeSiteBuffer.h"
 #include "TreeChangeEventListener.h"
 
 namespace RevBayesCore {
@@ -54,10 +55,9 @@ namespace RevBayesCore {
         virtual void                                                        swapParameterInternal(const DagNode *oldP, const DagNode *newP);                         //!< Swap a parameter
         
         // the likelihoods
-        std::vector<std::vector<std::vector<double> > >                     partial_likelihoods;
-        std::vector<std::vector<std::vector<double> > >                     contrasts;
+        NodeSiteBuffer                                                      partial_likelihoods;                    //!< Indexed by (active likelihood, node)
+        NodeSiteBuffer                                                      contrasts;                              //!< Indexed by (active likelihood, node)
         std::vector<std::vector<double> >                                   contrast_uncertainty;
-        std::vector<std::vector<std::vector<double> > >                     normalizing_constants;
         std::vector<size_t>                                                 active_likelihood;
         
         // convenience variables available for derived classes too
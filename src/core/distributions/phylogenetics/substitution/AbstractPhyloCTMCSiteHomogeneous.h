@@ -7,6 +7,7 @@
 #include "DnaState.h"
 #include "MatrixReal.h"
 #include "MemberObject.h"
+#include "PartialLikelihoodBufferPool.h"
 #include "RbConstants.h"
 #include "RbMathLogic.h"
 #include "RbSettings.h"
@@ -19,6 +20,9 @@
 #include "TreeChangeEventListener.h"
 #include "TypedDistribution.h"
 
+#include <algorithm>
+#include <functional>
+#include <mutex>
 #include <memory.h>
 
 namespace RevBayesCore {
@@ -59,6 +63,18 @@ namespace RevBayesCore {
      * siteOffset                  =  num_chars;
      * This gives the more convenient access via
      * partialLikelihoods[active*activeLikelihoodOffset + node_index*nodeOffset + siteRateIndex*mixtureOffset + siteIndex*siteOffset + charIndex]
+     * Derived classes should get the partial likelihoods of the active copy of a node by getPartialLikelihoods(node_index).
+     *
+     * We do not allocate this array as a whole. Instead, the partial likelihoods of each copy of a node (slot active*num_nodes+node_index)
+     * are a buffer of nodeOffset values from a PartialLikelihoodBufferPool. Every node holds a buffer for its active copy,
+     * but a node gets a buffer for its other copy only when it is recomputed, and gives it back once the move is accepted or rejected.
+     * Hence, we store about one copy of the partial likelihoods per node plus one per node that was dirty at the same time,
+     * instead of two copies of every node. The released buffers are kept for reuse, so the pool does not allocate while the MCMC runs.
+     *
+     * Optionally, the partial likelihoods are stored in single precision (see setUseSinglePrecision()), which halves the memory.
+     * Then the buffers come from singlePrecisionPartialLikelihoods instead. The computations are still done in double precision:
+     * getPartialLikelihoods() returns a double precision working copy of the node, which is written back (rounded to single precision)
+     * once the node has been computed and scaled. We rescale every node in this mode, because floats underflow quickly (see scalesNode()).
      *
      * Our implementation of the partial likelihoods means that we can store the partial likelihood of a node, but not for site rates.
      * We also use twice as much memory because we store the partial likelihood along each branch and not only for each internal node.
@@ -76,6 +92,12 @@ namespace RevBayesCore {
      * This gives the more convenient access via
      * pmatrices[active * activePmatrixOffset + node_index * nodeOffset + site_mixture_index]
      *
+     * The site patterns of this process (pattern_block_start to pattern_block_end, see MPI) can additionally be split
+     * into blocks that are computed on several threads (see the user setting 'numThreads'). Derived classes opt in by
+     * overriding the *ForPatterns methods, which compute the likelihoods only for the patterns in [pattern_begin, pattern_end),
+     * and supportsPatternBlockThreads(). Every pattern is computed by exactly the same operations as in the serial case
+     * and the per pattern likelihoods are summed serially, so the likelihood does not depend on the number of threads.
+     *
      */
     template<class charType>
     class AbstractPhyloCTMCSiteHomogeneous : public TypedDistribution< AbstractHomologousDiscreteCharacterData >, public MemberObject< RbVector<double> >, public MemberObject < MatrixReal >, public TreeChangeEventListener {
@@ -119,6 +141,7 @@ namespace RevBayesCore {
         void                                                                setSiteRates(const TypedDagNode< RbVector< double > > *r);
         void                                                                setSiteRatesProbs(const TypedDagNode< Simplex > *rp);
         void                                                                setUseMarginalLikelihoods(bool tf);
+        void                                                                setUseSinglePrecision(bool tf);                                                             //!< Store the partial likelihoods in single instead of double precision
         void                                                                setUseSiteMatrices(bool sm, const TypedDagNode< Simplex > *s = NULL);
         void                                                                swap_taxon_name_2_tip_index(std::string tip1, std::string tip2);
 
@@ -129,10 +152,18 @@ namespace RevBayesCore {
     protected:
 
         // helper method for this and derived classes
+        void                                                                allocatePartialLikelihoods(void) const;                                                     //!< Set up the partial likelihood buffers of the active copies of all nodes
+        void                                                                freePartialLikelihoods(void) const;                                                         //!< Free the partial likelihoods
         void                                                                recursivelyFlagNodeDirty(const TopologyNode& n);
+        bool                                                                scalesNode(size_t node_idx) const;                                                          //!< Do we rescale the partial likelihoods of this node?
+        bool                                                                usesScalingFactors(void) const;                                                             //!< Are the partial likelihoods scaled, so that the root needs to take the scaling factors out?
         void                                                                flagNodeDirtyPmatrix(size_t node_idx);
+        double                                                              getLogScalingFactor(size_t node_idx, size_t site) const;                                    //!< The log of the factor by which the partial likelihoods of this node and site were divided
+        double*                                                             getPartialLikelihoods(size_t node_idx);                                                     //!< The (active) partial likelihoods of this node
+        const double*                                                       getPartialLikelihoods(size_t node_idx) const;                                               //!< The (active) partial likelihoods of this node
         virtual void                                                        resizeLikelihoodVectors(void);
         virtual void                                                        setActivePIDSpecialized(size_t i, size_t n);                                                          //!< Set the number of processes for this distribution.
+        virtual bool                                                        supportsScalingExponents(void) const { return true; }                                       //!< Can the partial likelihoods be scaled with power-of-two exponents (see RbSettings)?
         virtual void                                                        updateTransitionProbabilities(size_t node_idx);
         virtual void                                                        updateTransitionProbabilityMatrices(void);
         virtual std::vector<double>                                         getRootFrequencies( size_t mixture = 0 ) const;
@@ -157,6 +188,14 @@ namespace RevBayesCore {
         virtual void                                                        computeRootLikelihood( size_t root, size_t left, size_t right) = 0;
         virtual void                                                        computeRootLikelihood( size_t root, size_t left, size_t right, size_t middle) = 0;
 
+        // virtual methods computing only a block of site patterns; override these (and supportsPatternBlockThreads) to allow for multithreading
+        virtual void                                                        computeInternalNodeLikelihoodForPatterns(const TopologyNode &n, size_t nIdx, size_t l, size_t r, size_t pattern_begin, size_t pattern_end);
+        virtual void                                                        computeInternalNodeLikelihoodForPatterns(const TopologyNode &n, size_t nIdx, size_t l, size_t r, size_t m, size_t pattern_begin, size_t pattern_end);
+        virtual void                                                        computeTipLikelihoodForPatterns(const TopologyNode &node, size_t nIdx, size_t pattern_begin, size_t pattern_end);
+        virtual void                                                        computeRootLikelihoodForPatterns( size_t root, size_t left, size_t right, size_t pattern_begin, size_t pattern_end);
+        virtual void                                                        computeRootLikelihoodForPatterns( size_t root, size_t left, size_t right, size_t middle, size_t pattern_begin, size_t pattern_end);
+        virtual bool                                                        supportsPatternBlockThreads(void) const;                                                     //!< Can the likelihood computations be split into blocks of patterns?
+
         // virtual methods that you may want to overwrite
         virtual void                                                        compress(void);
         virtual void                                                        computeMarginalNodeLikelihood(size_t node_idx, size_t parentIdx);
@@ -190,11 +229,17 @@ namespace RevBayesCore {
         size_t                                                              pmatNodeOffset;
 
         // the likelihoods
-        mutable double*                                                     partialLikelihoods;
+        mutable PartialLikelihoodBufferPool<double>                         partialLikelihoods;
+        mutable PartialLikelihoodBufferPool<float>                          singlePrecisionPartialLikelihoods;
+        mutable PartialLikelihoodBufferPool<double>                         partialLikelihoodWorkingCopies;                 // the double precision copies of single precision partial likelihoods, by active*num_nodes+node_index
+        mutable std::mutex                                                  partialLikelihoodWorkingCopiesMutex;            // serializes the creation of working copies by getPartialLikelihoods()
+        bool                                                                use_single_precision;
         std::vector<size_t>                                                 activeLikelihood;
         double*                                                             marginalLikelihoods;
 
         std::vector< std::vector< std::vector<double> > >                   perNodeSiteLogScalingFactors;
+        std::vector<int>                                                    perNodeSiteScalingExponents;                    // the power-of-two scaling exponents, indexed by (active likelihood, node, site), if we use them
+        bool                                                                use_scaling_exponents;
 
         // the data
         std::vector<std::vector<RbBitSet> >                                 ambiguous_char_matrix;
@@ -265,13 +310,21 @@ namespace RevBayesCore {
     private:
 
         // private methods
+        void                                                                beginPartialLikelihoodComputation(size_t i, const size_t *children, size_t n_children);    //!< Prepare the partial likelihoods of a node and its children for the computation of the node
+        void                                                                finishPartialLikelihoodComputation(size_t i, const size_t *children, size_t n_children);   //!< Store the partial likelihoods of a node once it has been computed and scaled
+        void                                                                releaseInactivePartialLikelihoods(size_t i);                                                //!< Give the buffer of the inactive copy of a node back to the pool
+        void                                                                computeForPatternBlocks(const std::function<void (size_t, size_t)> &job);                   //!< Execute the job for each block of patterns, possibly on several threads
         void                                                                fillLikelihoodVector(const TopologyNode &n, size_t nIdx);
+        size_t                                                              getNumberOfPatternBlocks(void) const;                                                       //!< The number of blocks the patterns are split into for multithreading
         void                                                                recursiveMarginalLikelihoodComputation(size_t nIdx);
         virtual void                                                        scale(size_t i);
         virtual void                                                        scale(size_t i, size_t l, size_t r);
         virtual void                                                        scale(size_t i, size_t l, size_t r, size_t m);
+        void                                                                scaleForPatterns(size_t i, const size_t *children, size_t n_children, size_t pattern_begin, size_t pattern_end);
+        void                                                                scaleForPatternsWithExponents(size_t i, const size_t *children, size_t n_children, size_t pattern_begin, size_t pattern_end);
         virtual void                                                        simulate(const TopologyNode& node, std::vector< DiscreteTaxonData< charType > > &t, const std::vector<bool> &inv, const std::vector<size_t> &perSiteRates);
         virtual void                                                        updateTransitionProbabilityMatrix(size_t node_idx);
+        void                                                                updateTransitionProbabilityMatrices(const std::vector<size_t> &node_indices);              //!< Update the matrices of these branches (all at once per rate matrix)
         
         
         
@@ -287,8 +340,11 @@ namespace RevBayesCore {
 #include "RandomNumberGenerator.h"
 #include "RateMatrix_JC.h"
 #include "StochasticNode.h"
+#include "ThreadPool.h"
 
 #include <cmath>
+#include <map>
+#include <unordered_map>
 
 #ifdef RB_MPI
 #include <mpi.h>
@@ -309,11 +365,16 @@ num_matrices( 1 ),
 tau( t ),
 transition_prob_matrices( std::vector<TransitionProbabilityMatrix>(num_site_mixtures, TransitionProbabilityMatrix(num_chars) ) ),
 //    partialLikelihoods( new double[2*num_nodes*num_site_mixtures*num_sites*num_chars] ),
-partialLikelihoods( NULL ),
+partialLikelihoods(),
+singlePrecisionPartialLikelihoods(),
+partialLikelihoodWorkingCopies(),
+use_single_precision( false ),
 activeLikelihood( std::vector<size_t>(num_nodes, 0) ),
 //    marginalLikelihoods( new double[num_nodes*num_site_mixtures*num_sites*num_chars] ),
 marginalLikelihoods( NULL ),
 perNodeSiteLogScalingFactors( std::vector<std::vector< std::vector<double> > >(2, std::vector<std::vector<double> >(num_nodes, std::vector<double>(num_sites, 0.0) ) ) ),
+perNodeSiteScalingExponents(),
+use_scaling_exponents( false ),
 ambiguous_char_matrix(),
 char_matrix(),
 gap_matrix(),
@@ -411,11 +472,16 @@ num_matrices( n.num_matrices ),
 tau( n.tau ),
 transition_prob_matrices( n.transition_prob_matrices ),
 //    partialLikelihoods( new double[2*num_nodes*num_site_mixtures*num_sites*num_chars] ),
-partialLikelihoods( NULL ),
+partialLikelihoods(),
+singlePrecisionPartialLikelihoods(),
+partialLikelihoodWorkingCopies(),
+use_single_precision( n.use_single_precision ),
 activeLikelihood( n.activeLikelihood ),
 //    marginalLikelihoods( new double[num_nodes*num_site_mixtures*num_sites*num_chars] ),
 marginalLikelihoods( NULL ),
 perNodeSiteLogScalingFactors( n.perNodeSiteLogScalingFactors ),
+perNodeSiteScalingExponents( n.perNodeSiteScalingExponents ),
+use_scaling_exponents( n.use_scaling_exponents ),
 ambiguous_char_matrix( n.ambiguous_char_matrix ),
 char_matrix( n.char_matrix ),
 gap_matrix( n.gap_matrix ),
@@ -479,8 +545,12 @@ sampled_site_matrix_component( n.sampled_site_matrix_component )
     // copy the partial likelihoods if necessary
     if ( in_mcmc_mode == true )
     {
-        partialLikelihoods = new double[2*activeLikelihoodOffset];
-        memcpy(partialLikelihoods, n.partialLikelihoods, 2*activeLikelihoodOffset*sizeof(double));
+        partialLikelihoods                  = n.partialLikelihoods;
+        singlePrecisionPartialLikelihoods   = n.singlePrecisionPartialLikelihoods;
+        if ( use_single_precision == true )
+        {
+            partialLikelihoodWorkingCopies.initialize( nodeOffset, 2*num_nodes, num_nodes );
+        }
     }
 
     // copy the marginal likelihoods if necessary
@@ -509,11 +579,74 @@ RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::~AbstractPhyloCTMCSite
     }
 
     // free the partial likelihoods
-    delete [] partialLikelihoods;
+    freePartialLikelihoods();
     delete [] marginalLikelihoods;
 }
 
 
+/**
+ * Set up the pool of partial likelihood buffers (in single or double precision) and allocate the active copies of all nodes.
+ * The other copies get their buffers when the nodes are recomputed.
+ * We keep the released buffers of all nodes, so that a move that touches every node (e.g., of the substitution model)
+ * does not free and allocate a second copy of every node again and again.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::allocatePartialLikelihoods( void ) const
+{
+
+    size_t max_free_buffers = num_nodes;
+
+    if ( use_single_precision == true )
+    {
+        singlePrecisionPartialLikelihoods.initialize( nodeOffset, 2*num_nodes, max_free_buffers );
+        partialLikelihoodWorkingCopies.initialize( nodeOffset, 2*num_nodes, max_free_buffers );
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            singlePrecisionPartialLikelihoods.acquire( activeLikelihood[i]*num_nodes + i );
+        }
+    }
+    else
+    {
+        partialLikelihoods.initialize( nodeOffset, 2*num_nodes, max_free_buffers );
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            partialLikelihoods.acquire( activeLikelihood[i]*num_nodes + i );
+        }
+    }
+
+}
+
+
+/**
+ * Prepare the computation of the partial likelihoods of a node.
+ * We take a buffer for the active copy of the node from the pool, if it does not have one yet.
+ * In single precision mode, we also make sure that the double precision working copies of the children exist
+ * and create a new working copy for the node. All buffers and working copies have to exist before we compute the patterns
+ * on several threads, because creating them is not thread safe.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::beginPartialLikelihoodComputation( size_t node_index, const size_t *children, size_t n_children )
+{
+
+    size_t slot = activeLikelihood[node_index]*num_nodes + node_index;
+
+    for (size_t j = 0; j < n_children; ++j)
+    {
+        getPartialLikelihoods( children[j] );
+    }
+
+    if ( use_single_precision == false )
+    {
+        partialLikelihoods.acquire( slot );
+        return;
+    }
+
+    singlePrecisionPartialLikelihoods.acquire( slot );
+    partialLikelihoodWorkingCopies.acquire( slot );
+
+}
+
+
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::bootstrap( void )
 {
@@ -623,6 +756,48 @@ inline bool has_weighted_characters(AbstractHomologousDiscreteCharacterData& dat
     return false;
 }
 
+/**
+ * Hash a character state such that two states with the same string representation have the same hash,
+ * i.e., missing states, gaps and otherwise the set of observed states.
+ */
+inline size_t hash_character_state(const DiscreteCharacterState& c)
+{
+    if ( c.isMissingState() )
+    {
+        return 0x9e3779b97f4a7c15ULL;
+    }
+    if ( c.isGapState() )
+    {
+        return 0xc2b2ae3d27d4eb4fULL;
+    }
+
+    RbBitSet bs = c.getState();
+    size_t h = bs.size();
+    for (size_t i = bs.find_first(); i != RbBitSet::npos; i = bs.find_next(i))
+    {
+        h ^= i + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+
+    return h;
+}
+
+/**
+ * Are the two character states identical in their string representation?
+ */
+inline bool equal_character_states(const DiscreteCharacterState& a, const DiscreteCharacterState& b)
+{
+    if ( a.isMissingState() || b.isMissingState() )
+    {
+        return a.isMissingState() == b.isMissingState();
+    }
+    if ( a.isGapState() || b.isGapState() )
+    {
+        return a.isGapState() == b.isGapState();
+    }
+
+    return a.getState() == b.getState();
+}
+
 }
 
 template<class charType>
@@ -676,34 +851,71 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
     // compress the character matrix if we're asked to
     if ( compressed == true )
     {
+        // get the taxon data of the tips only once instead of for every site
+        std::vector<const AbstractDiscreteTaxonData*> tip_data;
+        for (auto& node: nodes)
+        {
+            if ( node->isTip() )
+            {
+                tip_data.push_back( &value->getTaxonData( node->getName() ) );
+            }
+        }
+
+        // hash the columns of the alignment
+        // this is the expensive part, so we split the sites into blocks that are hashed in parallel
+        std::vector<size_t> site_hashes( num_sites, 0 );
+        const size_t MIN_SITES_PER_BLOCK = 1024;
+        size_t num_blocks = std::min( ThreadPool::threadPoolInstance().getNumberOfThreads(), num_sites / MIN_SITES_PER_BLOCK );
+        num_blocks = std::max( num_blocks, size_t(1) );
+        ThreadPool::threadPoolInstance().parallelFor( num_blocks, [&](size_t block)
+        {
+            size_t site_begin = (block     * num_sites) / num_blocks;
+            size_t site_end   = ((block+1) * num_sites) / num_blocks;
+            for (size_t site = site_begin; site < site_end; ++site)
+            {
+                size_t h = 0;
+                for (size_t i = 0; i < tip_data.size(); ++i)
+                {
+                    h ^= hash_character_state( tip_data[i]->getCharacter(site_indices[site]) ) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+                }
+                site_hashes[site] = h;
+            }
+        } );
+
         // find the unique site patterns and compute their respective frequencies
-        std::map<std::string,size_t> patterns;
+        // we map the hash of a column to the patterns with this hash and only compare the columns if the hashes match
+        std::unordered_multimap<size_t,size_t> patterns;
+        patterns.reserve( num_sites );
         for (size_t site = 0; site < num_sites; ++site)
         {
-            // create the site pattern
-            std::string pattern = "";
-            for (auto& node: nodes)
+            // check if we have already seen this site pattern
+            size_t pattern_index = num_patterns;
+            auto candidates = patterns.equal_range( site_hashes[site] );
+            for (auto it = candidates.first; it != candidates.second && pattern_index == num_patterns; ++it)
             {
-                if ( node->isTip() )
+                size_t other_site = indexOfSitePattern[it->second];
+                bool same = true;
+                for (size_t i = 0; i < tip_data.size() && same == true; ++i)
                 {
-                    AbstractDiscreteTaxonData& taxon = value->getTaxonData( node->getName() );
-                    CharacterState &c = taxon.getCharacter(site_indices[site]);
-                    pattern += c.getStringValue();
+                    same = equal_character_states( tip_data[i]->getCharacter(site_indices[site]), tip_data[i]->getCharacter(site_indices[other_site]) );
+                }
+                if ( same == true )
+                {
+                    pattern_index = it->second;
                 }
             }
-            // check if we have already seen this site pattern
-            std::map<std::string, size_t>::const_iterator index = patterns.find( pattern );
-            if ( index != patterns.end() )
+
+            if ( pattern_index != num_patterns )
             {
                 // we have already seen this pattern
                 // increase the frequency counter
-                pattern_counts[ index->second ]++;
+                pattern_counts[ pattern_index ]++;
 
                 // obviously this site isn't unique nor the first encounter
                 unique[site] = false;
 
                 // remember which pattern this site uses
-                site_pattern[site] = index->second;
+                site_pattern[site] = pattern_index;
             }
             else
             {
@@ -711,7 +923,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
                 pattern_counts.push_back(1);
 
                 // insert this pattern with the corresponding index in the map
-                patterns.insert( std::pair<std::string,size_t>(pattern,num_patterns) );
+                patterns.insert( std::pair<size_t,size_t>(site_hashes[site],num_patterns) );
 
                 // remember which pattern this site uses
                 site_pattern[site] = num_patterns;
@@ -876,6 +1088,63 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
 }
 
 
+/**
+ * Execute the job for all patterns of this process. If the patterns are split into several blocks,
+ * then each block is a separate job on the thread pool and we return once all blocks are done.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeForPatternBlocks( const std::function<void (size_t, size_t)> &job )
+{
+
+    size_t num_blocks = getNumberOfPatternBlocks();
+
+    if ( num_blocks < 2 )
+    {
+        job( 0, pattern_block_size );
+        return;
+    }
+
+    ThreadPool::threadPoolInstance().parallelFor( num_blocks, [&](size_t block)
+    {
+        size_t pattern_begin = (block     * pattern_block_size) / num_blocks;
+        size_t pattern_end   = ((block+1) * pattern_block_size) / num_blocks;
+        job( pattern_begin, pattern_end );
+    } );
+
+}
+
+
+/**
+ * Compute the partial likelihoods of an internal node for a block of patterns.
+ * The default implementation can only compute all patterns at once and thus should
+ * be overwritten by derived classes that want to support multithreading.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihoodForPatterns(const TopologyNode &node, size_t node_index, size_t left, size_t right, size_t pattern_begin, size_t pattern_end)
+{
+
+    if ( pattern_begin != 0 || pattern_end != pattern_block_size )
+    {
+        throw RbException("This PhyloCTMC cannot compute the likelihood for a block of site patterns.");
+    }
+
+    computeInternalNodeLikelihood(node, node_index, left, right);
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihoodForPatterns(const TopologyNode &node, size_t node_index, size_t left, size_t right, size_t middle, size_t pattern_begin, size_t pattern_end)
+{
+
+    if ( pattern_begin != 0 || pattern_end != pattern_block_size )
+    {
+        throw RbException("This PhyloCTMC cannot compute the likelihood for a block of site patterns.");
+    }
+
+    computeInternalNodeLikelihood(node, node_index, left, right, middle);
+}
+
+
 template<class charType>
 double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbability( void )
 {
@@ -901,9 +1170,12 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbab
     // if we are not in MCMC mode, then we need to (temporarily) allocate memory
     if ( in_mcmc_mode == false )
     {
-        partialLikelihoods = new double[2*activeLikelihoodOffset];
+        allocatePartialLikelihoods();
     }
 
+    // the working copies of single precision partial likelihoods may belong to the previous tree
+    partialLikelihoodWorkingCopies.releaseAll();
+
     // compute the ln probability by recursively calling the probability calculation for each node
     const TopologyNode &root = tau->getValue().getRoot();
 
@@ -924,8 +1196,22 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbab
             size_t right_index = right.getIndex();
             fillLikelihoodVector( right, right_index );
 
-            computeRootLikelihood( root_index, left_index, right_index );
-            scale(root_index, left_index, right_index);
+            size_t children[2] = { left_index, right_index };
+            beginPartialLikelihoodComputation( root_index, children, 2 );
+            if ( getNumberOfPatternBlocks() > 1 )
+            {
+                computeForPatternBlocks( [&](size_t pattern_begin, size_t pattern_end)
+                {
+                    computeRootLikelihoodForPatterns( root_index, left_index, right_index, pattern_begin, pattern_end );
+                    scaleForPatterns( root_index, children, 2, pattern_begin, pattern_end );
+                } );
+            }
+            else
+            {
+                computeRootLikelihood( root_index, left_index, right_index );
+                scale(root_index, left_index, right_index);
+            }
+            finishPartialLikelihoodComputation( root_index, children, 2 );
 
         }
         else if ( root.getNumberOfChildren() == 3 ) // unrooted trees have three children for the root
@@ -940,8 +1226,22 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbab
             size_t middleIndex = middle.getIndex();
             fillLikelihoodVector( middle, middleIndex );
 
-            computeRootLikelihood( root_index, left_index, right_index, middleIndex );
-            scale(root_index, left_index, right_index, middleIndex);
+            size_t children[3] = { left_index, right_index, middleIndex };
+            beginPartialLikelihoodComputation( root_index, children, 3 );
+            if ( getNumberOfPatternBlocks() > 1 )
+            {
+                computeForPatternBlocks( [&](size_t pattern_begin, size_t pattern_end)
+                {
+                    computeRootLikelihoodForPatterns( root_index, left_index, right_index, middleIndex, pattern_begin, pattern_end );
+                    scaleForPatterns( root_index, children, 3, pattern_begin, pattern_end );
+                } );
+            }
+            else
+            {
+                computeRootLikelihood( root_index, left_index, right_index, middleIndex );
+                scale(root_index, left_index, right_index, middleIndex);
+            }
+            finishPartialLikelihoodComputation( root_index, children, 3 );
 
         }
         else
@@ -958,8 +1258,7 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbab
     if ( in_mcmc_mode == false )
     {
         // free the partial likelihoods
-        delete [] partialLikelihoods;
-        partialLikelihoods = NULL;
+        freePartialLikelihoods();
     }
 
     // set the ancestral states as stale
@@ -977,7 +1276,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalNo
     this->updateTransitionProbabilities( node_index );
 
     // get the pointers to the partial likelihoods and the marginal likelihoods
-    const double*   p_node                  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const double*   p_node                  = this->getPartialLikelihoods(node_index);
     double*         p_node_marginal         = this->marginalLikelihoods + node_index*this->nodeOffset;
     const double*   p_parent_node_marginal  = this->marginalLikelihoods + parentnode_index*this->nodeOffset;
 
@@ -1054,7 +1353,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalRo
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods and the marginal likelihoods
-    const double*   p_node           = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const double*   p_node           = this->getPartialLikelihoods(node_index);
     double*         p_node_marginal  = this->marginalLikelihoods + node_index*this->nodeOffset;
 
     // get pointers the likelihood for both subtrees
@@ -1219,7 +1518,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawJointConditio
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods and the marginal likelihoods
-    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    double*         p_node  = this->getPartialLikelihoods(node_index);
 
     // get pointers the likelihood for both subtrees
     const double*   p_site           = p_node;
@@ -1341,7 +1640,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawSiteMixtureAl
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods and the marginal likelihoods
-    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    double*         p_node  = this->getPartialLikelihoods(node_index);
 
     // get pointers the likelihood for both subtrees
     const double*   p_site           = p_node;
@@ -1648,7 +1947,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( in_mcmc_mode == false )
         {
             delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            allocatePartialLikelihoods();
             in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
@@ -1668,8 +1967,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( delete_partial_likelihoods == true )
         {
             // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
+            freePartialLikelihoods();
             in_mcmc_mode = false;
         }
 
@@ -1699,7 +1997,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( in_mcmc_mode == false )
         {
             delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            allocatePartialLikelihoods();
             in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
@@ -1738,8 +2036,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( delete_partial_likelihoods == true )
         {
             // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
+            freePartialLikelihoods();
             in_mcmc_mode = false;
         }
 
@@ -1827,7 +2124,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( in_mcmc_mode == false )
         {
             delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            allocatePartialLikelihoods();
             in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
@@ -1855,8 +2152,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( delete_partial_likelihoods == true )
         {
             // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
+            freePartialLikelihoods();
             in_mcmc_mode = false;
         }
 
@@ -1881,7 +2177,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( in_mcmc_mode == false )
         {
             delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            allocatePartialLikelihoods();
             in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
@@ -1909,8 +2205,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(con
         if ( delete_partial_likelihoods == true )
         {
             // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
+            freePartialLikelihoods();
             in_mcmc_mode = false;
         }
 
@@ -1951,9 +2246,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyDrawJo
     this->updateTransitionProbabilities( node_index );
 
     // get the pointers to the partial likelihoods and the marginal likelihoods
-    //    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
+    //    double*         p_node  = this->getPartialLikelihoods(node_index);
+    const double*   p_left  = this->getPartialLikelihoods(left);
+    const double*   p_right = this->getPartialLikelihoods(right);
 
     // get pointers the likelihood for both subtrees
     //    const double*   p_site           = p_node;
@@ -2140,10 +2435,23 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::fillLikelihoodVec
         {
             // this is a tip node
             // compute the likelihood for the tip and we are done
-            computeTipLikelihood(node, node_index);
+            beginPartialLikelihoodComputation(node_index, NULL, 0);
+            if ( getNumberOfPatternBlocks() > 1 )
+            {
+                computeForPatternBlocks( [&](size_t pattern_begin, size_t pattern_end)
+                {
+                    computeTipLikelihoodForPatterns(node, node_index, pattern_begin, pattern_end);
+                    scaleForPatterns(node_index, NULL, 0, pattern_begin, pattern_end);
+                } );
+            }
+            else
+            {
+                computeTipLikelihood(node, node_index);
 
-            // rescale likelihood vector
-            scale(node_index);
+                // rescale likelihood vector
+                scale(node_index);
+            }
+            finishPartialLikelihoodComputation(node_index, NULL, 0);
         }
         else
         {
@@ -2156,16 +2464,62 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::fillLikelihoodVec
             fillLikelihoodVector( right, right_index );
 
             // now compute the likelihoods of this internal node
-            computeInternalNodeLikelihood(node,node_index,left_index,right_index);
+            size_t children[2] = { left_index, right_index };
+            beginPartialLikelihoodComputation(node_index, children, 2);
+            if ( getNumberOfPatternBlocks() > 1 )
+            {
+                computeForPatternBlocks( [&](size_t pattern_begin, size_t pattern_end)
+                {
+                    computeInternalNodeLikelihoodForPatterns(node, node_index, left_index, right_index, pattern_begin, pattern_end);
+                    scaleForPatterns(node_index, children, 2, pattern_begin, pattern_end);
+                } );
+            }
+            else
+            {
+                computeInternalNodeLikelihood(node,node_index,left_index,right_index);
 
-            // rescale likelihood vector
-            scale(node_index,left_index,right_index);
+                // rescale likelihood vector
+                scale(node_index,left_index,right_index);
+            }
+            finishPartialLikelihoodComputation(node_index, children, 2);
         }
 
     }
 
 }
 
+/**
+ * Store the partial likelihoods of a node once they have been computed and scaled.
+ * In single precision mode, we round the working copy of the node into the single precision storage.
+ * The working copy keeps the rounded values, so that the parent sees the same values as after a reload.
+ * We do not need the working copies of the children anymore.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::finishPartialLikelihoodComputation( size_t node_index, const size_t *children, size_t n_children )
+{
+
+    if ( use_single_precision == false )
+    {
+        return;
+    }
+
+    size_t slot = activeLikelihood[node_index]*num_nodes + node_index;
+    double* p_node = partialLikelihoodWorkingCopies.get( slot );
+    float* p_stored = singlePrecisionPartialLikelihoods.acquire( slot );
+    for (size_t i = 0; i < nodeOffset; ++i)
+    {
+        p_stored[i] = float( p_node[i] );
+        p_node[i]   = p_stored[i];
+    }
+
+    for (size_t j = 0; j < n_children; ++j)
+    {
+        partialLikelihoodWorkingCopies.release( activeLikelihood[children[j]]*num_nodes + children[j] );
+    }
+
+}
+
+
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::fireTreeChangeEvent( const RevBayesCore::TopologyNode &n, const unsigned& m )
 {
@@ -2181,6 +2535,18 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::fireTreeChangeEve
 }
 
 
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::freePartialLikelihoods( void ) const
+{
+
+    partialLikelihoods.clear();
+    singlePrecisionPartialLikelihoods.clear();
+
+    partialLikelihoodWorkingCopies.clear();
+
+}
+
+
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::flagNodeDirtyPmatrix(size_t node_idx)
 {
@@ -2202,6 +2568,121 @@ std::vector<size_t> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::ge
 }
 
 
+/**
+ * Get the log of the factor by which the partial likelihoods of this node and site were divided.
+ * The log-likelihood of the site is the log of the scaled likelihood minus this value.
+ */
+template<class charType>
+double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getLogScalingFactor( size_t node_index, size_t site ) const
+{
+
+    if ( use_scaling_exponents == true )
+    {
+        return -RbConstants::LN2 * this->perNodeSiteScalingExponents[(this->activeLikelihood[node_index]*this->num_nodes + node_index) * this->pattern_block_size + site];
+    }
+
+    return this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site];
+}
+
+
+/**
+ * Do we rescale the partial likelihoods of this node?
+ * Normally, we rescale every scalingDensity-th node. Single precision partial likelihoods are rescaled at every node instead,
+ * whatever the useScaling and scalingDensity settings are, because floats underflow below about 2^-126,
+ * which a few nodes without rescaling easily reach. This is the only place where single precision overrides these settings,
+ * together with usesScalingFactors().
+ */
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scalesNode( size_t node_index ) const
+{
+
+    if ( use_single_precision == true )
+    {
+        return true;
+    }
+
+    return RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0;
+}
+
+
+/**
+ * Are the partial likelihoods scaled?
+ * Single precision partial likelihoods are always scaled, even if the user switched scaling off (see scalesNode()).
+ * Every computation of the likelihood at the root needs to take the scaling factors out if this returns true.
+ */
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::usesScalingFactors( void ) const
+{
+
+    return RbSettings::userSettings().getUseScaling() == true || use_single_precision == true;
+}
+
+
+template<class charType>
+double* RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getPartialLikelihoods( size_t node_index )
+{
+
+    const AbstractPhyloCTMCSiteHomogeneous<charType>& self = *this;
+
+    return const_cast<double*>( self.getPartialLikelihoods(node_index) );
+}
+
+
+/**
+ * Get the partial likelihoods of the active copy of this node.
+ * If the active copy has no buffer yet (the node was flagged dirty but not recomputed), we take one from the pool.
+ * In single precision mode, these are the double precision working copies, which we create on demand.
+ */
+template<class charType>
+const double* RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getPartialLikelihoods( size_t node_index ) const
+{
+
+    size_t slot = activeLikelihood[node_index]*num_nodes + node_index;
+
+    if ( use_single_precision == false )
+    {
+        return partialLikelihoods.acquire( slot );
+    }
+
+    // several pattern blocks may ask for the working copy at the same time, and creating it changes the pool
+    std::lock_guard<std::mutex> lock( partialLikelihoodWorkingCopiesMutex );
+
+    double* p_node = partialLikelihoodWorkingCopies.get( slot );
+    if ( p_node == NULL )
+    {
+        const float* p_stored = singlePrecisionPartialLikelihoods.acquire( slot );
+        p_node = partialLikelihoodWorkingCopies.acquire( slot );
+        std::copy( p_stored, p_stored + nodeOffset, p_node );
+    }
+
+    return p_node;
+}
+
+
+/**
+ * Get the number of blocks into which we split the patterns of this process.
+ * We use one block per thread, unless there are too few patterns to make the threads worth it,
+ * or unless we are already running inside a parallel region (e.g. as one of several chains).
+ */
+template<class charType>
+size_t RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getNumberOfPatternBlocks( void ) const
+{
+
+    // the minimum number of patterns per block so that the threading overhead pays off
+    const size_t MIN_PATTERNS_PER_BLOCK = 256;
+
+    const ThreadPool &pool = ThreadPool::threadPoolInstance();
+    if ( supportsPatternBlockThreads() == false || pool.isInsideParallelRegion() == true )
+    {
+        return 1;
+    }
+
+    size_t num_blocks = std::min( pool.getNumberOfThreads(), pattern_block_size / MIN_PATTERNS_PER_BLOCK );
+
+    return std::max( num_blocks, size_t(1) );
+}
+
+
 
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getRootFrequencies( std::vector<std::vector<double> >& rf ) const
@@ -2334,9 +2815,14 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::keepSpecializatio
         (*it) = false;
     }
 
-    for (std::vector<bool>::iterator it = this->changed_nodes.begin(); it != this->changed_nodes.end(); ++it)
+    // we keep the new partial likelihoods, so the old copies of the changed nodes go back to the pool
+    for (size_t index = 0; index < changed_nodes.size(); ++index)
     {
-        (*it) = false;
+        if ( changed_nodes[index] == true )
+        {
+            releaseInactivePartialLikelihoods( index );
+        }
+        changed_nodes[index] = false;
     }
     
     for (std::vector<bool>::iterator it = this->pmat_dirty_nodes.begin(); it != this->pmat_dirty_nodes.end(); ++it)
@@ -2385,6 +2871,23 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyFlagNo
 
 
 
+/**
+ * Give the buffer of the inactive copy of this node back to the pool.
+ * We call this once a move was accepted or rejected, because then we do not need the other copy of a changed node anymore.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::releaseInactivePartialLikelihoods( size_t node_index )
+{
+
+    size_t slot = (activeLikelihood[node_index] == 0 ? 1 : 0)*num_nodes + node_index;
+
+    partialLikelihoods.release( slot );
+    singlePrecisionPartialLikelihoods.release( slot );
+    partialLikelihoodWorkingCopies.release( slot );
+
+}
+
+
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursiveMarginalLikelihoodComputation( size_t node_index )
 {
@@ -2612,15 +3115,8 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::resizeLikelihoodV
     {
 
         // we resize the partial likelihood vectors to the new dimensions
-        delete [] partialLikelihoods;
-
-        partialLikelihoods = new double[2*activeLikelihoodOffset];
-
-        // reinitialize likelihood vectors
-        for (size_t i = 0; i < 2*activeLikelihoodOffset; i++)
-        {
-            partialLikelihoods[i] = 0.0;
-        }
+        freePartialLikelihoods();
+        allocatePartialLikelihoods();
 
     }
 
@@ -2639,10 +3135,20 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::resizeLikelihoodV
 
     }
 
-    perNodeSiteLogScalingFactors = std::vector<std::vector< std::vector<double> > >(2, std::vector<std::vector<double> >(num_nodes, std::vector<double>(pattern_block_size, 0.0) ) );
-    
-    activePmatrixOffset         =  num_nodes * num_site_mixtures;
-    pmatNodeOffset              =  num_site_mixtures;
+    use_scaling_exponents = RbSettings::userSettings().getUseScalingExponents() && supportsScalingExponents();
+    if ( use_scaling_exponents == true )
+    {
+        perNodeSiteLogScalingFactors.clear();
+        perNodeSiteScalingExponents.assign(2 * num_nodes * pattern_block_size, 0);
+    }
+    else
+    {
+        perNodeSiteLogScalingFactors = std::vector<std::vector< std::vector<double> > >(2, std::vector<std::vector<double> >(num_nodes, std::vector<double>(pattern_block_size, 0.0) ) );
+        perNodeSiteScalingExponents.clear();
+    }
+    
+    activePmatrixOffset         =  num_nodes * num_site_mixtures;
+    pmatNodeOffset              =  num_site_mixtures;
     pmatrices                   =  std::vector<TransitionProbabilityMatrix>(activePmatrixOffset * 2, TransitionProbabilityMatrix(num_chars));
 
     transition_prob_matrices = std::vector<TransitionProbabilityMatrix>(num_site_mixtures, TransitionProbabilityMatrix(num_chars) );
@@ -2674,6 +3180,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::restoreSpecializa
         if ( changed_nodes[index] == true )
         {
             activeLikelihood[index] = (activeLikelihood[index] == 0 ? 1 : 0);
+
+            // the new partial likelihoods go back to the pool
+            releaseInactivePartialLikelihoods( index );
         }
 
         // set all flags to false
@@ -2703,79 +3212,59 @@ template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index)
 {
 
-    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-
-    if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
-    {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
-        {
-
-            // the max probability
-            double max = 0.0;
-
-            // compute the per site probabilities
-            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
-            {
-                // get the pointers to the likelihood for this mixture category
-                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
-
-                double* p_site_mixture = p_node + offset;
+    scaleForPatterns(node_index, NULL, 0, 0, this->pattern_block_size);
+}
 
-                for ( size_t i=0; i<this->num_chars; ++i)
-                {
-                    if ( p_site_mixture[i] > max )
-                    {
-                        max = p_site_mixture[i];
-                    }
-                }
 
-            }
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index, size_t left, size_t right )
+{
 
-            // Don't divide by zero or NaN.
-            if (not (max > 0)) continue;
+    size_t children[2] = { left, right };
+    scaleForPatterns(node_index, children, 2, 0, this->pattern_block_size);
+}
 
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = -log(max);
 
-            // compute the per site probabilities
-            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
-            {
-                // get the pointers to the likelihood for this mixture category
-                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index, size_t left, size_t right, size_t middle )
+{
 
-                double* p_site_mixture = p_node + offset;
+    size_t children[3] = { left, right, middle };
+    scaleForPatterns(node_index, children, 3, 0, this->pattern_block_size);
+}
 
-                for ( size_t i=0; i<this->num_chars; ++i)
-                {
-                    p_site_mixture[i] /= max;
-                }
 
-            }
+/**
+ * Rescale the partial likelihoods of this node for the patterns in [pattern_begin, pattern_end).
+ * The log-scaling factor of a pattern is the sum of the log-scaling factors of the children
+ * plus the log of the scaler applied at this node (if this node is scaled at all).
+ *
+ * If we use scaling exponents, then we instead sum the integer exponents of the children and only rescale
+ * a pattern when its largest partial likelihood drops below 2^-256 (2^-32 in single precision). The scaler is then a power of two,
+ * so we neither need a log nor lose precision when rescaling.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scaleForPatterns( size_t node_index, const size_t *children, size_t n_children, size_t pattern_begin, size_t pattern_end )
+{
 
-        }
-    }
-    else if ( RbSettings::userSettings().getUseScaling() == true )
+    if ( usesScalingFactors() == false )
     {
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
-        {
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = 0;
-        }
-
+        return;
     }
-}
-
 
-template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index, size_t left, size_t right )
-{
+    if ( use_scaling_exponents == true )
+    {
+        scaleForPatternsWithExponents(node_index, children, n_children, pattern_begin, pattern_end);
+        return;
+    }
 
-    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    double* p_node = this->getPartialLikelihoods(node_index);
+    std::vector<double> &node_log_scaling_factors = this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index];
 
-    if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+    if ( scalesNode(node_index) == true )
     {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all sites
+        for (size_t site = pattern_begin; site < pattern_end ; ++site)
         {
 
             // the max probability
@@ -2787,7 +3276,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
                 // get the pointers to the likelihood for this mixture category
                 size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
 
-                double*          p_site_mixture          = p_node + offset;
+                double* p_site_mixture = p_node + offset;
 
                 for ( size_t i=0; i<this->num_chars; ++i)
                 {
@@ -2795,7 +3284,6 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
                     {
                         max = p_site_mixture[i];
                     }
-
                 }
 
             }
@@ -2803,7 +3291,12 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
             // Don't divide by zero or NaN.
             if (not (max > 0)) continue;
 
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right][site] - log(max);
+            double log_scaling_factor = 0.0;
+            for (size_t j = 0; j < n_children; ++j)
+            {
+                log_scaling_factor += this->perNodeSiteLogScalingFactors[this->activeLikelihood[children[j]]][children[j]][site];
+            }
+            node_log_scaling_factors[site] = log_scaling_factor - log(max);
 
             // compute the per site probabilities
             for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
@@ -2821,44 +3314,64 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
             }
 
         }
-
     }
-    else if ( RbSettings::userSettings().getUseScaling() == true )
+    else
     {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all sites
+        for (size_t site = pattern_begin; site < pattern_end ; ++site)
         {
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right][site];
+            double log_scaling_factor = 0.0;
+            for (size_t j = 0; j < n_children; ++j)
+            {
+                log_scaling_factor += this->perNodeSiteLogScalingFactors[this->activeLikelihood[children[j]]][children[j]][site];
+            }
+            node_log_scaling_factors[site] = log_scaling_factor;
         }
 
     }
-
 }
 
 
+
+/**
+ * Rescale the partial likelihoods of this node for the patterns in [pattern_begin, pattern_end) using power-of-two exponents.
+ * The exponent of a pattern is the sum of the exponents of the children, minus the exponent of the scaler applied at this node.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index, size_t left, size_t right, size_t middle )
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scaleForPatternsWithExponents( size_t node_index, const size_t *children, size_t n_children, size_t pattern_begin, size_t pattern_end )
 {
 
-    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    // we rescale once the largest partial likelihood of a pattern drops below 2^-256
+    // single precision numbers only go down to about 2^-126, so we then rescale much earlier
+    const int SCALING_THRESHOLD_EXPONENT = ( use_single_precision == true ? -32 : -256 );
+
+    double* p_node = this->getPartialLikelihoods(node_index);
+    int* node_exponents = &this->perNodeSiteScalingExponents[(this->activeLikelihood[node_index]*this->num_nodes + node_index) * this->pattern_block_size];
 
-    if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+    const int* child_exponents[3] = { NULL, NULL, NULL };
+    for (size_t j = 0; j < n_children; ++j)
     {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        child_exponents[j] = &this->perNodeSiteScalingExponents[(this->activeLikelihood[children[j]]*this->num_nodes + children[j]) * this->pattern_block_size];
+    }
+
+    bool scale_this_node = scalesNode(node_index);
+
+    // iterate over all sites
+    for (size_t site = pattern_begin; site < pattern_end ; ++site)
+    {
+        int exponent = 0;
+        for (size_t j = 0; j < n_children; ++j)
         {
+            exponent += child_exponents[j][site];
+        }
 
+        if ( scale_this_node == true )
+        {
             // the max probability
             double max = 0.0;
-
-            // compute the per site probabilities
             for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
             {
-                // get the pointers to the likelihood for this mixture category
-                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
-
-                double* p_site_mixture = p_node + offset;
-
+                const double* p_site_mixture = p_node + mixture*this->mixtureOffset + site*this->siteOffset;
                 for ( size_t i=0; i<this->num_chars; ++i)
                 {
                     if ( p_site_mixture[i] > max )
@@ -2866,40 +3379,29 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
                         max = p_site_mixture[i];
                     }
                 }
-
             }
 
             // Don't divide by zero or NaN.
-            if (not (max > 0)) continue;
-
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[middle]][middle][site] - log(max);
-
-            // compute the per site probabilities
-            for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+            int max_exponent = 0;
+            if ( max > 0 && std::frexp(max, &max_exponent) > 0 && max_exponent < SCALING_THRESHOLD_EXPONENT )
             {
-                // get the pointers to the likelihood for this mixture category
-                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
-
-                double* p_site_mixture = p_node + offset;
-
-                for ( size_t i=0; i<this->num_chars; ++i)
+                // scaling by a power of two is exact
+                // we scale every value directly, because 2^-max_exponent overflows if the max is subnormal
+                for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
                 {
-                    p_site_mixture[i] /= max;
+                    double* p_site_mixture = p_node + mixture*this->mixtureOffset + site*this->siteOffset;
+                    for ( size_t i=0; i<this->num_chars; ++i)
+                    {
+                        p_site_mixture[i] = std::ldexp(p_site_mixture[i], -max_exponent);
+                    }
                 }
-
+                exponent += max_exponent;
             }
-
-        }
-    }
-    else if ( RbSettings::userSettings().getUseScaling() == true )
-    {
-        // iterate over all mixture categories
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
-        {
-            this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[left]][left][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[right]][right][site] + this->perNodeSiteLogScalingFactors[this->activeLikelihood[middle]][middle][site];
         }
 
+        node_exponents[site] = exponent;
     }
+
 }
 
 
@@ -3119,8 +3621,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::setMcmcMode(bool
     // free old memory
     if ( in_mcmc_mode == true )
     {
-        delete [] partialLikelihoods;
-        partialLikelihoods = NULL;
+        freePartialLikelihoods();
     }
 
     // set our internal flag
@@ -3347,6 +3848,27 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::setUseMarginalLik
 
 }
 
+/**
+ * Store the partial likelihoods in single instead of double precision.
+ * This halves the memory needed for the partial likelihoods, but the likelihood is only accurate to about 7 digits.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::setUseSinglePrecision(bool tf)
+{
+
+    if ( tf != use_single_precision )
+    {
+        freePartialLikelihoods();
+        use_single_precision = tf;
+        this->resizeLikelihoodVectors();
+
+        // we need to recompute all partial likelihoods
+        dirty_nodes = std::vector<bool>(num_nodes, true);
+    }
+
+}
+
+
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::setUseSiteMatrices(bool use_sm, const TypedDagNode< Simplex > *s)
 {
@@ -3434,6 +3956,45 @@ std::vector< std::vector<double> >* RevBayesCore::AbstractPhyloCTMCSiteHomogeneo
 
 
 
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikelihoodForPatterns( size_t root, size_t left, size_t right, size_t pattern_begin, size_t pattern_end)
+{
+
+    if ( pattern_begin != 0 || pattern_end != pattern_block_size )
+    {
+        throw RbException("This PhyloCTMC cannot compute the likelihood for a block of site patterns.");
+    }
+
+    computeRootLikelihood(root, left, right);
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikelihoodForPatterns( size_t root, size_t left, size_t right, size_t middle, size_t pattern_begin, size_t pattern_end)
+{
+
+    if ( pattern_begin != 0 || pattern_end != pattern_block_size )
+    {
+        throw RbException("This PhyloCTMC cannot compute the likelihood for a block of site patterns.");
+    }
+
+    computeRootLikelihood(root, left, right, middle);
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeTipLikelihoodForPatterns(const TopologyNode &node, size_t node_index, size_t pattern_begin, size_t pattern_end)
+{
+
+    if ( pattern_begin != 0 || pattern_end != pattern_block_size )
+    {
+        throw RbException("This PhyloCTMC cannot compute the likelihood for a block of site patterns.");
+    }
+
+    computeTipLikelihood(node, node_index);
+}
+
+
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikelihoods( std::vector<double> &rv ) const
 {
@@ -3444,7 +4005,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods of the left and right subtree
-    double*   p_node  = this->partialLikelihoods + this->activeLikelihood[node_index] * this->activeLikelihoodOffset  + node_index*this->nodeOffset;
+    const double*   p_node  = this->getPartialLikelihoods(node_index);
 
     // create a vector for the per mixture likelihoods
     // we need this vector to sum over the different mixture likelihoods
@@ -3453,13 +4014,13 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     std::vector<double> site_mixture_probs = getMixtureProbs();
 
     // get pointer the likelihood
-    double*   p_mixture     = p_node;
+    const double*   p_mixture     = p_node;
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
 
         // get pointers to the likelihood for this mixture category
-        double*   p_site_mixture     = p_mixture;
+        const double*   p_site_mixture     = p_mixture;
         // iterate over all sites
 
         for (size_t site = 0; site < pattern_block_size; ++site)
@@ -3467,7 +4028,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             // temporary variable storing the likelihood
             double tmp = 0.0;
             // get the pointers to the likelihoods for this site and mixture category
-            double* p_site_j   = p_site_mixture;
+            const double* p_site_j   = p_site_mixture;
             // iterate over all starting states
             for (size_t i=0; i<num_chars; ++i)
             {
@@ -3531,7 +4092,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
         {
 
            
-            if ( RbSettings::userSettings().getUseScaling() == true )
+            if ( this->usesScalingFactors() == true )
             {
                 if ( this->site_invariant[site] == true )
                 {
@@ -3541,12 +4102,12 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
                         ftotal += f[this->invariant_site_index[site][c]];
                     }
 
-                    rv[site] = log( prob_invariant * ftotal + oneMinusPInv * per_mixture_Likelihoods[site] / exp(this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site]) ) * *patterns;
+                    rv[site] = log( prob_invariant * ftotal + oneMinusPInv * per_mixture_Likelihoods[site] / exp(this->getLogScalingFactor(node_index, site)) ) * *patterns;
                 }
                 else
                 {
                     rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] ) * *patterns;
-                    rv[site] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                    rv[site] -= this->getLogScalingFactor(node_index, site) * *patterns;
                 }
 
             }
@@ -3580,9 +4141,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
         {
             rv[site] = log( per_mixture_Likelihoods[site] ) * *patterns;
 
-            if ( RbSettings::userSettings().getUseScaling() == true )
+            if ( this->usesScalingFactors() == true )
             {
-                rv[site] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                rv[site] -= this->getLogScalingFactor(node_index, site) * *patterns;
             }
 
         }
@@ -3602,7 +4163,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods of the left and right subtree
-    double*   p_node  = this->partialLikelihoods + this->activeLikelihood[node_index] * this->activeLikelihoodOffset  + node_index*this->nodeOffset;
+    const double*   p_node  = this->getPartialLikelihoods(node_index);
 
     // create a vector for the per mixture likelihoods
     // we need this vector to sum over the different mixture likelihoods
@@ -3611,13 +4172,13 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     std::vector<double> site_mixture_probs = getMixtureProbs();
 
     // get pointer the likelihood
-    double*   p_mixture     = p_node;
+    const double*   p_mixture     = p_node;
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
 
         // get pointers to the likelihood for this mixture category
-        double*   p_site_mixture     = p_mixture;
+        const double*   p_site_mixture     = p_mixture;
         // iterate over all sites
 
         for (size_t site = 0; site < pattern_block_size; ++site)
@@ -3625,7 +4186,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             // temporary variable storing the likelihood
             double tmp = 0.0;
             // get the pointers to the likelihoods for this site and mixture category
-            double* p_site_j   = p_site_mixture;
+            const double* p_site_j   = p_site_mixture;
             // iterate over all starting states
             for (size_t i=0; i<num_chars; ++i)
             {
@@ -3699,9 +4260,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
                 {
                     rv[site][site_rate_index * num_site_matrices + matrix] = log( oneMinusPInv * per_site_mixture_Likelihoods[site][site_rate_index * num_site_matrices + matrix] ) * *patterns;
 
-                    if ( RbSettings::userSettings().getUseScaling() == true )
+                    if ( this->usesScalingFactors() == true )
                     {
-                        rv[site][site_rate_index * num_site_matrices + matrix] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                        rv[site][site_rate_index * num_site_matrices + matrix] -= this->getLogScalingFactor(node_index, site) * *patterns;
                     }
 
                 }
@@ -3720,9 +4281,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             {
                 rv[site][mixture] = log( per_site_mixture_Likelihoods[site][mixture] ) * *patterns;
 
-                if ( RbSettings::userSettings().getUseScaling() == true )
+                if ( this->usesScalingFactors() == true )
                 {
-                    rv[site][mixture] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                    rv[site][mixture] -= this->getLogScalingFactor(node_index, site) * *patterns;
                 }
             }
 
@@ -3743,7 +4304,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     size_t node_index = root.getIndex();
 
     // get the pointers to the partial likelihoods of the left and right subtree
-    double*   p_node  = this->partialLikelihoods + this->activeLikelihood[node_index] * this->activeLikelihoodOffset  + node_index*this->nodeOffset;
+    const double*   p_node  = this->getPartialLikelihoods(node_index);
 
     size_t num_site_matrices = num_site_mixtures/num_site_rates;
 
@@ -3754,14 +4315,14 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     std::vector<double> site_mixture_probs = getMixtureProbs();
 
     // get pointer the likelihood
-    double*   p_mixture     = p_node;
+    const double*   p_mixture     = p_node;
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         size_t site_rate_index = mixture / num_site_matrices;
 
         // get pointers to the likelihood for this mixture category
-        double*   p_site_mixture     = p_mixture;
+        const double*   p_site_mixture     = p_mixture;
         // iterate over all sites
 
         for (size_t site = 0; site < pattern_block_size; ++site)
@@ -3769,7 +4330,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             // temporary variable storing the likelihood
             double tmp = 0.0;
             // get the pointers to the likelihoods for this site and mixture category
-            double* p_site_j   = p_site_mixture;
+            const double* p_site_j   = p_site_mixture;
             // iterate over all starting states
             for (size_t i=0; i<num_chars; ++i)
             {
@@ -3854,9 +4415,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             {
                 rv[site][site_rate_index] = log( oneMinusPInv * per_site_rate_Likelihoods[site][site_rate_index - 1] ) * *patterns;
 
-                if ( RbSettings::userSettings().getUseScaling() == true )
+                if ( this->usesScalingFactors() == true )
                 {
-                    rv[site][site_rate_index] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                    rv[site][site_rate_index] -= this->getLogScalingFactor(node_index, site) * *patterns;
                 }
 
             }
@@ -3873,9 +4434,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             {
                 rv[site][site_rate_index] = log( per_site_rate_Likelihoods[site][site_rate_index] ) * *patterns;
 
-                if ( RbSettings::userSettings().getUseScaling() == true )
+                if ( this->usesScalingFactors() == true )
                 {
-                    rv[site][site_rate_index] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                    rv[site][site_rate_index] -= this->getLogScalingFactor(node_index, site) * *patterns;
                 }
             }
 
@@ -3949,6 +4510,14 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::sumRootLikeliho
 }
 
 
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::supportsPatternBlockThreads( void ) const
+{
+    // by default we compute all patterns at once
+    return false;
+}
+
+
 
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::swap_taxon_name_2_tip_index(std::string tip1, std::string tip2)
@@ -4251,40 +4820,112 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
     
     if (node->isRoot()) throw RbException("dnPhyloCTMC called updateTransitionProbabilityMatrix for the root node\n");
     
-    // second, get the clock rate for the branch
-    double rate = 1.0;
-    if ( this->branch_heterogeneous_clock_rates == true )
+    updateTransitionProbabilityMatrices( std::vector<size_t>(1, node_idx) );
+}
+
+
+/*
+ * Update the transition probability matrices for each branch that is marked dirty.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionProbabilityMatrices( void )
+{
+    
+    const std::vector<TopologyNode*> &nodes = tau->getValue().getNodes();
+    
+    std::vector<size_t> dirty_branches;
+    for (std::vector<TopologyNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
     {
-        rate = this->heterogeneous_clock_rates->getValue()[node_idx];
+        size_t node_index = (*it)->getIndex();
+        if (pmat_dirty_nodes[node_index] == true)
+        {
+            if ((*it)->isRoot() == false)
+            {
+                dirty_branches.push_back( node_index );
+            }
+            
+            // mark as computed
+            pmat_dirty_nodes[node_index] = false;
+        }
     }
-    else if (homogeneous_clock_rate != NULL)
+    
+    if ( dirty_branches.empty() == false )
     {
-        rate = this->homogeneous_clock_rate->getValue();
+        updateTransitionProbabilityMatrices( dirty_branches );
     }
     
+}
+
+
+/*
+ * Update the transition probability matrices for the branches attached to the given node indices.
+ * We hand all matrices that use the same rate matrix (all branches and site rates) to the rate matrix at once,
+ * so that it can compute them in a single pass, e.g., from its eigen system.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionProbabilityMatrices(const std::vector<size_t> &node_indices)
+{
+    
+    const std::vector<TopologyNode*> &nodes = tau->getValue().getNodes();
+    
     // we rescale the rate by the inverse of the proportion of invariant sites
-    rate /= ( 1.0 - getPInv() );
+    double p_inv_rescaling = 1.0 - getPInv();
     
-    double end_age = node->getAge();
+    // first, get the ages and clock rates of all branches
+    std::vector<double> start_ages( node_indices.size() );
+    std::vector<double> end_ages( node_indices.size() );
+    std::vector<double> branch_rates( node_indices.size() );
+    for (size_t i = 0; i < node_indices.size(); ++i)
+    {
+        size_t node_idx = node_indices[i];
+        const TopologyNode* node = nodes[node_idx];
+        
+        double rate = 1.0;
+        if ( this->branch_heterogeneous_clock_rates == true )
+        {
+            rate = this->heterogeneous_clock_rates->getValue()[node_idx];
+        }
+        else if (homogeneous_clock_rate != NULL)
+        {
+            rate = this->homogeneous_clock_rate->getValue();
+        }
+        branch_rates[i] = rate / p_inv_rescaling;
+        
+        end_ages[i] = node->getAge();
+        
+        // if the tree is not a time tree, then the age will be not a number
+        if ( RbMath::isFinite(end_ages[i]) == false )
+        {
+            // we assume by default that the end is at time 0
+            end_ages[i] = 0.0;
+        }
+        start_ages[i] = end_ages[i] + node->getBranchLength();
+    }
     
-    // if the tree is not a time tree, then the age will be not a number
-    if ( RbMath::isFinite(end_age) == false )
+    // the site rates
+    std::vector<double> site_rates( this->num_site_rates, 1.0 );
+    if ( this->rate_variation_across_sites == true )
     {
-        // we assume by default that the end is at time 0
-        end_age = 0.0;
+        for (size_t j = 0; j < this->num_site_rates; ++j)
+        {
+            site_rates[j] = this->site_rates->getValue()[j];
+        }
     }
-    double start_age = end_age + node->getBranchLength();
     
-    // first, get the rate matrix for this branch
     RateMatrix_JC jc(this->num_chars);
-    const RateGenerator *rm = &jc;
     
-    size_t pmat_offset = this->active_pmatrices[node_idx] * this->activePmatrixOffset + node_idx * this->pmatNodeOffset;
+    // the batch of matrices for one rate matrix
+    std::vector<double> batch_start_ages;
+    std::vector<double> batch_end_ages;
+    std::vector<double> batch_rates;
+    std::vector<TransitionProbabilityMatrix*> batch_matrices;
     
     if (this->branch_heterogeneous_substitution_matrices == false )
     {
+        // all branches share the rate matrices, so we compute all branches and site rates of a matrix at once
         for (size_t matrix = 0; matrix < this->num_matrices; ++matrix)
         {
+            const RateGenerator *rm = &jc;
             if ( this->heterogeneous_rate_matrices != NULL )
             {
                 rm = &this->heterogeneous_rate_matrices->getValue()[matrix];
@@ -4294,64 +4935,56 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
                 rm = &this->homogeneous_rate_matrix->getValue();
             }
             
-            for (size_t j = 0; j < this->num_site_rates; ++j)
+            batch_start_ages.clear();
+            batch_end_ages.clear();
+            batch_rates.clear();
+            batch_matrices.clear();
+            for (size_t i = 0; i < node_indices.size(); ++i)
             {
-                double r = 1.0;
-                if ( this->rate_variation_across_sites == true )
+                size_t node_idx = node_indices[i];
+                size_t pmat_offset = this->active_pmatrices[node_idx] * this->activePmatrixOffset + node_idx * this->pmatNodeOffset;
+                
+                for (size_t j = 0; j < this->num_site_rates; ++j)
                 {
-                    r = this->site_rates->getValue()[j];
+                    batch_start_ages.push_back( start_ages[i] );
+                    batch_end_ages.push_back( end_ages[i] );
+                    batch_rates.push_back( branch_rates[i] * site_rates[j] );
+                    batch_matrices.push_back( &this->pmatrices[pmat_offset + j * this->num_matrices + matrix] );
                 }
-                
-                rm->calculateTransitionProbabilities( start_age, end_age,  rate * r, this->pmatrices[pmat_offset + j * this->num_matrices + matrix] );
             }
+            
+            rm->calculateTransitionProbabilitiesForBranches( batch_start_ages, batch_end_ages, batch_rates, batch_matrices );
         }
     }
     else
     {
-        if ( this->heterogeneous_rate_matrices != NULL )
-        {
-            rm = &this->heterogeneous_rate_matrices->getValue()[node_idx];
-        }
-        else if ( this->homogeneous_rate_matrix != NULL )
-        {
-            rm = &this->homogeneous_rate_matrix->getValue();
-        }
-        
-        for (size_t j = 0; j < this->num_site_rates; ++j)
+        // every branch has its own rate matrix, so we compute the site rates of a branch at once
+        for (size_t i = 0; i < node_indices.size(); ++i)
         {
-            double r = 1.0;
-            if ( this->rate_variation_across_sites == true )
+            size_t node_idx = node_indices[i];
+            size_t pmat_offset = this->active_pmatrices[node_idx] * this->activePmatrixOffset + node_idx * this->pmatNodeOffset;
+            
+            const RateGenerator *rm = &jc;
+            if ( this->heterogeneous_rate_matrices != NULL )
             {
-                r = this->site_rates->getValue()[j];
+                rm = &this->heterogeneous_rate_matrices->getValue()[node_idx];
+            }
+            else if ( this->homogeneous_rate_matrix != NULL )
+            {
+                rm = &this->homogeneous_rate_matrix->getValue();
             }
             
-            rm->calculateTransitionProbabilities( start_age, end_age,  rate * r, this->pmatrices[pmat_offset + j] );
-        }
-    }
-}
-
-
-/*
- * Update the transition probability matrices for each branch that is marked dirty.
- */
-template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionProbabilityMatrices( void )
-{
-    
-    std::vector<TopologyNode*> nodes = tau->getValue().getNodes();
-        
-    for (std::vector<TopologyNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-    {
-        size_t node_index = (*it)->getIndex();
-        if (pmat_dirty_nodes[node_index] == true)
-        {
-            if ((*it)->isRoot() == false)
+            batch_start_ages.assign( this->num_site_rates, start_ages[i] );
+            batch_end_ages.assign( this->num_site_rates, end_ages[i] );
+            batch_rates.clear();
+            batch_matrices.clear();
+            for (size_t j = 0; j < this->num_site_rates; ++j)
             {
-                updateTransitionProbabilityMatrix(node_index);
+                batch_rates.push_back( branch_rates[i] * site_rates[j] );
+                batch_matrices.push_back( &this->pmatrices[pmat_offset + j] );
             }
-
-            // mark as computed
-            pmat_dirty_nodes[node_index] = false;
+            
+            rm->calculateTransitionProbabilitiesForBranches( batch_start_ages, batch_end_ages, batch_rates, batch_matrices );
         }
     }
     
@@ -0,0 +1,195 @@
+#ifndef PartialLikelihoodBufferPool_H
+#define PartialLikelihoodBufferPool_H
+
+#include <stddef.h>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Pool of equally sized buffers for the partial likelihoods of the nodes of a tree.
+     *
+     * The partial likelihoods of a node are stored twice, so that we can restore the old values when a proposal is rejected.
+     * However, a single move only touches a few nodes (e.g., the path from a branch to the root),
+     * so most nodes never need their second copy. The pool maps slots (copy*num_nodes + node_index) to buffers.
+     * A slot gets a buffer only when it is acquired, and a released buffer goes onto a free list from which it is reused.
+     * Thus, we store about one copy per node plus one copy per node that is currently dirty.
+     *
+     * We keep at most max_free_buffers released buffers for later reuse and free the rest.
+     * Neither new nor reused buffers are initialized, because the partial likelihoods of a node are always computed before they are read.
+     */
+    template<class valueType>
+    class PartialLikelihoodBufferPool {
+
+    public:
+                                                    PartialLikelihoodBufferPool(void);
+                                                    PartialLikelihoodBufferPool(const PartialLikelihoodBufferPool &p);          //!< Deep copy of the buffers of all assigned slots
+                                                   ~PartialLikelihoodBufferPool(void);
+
+        PartialLikelihoodBufferPool&                operator=(const PartialLikelihoodBufferPool &p);
+
+        valueType*                                  acquire(size_t slot);                                                       //!< Get the buffer of this slot, assigning one if the slot has none
+        void                                        clear(void);                                                                //!< Free all buffers and remove all slots
+        valueType*                                  get(size_t slot) const { return slot_buffers[slot]; }                       //!< The buffer of this slot, or NULL if the slot has none
+        void                                        initialize(size_t buffer_size, size_t num_slots, size_t max_free_buffers); //!< Free all buffers and set up empty slots
+        void                                        release(size_t slot);                                                       //!< Return the buffer of this slot to the free list
+        void                                        releaseAll(void);                                                           //!< Return the buffers of all slots to the free list
+
+    private:
+
+        size_t                                      buffer_size;
+        size_t                                      max_free_buffers;
+        std::vector<valueType*>                     slot_buffers;                                                               //!< The buffer of each slot (NULL if unassigned)
+        std::vector<valueType*>                     free_buffers;                                                               //!< Released buffers for reuse
+    };
+
+}
+
+
+template<class valueType>
+RevBayesCore::PartialLikelihoodBufferPool<valueType>::PartialLikelihoodBufferPool( void ) :
+    buffer_size( 0 ),
+    max_free_buffers( 0 )
+{
+
+}
+
+
+template<class valueType>
+RevBayesCore::PartialLikelihoodBufferPool<valueType>::PartialLikelihoodBufferPool( const PartialLikelihoodBufferPool &p ) :
+    buffer_size( p.buffer_size ),
+    max_free_buffers( p.max_free_buffers ),
+    slot_buffers( p.slot_buffers.size(), NULL )
+{
+
+    for (size_t i = 0; i < slot_buffers.size(); ++i)
+    {
+        if ( p.slot_buffers[i] != NULL )
+        {
+            slot_buffers[i] = new valueType[buffer_size];
+            memcpy(slot_buffers[i], p.slot_buffers[i], buffer_size*sizeof(valueType));
+        }
+    }
+
+}
+
+
+template<class valueType>
+RevBayesCore::PartialLikelihoodBufferPool<valueType>::~PartialLikelihoodBufferPool( void )
+{
+
+    clear();
+}
+
+
+template<class valueType>
+RevBayesCore::PartialLikelihoodBufferPool<valueType>& RevBayesCore::PartialLikelihoodBufferPool<valueType>::operator=( const PartialLikelihoodBufferPool &p )
+{
+
+    if ( this != &p )
+    {
+        PartialLikelihoodBufferPool<valueType> tmp( p );
+
+        std::swap( buffer_size, tmp.buffer_size );
+        std::swap( max_free_buffers, tmp.max_free_buffers );
+        slot_buffers.swap( tmp.slot_buffers );
+        free_buffers.swap( tmp.free_buffers );
+    }
+
+    return *this;
+}
+
+
+template<class valueType>
+valueType* RevBayesCore::PartialLikelihoodBufferPool<valueType>::acquire( size_t slot )
+{
+
+    valueType* &buffer = slot_buffers[slot];
+    if ( buffer == NULL )
+    {
+        if ( free_buffers.empty() == false )
+        {
+            buffer = free_buffers.back();
+            free_buffers.pop_back();
+        }
+        else
+        {
+            buffer = new valueType[buffer_size];
+        }
+    }
+
+    return buffer;
+}
+
+
+template<class valueType>
+void RevBayesCore::PartialLikelihoodBufferPool<valueType>::clear( void )
+{
+
+    for (size_t i = 0; i < slot_buffers.size(); ++i)
+    {
+        delete [] slot_buffers[i];
+    }
+    slot_buffers.clear();
+
+    for (size_t i = 0; i < free_buffers.size(); ++i)
+    {
+        delete [] free_buffers[i];
+    }
+    free_buffers.clear();
+
+}
+
+
+template<class valueType>
+void RevBayesCore::PartialLikelihoodBufferPool<valueType>::initialize( size_t bs, size_t num_slots, size_t max_free )
+{
+
+    clear();
+
+    buffer_size         = bs;
+    max_free_buffers    = max_free;
+    slot_buffers.resize( num_slots, NULL );
+
+}
+
+
+template<class valueType>
+void RevBayesCore::PartialLikelihoodBufferPool<valueType>::release( size_t slot )
+{
+
+    // nothing to do if the pool is not set up or the slot has no buffer
+    if ( slot >= slot_buffers.size() || slot_buffers[slot] == NULL )
+    {
+        return;
+    }
+
+    valueType* &buffer = slot_buffers[slot];
+
+    if ( free_buffers.size() < max_free_buffers )
+    {
+        free_buffers.push_back( buffer );
+    }
+    else
+    {
+        delete [] buffer;
+    }
+    buffer = NULL;
+
+}
+
+
+template<class valueType>
+void RevBayesCore::PartialLikelihoodBufferPool<valueType>::releaseAll( void )
+{
+
+    for (size_t i = 0; i < slot_buffers.size(); ++i)
+    {
+        release( i );
+    }
+
+}
+
+#endif
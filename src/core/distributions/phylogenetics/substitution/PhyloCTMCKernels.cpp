@@ -0,0 +1,293 @@
+#include "PhyloCTMCKernels.h"
+
+#if ( defined(__x86_64__) || defined(__i386__) ) && defined(__GNUC__)
+#define RB_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    /*
+     * Scalar kernels
+     */
+    namespace scalar {
+
+        typedef double Vector;
+        const size_t WIDTH = 1;
+
+        inline Vector zero(void)                                            { return 0.0; }
+        inline Vector set1(double x)                                        { return x; }
+        inline Vector load(const double* p)                                 { return *p; }
+        inline void   store(double* p, Vector v)                            { *p = v; }
+        inline Vector loadPartial(const double* p, size_t n)                { return ( n > 0 ? *p : 0.0 ); }
+        inline void   storePartial(double* p, Vector v, size_t n)           { if ( n > 0 ) *p = v; }
+        inline Vector add(Vector a, Vector b)                               { return a + b; }
+        inline Vector mul(Vector a, Vector b)                               { return a * b; }
+
+#       include "PhyloCTMCKernelsImpl.h"
+
+    }
+
+#if defined( RB_X86_KERNELS )
+
+    /*
+     * SSE2 kernels
+     */
+#if defined(__clang__)
+#   pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#else
+#   pragma GCC push_options
+#   pragma GCC target("sse2")
+#endif
+
+    namespace sse {
+
+        typedef __m128d Vector;
+        const size_t WIDTH = 2;
+
+        inline Vector zero(void)                                            { return _mm_setzero_pd(); }
+        inline Vector set1(double x)                                        { return _mm_set1_pd(x); }
+        inline Vector load(const double* p)                                 { return _mm_loadu_pd(p); }
+        inline void   store(double* p, Vector v)                            { _mm_storeu_pd(p, v); }
+        inline Vector loadPartial(const double* p, size_t n)                { return _mm_load_sd(p); }
+        inline void   storePartial(double* p, Vector v, size_t n)           { _mm_store_sd(p, v); }
+        inline Vector add(Vector a, Vector b)                               { return _mm_add_pd(a, b); }
+        inline Vector mul(Vector a, Vector b)                               { return _mm_mul_pd(a, b); }
+
+#       include "PhyloCTMCKernelsImpl.h"
+
+    }
+
+#if defined(__clang__)
+#   pragma clang attribute pop
+#else
+#   pragma GCC pop_options
+#endif
+
+
+    /*
+     * AVX2 kernels
+     * Note, we do not enable FMA so that the compiler cannot fuse the multiplications and additions.
+     */
+#if defined(__clang__)
+#   pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#   pragma GCC push_options
+#   pragma GCC target("avx2")
+#endif
+
+    namespace avx2 {
+
+        typedef __m256d Vector;
+        const size_t WIDTH = 4;
+
+        inline __m256i partialMask(size_t n)                                { return _mm256_cmpgt_epi64( _mm256_set1_epi64x( (long long)n ), _mm256_setr_epi64x(0, 1, 2, 3) ); }
+
+        inline Vector zero(void)                                            { return _mm256_setzero_pd(); }
+        inline Vector set1(double x)                                        { return _mm256_set1_pd(x); }
+        inline Vector load(const double* p)                                 { return _mm256_loadu_pd(p); }
+        inline void   store(double* p, Vector v)                            { _mm256_storeu_pd(p, v); }
+        inline Vector loadPartial(const double* p, size_t n)                { return _mm256_maskload_pd(p, partialMask(n)); }
+        inline void   storePartial(double* p, Vector v, size_t n)           { _mm256_maskstore_pd(p, partialMask(n), v); }
+        inline Vector add(Vector a, Vector b)                               { return _mm256_add_pd(a, b); }
+        inline Vector mul(Vector a, Vector b)                               { return _mm256_mul_pd(a, b); }
+
+#       include "PhyloCTMCKernelsImpl.h"
+
+    }
+
+#if defined(__clang__)
+#   pragma clang attribute pop
+#else
+#   pragma GCC pop_options
+#endif
+
+
+    /*
+     * AVX-512 kernels
+     * AVX-512F contains fused multiply-adds, so we use the arithmetic with explicit rounding which the compiler will not fuse
+     * (in the zero-masked form with all lanes selected, because the unmasked form starts from an undefined vector).
+     */
+#if defined(__clang__)
+#   pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#else
+#   pragma GCC push_options
+#   pragma GCC target("avx512f")
+#endif
+
+    namespace avx512 {
+
+        typedef __m512d Vector;
+        const size_t WIDTH = 8;
+        const __mmask8 ALL_LANES = 0xFF;
+
+        inline __mmask8 partialMask(size_t n)                               { return (__mmask8)( (1u << n) - 1 ); }
+
+        inline Vector zero(void)                                            { return _mm512_setzero_pd(); }
+        inline Vector set1(double x)                                        { return _mm512_set1_pd(x); }
+        inline Vector load(const double* p)                                 { return _mm512_loadu_pd(p); }
+        inline void   store(double* p, Vector v)                            { _mm512_storeu_pd(p, v); }
+        inline Vector loadPartial(const double* p, size_t n)                { return _mm512_maskz_loadu_pd(partialMask(n), p); }
+        inline void   storePartial(double* p, Vector v, size_t n)           { _mm512_mask_storeu_pd(p, partialMask(n), v); }
+        inline Vector add(Vector a, Vector b)                               { return _mm512_maskz_add_round_pd(ALL_LANES, a, b, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        inline Vector mul(Vector a, Vector b)                               { return _mm512_maskz_mul_round_pd(ALL_LANES, a, b, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+#       include "PhyloCTMCKernelsImpl.h"
+
+    }
+
+#if defined(__clang__)
+#   pragma clang attribute pop
+#else
+#   pragma GCC pop_options
+#endif
+
+#endif
+
+
+    PhyloCTMCKernels::InstructionSet detectInstructionSet(void)
+    {
+
+#if defined( RB_X86_KERNELS )
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx512f") )
+        {
+            return PhyloCTMCKernels::AVX512;
+        }
+        if ( __builtin_cpu_supports("avx2") )
+        {
+            return PhyloCTMCKernels::AVX2;
+        }
+        if ( __builtin_cpu_supports("sse2") )
+        {
+            return PhyloCTMCKernels::SSE;
+        }
+#endif
+
+        return PhyloCTMCKernels::SCALAR;
+    }
+
+
+    /**
+     * Choose the instruction set for a given number of states.
+     * We do not use vectors that are wider than the number of states.
+     */
+    PhyloCTMCKernels::InstructionSet instructionSetForStates(size_t num_chars)
+    {
+
+        PhyloCTMCKernels::InstructionSet s = PhyloCTMCKernels::getInstructionSet();
+        if ( s == PhyloCTMCKernels::AVX512 && num_chars < 8 )
+        {
+            s = PhyloCTMCKernels::AVX2;
+        }
+        if ( s == PhyloCTMCKernels::AVX2 && num_chars < 4 )
+        {
+            s = PhyloCTMCKernels::SSE;
+        }
+
+        return s;
+    }
+
+
+    /**
+     * Transpose the transition probability matrix into a scratch buffer of the calling thread.
+     */
+    const double* transposeTransitionProbabilities(const double* tp, size_t num_chars)
+    {
+
+        static thread_local std::vector<double> tp_transposed;
+        tp_transposed.resize( num_chars * num_chars );
+
+        for (size_t c1 = 0; c1 < num_chars; ++c1)
+        {
+            for (size_t c2 = 0; c2 < num_chars; ++c2)
+            {
+                tp_transposed[c2*num_chars+c1] = tp[c1*num_chars+c2];
+            }
+        }
+
+        return tp_transposed.data();
+    }
+
+}
+
+
+PhyloCTMCKernels::InstructionSet PhyloCTMCKernels::getInstructionSet( void )
+{
+
+    static const InstructionSet best_instruction_set = detectInstructionSet();
+
+    return best_instruction_set;
+}
+
+
+std::string PhyloCTMCKernels::getInstructionSetName( InstructionSet s )
+{
+
+    switch ( s )
+    {
+        case AVX512:    return "AVX-512";
+        case AVX2:      return "AVX2";
+        case SSE:       return "SSE2";
+        default:        return "scalar";
+    }
+
+}
+
+
+void PhyloCTMCKernels::computeInternalNodeLikelihood(const double* tp, const double* p_a, const double* p_b, const double* p_c, double* p_node, size_t num_chars, size_t num_sites, size_t site_offset)
+{
+
+    const double* tp_transposed = transposeTransitionProbabilities(tp, num_chars);
+
+    static thread_local std::vector<double> children;
+    children.resize( num_chars );
+
+    switch ( instructionSetForStates(num_chars) )
+    {
+#if defined( RB_X86_KERNELS )
+        case AVX512:    avx512::computeInternalNodeLikelihood(tp_transposed, p_a, p_b, p_c, p_node, num_chars, num_sites, site_offset, children.data()); break;
+        case AVX2:      avx2::computeInternalNodeLikelihood(tp_transposed, p_a, p_b, p_c, p_node, num_chars, num_sites, site_offset, children.data()); break;
+        case SSE:       sse::computeInternalNodeLikelihood(tp_transposed, p_a, p_b, p_c, p_node, num_chars, num_sites, site_offset, children.data()); break;
+#endif
+        default:        scalar::computeInternalNodeLikelihood(tp_transposed, p_a, p_b, p_c, p_node, num_chars, num_sites, site_offset, children.data()); break;
+    }
+
+}
+
+
+void PhyloCTMCKernels::computeRootLikelihood(const double* f, const double* p_a, const double* p_b, const double* p_c, double* p_root, size_t num_chars, size_t num_sites, size_t site_offset)
+{
+
+    switch ( instructionSetForStates(num_chars) )
+    {
+#if defined( RB_X86_KERNELS )
+        case AVX512:    avx512::computeRootLikelihood(f, p_a, p_b, p_c, p_root, num_chars, num_sites, site_offset); break;
+        case AVX2:      avx2::computeRootLikelihood(f, p_a, p_b, p_c, p_root, num_chars, num_sites, site_offset); break;
+        case SSE:       sse::computeRootLikelihood(f, p_a, p_b, p_c, p_root, num_chars, num_sites, site_offset); break;
+#endif
+        default:        scalar::computeRootLikelihood(f, p_a, p_b, p_c, p_root, num_chars, num_sites, site_offset); break;
+    }
+
+}
+
+
+void PhyloCTMCKernels::computeTipLikelihood(const double* tp, const std::vector<bool> &gaps, const std::vector<unsigned long> &states, const std::vector<RbBitSet> *ambiguous_states, size_t site_begin, size_t site_end, double* p_tip, size_t num_chars, size_t site_offset)
+{
+
+    const double* tp_transposed = transposeTransitionProbabilities(tp, num_chars);
+
+    switch ( instructionSetForStates(num_chars) )
+    {
+#if defined( RB_X86_KERNELS )
+        case AVX512:    avx512::computeTipLikelihood(tp_transposed, gaps, states, ambiguous_states, site_begin, site_end, p_tip, num_chars, site_offset); break;
+        case AVX2:      avx2::computeTipLikelihood(tp_transposed, gaps, states, ambiguous_states, site_begin, site_end, p_tip, num_chars, site_offset); break;
+        case SSE:       sse::computeTipLikelihood(tp_transposed, gaps, states, ambiguous_states, site_begin, site_end, p_tip, num_chars, site_offset); break;
+#endif
+        default:        scalar::computeTipLikelihood(tp_transposed, gaps, states, ambiguous_states, site_begin, site_end, p_tip, num_chars, site_offset); break;
+    }
+
+}
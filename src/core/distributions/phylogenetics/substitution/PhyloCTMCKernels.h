@@ -0,0 +1,46 @@
+#ifndef PhyloCTMCKernels_H
+#define PhyloCTMCKernels_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "RbBitSet.h"
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Vectorized kernels for the partial likelihood computations of the site-homogeneous PhyloCTMC.
+     *
+     * The inner loops of the pruning algorithm (internal nodes, root and tips) are implemented here for
+     * several instruction sets: plain scalar code, SSE2, AVX2 and AVX-512. The best instruction set supported
+     * by the CPU is detected once at runtime, so a single binary uses the wide vector units where they exist
+     * and still runs on older machines. The SIMD code is compiled with function-specific target attributes,
+     * so no special compiler flags are needed.
+     *
+     * All kernels work on a block of sites of one mixture category. The partial likelihoods of a site are
+     * stored contiguously (num_chars values) and consecutive sites are site_offset values apart.
+     *
+     * The vectorized kernels run over the starting states and accumulate the terminal states in the same
+     * order as the scalar code, without fused multiply-adds. Thus, all instruction sets produce bit-identical
+     * partial likelihoods and an analysis gives the same results on every machine.
+     */
+    namespace PhyloCTMCKernels {
+
+        enum InstructionSet { SCALAR, SSE, AVX2, AVX512 };
+
+        InstructionSet              getInstructionSet(void);                                                    //!< The best instruction set supported by this CPU
+        std::string                 getInstructionSetName(InstructionSet s);                                    //!< The name of the instruction set
+
+        // p_c may be NULL for two children; the product of the children is formed in the order a*b*c
+        void                        computeInternalNodeLikelihood(const double* tp, const double* p_a, const double* p_b, const double* p_c, double* p_node, size_t num_chars, size_t num_sites, size_t site_offset);
+        void                        computeRootLikelihood(const double* f, const double* p_a, const double* p_b, const double* p_c, double* p_root, size_t num_chars, size_t num_sites, size_t site_offset);
+
+        // ambiguous_states may be NULL if the observed states are unambiguous; p_tip points to the first site in [site_begin,site_end)
+        void                        computeTipLikelihood(const double* tp, const std::vector<bool> &gaps, const std::vector<unsigned long> &states, const std::vector<RbBitSet> *ambiguous_states, size_t site_begin, size_t site_end, double* p_tip, size_t num_chars, size_t site_offset);
+
+    }
+
+}
+
+#endif
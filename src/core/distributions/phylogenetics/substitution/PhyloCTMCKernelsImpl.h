@@ -0,0 +1,194 @@
+/*
+ * The bodies of the PhyloCTMC partial likelihood kernels.
+ *
+ * This file is included once per instruction set by PhyloCTMCKernels.cpp, each time inside its own namespace
+ * and with the target of the surrounding functions set accordingly. Before the inclusion, the namespace has to provide
+ *
+ *    Vector                                    the vector type
+ *    WIDTH                                     the number of doubles in a vector
+ *    zero(), set1(x)                           initialization
+ *    load(p), store(p,v)                       unaligned loads and stores of WIDTH values
+ *    loadPartial(p,n), storePartial(p,v,n)     loads and stores of the first n < WIDTH values
+ *    add(a,b), mul(a,b)                        the arithmetic (which must not be fused)
+ *
+ * The kernels use the transposed transition probability matrix, tp_transposed[c2*num_chars+c1] = P(c1 -> c2),
+ * so that the vectors run over the starting states c1.
+ *
+ * There are deliberately no include guards.
+ */
+
+
+/**
+ * Compute the partial likelihoods of an internal node for a block of sites.
+ * The children are multiplied first (in the order a*b*c), and then we sum over the terminal states.
+ */
+inline void computeInternalNodeLikelihood(const double* tp_transposed, const double* p_a, const double* p_b, const double* p_c, double* p_node, size_t num_chars, size_t num_sites, size_t site_offset, double* children)
+{
+
+    for (size_t site = 0; site < num_sites; ++site)
+    {
+
+        // the product of the partial likelihoods of the children per terminal state
+        for (size_t c2 = 0; c2 < num_chars; ++c2)
+        {
+            children[c2] = p_a[c2] * p_b[c2];
+        }
+        if ( p_c != NULL )
+        {
+            for (size_t c2 = 0; c2 < num_chars; ++c2)
+            {
+                children[c2] *= p_c[c2];
+            }
+        }
+
+        // full vectors of starting states
+        size_t c1 = 0;
+        for (; c1 + WIDTH <= num_chars; c1 += WIDTH)
+        {
+            const double* tp = tp_transposed + c1;
+            Vector sum = zero();
+            for (size_t c2 = 0; c2 < num_chars; ++c2)
+            {
+                sum = add( sum, mul( set1( children[c2] ), load( tp ) ) );
+                tp += num_chars;
+            }
+            store( p_node + c1, sum );
+        }
+
+        // the remaining starting states
+        if ( c1 < num_chars )
+        {
+            size_t n = num_chars - c1;
+            const double* tp = tp_transposed + c1;
+            Vector sum = zero();
+            for (size_t c2 = 0; c2 < num_chars; ++c2)
+            {
+                sum = add( sum, mul( set1( children[c2] ), loadPartial( tp, n ) ) );
+                tp += num_chars;
+            }
+            storePartial( p_node + c1, sum, n );
+        }
+
+        // increment the pointers to the next site
+        p_a += site_offset; p_b += site_offset; p_node += site_offset;
+        if ( p_c != NULL )
+        {
+            p_c += site_offset;
+        }
+
+    } // end-for over all sites
+
+}
+
+
+/**
+ * Compute the partial likelihoods at the root for a block of sites, i.e., the product a*b*c*f.
+ */
+inline void computeRootLikelihood(const double* f, const double* p_a, const double* p_b, const double* p_c, double* p_root, size_t num_chars, size_t num_sites, size_t site_offset)
+{
+
+    for (size_t site = 0; site < num_sites; ++site)
+    {
+
+        size_t c = 0;
+        for (; c + WIDTH <= num_chars; c += WIDTH)
+        {
+            Vector p = mul( load( p_a + c ), load( p_b + c ) );
+            if ( p_c != NULL )
+            {
+                p = mul( p, load( p_c + c ) );
+            }
+            store( p_root + c, mul( p, load( f + c ) ) );
+        }
+
+        if ( c < num_chars )
+        {
+            size_t n = num_chars - c;
+            Vector p = mul( loadPartial( p_a + c, n ), loadPartial( p_b + c, n ) );
+            if ( p_c != NULL )
+            {
+                p = mul( p, loadPartial( p_c + c, n ) );
+            }
+            storePartial( p_root + c, mul( p, loadPartial( f + c, n ) ), n );
+        }
+
+        // increment the pointers to the next site
+        p_a += site_offset; p_b += site_offset; p_root += site_offset;
+        if ( p_c != NULL )
+        {
+            p_c += site_offset;
+        }
+
+    } // end-for over all sites
+
+}
+
+
+/**
+ * Compute the partial likelihoods of a tip for the sites [site_begin,site_end).
+ * For an observed state we copy the corresponding row of the transposed matrix,
+ * and for an ambiguous state we add up the rows of all observed states.
+ */
+inline void computeTipLikelihood(const double* tp_transposed, const std::vector<bool> &gaps, const std::vector<unsigned long> &states, const std::vector<RbBitSet> *ambiguous_states, size_t site_begin, size_t site_end, double* p_tip, size_t num_chars, size_t site_offset)
+{
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+
+        if ( gaps[site] == true )
+        {
+            // since this is a gap we need to assume that the actual state could have been any state
+            for (size_t c1 = 0; c1 < num_chars; ++c1)
+            {
+                p_tip[c1] = 1.0;
+            }
+        }
+        else if ( ambiguous_states == NULL )
+        {
+            const double* tp = tp_transposed + states[site] * num_chars;
+
+            size_t c1 = 0;
+            for (; c1 + WIDTH <= num_chars; c1 += WIDTH)
+            {
+                store( p_tip + c1, load( tp + c1 ) );
+            }
+            if ( c1 < num_chars )
+            {
+                storePartial( p_tip + c1, loadPartial( tp + c1, num_chars - c1 ), num_chars - c1 );
+            }
+        }
+        else
+        {
+            const RbBitSet &observed = (*ambiguous_states)[site];
+
+            size_t c1 = 0;
+            for (; c1 < num_chars; c1 += WIDTH)
+            {
+                size_t n = (c1 + WIDTH <= num_chars ? WIDTH : num_chars - c1);
+                Vector sum = zero();
+                for (size_t c2 = 0; c2 < num_chars; ++c2)
+                {
+                    if ( observed.test(c2) == true )
+                    {
+                        const double* tp = tp_transposed + c2 * num_chars + c1;
+                        sum = add( sum, (n == WIDTH ? load( tp ) : loadPartial( tp, n )) );
+                    }
+                }
+
+                if ( n == WIDTH )
+                {
+                    store( p_tip + c1, sum );
+                }
+                else
+                {
+                    storePartial( p_tip + c1, sum, n );
+                }
+            }
+        }
+
+        // increment the pointer to the next site
+        p_tip += site_offset;
+
+    } // end-for over all sites
+
+}
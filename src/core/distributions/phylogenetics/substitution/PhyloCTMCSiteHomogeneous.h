@@ -4,6 +4,7 @@
 #include <cassert>
 #include "AbstractPhyloCTMCSiteHomogeneous.h"
 #include "DnaState.h"
+#include "PhyloCTMCKernels.h"
 #include "RateMatrix.h"
 #include "RbVector.h"
 #include "TopologyNode.h"
@@ -30,6 +31,12 @@ namespace RevBayesCore {
         virtual void                                        computeInternalNodeLikelihood(const TopologyNode &n, size_t nIdx, size_t l, size_t r);
         virtual void                                        computeInternalNodeLikelihood(const TopologyNode &n, size_t nIdx, size_t l, size_t r, size_t m);
         virtual void                                        computeTipLikelihood(const TopologyNode &node, size_t nIdx);
+        virtual void                                        computeRootLikelihoodForPatterns(size_t root, size_t l, size_t r, size_t pattern_begin, size_t pattern_end);
+        virtual void                                        computeRootLikelihoodForPatterns(size_t root, size_t l, size_t r, size_t m, size_t pattern_begin, size_t pattern_end);
+        virtual void                                        computeInternalNodeLikelihoodForPatterns(const TopologyNode &n, size_t nIdx, size_t l, size_t r, size_t pattern_begin, size_t pattern_end);
+        virtual void                                        computeInternalNodeLikelihoodForPatterns(const TopologyNode &n, size_t nIdx, size_t l, size_t r, size_t m, size_t pattern_begin, size_t pattern_end);
+        virtual void                                        computeTipLikelihoodForPatterns(const TopologyNode &node, size_t nIdx, size_t pattern_begin, size_t pattern_end);
+        virtual bool                                        supportsPatternBlockThreads(void) const;
 
 
     private:
@@ -77,14 +84,18 @@ template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( size_t root, size_t left, size_t right)
 {
 
-    // get the pointers to the partial likelihoods of the left and right subtree
-          double* p        = this->partialLikelihoods + this->activeLikelihood[root]  * this->activeLikelihoodOffset + root  * this->nodeOffset;
-    const double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]  * this->activeLikelihoodOffset + left  * this->nodeOffset;
-    const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right] * this->activeLikelihoodOffset + right * this->nodeOffset;
+    computeRootLikelihoodForPatterns(root, left, right, 0, this->pattern_block_size);
+}
 
-    // create a vector for the per mixture likelihoods
-    // we need this vector to sum over the different mixture likelihoods
-    std::vector<double> per_mixture_Likelihoods = std::vector<double>(this->num_patterns,0.0);
+
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihoodForPatterns( size_t root, size_t left, size_t right, size_t pattern_begin, size_t pattern_end)
+{
+
+    // get the pointers to the partial likelihoods of the left and right subtree
+          double* p        = this->getPartialLikelihoods(root);
+    const double* p_left   = this->getPartialLikelihoods(left);
+    const double* p_right  = this->getPartialLikelihoods(right);
 
     // get pointers the likelihood for both subtrees
           double*   p_mixture          = p;
@@ -101,38 +112,13 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( si
         // get the root frequencies
         const std::vector<double> &f                    = ff[mixture % ff.size()];
         assert(f.size() == this->num_chars);
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
 
         // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
-        {
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j             = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-                  double* p_site_j        = p_site_mixture;
-            const double* p_site_left_j   = p_site_mixture_left;
-            const double* p_site_right_j  = p_site_mixture_right;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
-            {
-                // add the probability of starting from this state
-                *p_site_j = *p_site_left_j * *p_site_right_j * *f_j;
-
-                assert(isnan(*p_site_j) || (0.0 <= *p_site_j and *p_site_j <= 1.00000000001));
-
-                // increment pointers
-                ++p_site_j; ++p_site_left_j; ++p_site_right_j;
-            }
-
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset;
-
-        } // end-for over all sites (=patterns)
+              double*   p_site_mixture          = p_mixture       + pattern_begin*this->siteOffset;
+        const double*   p_site_mixture_left     = p_mixture_left  + pattern_begin*this->siteOffset;
+        const double*   p_site_mixture_right    = p_mixture_right + pattern_begin*this->siteOffset;
+        // compute the per site probabilities (using the vectorized kernel)
+        PhyloCTMCKernels::computeRootLikelihood(f.data(), p_site_mixture_left, p_site_mixture_right, NULL, p_site_mixture, this->num_chars, pattern_end-pattern_begin, this->siteOffset);
 
         // increment the pointers to the next mixture category
         p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset;
@@ -145,13 +131,21 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( si
 
 template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( size_t root, size_t left, size_t right, size_t middle)
+{
+
+    computeRootLikelihoodForPatterns(root, left, right, middle, 0, this->pattern_block_size);
+}
+
+
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihoodForPatterns( size_t root, size_t left, size_t right, size_t middle, size_t pattern_begin, size_t pattern_end)
 {
 
     // get the pointers to the partial likelihoods of the left and right subtree
-          double* p        = this->partialLikelihoods + this->activeLikelihood[root]   * this->activeLikelihoodOffset + root   * this->nodeOffset;
-    const double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]   * this->activeLikelihoodOffset + left   * this->nodeOffset;
-    const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right]  * this->activeLikelihoodOffset + right  * this->nodeOffset;
-    const double* p_middle = this->partialLikelihoods + this->activeLikelihood[middle] * this->activeLikelihoodOffset + middle * this->nodeOffset;
+          double* p        = this->getPartialLikelihoods(root);
+    const double* p_left   = this->getPartialLikelihoods(left);
+    const double* p_right  = this->getPartialLikelihoods(right);
+    const double* p_middle = this->getPartialLikelihoods(middle);
 
     // get pointers the likelihood for both subtrees
           double*   p_mixture          = p;
@@ -170,41 +164,14 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( si
         // get the root frequencies
         const std::vector<double> &f                    = ff[mixture % ff.size()];
         assert(f.size() == this->num_chars);
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
 
         // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        const double*   p_site_mixture_middle   = p_mixture_middle;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
-        {
-
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-                  double* p_site_j        = p_site_mixture;
-            const double* p_site_left_j   = p_site_mixture_left;
-            const double* p_site_right_j  = p_site_mixture_right;
-            const double* p_site_middle_j = p_site_mixture_middle;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
-            {
-                // add the probability of starting from this state
-                *p_site_j = *p_site_left_j * *p_site_right_j * *p_site_middle_j * *f_j;
-
-                assert(isnan(*p_site_j) || (0.0 <= *p_site_j and *p_site_j <= 1.00000000001));
-
-                // increment pointers
-                ++p_site_j; ++p_site_left_j; ++p_site_right_j; ++p_site_middle_j;
-            }
-
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture_middle+=this->siteOffset;
-
-        } // end-for over all sites (=patterns)
+              double*   p_site_mixture          = p_mixture        + pattern_begin*this->siteOffset;
+        const double*   p_site_mixture_left     = p_mixture_left   + pattern_begin*this->siteOffset;
+        const double*   p_site_mixture_right    = p_mixture_right  + pattern_begin*this->siteOffset;
+        const double*   p_site_mixture_middle   = p_mixture_middle + pattern_begin*this->siteOffset;
+        // compute the per site probabilities (using the vectorized kernel)
+        PhyloCTMCKernels::computeRootLikelihood(f.data(), p_site_mixture_left, p_site_mixture_right, p_site_mixture_middle, p_site_mixture, this->num_chars, pattern_end-pattern_begin, this->siteOffset);
 
         // increment the pointers to the next mixture category
         p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset; p_mixture_middle+=this->mixtureOffset;
@@ -216,6 +183,14 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( si
 
 template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihood(const TopologyNode &node, size_t node_index, size_t left, size_t right)
+{
+
+    computeInternalNodeLikelihoodForPatterns(node, node_index, left, right, 0, this->pattern_block_size);
+}
+
+
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihoodForPatterns(const TopologyNode &node, size_t node_index, size_t left, size_t right, size_t pattern_begin, size_t pattern_end)
 {
 
     // compute the transition probability matrix
@@ -223,9 +198,9 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikeli
     size_t pmat_offset = this->active_pmatrices[node_index] * this->activePmatrixOffset + node_index * this->pmatNodeOffset;
 
     // get the pointers to the partial likelihoods for this node and the two descendant subtrees
-    const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const double*   p_left  = this->getPartialLikelihoods(left);
+    const double*   p_right = this->getPartialLikelihoods(right);
+    double*         p_node  = this->getPartialLikelihoods(node_index);
 
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
@@ -235,51 +210,28 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikeli
         const double* tp_begin = this->pmatrices[pmat_offset + mixture].theMatrix;
 
         // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
+        size_t offset = mixture*this->mixtureOffset + pattern_begin*this->siteOffset;
         double*          p_site_mixture          = p_node + offset;
         const double*    p_site_mixture_left     = p_left + offset;
         const double*    p_site_mixture_right    = p_right + offset;
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
-        {
-
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            // iterate over the possible starting states
-            for (size_t c1 = 0; c1 < this->num_chars; ++c1)
-            {
-                // temporary variable
-                double sum = 0.0;
-
-                // iterate over all possible terminal states
-                for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
-                {
-                    sum += p_site_mixture_left[c2] * p_site_mixture_right[c2] * tp_a[c2];
-
-                } // end-for over all distination character
-
-                // store the likelihood for this starting state
-                p_site_mixture[c1] = sum;
+        // compute the per site probabilities (using the vectorized kernel)
+        PhyloCTMCKernels::computeInternalNodeLikelihood(tp_begin, p_site_mixture_left, p_site_mixture_right, NULL, p_site_mixture, this->num_chars, pattern_end-pattern_begin, this->siteOffset);
 
-                assert(isnan(sum) || (0 <= sum and sum <= 1.00000000001));
-
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
-
-            } // end-for over all initial characters
+    } // end-for over all mixtures (=rate-categories)
 
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
+}
 
-        } // end-for over all sites (=patterns)
 
-    } // end-for over all mixtures (=rate-categories)
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihood(const TopologyNode &node, size_t node_index, size_t left, size_t right, size_t middle)
+{
 
+    computeInternalNodeLikelihoodForPatterns(node, node_index, left, right, middle, 0, this->pattern_block_size);
 }
 
 
 template<class charType>
-void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihood(const TopologyNode &node, size_t node_index, size_t left, size_t right, size_t middle)
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikelihoodForPatterns(const TopologyNode &node, size_t node_index, size_t left, size_t right, size_t middle, size_t pattern_begin, size_t pattern_end)
 {
 
     // compute the transition probability matrix
@@ -287,10 +239,10 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikeli
     size_t pmat_offset = this->active_pmatrices[node_index] * this->activePmatrixOffset + node_index * this->pmatNodeOffset;
 
     // get the pointers to the partial likelihoods for this node and the two descendant subtrees
-    const double*   p_left      = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_middle    = this->partialLikelihoods + this->activeLikelihood[middle]*this->activeLikelihoodOffset + middle*this->nodeOffset;
-    const double*   p_right     = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    double*         p_node      = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const double*   p_left      = this->getPartialLikelihoods(left);
+    const double*   p_middle    = this->getPartialLikelihoods(middle);
+    const double*   p_right     = this->getPartialLikelihoods(right);
+    double*         p_node      = this->getPartialLikelihoods(node_index);
 
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
@@ -300,60 +252,38 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikeli
         const double* tp_begin = this->pmatrices[pmat_offset + mixture].theMatrix;
 
         // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
+        size_t offset = mixture*this->mixtureOffset + pattern_begin*this->siteOffset;
         double*          p_site_mixture          = p_node + offset;
         const double*    p_site_mixture_left     = p_left + offset;
         const double*    p_site_mixture_middle   = p_middle + offset;
         const double*    p_site_mixture_right    = p_right + offset;
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
-        {
-
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            // iterate over the possible starting states
-            for (size_t c1 = 0; c1 < this->num_chars; ++c1)
-            {
-                // temporary variable
-                double sum = 0.0;
+        // compute the per site probabilities (using the vectorized kernel)
+        PhyloCTMCKernels::computeInternalNodeLikelihood(tp_begin, p_site_mixture_left, p_site_mixture_middle, p_site_mixture_right, p_site_mixture, this->num_chars, pattern_end-pattern_begin, this->siteOffset);
 
-                // iterate over all possible terminal states
-                for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
-                {
-                    sum += p_site_mixture_left[c2] * p_site_mixture_middle[c2] * p_site_mixture_right[c2] * tp_a[c2];
-
-                } // end-for over all distination character
-
-                assert(isnan(sum) || (0 <= sum and sum <= 1.00000000001));
-
-                // store the likelihood for this starting state
-                p_site_mixture[c1] = sum;
+    } // end-for over all mixtures (=rate-categories)
 
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
+}
 
-            } // end-for over all initial characters
 
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_middle+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
 
-        } // end-for over all sites (=patterns)
 
-    } // end-for over all mixtures (=rate-categories)
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(const TopologyNode &node, size_t node_index)
+{
 
+    computeTipLikelihoodForPatterns(node, node_index, 0, this->pattern_block_size);
 }
 
 
-
-
 template<class charType>
-void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(const TopologyNode &node, size_t node_index)
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihoodForPatterns(const TopologyNode &node, size_t node_index, size_t pattern_begin, size_t pattern_end)
 {
 
-    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    double* p_node = this->getPartialLikelihoods(node_index);
     
     // get the current correct tip index in case the whole tree change (after performing an empiricalTree Proposal)
-    size_t data_tip_index = this->taxon_name_2_tip_index_map[ node.getName() ];
+    // note, we only read from the map because this may be called concurrently for different blocks of patterns
+    size_t data_tip_index = this->taxon_name_2_tip_index_map.at( node.getName() );
     const std::vector<bool> &gap_node = this->gap_matrix[data_tip_index];
     const std::vector<unsigned long> &char_node = this->char_matrix[data_tip_index];
     const std::vector<RbBitSet> &amb_char_node = this->ambiguous_char_matrix[data_tip_index];
@@ -377,74 +307,52 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(cons
         const double* tp_begin = this->pmatrices[pmat_offset + mixture].theMatrix;
 
         // get the pointer to the likelihoods for this site and mixture category
-        double* p_site_mixture = p_mixture;
+        double* p_site_mixture = p_mixture + pattern_begin*this->siteOffset;
 
-        // iterate over all sites
-        for (size_t site = 0; site != this->pattern_block_size; ++site)
+        if ( this->using_weighted_characters == false )
         {
-
-            // is this site a gap?
-            if ( gap_node[site] )
-            {
-                // since this is a gap we need to assume that the actual state could have been any state
-
-                // iterate over all initial states for the transitions
-                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
-                {
-
-                    // store the likelihood
-                    p_site_mixture[c1] = 1.0;
-
-                }
-            }
-            else // we have observed a character
+            // compute the per site probabilities (using the vectorized kernel)
+            // note, the observed state could be ambiguous!
+            const std::vector<RbBitSet> *amb_char_site = ( this->using_ambiguous_characters == true ? &amb_char_node : NULL );
+            PhyloCTMCKernels::computeTipLikelihood(tp_begin, gap_node, char_node, amb_char_site, pattern_begin, pattern_end, p_site_mixture, this->num_chars, this->siteOffset);
+        }
+        else
+        {
+            // iterate over all sites
+            for (size_t site = pattern_begin; site != pattern_end; ++site)
             {
 
-                // iterate over all possible initial states
-                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+                // is this site a gap?
+                if ( gap_node[site] )
                 {
+                    // since this is a gap we need to assume that the actual state could have been any state
 
-                    if ( this->using_ambiguous_characters == true && this->using_weighted_characters == false)
+                    // iterate over all initial states for the transitions
+                    for (size_t c1 = 0; c1 < this->num_chars; ++c1)
                     {
-                        // compute the likelihood that we had a transition from state c1 to the observed state org_val
-                        // note, the observed state could be ambiguous!
-                        const RbBitSet &val = amb_char_node[site];
-
-                        // get the pointer to the transition probabilities for the terminal states
-                        const double* d  = tp_begin+(this->num_chars*c1);
 
-                        double tmp = 0.0;
+                        // store the likelihood
+                        p_site_mixture[c1] = 1.0;
 
-                        for ( size_t i=0; i<this->num_chars; ++i )
-                        {
-                            // check whether we observed this state
-                            if ( val.test(i) == true )
-                            {
-                                // add the probability
-                                tmp += *d;
-                            }
+                    }
+                }
+                else // we have observed a character
+                {
 
-                            // increment the pointer to the next transition probability
-                            ++d;
-                        } // end-while over all observed states for this character
+                    // compute the likelihood that we had a transition from state c1 to the observed state org_val
+                    // note, the observed state could be ambiguous!
+                    size_t this_site_index = site_indices[site];
+                    const RbBitSet &val = this->value->getCharacter(char_data_node_index, this_site_index).getState();
+                    const std::vector< double >& weights = this->value->getCharacter(char_data_node_index, this_site_index).getWeights();
 
-                        // store the likelihood
-                        p_site_mixture[c1] = tmp;
-                        
-                    }
-                    else if ( this->using_weighted_characters == true )
+                    // iterate over all possible initial states
+                    for (size_t c1 = 0; c1 < this->num_chars; ++c1)
                     {
-                        // compute the likelihood that we had a transition from state c1 to the observed state org_val
-                        // note, the observed state could be ambiguous!
-//                        const RbBitSet &val = amb_char_node[site];
-                        size_t this_site_index = site_indices[site];
-                        const RbBitSet &val = this->value->getCharacter(char_data_node_index, this_site_index).getState();
 
                         // get the pointer to the transition probabilities for the terminal states
                         const double* d = tp_begin+(this->num_chars*c1);
 
                         double tmp = 0.0;
-                        const std::vector< double >& weights = this->value->getCharacter(char_data_node_index, this_site_index).getWeights();
                         for ( size_t i=0; i<this->num_chars; ++i )
                         {
                             // check whether we observed this state
@@ -460,25 +368,17 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(cons
 
                         // store the likelihood
                         p_site_mixture[c1] = tmp;
-                        
-                    }
-                    else // no ambiguous characters in use
-                    {
-                        unsigned long org_val = char_node[site];
-
-                        // store the likelihood
-                        p_site_mixture[c1] = tp_begin[c1*this->num_chars+org_val];
 
-                    }
+                    } // end-for over all possible initial character for the branch
 
-                } // end-for over all possible initial character for the branch
+                } // end-if a gap state
 
-            } // end-if a gap state
+                // increment the pointers to next site
+                p_site_mixture+=this->siteOffset;
 
-            // increment the pointers to next site
-            p_site_mixture+=this->siteOffset;
+            } // end-for over all sites/patterns in the sequence
 
-        } // end-for over all sites/patterns in the sequence
+        }
 
         // increment the pointers to next mixture category
         p_mixture+=this->mixtureOffset;
@@ -488,4 +388,12 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(cons
 }
 
 
+template<class charType>
+bool RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::supportsPatternBlockThreads( void ) const
+{
+    // all our kernels can compute a block of patterns independently
+    return true;
+}
+
+
 #endif
@@ -46,6 +46,7 @@ namespace RevBayesCore {
         virtual void                                        computeTipCorrection(const TopologyNode &node, size_t nIdx);
 
         virtual void                                        resizeLikelihoodVectors(void);
+        virtual bool                                        supportsPatternBlockThreads(void) const;
 
         bool                                                warned;
 
@@ -469,6 +470,14 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::computeTipLike
     }
 }
 
+template<class charType>
+bool RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::supportsPatternBlockThreads( void ) const
+{
+    // the corrections are computed over the correction masks and not per pattern,
+    // so we can only split the patterns into blocks if we do not need any corrections
+    return coding == AscertainmentBias::ALL && PhyloCTMCSiteHomogeneous<charType>::supportsPatternBlockThreads();
+}
+
 template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::computeTipCorrection(const TopologyNode &node, size_t node_index)
 {
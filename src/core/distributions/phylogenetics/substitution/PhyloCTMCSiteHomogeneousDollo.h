@@ -58,6 +58,7 @@ template <class valueType> class TypedDagNode;
 
             double                                              sumRootLikelihood( void );
             void                                                resizeLikelihoodVectors(void);
+            bool                                                supportsScalingExponents(void) const { return false; }     //!< We scale the partial likelihoods and corrections ourselves with log factors
             void                                                updateTransitionProbabilities(size_t node_idx);
             void                                                getStationaryFrequencies( std::vector<std::vector<double> >& ) const;
 
@@ -0,0 +1,80 @@
+#include "CladogeneticEventTable.h"
+
+#include "RbException.h"
+
+using namespace RevBayesCore;
+
+
+CladogeneticEventTable::CladogeneticEventTable( void ) :
+    num_states( 0 )
+{
+    
+}
+
+
+/**
+ * Build the table from the event map.
+ * We first count the events per ancestor and daughter state and then fill the rows in the order of the event map.
+ */
+void CladogeneticEventTable::compile( const std::map<std::vector<unsigned>, double> &event_map, size_t n )
+{
+    
+    num_states = n;
+    
+    ancestor_offsets = std::vector<size_t>(num_states + 1, 0);
+    daughter_offsets = std::vector<size_t>(num_states + 1, 0);
+    total_speciation_rates = std::vector<double>(num_states, 0.0);
+    
+    std::map<std::vector<unsigned>, double>::const_iterator it;
+    for (it = event_map.begin(); it != event_map.end(); ++it)
+    {
+        const std::vector<unsigned>& states = it->first;
+        if ( states.size() != 3 || states[0] >= num_states || states[1] >= num_states || states[2] >= num_states )
+        {
+            throw RbException("The cladogenetic event map contains an event that does not match the number of states of the process.");
+        }
+        
+        ++ancestor_offsets[states[0] + 1];
+        ++daughter_offsets[states[1] + 1];
+        ++daughter_offsets[states[2] + 1];
+        total_speciation_rates[states[0]] += it->second;
+    }
+    
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        ancestor_offsets[i + 1] += ancestor_offsets[i];
+        daughter_offsets[i + 1] += daughter_offsets[i];
+    }
+    
+    size_t num_events = event_map.size();
+    ancestor_daughter_1.resize( num_events );
+    ancestor_daughter_2.resize( num_events );
+    ancestor_rate.resize( num_events );
+    daughter_ancestor.resize( 2 * num_events );
+    daughter_sister.resize( 2 * num_events );
+    daughter_rate.resize( 2 * num_events );
+    
+    std::vector<size_t> next_ancestor( ancestor_offsets.begin(), ancestor_offsets.end() - 1 );
+    std::vector<size_t> next_daughter( daughter_offsets.begin(), daughter_offsets.end() - 1 );
+    for (it = event_map.begin(); it != event_map.end(); ++it)
+    {
+        const std::vector<unsigned>& states = it->first;
+        double rate = it->second;
+        
+        size_t k = next_ancestor[states[0]]++;
+        ancestor_daughter_1[k] = states[1];
+        ancestor_daughter_2[k] = states[2];
+        ancestor_rate[k]       = rate;
+        
+        k = next_daughter[states[1]]++;
+        daughter_ancestor[k] = states[0];
+        daughter_sister[k]   = states[2];
+        daughter_rate[k]     = rate;
+        
+        k = next_daughter[states[2]]++;
+        daughter_ancestor[k] = states[0];
+        daughter_sister[k]   = states[1];
+        daughter_rate[k]     = rate;
+    }
+    
+}
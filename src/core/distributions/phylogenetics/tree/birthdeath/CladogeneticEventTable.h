@@ -0,0 +1,53 @@
+#ifndef CladogeneticEventTable_H
+#define CladogeneticEventTable_H
+
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+namespace RevBayesCore {
+    
+    /**
+     * @brief Compiled table of the cladogenetic events of an SSE model.
+     *
+     * The cladogenetic event map of a CladogeneticSpeciationRateMatrix is a std::map from
+     * [ancestor_state, daughter_1_state, daughter_2_state] to the speciation rate of the event.
+     * The ODEs and the likelihood at the nodes need the events of a given ancestor (or daughter) state,
+     * which means a full pass over the map for every state and thus O(num_states * num_events) per evaluation.
+     *
+     * This table stores the events once in flat arrays (compressed sparse rows), grouped by the ancestor state
+     * and separately by the daughter state, together with the total speciation rate of every state.
+     * Within each group, the events keep the order of the event map, so all sums are formed in the same order as before.
+     * The table is compiled once whenever the event map changes.
+     */
+    class CladogeneticEventTable {
+        
+    public:
+        
+        CladogeneticEventTable(void);
+        
+        void                                        compile(const std::map<std::vector<unsigned>, double> &event_map, size_t num_states);   //!< Build the table from the event map
+        size_t                                      getNumberOfStates(void) const { return num_states; }
+        
+        // the events of ancestor state i are the indices ancestor_offsets[i] to ancestor_offsets[i+1]-1
+        std::vector<size_t>                         ancestor_offsets;
+        std::vector<unsigned>                       ancestor_daughter_1;                //!< the state of the first daughter of each event
+        std::vector<unsigned>                       ancestor_daughter_2;                //!< the state of the second daughter of each event
+        std::vector<double>                         ancestor_rate;                      //!< the speciation rate of each event
+        
+        // the events with daughter state i are the indices daughter_offsets[i] to daughter_offsets[i+1]-1 (an event appears once per daughter)
+        std::vector<size_t>                         daughter_offsets;
+        std::vector<unsigned>                       daughter_ancestor;                  //!< the ancestor state of each event
+        std::vector<unsigned>                       daughter_sister;                    //!< the state of the other daughter of each event
+        std::vector<double>                         daughter_rate;                      //!< the speciation rate of each event
+        
+        std::vector<double>                         total_speciation_rates;             //!< the sum of the speciation rates of all events of each ancestor state
+        
+    private:
+        
+        size_t                                      num_states;
+    };
+    
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include "ExtinctionProbabilityTable.h"
+
+#include <algorithm>
+
+#include "RbException.h"
+
+using namespace RevBayesCore;
+
+
+ExtinctionProbabilityTable::ExtinctionProbabilityTable( void ) :
+    num_states( 0 )
+{
+    
+}
+
+
+void ExtinctionProbabilityTable::addKnot( double age, const std::vector<double> &e, bool is_break )
+{
+    
+    if ( ages.empty() == true )
+    {
+        num_states = e.size();
+    }
+    else if ( age <= ages.back() || e.size() != num_states )
+    {
+        throw RbException("The knots of the extinction probability table must have increasing ages and the same number of states.");
+    }
+    
+    ages.push_back( age );
+    breaks.push_back( is_break );
+    values.insert( values.end(), e.begin(), e.end() );
+    
+}
+
+
+void ExtinctionProbabilityTable::clear( void )
+{
+    
+    ages.clear();
+    breaks.clear();
+    values.clear();
+    
+}
+
+
+bool ExtinctionProbabilityTable::covers( double age ) const
+{
+    
+    return ages.size() > 1 && age >= ages.front() && age <= ages.back();
+}
+
+
+/**
+ * Interpolate the extinction probabilities at this age with the Lagrange polynomial through up to four knots,
+ * two on either side of the age. We do not use knots from beyond a break.
+ */
+void ExtinctionProbabilityTable::interpolate( double age, double *e ) const
+{
+    
+    // find the interval [ages[k], ages[k+1]] that contains the age
+    size_t k = std::upper_bound( ages.begin(), ages.end(), age ) - ages.begin();
+    k = ( k == 0 ? 0 : k - 1 );
+    if ( k + 1 >= ages.size() )
+    {
+        k = ages.size() - 2;
+    }
+    
+    // the knots of the stencil
+    size_t first = k;
+    size_t last  = k + 1;
+    if ( first > 0 && breaks[first] == false )
+    {
+        --first;
+    }
+    if ( last + 1 < ages.size() && breaks[last] == false )
+    {
+        ++last;
+    }
+    
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        e[i] = 0.0;
+    }
+    
+    for (size_t j = first; j <= last; ++j)
+    {
+        double weight = 1.0;
+        for (size_t m = first; m <= last; ++m)
+        {
+            if ( m != j )
+            {
+                weight *= (age - ages[m]) / (ages[j] - ages[m]);
+            }
+        }
+        
+        const double* v = &values[j * num_states];
+        for (size_t i = 0; i < num_states; ++i)
+        {
+            e[i] += weight * v[i];
+        }
+    }
+    
+}
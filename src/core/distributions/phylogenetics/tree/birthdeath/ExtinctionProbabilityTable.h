@@ -0,0 +1,44 @@
+#ifndef ExtinctionProbabilityTable_H
+#define ExtinctionProbabilityTable_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace RevBayesCore {
+    
+    /**
+     * @brief Table of the extinction probabilities E(t) of an SSE model for interpolation.
+     *
+     * The extinction probabilities E(t) of the state-dependent birth-death processes only depend on the age t
+     * and on the parameters of the model, but not on the branch. Thus, we can solve the ODE for E(t) once on a
+     * dense grid of ages from the present to the start of the process, and the branch integrations only need
+     * to solve the ODE of the observation probabilities D(t) while they interpolate E(t) from this table.
+     *
+     * The table stores the values at increasing ages (knots). We interpolate with the cubic polynomial through
+     * the two knots on either side of the age. Knots can be marked as breaks (e.g., at the boundaries of epochs),
+     * where the derivatives of E(t) may jump; then we do not use knots from beyond the break,
+     * and use a polynomial of lower degree near the break instead.
+     */
+    class ExtinctionProbabilityTable {
+        
+    public:
+        
+        ExtinctionProbabilityTable(void);
+        
+        void                                        addKnot(double age, const std::vector<double> &e, bool is_break = false);  //!< Append the extinction probabilities at the next (older) age
+        void                                        clear(void);                                                                //!< Remove all knots, i.e., invalidate the table
+        bool                                        covers(double age) const;                                                   //!< Can we interpolate at this age?
+        void                                        interpolate(double age, double *e) const;                                   //!< Write the interpolated extinction probabilities at this age into e
+        bool                                        isEmpty(void) const { return ages.empty(); }
+        
+    private:
+        
+        size_t                                      num_states;
+        std::vector<double>                         ages;                                                                       //!< The ages of the knots (increasing)
+        std::vector<bool>                           breaks;                                                                     //!< Is the knot a break?
+        std::vector<double>                         values;                                                                     //!< The extinction probabilities at the knots, num_states values per knot
+    };
+    
+}
+
+#endif
@@ -1,11 +1,8 @@
 #include <stddef.h>
-#include <map>
-#include <utility>
 #include <vector>
 
 #include "SSE_ODE.h"
 #include "RateGenerator.h"
-#include "TimeInterval.h"
 
 using namespace RevBayesCore;
 
@@ -13,13 +10,29 @@ using namespace RevBayesCore;
 SSE_ODE::SSE_ODE( const std::vector<double> &m, const RateGenerator* q, double r, bool backward_time, bool extinction_only, bool allow_shifts_extinct ) :
     mu( m ),
     num_states( q->getNumberOfStates() ),
-    Q( q ),
-    rate( r ),
+    anagenetic_rates( num_states * num_states, 0.0 ),
+    event_table( NULL ),
+    extinction_probabilities( NULL ),
+    safe_x( 2 * num_states, 0.0 ),
     extinction_only( extinction_only ),
+    use_speciation_from_event_map( false ),
     backward_time( backward_time ),
     allow_rate_shifts_extinction( allow_shifts_extinct )
 {
     
+    // the rates do not change during the integration, so we ask the rate matrix only once
+    double age = 0.0;
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        for (size_t j = 0; j < num_states; ++j)
+        {
+            if ( i != j )
+            {
+                anagenetic_rates[i * num_states + j] = q->getRate(i, j, age, r);
+            }
+        }
+    }
+    
 }
 
 
@@ -29,15 +42,29 @@ void SSE_ODE::operator()(const std::vector< double > &x, std::vector< double > &
     
     // catch negative extinction probabilities that can result from
     // rounding errors in the ODE stepper
-    std::vector< double > safe_x = x;
-    for (size_t i = 0; i < num_states * 2; ++i)
+    size_t d_offset = num_states;
+    if ( extinction_probabilities == NULL )
+    {
+        for (size_t i = 0; i < num_states * 2; ++i)
+        {
+            safe_x[i] = ( x[i] < 0.0 ? 0.0 : x[i] );
+        }
+    }
+    else
     {
-        safe_x[i] = ( x[i] < 0.0 ? 0.0 : x[i] );
+        // we only integrate D(t), which is the whole state, and look up E(t)
+        extinction_probabilities->interpolate( t, &safe_x[0] );
+        for (size_t i = 0; i < num_states; ++i)
+        {
+            safe_x[i] = ( safe_x[i] < 0.0 ? 0.0 : safe_x[i] );
+            safe_x[i + num_states] = ( x[i] < 0.0 ? 0.0 : x[i] );
+        }
+        d_offset = 0;
     }
     
-    double age = 0.0;
     for (size_t i = 0; i < num_states; ++i)
     {
+        const double* q_i = &anagenetic_rates[i * num_states];
         
         // calculate sum of speciation rates
         // lambda_ijk for all possible values of j and k
@@ -45,36 +72,20 @@ void SSE_ODE::operator()(const std::vector< double > &x, std::vector< double > &
         
         if ( use_speciation_from_event_map == true )
         {
-            std::map<std::vector<unsigned>, double>::iterator it;
-            for (it = event_map.begin(); it != event_map.end(); it++)
-            {
-                const std::vector<unsigned>& states = it->first;
-                double curr_lambda = it->second;
-            
-                if (i == states[0])
-                {
-                    lambda_sum += curr_lambda;
-                }
-            }
+            lambda_sum = event_table->total_speciation_rates[i];
         }
         else
         {
             lambda_sum = lambda[i];
         }
         
-        /**** Extinction ****/
-        /**** equation A2 ***/
-        
-        // extinction event
-        dxdt[i] = mu[i];
-        
         // no event
         double no_event_rate = mu[i] + lambda_sum;
         for (size_t j = 0; j < num_states; ++j)
         {
             if ( i != j && allow_rate_shifts_extinction == true )
             {
-                no_event_rate += Q->getRate(i, j, age, rate);
+                no_event_rate += q_i[j];
             }
         }
         
@@ -83,39 +94,42 @@ void SSE_ODE::operator()(const std::vector< double > &x, std::vector< double > &
             no_event_rate += psi[i];
         }
 
-        dxdt[i] -= no_event_rate * safe_x[i];
-        
-        // speciation event
-        if ( use_speciation_from_event_map == true )
+        if ( extinction_probabilities == NULL )
         {
-            std::map<std::vector<unsigned>, double>::iterator it;
-            for (it = event_map.begin(); it != event_map.end(); it++)
+            /**** Extinction ****/
+            /**** equation A2 ***/
+            
+            // extinction event
+            dxdt[i] = mu[i];
+            
+            dxdt[i] -= no_event_rate * safe_x[i];
+            
+            // speciation event
+            if ( use_speciation_from_event_map == true )
             {
-                const std::vector<unsigned>& states = it->first;
-                double curr_lambda = it->second;
-                if (i == states[0])
+                for (size_t k = event_table->ancestor_offsets[i]; k < event_table->ancestor_offsets[i+1]; ++k)
                 {
-                    dxdt[i] += curr_lambda * safe_x[states[1]] * safe_x[states[2]];
+                    dxdt[i] += event_table->ancestor_rate[k] * safe_x[event_table->ancestor_daughter_1[k]] * safe_x[event_table->ancestor_daughter_2[k]];
                 }
             }
-        }
-        else
-        {
-            dxdt[i] += lambda[i] * safe_x[i] * safe_x[i];
-        }
-        
-        // anagenetic state change
-        for (size_t j = 0; j < num_states; ++j)
-        {
-            if ( i != j && allow_rate_shifts_extinction == true )
+            else
             {
-                dxdt[i] += Q->getRate(i, j, age, rate) * safe_x[j];
+                dxdt[i] += lambda[i] * safe_x[i] * safe_x[i];
+            }
+            
+            // anagenetic state change
+            for (size_t j = 0; j < num_states; ++j)
+            {
+                if ( i != j && allow_rate_shifts_extinction == true )
+                {
+                    dxdt[i] += q_i[j] * safe_x[j];
+                }
+            }
+            
+            if ( backward_time == false )
+            {
+                dxdt[i] = -dxdt[i];
             }
-        }
-
-        if ( backward_time == false )
-        {
-            dxdt[i] = -dxdt[i];
         }
         
         if ( extinction_only == false )
@@ -124,41 +138,33 @@ void SSE_ODE::operator()(const std::vector< double > &x, std::vector< double > &
             /**** equation A1 ****/
         
             // no event
-            dxdt[i + num_states] = -no_event_rate * safe_x[i + num_states];
+            dxdt[i + d_offset] = -no_event_rate * safe_x[i + num_states];
             
             // speciation event
             if ( use_speciation_from_event_map == true )
             {
-                std::map<std::vector<unsigned>, double>::iterator it;
-                for (it = event_map.begin(); it != event_map.end(); it++)
+                if ( backward_time == true )
                 {
-                    const std::vector<unsigned>& states = it->first;
-                    double lambda = it->second;
-                    if ( backward_time == true )
+                    for (size_t k = event_table->ancestor_offsets[i]; k < event_table->ancestor_offsets[i+1]; ++k)
                     {
-                        if (i == states[0])
-                        {
-                            double term1 = safe_x[states[1] + num_states] * safe_x[states[2]];
-                            double term2 = safe_x[states[2] + num_states] * safe_x[states[1]];
-                            dxdt[i + num_states] += lambda * (term1 + term2 );
-                        }
+                        unsigned d1 = event_table->ancestor_daughter_1[k];
+                        unsigned d2 = event_table->ancestor_daughter_2[k];
+                        double term1 = safe_x[d1 + num_states] * safe_x[d2];
+                        double term2 = safe_x[d2 + num_states] * safe_x[d1];
+                        dxdt[i + d_offset] += event_table->ancestor_rate[k] * (term1 + term2 );
                     }
-                    else
+                }
+                else
+                {
+                    for (size_t k = event_table->daughter_offsets[i]; k < event_table->daughter_offsets[i+1]; ++k)
                     {
-                        if (i == states[1])
-                        {
-                            dxdt[i + num_states] += lambda * safe_x[states[0] + num_states] * safe_x[states[2]];
-                        }
-                        if (i == states[2])
-                        {
-                            dxdt[i + num_states] += lambda * safe_x[states[0] + num_states] * safe_x[states[1]];
-                        }
+                        dxdt[i + d_offset] += event_table->daughter_rate[k] * safe_x[event_table->daughter_ancestor[k] + num_states] * safe_x[event_table->daughter_sister[k]];
                     }
                 }
             }
             else
             {
-                dxdt[i + num_states] += 2 * lambda[i] * safe_x[i] * safe_x[i + num_states];
+                dxdt[i + d_offset] += 2 * lambda[i] * safe_x[i] * safe_x[i + num_states];
             }
         
             // anagenetic state change
@@ -168,11 +174,11 @@ void SSE_ODE::operator()(const std::vector< double > &x, std::vector< double > &
                 {
                     if ( backward_time == true )
                     {
-                        dxdt[i + num_states] += Q->getRate(i, j, age, rate) * safe_x[j + num_states];
+                        dxdt[i + d_offset] += q_i[j] * safe_x[j + num_states];
                     }
                     else
                     {
-                        dxdt[i + num_states] += Q->getRate(j, i, age, rate) * safe_x[j + num_states];
+                        dxdt[i + d_offset] += anagenetic_rates[j * num_states + i] * safe_x[j + num_states];
                     }
                 }
                 
@@ -185,11 +191,25 @@ void SSE_ODE::operator()(const std::vector< double > &x, std::vector< double > &
 }
 
 
-void SSE_ODE::setEventMap( const std::map<std::vector<unsigned>, double> &e )
+/**
+ * Use the cladogenetic events of this table. The table must live as long as the ODE.
+ */
+void SSE_ODE::setEventTable( const CladogeneticEventTable *e )
 {
     
     use_speciation_from_event_map = true;
-    event_map = e;
+    event_table = e;
+}
+
+
+/**
+ * Interpolate the extinction probabilities from this table instead of integrating them.
+ * Then the state only contains the observation probabilities. The table must live as long as the ODE.
+ */
+void SSE_ODE::setExtinctionProbabilities( const ExtinctionProbabilityTable *e )
+{
+    
+    extinction_probabilities = e;
 }
 
 
@@ -207,4 +227,3 @@ void SSE_ODE::setSerialSamplingRate( const std::vector<double> &s )
     psi = s;
 
 }
-
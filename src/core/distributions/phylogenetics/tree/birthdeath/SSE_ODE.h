@@ -2,6 +2,8 @@
 #define SSE_ODE_H
 
 #include "AbstractBirthDeathProcess.h"
+#include "CladogeneticEventTable.h"
+#include "ExtinctionProbabilityTable.h"
 #include "RateMatrix.h"
 
 #include <vector>
@@ -16,6 +18,13 @@ namespace RevBayesCore {
      * cladogenetic multi-rate birth-death process (ClaSSE: Goldberg and Igic, 2012)
      * Will Freyman 6/22/16
      *
+     * The right-hand side is evaluated many times per branch, so it does not allocate memory:
+     * the anagenetic rates are read once from the rate matrix in the constructor,
+     * and the cladogenetic events come from a compiled CladogeneticEventTable owned by the caller.
+     *
+     * If a table of the extinction probabilities is set (see setExtinctionProbabilities()), then the state
+     * contains only the num_states observation probabilities D(t), and E(t) is interpolated from the table.
+     *
      */
     class SSE_ODE {
         
@@ -25,7 +34,8 @@ namespace RevBayesCore {
         
         void operator() ( const std::vector< double > &x, std::vector< double > &dxdt , const double t );
         
-        void            setEventMap( const std::map<std::vector<unsigned>, double> &e );
+        void            setEventTable( const CladogeneticEventTable *e );
+        void            setExtinctionProbabilities( const ExtinctionProbabilityTable *e );
         void            setSpeciationRate( const std::vector<double> &s );
         void            setSerialSamplingRate( const std::vector<double> &s );
         
@@ -35,9 +45,10 @@ namespace RevBayesCore {
         std::vector<double>                         lambda;                             //!< vector of speciation rates, one rate for each character state
         std::vector<double>                         psi;                                //!< vector of fossilization rates, one rate for each character state
         size_t                                      num_states;                         //!< the number of character states = q->getNumberOfStates()
-        const RateGenerator*                        Q;                                  //!< anagenetic rate matrix
-        std::map<std::vector<unsigned>, double>     event_map;                          //!< cladogenetic event map, with the structure pair< [ancestor_state, daughter_1_state, daughter_2_state], speciation_rate >
-        double                                      rate;                               //!< clock rate for anagenetic change
+        std::vector<double>                         anagenetic_rates;                   //!< the rates Q(i,j) of the anagenetic rate matrix (scaled by the clock rate), stored row by row
+        const CladogeneticEventTable*               event_table;                        //!< compiled cladogenetic event map, with the events grouped by ancestor and daughter state
+        const ExtinctionProbabilityTable*           extinction_probabilities;           //!< the extinction probabilities E(t), if we only integrate D(t)
+        std::vector<double>                         safe_x;                             //!< scratch copy of the state with negative probabilities set to zero
         
         // flags to modify behabior
         bool                                        extinction_only;                    //!< calculate only extinction probabilities
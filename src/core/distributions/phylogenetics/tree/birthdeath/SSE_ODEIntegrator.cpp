@@ -0,0 +1,270 @@
+#include "SSE_ODEIntegrator.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include <boost/ref.hpp>
+#include <boost/numeric/odeint.hpp> // IWYU pragma: keep
+
+#include "SSE_ODE.h"
+
+using namespace RevBayesCore;
+
+
+/**
+ * The steppers keep their buffers between the integrations.
+ * The buffers of the state vectors are only resized if the number of states changes.
+ */
+struct SSE_ODEIntegrator::Steppers {
+
+    typedef boost::numeric::odeint::runge_kutta_dopri5< std::vector<double> >                              explicit_stepper_type;
+    typedef boost::numeric::odeint::result_of::make_controlled< explicit_stepper_type >::type              controlled_explicit_stepper_type;
+    typedef boost::numeric::odeint::rosenbrock4_controller< boost::numeric::odeint::rosenbrock4<double> >  controlled_stiff_stepper_type;
+    typedef boost::numeric::ublas::vector<double>                                                          stiff_state_type;
+    typedef boost::numeric::ublas::matrix<double>                                                          stiff_matrix_type;
+
+    Steppers(double abs_tol, double rel_tol) :
+        explicit_stepper( boost::numeric::odeint::make_controlled( abs_tol, rel_tol, explicit_stepper_type() ) )
+    {}
+
+    void                                resize(size_t n)
+    {
+        if ( stiff_x.size() != n )
+        {
+            stiff_x.resize( n, false );
+            x.resize( n );
+            dxdt.resize( n );
+            dxdt_0.resize( n );
+        }
+    }
+
+    /** Evaluate the ODE for a state in the format of the stiff stepper. */
+    void                                evaluate(SSE_ODE &ode, const stiff_state_type &x_in, std::vector<double> &dxdt_out, double t)
+    {
+        std::copy( x_in.begin(), x_in.end(), x.begin() );
+        ode( x, dxdt_out, t );
+    }
+
+    /** The ODE in the format of the stiff stepper. */
+    struct StiffSystem {
+
+        StiffSystem(SSE_ODE &o, Steppers &s) : ode( &o ), steppers( &s ) {}
+
+        void operator()(const stiff_state_type &x, stiff_state_type &dxdt, double t) const
+        {
+            steppers->evaluate( *ode, x, steppers->dxdt, t );
+            std::copy( steppers->dxdt.begin(), steppers->dxdt.end(), dxdt.begin() );
+        }
+
+        SSE_ODE*                        ode;
+        Steppers*                       steppers;
+    };
+
+
+    /**
+     * The Jacobian of the ODE by forward differences.
+     * This costs num_states+2 evaluations of the ODE, but we only need it for stiff branches.
+     */
+    struct StiffJacobian {
+
+        StiffJacobian(SSE_ODE &o, Steppers &s) : ode( &o ), steppers( &s ) {}
+
+        void operator()(const stiff_state_type &x, stiff_matrix_type &jacobi, double t, stiff_state_type &dfdt) const
+        {
+            const double sqrt_eps = std::sqrt( std::numeric_limits<double>::epsilon() );
+            size_t n = x.size();
+
+            std::vector<double> &dxdt_0 = steppers->dxdt_0;
+            std::vector<double> &dxdt   = steppers->dxdt;
+            steppers->evaluate( *ode, x, dxdt_0, t );
+
+            for (size_t j = 0; j < n; ++j)
+            {
+                double h = sqrt_eps * std::max( std::fabs( x[j] ), 1E-8 );
+                std::copy( x.begin(), x.end(), steppers->x.begin() );
+                steppers->x[j] += h;
+                (*ode)( steppers->x, dxdt, t );
+                for (size_t i = 0; i < n; ++i)
+                {
+                    jacobi(i, j) = (dxdt[i] - dxdt_0[i]) / h;
+                }
+            }
+
+            double h_t = sqrt_eps * std::max( std::fabs( t ), 1.0 );
+            steppers->evaluate( *ode, x, dxdt, t + h_t );
+            for (size_t i = 0; i < n; ++i)
+            {
+                dfdt[i] = (dxdt[i] - dxdt_0[i]) / h_t;
+            }
+        }
+
+        SSE_ODE*                        ode;
+        Steppers*                       steppers;
+    };
+
+
+    controlled_explicit_stepper_type    explicit_stepper;
+    stiff_state_type                    stiff_x;
+    std::vector<double>                 x;                                          //!< scratch state for the ODE
+    std::vector<double>                 dxdt;                                       //!< scratch derivatives
+    std::vector<double>                 dxdt_0;                                     //!< derivatives at the current state (for the Jacobian)
+};
+
+
+SSE_ODEIntegrator::SSE_ODEIntegrator(double abs_tol, double rel_tol, size_t max_steps) :
+    abs_tolerance( abs_tol ),
+    rel_tolerance( rel_tol ),
+    max_explicit_steps( max_steps ),
+    steppers( new Steppers( abs_tol, rel_tol ) ),
+    num_steps( 0 ),
+    num_rejected_steps( 0 ),
+    num_stiff_steps( 0 )
+{
+
+}
+
+
+SSE_ODEIntegrator::SSE_ODEIntegrator(const SSE_ODEIntegrator &i) :
+    abs_tolerance( i.abs_tolerance ),
+    rel_tolerance( i.rel_tolerance ),
+    max_explicit_steps( i.max_explicit_steps ),
+    steppers( new Steppers( i.abs_tolerance, i.rel_tolerance ) ),
+    num_steps( i.num_steps ),
+    num_rejected_steps( i.num_rejected_steps ),
+    num_stiff_steps( i.num_stiff_steps )
+{
+
+}
+
+
+SSE_ODEIntegrator::~SSE_ODEIntegrator( void )
+{
+
+    delete steppers;
+}
+
+
+SSE_ODEIntegrator& SSE_ODEIntegrator::operator=(const SSE_ODEIntegrator &i)
+{
+
+    if ( this != &i )
+    {
+        delete steppers;
+
+        abs_tolerance       = i.abs_tolerance;
+        rel_tolerance       = i.rel_tolerance;
+        max_explicit_steps  = i.max_explicit_steps;
+        steppers            = new Steppers( abs_tolerance, rel_tolerance );
+        num_steps           = i.num_steps;
+        num_rejected_steps  = i.num_rejected_steps;
+        num_stiff_steps     = i.num_stiff_steps;
+    }
+
+    return *this;
+}
+
+
+/**
+ * Integrate the ODE from begin_time to end_time, starting with the step size dt.
+ * We try the explicit Dormand-Prince stepper first and switch to the Rosenbrock stepper
+ * if the explicit stepper needs too many steps.
+ */
+void SSE_ODEIntegrator::integrate(SSE_ODE &ode, std::vector<double> &x, double begin_time, double end_time, double dt)
+{
+
+    double t = begin_time;
+    double direction = ( end_time < begin_time ? -1.0 : 1.0 );
+    dt = direction * std::fabs( dt );
+    if ( dt == 0.0 )
+    {
+        dt = end_time - begin_time;
+    }
+
+    // the derivatives of the last step belong to a different state
+    steppers->explicit_stepper.reset();
+
+    size_t num_attempts = 0;
+    while ( direction * (end_time - t) > 0.0 )
+    {
+        if ( num_attempts >= max_explicit_steps || t + dt == t )
+        {
+            integrateStiff( ode, x, t, end_time, dt );
+            return;
+        }
+
+        // we never step beyond the end
+        bool last_step = ( direction * (t + dt - end_time) >= 0.0 );
+        if ( last_step == true )
+        {
+            dt = end_time - t;
+        }
+
+        ++num_attempts;
+        if ( steppers->explicit_stepper.try_step( boost::ref(ode), x, t, dt ) == boost::numeric::odeint::success )
+        {
+            ++num_steps;
+            if ( last_step == true )
+            {
+                t = end_time;
+            }
+        }
+        else
+        {
+            ++num_rejected_steps;
+        }
+    }
+
+}
+
+
+void SSE_ODEIntegrator::integrateStiff(SSE_ODE &ode, std::vector<double> &x, double t, double end_time, double dt)
+{
+
+    steppers->resize( x.size() );
+    Steppers::stiff_state_type &stiff_x = steppers->stiff_x;
+    std::copy( x.begin(), x.end(), stiff_x.begin() );
+
+    // a new controller has no step size history, so the result of a branch does not depend on the branches integrated before
+    Steppers::controlled_stiff_stepper_type stiff_stepper( abs_tolerance, rel_tolerance );
+
+    std::pair<Steppers::StiffSystem, Steppers::StiffJacobian> system = std::make_pair( Steppers::StiffSystem( ode, *steppers ), Steppers::StiffJacobian( ode, *steppers ) );
+
+    double direction = ( end_time < t ? -1.0 : 1.0 );
+    while ( direction * (end_time - t) > 0.0 )
+    {
+        // we never step beyond the end
+        bool last_step = ( direction * (t + dt - end_time) >= 0.0 );
+        if ( last_step == true )
+        {
+            dt = end_time - t;
+        }
+
+        if ( stiff_stepper.try_step( system, stiff_x, t, dt ) == boost::numeric::odeint::success )
+        {
+            ++num_steps;
+            ++num_stiff_steps;
+            if ( last_step == true )
+            {
+                t = end_time;
+            }
+        }
+        else
+        {
+            ++num_rejected_steps;
+        }
+    }
+
+    std::copy( stiff_x.begin(), stiff_x.end(), x.begin() );
+
+}
+
+
+void SSE_ODEIntegrator::resetStepCounts( void )
+{
+
+    num_steps           = 0;
+    num_rejected_steps  = 0;
+    num_stiff_steps     = 0;
+
+}
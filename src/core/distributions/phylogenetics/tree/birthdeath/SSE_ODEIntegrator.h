@@ -0,0 +1,58 @@
+#ifndef SSE_ODEIntegrator_H
+#define SSE_ODEIntegrator_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace RevBayesCore {
+
+    class SSE_ODE;
+
+    /**
+     * @brief Error-controlled integrator for the ODEs of the state-dependent birth-death processes.
+     *
+     * We integrate with the embedded Dormand-Prince 5(4) pair and adapt the step size so that the local error
+     * stays below the absolute and relative tolerances. The stepper and all of its buffers live as long as
+     * the integrator, and the ODE is passed by reference, so that a step does not allocate any memory.
+     *
+     * For very large rates the ODE becomes stiff and the explicit stepper needs tiny steps to stay stable.
+     * If a single integration needs more than max_explicit_steps steps, we continue the integration with the
+     * implicit Rosenbrock method of order 4, using a finite-difference Jacobian of the ODE.
+     *
+     * The integrator counts the accepted and rejected steps of both methods until resetStepCounts() is called.
+     */
+    class SSE_ODEIntegrator {
+
+    public:
+
+        SSE_ODEIntegrator(double abs_tol = 1E-8, double rel_tol = 1E-8, size_t max_explicit_steps = 1000);
+        SSE_ODEIntegrator(const SSE_ODEIntegrator &i);
+        ~SSE_ODEIntegrator(void);
+
+        SSE_ODEIntegrator&                          operator=(const SSE_ODEIntegrator &i);
+
+        size_t                                      getNumberOfRejectedSteps(void) const { return num_rejected_steps; }
+        size_t                                      getNumberOfStiffSteps(void) const { return num_stiff_steps; }          //!< The number of accepted steps of the implicit stepper
+        size_t                                      getNumberOfSteps(void) const { return num_steps; }                     //!< The number of accepted steps of both steppers
+        void                                        integrate(SSE_ODE &ode, std::vector<double> &x, double begin_time, double end_time, double dt);  //!< Integrate x from begin_time to end_time with initial step size dt
+        void                                        resetStepCounts(void);
+
+    private:
+
+        struct Steppers;                                                                                                    //!< The odeint steppers (defined in the source file)
+
+        void                                        integrateStiff(SSE_ODE &ode, std::vector<double> &x, double t, double end_time, double dt);
+
+        double                                      abs_tolerance;
+        double                                      rel_tolerance;
+        size_t                                      max_explicit_steps;
+        Steppers*                                   steppers;
+
+        size_t                                      num_steps;
+        size_t                                      num_rejected_steps;
+        size_t                                      num_stiff_steps;
+    };
+
+}
+
+#endif
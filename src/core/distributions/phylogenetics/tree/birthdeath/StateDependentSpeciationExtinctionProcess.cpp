@@ -22,6 +22,7 @@
 #include "RbMathCombinatorialFunctions.h"
 #include "RlString.h"
 #include "StochasticNode.h"
+#include "ThreadPool.h"
 #include "TopologyNode.h"
 #include "AbstractDiscreteTaxonData.h"
 #include "AbstractTaxonData.h"
@@ -45,7 +46,6 @@
 #include "TreeDiscreteCharacterData.h"
 #include "TypedDagNode.h"
 #include "TypedDistribution.h"
-#include "boost/numeric/odeint.hpp" // IWYU pragma: keep
 
 namespace RevBayesCore { class DagNode; }
 namespace RevBayesCore { template <class valueType> class RbOrderedSet; }
@@ -85,6 +85,9 @@ StateDependentSpeciationExtinctionProcess::StateDependentSpeciationExtinctionPro
     num_states( ext->getValue().size() ),
     scaling_factors( std::vector<std::vector<double> >(5, std::vector<double>(2,0.0) ) ),
     use_cladogenetic_events( false ),
+    clado_event_table_dirty( true ),
+    use_extinction_probability_table( false ),
+    ode_integrators( 1, SSE_ODEIntegrator( 1E-8, 1E-8 ) ),
     use_origin( uo ),
     sample_character_history( false ),
     average_speciation( std::vector<double>(5, 0.0) ),
@@ -300,6 +303,18 @@ double StateDependentSpeciationExtinctionProcess::computeLnProbability( void )
         resizeVectors(value->getNumberOfNodes());
     }
     
+    // count the ODE steps of this likelihood computation
+    for (size_t i = 0; i < ode_integrators.size(); ++i)
+    {
+        ode_integrators[i].resetStepCounts();
+    }
+    
+    // solve the extinction probabilities once for all branches
+    if ( use_extinction_probability_table == true )
+    {
+        computeExtinctionProbabilityTable();
+    }
+    
     // variable declarations and initialization
     double lnProbTimes = 0;
     
@@ -316,6 +331,74 @@ double StateDependentSpeciationExtinctionProcess::computeLnProbability( void )
 }
 
 
+/**
+ * Solve the extinction probabilities E(t) from the present to the start of the process and store them in the table.
+ * We integrate E(t) on a grid of NUM_TIME_SLICES intervals, so that the branches
+ * can interpolate E(t) instead of integrating it again.
+ */
+void StateDependentSpeciationExtinctionProcess::computeExtinctionProbabilityTable( void ) const
+{
+    
+    extinction_probability_table.clear();
+    
+    std::vector<double> sampling_probability;
+    if ( rho != NULL && rho_per_state == NULL )
+    {
+        sampling_probability   = std::vector<double>(num_states, rho->getValue());
+    }
+    else if ( rho == NULL && rho_per_state != NULL )
+    {
+        sampling_probability   = rho_per_state->getValue();
+    }
+    else
+    {
+        throw RbException("Either a global sampling fraction or state-specific sampling fraction needs to be set.");
+    }
+    
+    std::vector<double> state = std::vector<double>(2*num_states, 0.0);
+    for (size_t i=0; i<num_states; ++i)
+    {
+        state[i] = 1.0 - sampling_probability[i];
+    }
+    
+    const std::vector<double> &extinction_rates = mu->getValue();
+    SSE_ODE ode = SSE_ODE(extinction_rates, &getEventRateMatrix(), getEventRate(), true, true, allow_rate_shifts_on_extinct_lineages);
+    if ( use_cladogenetic_events == true )
+    {
+        ode.setEventTable( &getCladogeneticEventTable() );
+    }
+    else
+    {
+        ode.setSpeciationRate( lambda->getValue() );
+    }
+    
+    if ( phi != NULL )
+    {
+        ode.setSerialSamplingRate( phi->getValue() );
+    }
+    
+    size_t num_intervals = size_t( NUM_TIME_SLICES ) < 1 ? 1 : size_t( NUM_TIME_SLICES );
+    double max_age = getOriginAge();
+    double h = max_age / num_intervals;
+    
+    std::vector<double> e = std::vector<double>(state.begin(), state.begin() + num_states);
+    extinction_probability_table.addKnot( 0.0, e );
+    for (size_t k = 1; k <= num_intervals; ++k)
+    {
+        double begin_age = (k - 1) * h;
+        double end_age   = (k == num_intervals ? max_age : k * h);
+        ode_integrators[0].integrate( ode, state, begin_age, end_age, h );
+        
+        for (size_t i = 0; i < num_states; ++i)
+        {
+            e[i] = ( state[i] < 0.0 ? 0.0 : state[i] );
+        }
+        extinction_probability_table.addKnot( end_age, e );
+    }
+    
+}
+
+
 void StateDependentSpeciationExtinctionProcess::computeNodeProbability(const RevBayesCore::TopologyNode &node, size_t node_index) const
 {
     
@@ -325,227 +408,349 @@ void StateDependentSpeciationExtinctionProcess::computeNodeProbability(const Rev
         // mark as computed
         dirty_nodes[node_index] = false;
         
-        std::vector<double> &node_likelihood  = node_partial_likelihoods[node_index][active_likelihood[node_index]];
+        if ( node.isTip() == false )
+        {
+            computeNodeProbability( node.getChild(0), node.getChild(0).getIndex() );
+            computeNodeProbability( node.getChild(1), node.getChild(1).getIndex() );
+        }
+        
+        computeBranchProbability( node, node_index, ode_integrators[0] );
+    }
+    
+}
+
+
+/**
+ * Compute the probabilities at the top of the branch above this node from the probabilities of its children, which must be up to date.
+ * We only write the probabilities and scaling factors of this node, so independent nodes can be computed concurrently
+ * as long as each thread uses its own integrator.
+ */
+void StateDependentSpeciationExtinctionProcess::computeBranchProbability(const RevBayesCore::TopologyNode &node, size_t node_index, SSE_ODEIntegrator &integrator) const
+{
+    
+    std::vector<double> &node_likelihood  = node_partial_likelihoods[node_index][active_likelihood[node_index]];
+
+    if ( node.isTip() == true )
+    {
+        // this is a tip node
+        TreeDiscreteCharacterData* tree = static_cast<TreeDiscreteCharacterData*>( this->value );
 
-        if ( node.isTip() == true )
+        std::vector<double> sampling;
+        std::vector<double> extinction;
+        if ( rho != NULL && rho_per_state == NULL )
+        {
+            sampling   = std::vector<double>(num_states, rho->getValue());
+            extinction = std::vector<double>(num_states, 1.0 - rho->getValue());
+        }
+        else if ( rho == NULL && rho_per_state != NULL )
         {
-            // this is a tip node
-            TreeDiscreteCharacterData* tree = static_cast<TreeDiscreteCharacterData*>( this->value );
+            sampling   = rho_per_state->getValue();
+            extinction = std::vector<double>(num_states, 1.0);
+            for (size_t i=0; i<num_states; ++i)
+            {
+                extinction[i] = 1.0 - sampling[i];
+            }
+        }
+        else
+        {
+            throw RbException("Either a global sampling fraction or state-specific sampling fraction needs to be set.");
+        }
 
-            std::vector<double> sampling;
-            std::vector<double> extinction;
-            if ( rho != NULL && rho_per_state == NULL )
+        if ( node.isFossil() )
+        {
+            if ( phi == NULL )
             {
-                sampling   = std::vector<double>(num_states, rho->getValue());
-                extinction = std::vector<double>(num_states, 1.0 - rho->getValue());
+                throw(RbException("Tree has serially sampled tips, but no serial sampling rate was provided."));
             }
-            else if ( rho == NULL && rho_per_state != NULL )
+            sampling = phi->getValue();
+            extinction = pExtinction(0.0, node.getAge(), integrator);
+        }
+        
+        RbBitSet obs_state(num_states, true);
+        bool gap = true;
+
+        if ( tree->hasCharacterData() == true )
+        {
+            const DiscreteCharacterState &state = tree->getCharacterData().getTaxonData( node.getTaxon().getName() )[0];
+            obs_state = state.getState();
+            gap = (state.isMissingState() == true || state.isGapState() == true);
+        }
+
+        for (size_t j = 0; j < num_states; ++j)
+        {
+            
+            node_likelihood[j] = extinction[j];
+            
+            if ( obs_state.test( j ) == true || gap == true )
             {
-                sampling   = rho_per_state->getValue();
-                extinction = std::vector<double>(num_states, 1.0);
-                for (size_t i=0; i<num_states; ++i)
-                {
-                    extinction[i] = 1.0 - sampling[i];
-                }
+            	if ( node.isFossil() )
+            	{
+            		node_likelihood[num_states+j] = sampling[j] * extinction[j];
+            	}
+            	else
+            	{
+            		node_likelihood[num_states+j] = sampling[j];
+            	}
             }
             else
             {
-                throw RbException("Either a global sampling fraction or state-specific sampling fraction needs to be set.");
+                node_likelihood[num_states+j] = 0.0;
             }
+        }
+        
+    }
+    else
+    {
+        
+        // this is an internal node
+        const TopologyNode          &left           = node.getChild(0);
+        size_t                      left_index      = left.getIndex();
+        const TopologyNode          &right          = node.getChild(1);
+        size_t                      right_index     = right.getIndex();
+        
+        // get the likelihoods of descendant nodes
+        const std::vector<double> &left_likelihoods  = node_partial_likelihoods[left_index][active_likelihood[left_index]];
+        const std::vector<double> &right_likelihoods = node_partial_likelihoods[right_index][active_likelihood[right_index]];
 
-            if ( node.isFossil() )
-            {
-                if ( phi == NULL )
-                {
-                    throw(RbException("Tree has serially sampled tips, but no serial sampling rate was provided."));
-                }
-                sampling = phi->getValue();
-                extinction = pExtinction(0.0, node.getAge());
-            }
-            
-            RbBitSet obs_state(num_states, true);
-            bool gap = true;
+        const CladogeneticEventTable* event_table = NULL;
+        std::vector<double> speciation_rates;
+        if ( use_cladogenetic_events == true )
+        {
+            // get the compiled cladogenesis event map (sparse speciation rate matrix)
+            event_table = &getCladogeneticEventTable();
+        }
+        else
+        {
+            speciation_rates = lambda->getValue();
+        }
+        
+        bool speciation_node = true;
+        if ( left.isSampledAncestor() || right.isSampledAncestor() )
+        {
+            speciation_node = (phi == NULL);
+        }
 
-            if ( tree->hasCharacterData() == true )
-            {
-                const DiscreteCharacterState &state = tree->getCharacterData().getTaxonData( node.getTaxon().getName() )[0];
-                obs_state = state.getState();
-                gap = (state.isMissingState() == true || state.isGapState() == true);
-            }
+        // merge descendant likelihoods
+        for (size_t i=0; i<num_states; ++i)
+        {
+            node_likelihood[i] = left_likelihoods[i];
 
-            for (size_t j = 0; j < num_states; ++j)
+            if ( use_cladogenetic_events == true && speciation_node == true )
             {
                 
-                node_likelihood[j] = extinction[j];
-                
-                if ( obs_state.test( j ) == true || gap == true )
+                double like_sum = 0.0;
+                for (size_t k = event_table->ancestor_offsets[i]; k < event_table->ancestor_offsets[i+1]; ++k)
                 {
-                	if ( node.isFossil() )
-                	{
-                		node_likelihood[num_states+j] = sampling[j] * extinction[j];
-                	}
-                	else
-                	{
-                		node_likelihood[num_states+j] = sampling[j];
-                	}
-                }
-                else
-                {
-                    node_likelihood[num_states+j] = 0.0;
+                    double likelihoods = left_likelihoods[num_states + event_table->ancestor_daughter_1[k]] * right_likelihoods[num_states + event_table->ancestor_daughter_2[k]];
+                    like_sum += event_table->ancestor_rate[k] * likelihoods;
                 }
+                node_likelihood[num_states + i] = like_sum;
+                
+            }
+            else
+            {
+                node_likelihood[num_states + i] = left_likelihoods[num_states + i] * right_likelihoods[num_states + i];
+                node_likelihood[num_states + i] *= speciation_node ? speciation_rates[i] : 1.0;
             }
-            
+        }
+        
+    }
+    
+    double begin_age = node.getAge();
+    double end_age = node.getParent().getAge();
+    
+    if ( node.isSampledAncestor() == false )
+    {
+        // calculate likelihoods for this branch
+        if ( sample_character_history == false )
+        {
+            // numerically integrate over the entire branch length
+            numericallyIntegrateProcess(node_likelihood, begin_age, end_age, true, false, integrator);
         }
         else
         {
-            
-            // this is an internal node
-            const TopologyNode          &left           = node.getChild(0);
-            size_t                      left_index      = left.getIndex();
-            computeNodeProbability( left, left_index );
-            const TopologyNode          &right          = node.getChild(1);
-            size_t                      right_index     = right.getIndex();
-            computeNodeProbability( right, right_index );
-            
-            // get the likelihoods of descendant nodes
-            const std::vector<double> &left_likelihoods  = node_partial_likelihoods[left_index][active_likelihood[left_index]];
-            const std::vector<double> &right_likelihoods = node_partial_likelihoods[right_index][active_likelihood[right_index]];
+            // calculate the conditional likelihoods for each time slice moving
+            // along this branch backwards in time from the tip towards the root
 
-            std::map<std::vector<unsigned>, double> eventMap;
-            std::vector<double> speciation_rates;
-            if ( use_cladogenetic_events == true )
-            {
-                // get cladogenesis event map (sparse speciation rate matrix)
-                eventMap = cladogenesis_matrix->getValue().getEventMap();
-            }
-            else
-            {
-                speciation_rates = lambda->getValue();
-            }
+            std::vector<std::vector<double> > branch_likelihoods;
+            size_t current_dt = 0;
             
-            bool speciation_node = true;
-            if ( left.isSampledAncestor() || right.isSampledAncestor() )
+            // calculate partial likelihoods for each time slice and store them in branch_likelihoods
+            while ( (current_dt * dt) + begin_age < end_age )
             {
-                speciation_node = (phi == NULL);
-            }
 
-            // merge descendant likelihoods
-            for (size_t i=0; i<num_states; ++i)
-            {
-                node_likelihood[i] = left_likelihoods[i];
+                std::vector<double> dt_likelihood;
 
-                if ( use_cladogenetic_events == true && speciation_node == true )
-                {
-                    
-                    double like_sum = 0.0;
-                    std::map<std::vector<unsigned>, double>::iterator it;
-                    for (it = eventMap.begin(); it != eventMap.end(); it++)
-                    {
-                        const std::vector<unsigned>& states = it->first;
-                        double speciation_rate = it->second;
-                        if (i == states[0])
-                        {
-                            double likelihoods = left_likelihoods[num_states + states[1]] * right_likelihoods[num_states + states[2]];
-                            like_sum += speciation_rate * likelihoods;
-                        }
-                    }
-                    node_likelihood[num_states + i] = like_sum;
-                    
-                }
-                else
+                double current_dt_start = (current_dt * dt) + begin_age;
+                double current_dt_end = ((current_dt + 1) * dt) + begin_age;
+                if (current_dt_end > end_age)
                 {
-                    node_likelihood[num_states + i] = left_likelihoods[num_states + i] * right_likelihoods[num_states + i];
-                    node_likelihood[num_states + i] *= speciation_node ? speciation_rates[i] : 1.0;
+                    current_dt_end = end_age;
                 }
+                numericallyIntegrateProcess(node_likelihood, current_dt_start, current_dt_end, true, false, integrator);
+
+                std::vector<double>::const_iterator first = node_likelihood.begin() + num_states;
+                std::vector<double>::const_iterator last = node_likelihood.begin() + (num_states * 2);
+                dt_likelihood = std::vector<double>(first, last);
+
+                branch_likelihoods.push_back(dt_likelihood);
+                current_dt++;
+
             }
             
+            // save the branch conditional likelihoods
+            branch_partial_likelihoods[node_index] = branch_likelihoods;
         }
-        
-        double begin_age = node.getAge();
-        double end_age = node.getParent().getAge();
-        
-        if ( node.isSampledAncestor() == false )
+    }
+    
+    if ( RbSettings::userSettings().getUseScaling() == true ) //&& node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+    {
+        // rescale the conditional likelihoods at the "end" of the branch
+        double max = 0.0;
+        for (size_t i=0; i<num_states; ++i)
         {
-            // calculate likelihoods for this branch
-            if ( sample_character_history == false )
+            if ( node_likelihood[num_states+i] > max )
             {
-                // numerically integrate over the entire branch length
-                numericallyIntegrateProcess(node_likelihood, begin_age, end_age, true, false);
+                max = node_likelihood[num_states+i];
             }
-            else
-            {
-                // calculate the conditional likelihoods for each time slice moving
-                // along this branch backwards in time from the tip towards the root
-
-                std::vector<std::vector<double> > branch_likelihoods;
-                size_t current_dt = 0;
-                
-                // calculate partial likelihoods for each time slice and store them in branch_likelihoods
-                while ( (current_dt * dt) + begin_age < end_age )
-                {
-
-                    std::vector<double> dt_likelihood;
+        }
+//            max *= num_states;
+        
+        for (size_t i=0; i<num_states; ++i)
+        {
+            node_likelihood[num_states+i] /= max;
+        }
 
-                    double current_dt_start = (current_dt * dt) + begin_age;
-                    double current_dt_end = ((current_dt + 1) * dt) + begin_age;
-                    if (current_dt_end > end_age)
-                    {
-                        current_dt_end = end_age;
-                    }
-                    numericallyIntegrateProcess(node_likelihood, current_dt_start, current_dt_end, true, false);
+        scaling_factors[node_index][active_likelihood[node_index]] = log(max);
 
-                    std::vector<double>::const_iterator first = node_likelihood.begin() + num_states;
-                    std::vector<double>::const_iterator last = node_likelihood.begin() + (num_states * 2);
-                    dt_likelihood = std::vector<double>(first, last);
+        if ( node.isTip() == false )
+        {
+            const TopologyNode          &left           = node.getChild(0);
+            size_t                      left_index      = left.getIndex();
+            const TopologyNode          &right          = node.getChild(1);
+            size_t                      right_index     = right.getIndex();
+            scaling_factors[node_index][active_likelihood[node_index]] += scaling_factors[left_index][active_likelihood[left_index]] + scaling_factors[right_index][active_likelihood[right_index]];
+        }
+        
+    }
+}
 
-                    branch_likelihoods.push_back(dt_likelihood);
-                    current_dt++;
 
-                }
-                
-                // save the branch conditional likelihoods
-                branch_partial_likelihoods[node_index] = branch_likelihoods;
-            }
-        }
+/**
+ * Compute the probabilities of all dirty nodes below the root before the recursion in computeRootLikelihood() visits them.
+ * The branch of a node only depends on the subtrees of its children, so we group the dirty nodes by their height
+ * (the number of dirty nodes on the longest path down to a tip) and compute all nodes of the same height in parallel.
+ * Every node is computed by the same code no matter which thread runs it, so the result does not depend on the number of threads.
+ */
+void StateDependentSpeciationExtinctionProcess::computeDirtyNodeProbabilities( void ) const
+{
+    
+    ThreadPool &pool = ThreadPool::threadPoolInstance();
+    size_t num_threads = pool.getNumberOfThreads();
+    
+    // the recursion recomputes all nodes anyway if we sample the character history
+    if ( num_threads < 2 || pool.isInsideParallelRegion() == true || sample_character_history == true )
+    {
+        return;
+    }
+    
+    // the threads share the parameter values and the compiled event map, so we let all deterministic parameters update their values now
+    // getValue() of a deterministic node updates its value lazily, which must not happen on several threads at the same time
+    getOriginAge();
+    mu->getValue();
+    getEventRate();
+    if ( pi != NULL )
+    {
+        pi->getValue();
+    }
+    getEventRateMatrix();
+    if ( lambda != NULL )
+    {
+        lambda->getValue();
+    }
+    if ( phi != NULL )
+    {
+        phi->getValue();
+    }
+    if ( rho != NULL )
+    {
+        rho->getValue();
+    }
+    if ( rho_per_state != NULL )
+    {
+        rho_per_state->getValue();
+    }
+    if ( use_cladogenetic_events == true )
+    {
+        getCladogeneticEventTable();
+    }
+    
+    // every thread needs its own integrator
+    while ( ode_integrators.size() < num_threads )
+    {
+        ode_integrators.push_back( ode_integrators[0] );
+        ode_integrators.back().resetStepCounts();
+    }
+    
+    std::vector< std::vector<const TopologyNode*> > nodes_by_height;
+    const TopologyNode &root = value->getRoot();
+    for (size_t i = 0; i < root.getNumberOfChildren(); ++i)
+    {
+        collectDirtyNodes( root.getChild(i), nodes_by_height );
+    }
+    
+    for (size_t h = 0; h < nodes_by_height.size(); ++h)
+    {
+        const std::vector<const TopologyNode*> &nodes = nodes_by_height[h];
+        size_t num_jobs = std::min( nodes.size(), num_threads );
         
-        if ( RbSettings::userSettings().getUseScaling() == true ) //&& node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+        pool.parallelFor( num_jobs, [&](size_t job)
         {
-            // rescale the conditional likelihoods at the "end" of the branch
-            double max = 0.0;
-            for (size_t i=0; i<num_states; ++i)
+            for (size_t i = job; i < nodes.size(); i += num_jobs)
             {
-                if ( node_likelihood[num_states+i] > max )
-                {
-                    max = node_likelihood[num_states+i];
-                }
-            }
-//            max *= num_states;
-            
-            for (size_t i=0; i<num_states; ++i)
-            {
-                node_likelihood[num_states+i] /= max;
+                computeBranchProbability( *nodes[i], nodes[i]->getIndex(), ode_integrators[job] );
             }
+        });
+    }
+    
+}
 
-            scaling_factors[node_index][active_likelihood[node_index]] = log(max);
 
-            if ( node.isTip() == false )
-            {
-                const TopologyNode          &left           = node.getChild(0);
-                size_t                      left_index      = left.getIndex();
-                const TopologyNode          &right          = node.getChild(1);
-                size_t                      right_index     = right.getIndex();
-                scaling_factors[node_index][active_likelihood[node_index]] += scaling_factors[left_index][active_likelihood[left_index]] + scaling_factors[right_index][active_likelihood[right_index]];
-            }
-            
-        }
-        
+/**
+ * Add the dirty nodes of this subtree to the list of their height and mark them as computed.
+ * Returns the height of the node, i.e., 0 for a clean node.
+ */
+size_t StateDependentSpeciationExtinctionProcess::collectDirtyNodes(const TopologyNode &node, std::vector< std::vector<const TopologyNode*> > &nodes_by_height) const
+{
+    
+    size_t node_index = node.getIndex();
+    if ( dirty_nodes[node_index] == false )
+    {
+        return 0;
+    }
+    dirty_nodes[node_index] = false;
+    
+    size_t height = 0;
+    for (size_t i = 0; i < node.getNumberOfChildren(); ++i)
+    {
+        height = std::max( height, collectDirtyNodes( node.getChild(i), nodes_by_height ) );
     }
     
+    if ( nodes_by_height.size() <= height )
+    {
+        nodes_by_height.resize( height + 1 );
+    }
+    nodes_by_height[height].push_back( &node );
+    
+    return height + 1;
 }
 
 
 double StateDependentSpeciationExtinctionProcess::computeRootLikelihood( void ) const
 {
+    // compute the dirty subtrees in parallel (if we have several threads)
+    computeDirtyNodeProbabilities();
+    
     // get the likelihoods of descendant nodes
     const TopologyNode     &root            = value->getRoot();
     size_t                  node_index      = root.getIndex();
@@ -562,12 +767,12 @@ double StateDependentSpeciationExtinctionProcess::computeRootLikelihood( void )
 
     std::vector<double> &node_likelihood  = node_partial_likelihoods[node_index][active_likelihood[node_index]];
 
-    std::map<std::vector<unsigned>, double> eventMap;
+    const CladogeneticEventTable* event_table = NULL;
     std::vector<double> speciation_rates;
     if ( use_cladogenetic_events == true )
     {
-        // get cladogenesis event map (sparse speciation rate matrix)
-        eventMap = cladogenesis_matrix->getValue().getEventMap();
+        // get the compiled cladogenesis event map (sparse speciation rate matrix)
+        event_table = &getCladogeneticEventTable();
     }
     else
     {
@@ -589,16 +794,10 @@ double StateDependentSpeciationExtinctionProcess::computeRootLikelihood( void )
         {
 
             double like_sum = 0.0;
-            std::map<std::vector<unsigned>, double>::iterator it;
-            for (it = eventMap.begin(); it != eventMap.end(); it++)
+            for (size_t k = event_table->ancestor_offsets[i]; k < event_table->ancestor_offsets[i+1]; ++k)
             {
-                const std::vector<unsigned>& states = it->first;
-                double speciation_rate = it->second;
-                if (i == states[0])
-                {
-                    double likelihoods = left_likelihoods[num_states + states[1]] * right_likelihoods[num_states + states[2]];
-                    like_sum += speciation_rate * likelihoods;
-                }
+                double likelihoods = left_likelihoods[num_states + event_table->ancestor_daughter_1[k]] * right_likelihoods[num_states + event_table->ancestor_daughter_2[k]];
+                like_sum += event_table->ancestor_rate[k] * likelihoods;
             }
             node_likelihood[num_states + i] = like_sum;
 
@@ -1544,6 +1743,10 @@ void StateDependentSpeciationExtinctionProcess::executeMethod(const std::string
     {
         rv = num_shift_events;
     }
+    else if ( name == "numberODESteps" )
+    {
+        rv = getNumberOfODESteps();
+    }
     else
     {
         throw RbException("The state dependent birth-death process does not have a member method called '" + name + "'.");
@@ -1590,6 +1793,23 @@ void StateDependentSpeciationExtinctionProcess::getAffected(RbOrderedSet<DagNode
 }
 
 
+/**
+ * Get the compiled table of the cladogenetic events.
+ * We only compile the event map again if the cladogenesis matrix may have changed since the last time.
+ */
+const CladogeneticEventTable& StateDependentSpeciationExtinctionProcess::getCladogeneticEventTable(void) const
+{
+
+    if ( clado_event_table_dirty == true )
+    {
+        clado_event_table.compile( cladogenesis_matrix->getValue().getEventMap(), num_states );
+        clado_event_table_dirty = false;
+    }
+
+    return clado_event_table;
+}
+
+
 /**
  * Get the event rate
  */
@@ -1626,6 +1846,24 @@ const RateGenerator& StateDependentSpeciationExtinctionProcess::getEventRateMatr
 }
 
 
+/**
+ * The number of accepted, rejected and implicit (stiff) steps of the ODE integrator during the last likelihood computation.
+ */
+RbVector<long> StateDependentSpeciationExtinctionProcess::getNumberOfODESteps( void ) const
+{
+    
+    RbVector<long> steps( 3, 0 );
+    for (size_t i = 0; i < ode_integrators.size(); ++i)
+    {
+        steps[0] += long( ode_integrators[i].getNumberOfSteps() );
+        steps[1] += long( ode_integrators[i].getNumberOfRejectedSteps() );
+        steps[2] += long( ode_integrators[i].getNumberOfStiffSteps() );
+    }
+    
+    return steps;
+}
+
+
 double StateDependentSpeciationExtinctionProcess::getOriginAge( void ) const
 {
 
@@ -1740,6 +1978,13 @@ double StateDependentSpeciationExtinctionProcess::lnProbTreeShape(void) const
 std::vector<double> StateDependentSpeciationExtinctionProcess::pExtinction(double start, double end) const
 {
     
+    return pExtinction(start, end, ode_integrators[0]);
+}
+
+
+std::vector<double> StateDependentSpeciationExtinctionProcess::pExtinction(double start, double end, SSE_ODEIntegrator &integrator) const
+{
+    
     
     std::vector<double> sampling_probability;
     if ( rho != NULL && rho_per_state == NULL )
@@ -1762,7 +2007,7 @@ std::vector<double> StateDependentSpeciationExtinctionProcess::pExtinction(doubl
         initial_state[num_states + i] = sampling_probability[i];
     }
     
-    numericallyIntegrateProcess(initial_state, start, end, true, false);
+    numericallyIntegrateProcess(initial_state, start, end, true, false, integrator);
     
     return initial_state;
 }
@@ -1869,6 +2114,13 @@ void StateDependentSpeciationExtinctionProcess::redrawValue( void )
 void StateDependentSpeciationExtinctionProcess::restoreSpecialization(const DagNode *affecter)
 {
     
+    // the cladogenetic events and the extinction probabilities change with any parameter except the tree
+    if ( affecter != this->dag_node )
+    {
+        clado_event_table_dirty = true;
+        extinction_probability_table.clear();
+    }
+    
     if ( affecter == process_age )
     {
         if ( use_origin == false )
@@ -1914,6 +2166,7 @@ void StateDependentSpeciationExtinctionProcess::setCladogenesisMatrix(const Type
     
     // set the value
     cladogenesis_matrix = cm;
+    clado_event_table_dirty = true;
     
     // should we use the event map for the speciation rates?
     use_cladogenetic_events = true;
@@ -2024,6 +2277,18 @@ void StateDependentSpeciationExtinctionProcess::setSpeciationRates(const TypedDa
 }
 
 
+/**
+ * Set whether we solve the extinction probabilities once per likelihood computation and interpolate them along the branches.
+ */
+void StateDependentSpeciationExtinctionProcess::setUseExtinctionProbabilityTable( bool tf )
+{
+    
+    use_extinction_probability_table = tf;
+    extinction_probability_table.clear();
+    
+}
+
+
 void StateDependentSpeciationExtinctionProcess::setNumberOfTimeSlices( double n )
 {
     
@@ -3143,6 +3408,7 @@ void StateDependentSpeciationExtinctionProcess::swapParameterInternal(const DagN
     if ( oldP == cladogenesis_matrix )
     {
         cladogenesis_matrix = static_cast<const TypedDagNode<CladogeneticSpeciationRateMatrix>* >( newP );
+        clado_event_table_dirty = true;
     }
     
 }
@@ -3156,6 +3422,13 @@ void StateDependentSpeciationExtinctionProcess::swapParameterInternal(const DagN
 void StateDependentSpeciationExtinctionProcess::touchSpecialization(const DagNode *affecter, bool touchAll)
 {
     
+    // the cladogenetic events and the extinction probabilities change with any parameter except the tree
+    if ( affecter != this->dag_node )
+    {
+        clado_event_table_dirty = true;
+        extinction_probability_table.clear();
+    }
+    
     if ( affecter == process_age )
     {
         if ( use_origin == false)
@@ -3195,17 +3468,23 @@ void StateDependentSpeciationExtinctionProcess::touchSpecialization(const DagNod
  * Wrapper function for the ODE time stepper function.
  */
 void StateDependentSpeciationExtinctionProcess::numericallyIntegrateProcess(std::vector< double > &likelihoods, double begin_age, double end_age, bool backward_time, bool extinction_only) const
+{
+    
+    numericallyIntegrateProcess(likelihoods, begin_age, end_age, backward_time, extinction_only, ode_integrators[0]);
+}
+
+
+/**
+ * Integrate the ODE with the given integrator, so that several threads can integrate different branches.
+ */
+void StateDependentSpeciationExtinctionProcess::numericallyIntegrateProcess(std::vector< double > &likelihoods, double begin_age, double end_age, bool backward_time, bool extinction_only, SSE_ODEIntegrator &integrator) const
 {
     const std::vector<double> &extinction_rates = mu->getValue();
     SSE_ODE ode = SSE_ODE(extinction_rates, &getEventRateMatrix(), getEventRate(), backward_time, extinction_only, allow_rate_shifts_on_extinct_lineages);
     if ( use_cladogenetic_events == true )
     {
-        cladogenesis_matrix->getValue(); // we must call getValue() to update the speciation and extinction rates in the event map
-        
-        // get cladogenesis event map (sparse speciation rate matrix)
-        std::map<std::vector<unsigned>, double> event_map = cladogenesis_matrix->getValue().getEventMap();
-        
-        ode.setEventMap( event_map );
+        // get the compiled cladogenesis event map (sparse speciation rate matrix)
+        ode.setEventTable( &getCladogeneticEventTable() );
     }
     else
     {
@@ -3219,11 +3498,21 @@ void StateDependentSpeciationExtinctionProcess::numericallyIntegrateProcess(std:
         ode.setSerialSamplingRate( serial_sampling_rates );
     }
     
-   
-    typedef boost::numeric::odeint::runge_kutta_dopri5< std::vector< double > > stepper_type;
-
-//    boost::numeric::odeint::integrate_adaptive( make_controlled( 1E-7, 1E-7, stepper_type() ) , ode , likelihoods , begin_age , end_age , dt );
-    boost::numeric::odeint::integrate_adaptive( stepper_type(), ode , likelihoods , begin_age , end_age , dt );
+    if ( backward_time == true && extinction_only == false && extinction_probability_table.covers( begin_age ) == true && extinction_probability_table.covers( end_age ) == true )
+    {
+        // the extinction probabilities are the same on every branch, so we only integrate the observation probabilities
+        ode.setExtinctionProbabilities( &extinction_probability_table );
+        
+        std::vector<double> observation_probs( likelihoods.begin() + num_states, likelihoods.end() );
+        integrator.integrate( ode, observation_probs, begin_age, end_age, dt );
+        
+        extinction_probability_table.interpolate( end_age, &likelihoods[0] );
+        std::copy( observation_probs.begin(), observation_probs.end(), likelihoods.begin() + num_states );
+    }
+    else
+    {
+        integrator.integrate( ode, likelihoods, begin_age, end_age, dt );
+    }
     
     // catch negative extinction probabilities that can result from
     // rounding errors in the ODE stepper
@@ -22,6 +22,7 @@
 #include "RbMathCombinatorialFunctions.h"
 #include "RlString.h"
 #include "StochasticNode.h"
+#include "ThreadPool.h"
 #include "TopologyNode.h"
 #include "AbstractDiscreteTaxonData.h"
 #include "AbstractTaxonData.h"
@@ -45,7 +46,6 @@
 #include "TreeDiscreteCharacterData.h"
 #include "TypedDagNode.h"
 #include "TypedDistribution.h"
-#include "boost/numeric/odeint.hpp" // IWYU pragma: keep
 
 namespace RevBayesCore { class DagNode; }
 namespace RevBayesCore { template <class valueType> class RbOrderedSet; }
@@ -81,6 +81,9 @@ TimeVaryingStateDependentSpeciationExtinctionProcess::TimeVaryingStateDependentS
     num_states( p->getValue().size() ),
     scaling_factors( std::vector<std::vector<double> >(5, std::vector<double>(2,0.0) ) ),
     use_cladogenetic_events( false ),
+    clado_event_table_dirty( true ),
+    use_extinction_probability_table( false ),
+    ode_integrators( 1, SSE_ODEIntegrator( 1E-6, 1E-6 ) ),
     use_origin( uo ),
     sample_character_history( false ),
     average_speciation( std::vector<double>(5, 0.0) ),
@@ -301,6 +304,18 @@ double TimeVaryingStateDependentSpeciationExtinctionProcess::computeLnProbabilit
         resizeVectors(value->getNumberOfNodes());
     }
     
+    // count the ODE steps of this likelihood computation
+    for (size_t i = 0; i < ode_integrators.size(); ++i)
+    {
+        ode_integrators[i].resetStepCounts();
+    }
+    
+    // solve the extinction probabilities once for all branches
+    if ( use_extinction_probability_table == true )
+    {
+        computeExtinctionProbabilityTable();
+    }
+    
     // variable declarations and initialization
     double lnProbTimes = 0;
     
@@ -346,6 +361,68 @@ double TimeVaryingStateDependentSpeciationExtinctionProcess::computeEpochEnd(siz
 }
 
 
+/**
+ * Solve the extinction probabilities E(t) from the present to the start of the process and store them in the table.
+ * We integrate E(t) on a grid of NUM_TIME_SLICES intervals, so that the branches can interpolate E(t) instead of integrating it again.
+ * The epoch boundaries are added as breaks, because the derivatives of E(t) jump when the rates change.
+ */
+void TimeVaryingStateDependentSpeciationExtinctionProcess::computeExtinctionProbabilityTable( void ) const
+{
+    
+    extinction_probability_table.clear();
+    
+    double sampling_probability = rho->getValue();
+    std::vector<double> state = std::vector<double>(2*num_states, 0.0);
+    for (size_t i=0; i<num_states; ++i)
+    {
+        state[i] = 1.0 - sampling_probability;
+    }
+    
+    size_t num_intervals = size_t( NUM_TIME_SLICES ) < 1 ? 1 : size_t( NUM_TIME_SLICES );
+    double max_age = getOriginAge();
+    double h = max_age / num_intervals;
+    
+    const RbVector<double> &times = epoch_times->getValue();
+    size_t index_epoch = 0;
+    while ( index_epoch < times.size() && times[index_epoch] <= 0.0 )
+    {
+        ++index_epoch;
+    }
+    
+    std::vector<double> e = std::vector<double>(state.begin(), state.begin() + num_states);
+    extinction_probability_table.addKnot( 0.0, e );
+    double begin_age = 0.0;
+    size_t k = 1;
+    while ( begin_age < max_age )
+    {
+        // the next knot is either the next grid point or the next epoch boundary
+        double end_age = ( k == num_intervals ? max_age : k * h );
+        bool is_break = false;
+        if ( index_epoch < times.size() && times[index_epoch] <= end_age )
+        {
+            is_break = true;
+            end_age = times[index_epoch];
+            ++index_epoch;
+        }
+        
+        if ( end_age > begin_age )
+        {
+            numericallyIntegrateProcess( state, begin_age, end_age, true, true );
+            
+            e.assign( state.begin(), state.begin() + num_states );
+            extinction_probability_table.addKnot( end_age, e, is_break );
+            begin_age = end_age;
+        }
+        
+        if ( end_age >= k * h && k < num_intervals )
+        {
+            ++k;
+        }
+    }
+    
+}
+
+
 void TimeVaryingStateDependentSpeciationExtinctionProcess::computeNodeProbability(const RevBayesCore::TopologyNode &node, size_t node_index) const
 {
     
@@ -355,210 +432,336 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::computeNodeProbabilit
         // mark as computed
         dirty_nodes[node_index] = false;
         
-        std::vector<double> &node_likelihood  = node_partial_likelihoods[node_index][active_likelihood[node_index]];
+        if ( node.isTip() == false )
+        {
+            computeNodeProbability( node.getChild(0), node.getChild(0).getIndex() );
+            computeNodeProbability( node.getChild(1), node.getChild(1).getIndex() );
+        }
         
-        if ( node.isTip() == true )
+        computeBranchProbability( node, node_index, ode_integrators[0] );
+    }
+    
+}
+
+
+/**
+ * Compute the probabilities at the top of the branch above this node from the probabilities of its children, which must be up to date.
+ * We only write the probabilities and scaling factors of this node, so independent nodes can be computed concurrently
+ * as long as each thread uses its own integrator.
+ */
+void TimeVaryingStateDependentSpeciationExtinctionProcess::computeBranchProbability(const RevBayesCore::TopologyNode &node, size_t node_index, SSE_ODEIntegrator &integrator) const
+{
+    
+    std::vector<double> &node_likelihood  = node_partial_likelihoods[node_index][active_likelihood[node_index]];
+    
+    if ( node.isTip() == true )
+    {
+        // this is a tip node
+        TreeDiscreteCharacterData* tree = static_cast<TreeDiscreteCharacterData*>( this->value );
+        
+        std::vector<double> sampling(num_states, rho->getValue());
+        std::vector<double> extinction(num_states, 1.0 - rho->getValue());
+        
+        size_t index_epoch = computeEpochIndex( node.getAge() );
+        
+        if ( node.isFossil() )
         {
-            // this is a tip node
-            TreeDiscreteCharacterData* tree = static_cast<TreeDiscreteCharacterData*>( this->value );
-            
-            std::vector<double> sampling(num_states, rho->getValue());
-            std::vector<double> extinction(num_states, 1.0 - rho->getValue());
-            
-            size_t index_epoch = computeEpochIndex( node.getAge() );
-            
-            if ( node.isFossil() )
+            if ( phi == NULL )
             {
-                if ( phi == NULL )
-                {
-                    throw(RbException("Tree has serially sampled tips, but no serial sampling rate was provided."));
-                }
-                sampling = phi->getValue()[index_epoch];
-                extinction = pExtinction(0.0, node.getAge());
+                throw(RbException("Tree has serially sampled tips, but no serial sampling rate was provided."));
             }
+            sampling = phi->getValue()[index_epoch];
+            extinction = pExtinction(0.0, node.getAge(), integrator);
+        }
+        
+        RbBitSet obs_state(num_states, true);
+        bool gap = true;
+        
+        if ( tree->hasCharacterData() == true )
+        {
+            const DiscreteCharacterState &state = tree->getCharacterData().getTaxonData( node.getTaxon().getName() )[0];
+            obs_state = state.getState();
+            gap = (state.isMissingState() == true || state.isGapState() == true);
+        }
+        
+        for (size_t j = 0; j < num_states; ++j)
+        {
             
-            RbBitSet obs_state(num_states, true);
-            bool gap = true;
+            node_likelihood[j] = extinction[j];
             
-            if ( tree->hasCharacterData() == true )
+            if ( obs_state.test( j ) == true || gap == true )
             {
-                const DiscreteCharacterState &state = tree->getCharacterData().getTaxonData( node.getTaxon().getName() )[0];
-                obs_state = state.getState();
-                gap = (state.isMissingState() == true || state.isGapState() == true);
+            	if ( node.isFossil() )
+            	{
+            		node_likelihood[num_states+j] = sampling[j] * extinction[j];
+            	}
+            	else
+            	{
+            		node_likelihood[num_states+j] = sampling[j];
+            	}
             }
-            
-            for (size_t j = 0; j < num_states; ++j)
+            else
             {
-                
-                node_likelihood[j] = extinction[j];
-                
-                if ( obs_state.test( j ) == true || gap == true )
-                {
-                	if ( node.isFossil() )
-                	{
-                		node_likelihood[num_states+j] = sampling[j] * extinction[j];
-                	}
-                	else
-                	{
-                		node_likelihood[num_states+j] = sampling[j];
-                	}
-                }
-                else
-                {
-                    node_likelihood[num_states+j] = 0.0;
-                }
+                node_likelihood[num_states+j] = 0.0;
             }
-            
+        }
+        
+    }
+    else
+    {
+        
+        // this is an internal node
+        const TopologyNode          &left           = node.getChild(0);
+        size_t                      left_index      = left.getIndex();
+        const TopologyNode          &right          = node.getChild(1);
+        size_t                      right_index     = right.getIndex();
+        
+        // get the likelihoods of descendant nodes
+        const std::vector<double> &left_likelihoods  = node_partial_likelihoods[left_index][active_likelihood[left_index]];
+        const std::vector<double> &right_likelihoods = node_partial_likelihoods[right_index][active_likelihood[right_index]];
+        
+        const CladogeneticEventTable* event_table = NULL;
+        std::vector<double> speciation_rates;
+        if ( use_cladogenetic_events == true )
+        {
+            // get the compiled cladogenesis event map (sparse speciation rate matrix)
+            event_table = &getCladogeneticEventTable();
         }
         else
         {
+            size_t index_epoch = computeEpochIndex( node.getAge() );
+            speciation_rates = lambda->getValue()[index_epoch];
+        }
+        
+        bool speciation_node = true;
+        if ( left.isSampledAncestor() || right.isSampledAncestor() )
+        {
+            speciation_node = (phi == NULL);
+        }
+        
+        // merge descendant likelihoods
+        for (size_t i=0; i<num_states; ++i)
+        {
+            node_likelihood[i] = left_likelihoods[i];
             
-            // this is an internal node
-            const TopologyNode          &left           = node.getChild(0);
-            size_t                      left_index      = left.getIndex();
-            computeNodeProbability( left, left_index );
-            const TopologyNode          &right          = node.getChild(1);
-            size_t                      right_index     = right.getIndex();
-            computeNodeProbability( right, right_index );
-            
-            // get the likelihoods of descendant nodes
-            const std::vector<double> &left_likelihoods  = node_partial_likelihoods[left_index][active_likelihood[left_index]];
-            const std::vector<double> &right_likelihoods = node_partial_likelihoods[right_index][active_likelihood[right_index]];
-            
-            std::map<std::vector<unsigned>, double> eventMap;
-            std::vector<double> speciation_rates;
-            if ( use_cladogenetic_events == true )
+            if ( use_cladogenetic_events == true && speciation_node == true )
             {
-                // get cladogenesis event map (sparse speciation rate matrix)
-                eventMap = cladogenesis_matrix->getValue().getEventMap();
+                
+                double like_sum = 0.0;
+                for (size_t k = event_table->ancestor_offsets[i]; k < event_table->ancestor_offsets[i+1]; ++k)
+                {
+                    double likelihoods = left_likelihoods[num_states + event_table->ancestor_daughter_1[k]] * right_likelihoods[num_states + event_table->ancestor_daughter_2[k]];
+                    like_sum += event_table->ancestor_rate[k] * likelihoods;
+                }
+                node_likelihood[num_states + i] = like_sum;
+                
             }
             else
             {
-                size_t index_epoch = computeEpochIndex( node.getAge() );
-                speciation_rates = lambda->getValue()[index_epoch];
+                node_likelihood[num_states + i] = left_likelihoods[num_states + i] * right_likelihoods[num_states + i];
+                node_likelihood[num_states + i] *= speciation_node ? speciation_rates[i] : 1.0;
             }
+        }
+        
+    }
+    
+    double begin_age = node.getAge();
+    double end_age = node.getParent().getAge();
+    
+    if ( node.isSampledAncestor() == false )
+    {
+        // calculate likelihoods for this branch
+        if ( sample_character_history == false )
+        {
+            // numerically integrate over the entire branch length
+            numericallyIntegrateProcess(node_likelihood, begin_age, end_age, true, false, integrator);
+        }
+        else
+        {
+            // calculate the conditional likelihoods for each time slice moving
+            // along this branch backwards in time from the tip towards the root
             
-            bool speciation_node = true;
-            if ( left.isSampledAncestor() || right.isSampledAncestor() )
-            {
-                speciation_node = (phi == NULL);
-            }
+            std::vector<std::vector<double> > branch_likelihoods;
+            size_t current_dt = 0;
             
-            // merge descendant likelihoods
-            for (size_t i=0; i<num_states; ++i)
+            // calculate partial likelihoods for each time slice and store them in branch_likelihoods
+            while ( (current_dt * dt) + begin_age < end_age )
             {
-                node_likelihood[i] = left_likelihoods[i];
                 
-                if ( use_cladogenetic_events == true && speciation_node == true )
-                {
-                    
-                    double like_sum = 0.0;
-                    std::map<std::vector<unsigned>, double>::iterator it;
-                    for (it = eventMap.begin(); it != eventMap.end(); it++)
-                    {
-                        const std::vector<unsigned>& states = it->first;
-                        double speciation_rate = it->second;
-                        if (i == states[0])
-                        {
-                            double likelihoods = left_likelihoods[num_states + states[1]] * right_likelihoods[num_states + states[2]];
-                            like_sum += speciation_rate * likelihoods;
-                        }
-                    }
-                    node_likelihood[num_states + i] = like_sum;
-                    
-                }
-                else
+                std::vector<double> dt_likelihood;
+                
+                double current_dt_start = (current_dt * dt) + begin_age;
+                double current_dt_end = ((current_dt + 1) * dt) + begin_age;
+                if (current_dt_end > end_age)
                 {
-                    node_likelihood[num_states + i] = left_likelihoods[num_states + i] * right_likelihoods[num_states + i];
-                    node_likelihood[num_states + i] *= speciation_node ? speciation_rates[i] : 1.0;
+                    current_dt_end = end_age;
                 }
+                numericallyIntegrateProcess(node_likelihood, current_dt_start, current_dt_end, true, false, integrator);
+                
+                std::vector<double>::const_iterator first = node_likelihood.begin() + num_states;
+                std::vector<double>::const_iterator last = node_likelihood.begin() + (num_states * 2);
+                dt_likelihood = std::vector<double>(first, last);
+                
+                branch_likelihoods.push_back(dt_likelihood);
+                current_dt++;
+                
             }
             
+            // save the branch conditional likelihoods
+            branch_partial_likelihoods[node_index] = branch_likelihoods;
         }
-        
-        double begin_age = node.getAge();
-        double end_age = node.getParent().getAge();
-        
-        if ( node.isSampledAncestor() == false )
+    }
+    
+    if ( RbSettings::userSettings().getUseScaling() == true ) //&& node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+    {
+        // rescale the conditional likelihoods at the "end" of the branch
+        double max = 0.0;
+        for (size_t i=0; i<num_states; ++i)
         {
-            // calculate likelihoods for this branch
-            if ( sample_character_history == false )
-            {
-                // numerically integrate over the entire branch length
-                numericallyIntegrateProcess(node_likelihood, begin_age, end_age, true, false);
-            }
-            else
+            if ( node_likelihood[num_states+i] > max )
             {
-                // calculate the conditional likelihoods for each time slice moving
-                // along this branch backwards in time from the tip towards the root
-                
-                std::vector<std::vector<double> > branch_likelihoods;
-                size_t current_dt = 0;
-                
-                // calculate partial likelihoods for each time slice and store them in branch_likelihoods
-                while ( (current_dt * dt) + begin_age < end_age )
-                {
-                    
-                    std::vector<double> dt_likelihood;
-                    
-                    double current_dt_start = (current_dt * dt) + begin_age;
-                    double current_dt_end = ((current_dt + 1) * dt) + begin_age;
-                    if (current_dt_end > end_age)
-                    {
-                        current_dt_end = end_age;
-                    }
-                    numericallyIntegrateProcess(node_likelihood, current_dt_start, current_dt_end, true, false);
-                    
-                    std::vector<double>::const_iterator first = node_likelihood.begin() + num_states;
-                    std::vector<double>::const_iterator last = node_likelihood.begin() + (num_states * 2);
-                    dt_likelihood = std::vector<double>(first, last);
-                    
-                    branch_likelihoods.push_back(dt_likelihood);
-                    current_dt++;
-                    
-                }
-                
-                // save the branch conditional likelihoods
-                branch_partial_likelihoods[node_index] = branch_likelihoods;
+                max = node_likelihood[num_states+i];
             }
         }
+        max *= num_states;
         
-        if ( RbSettings::userSettings().getUseScaling() == true ) //&& node_index % RbSettings::userSettings().getScalingDensity() == 0 )
+        for (size_t i=0; i<num_states; ++i)
         {
-            // rescale the conditional likelihoods at the "end" of the branch
-            double max = 0.0;
-            for (size_t i=0; i<num_states; ++i)
-            {
-                if ( node_likelihood[num_states+i] > max )
-                {
-                    max = node_likelihood[num_states+i];
-                }
-            }
-            max *= num_states;
-            
-            for (size_t i=0; i<num_states; ++i)
-            {
-                node_likelihood[num_states+i] /= max;
-            }
-            
-            scaling_factors[node_index][active_likelihood[node_index]] = log(max);
-            
-            if ( node.isTip() == false )
+            node_likelihood[num_states+i] /= max;
+        }
+        
+        scaling_factors[node_index][active_likelihood[node_index]] = log(max);
+        
+        if ( node.isTip() == false )
+        {
+            const TopologyNode          &left           = node.getChild(0);
+            size_t                      left_index      = left.getIndex();
+            const TopologyNode          &right          = node.getChild(1);
+            size_t                      right_index     = right.getIndex();
+            scaling_factors[node_index][active_likelihood[node_index]] += scaling_factors[left_index][active_likelihood[left_index]] + scaling_factors[right_index][active_likelihood[right_index]];
+        }
+    }
+}
+
+
+/**
+ * Compute the probabilities of all dirty nodes below the root before the recursion in computeRootLikelihood() visits them.
+ * The branch of a node only depends on the subtrees of its children, so we group the dirty nodes by their height
+ * (the number of dirty nodes on the longest path down to a tip) and compute all nodes of the same height in parallel.
+ * Every node is computed by the same code no matter which thread runs it, so the result does not depend on the number of threads.
+ */
+void TimeVaryingStateDependentSpeciationExtinctionProcess::computeDirtyNodeProbabilities( void ) const
+{
+    
+    ThreadPool &pool = ThreadPool::threadPoolInstance();
+    size_t num_threads = pool.getNumberOfThreads();
+    
+    // the recursion recomputes all nodes anyway if we sample the character history
+    if ( num_threads < 2 || pool.isInsideParallelRegion() == true || sample_character_history == true )
+    {
+        return;
+    }
+    
+    // the threads share the parameter values and the compiled event map, so we let all deterministic parameters update their values now
+    // getValue() of a deterministic node updates its value lazily, which must not happen on several threads at the same time
+    getOriginAge();
+    mu->getValue();
+    getEventRate();
+    if ( pi != NULL )
+    {
+        pi->getValue();
+    }
+    if ( Q != NULL )
+    {
+        Q->getValue();
+    }
+    if ( epoch_times != NULL )
+    {
+        epoch_times->getValue();
+    }
+    if ( lambda != NULL )
+    {
+        lambda->getValue();
+    }
+    if ( phi != NULL )
+    {
+        phi->getValue();
+    }
+    if ( rho != NULL )
+    {
+        rho->getValue();
+    }
+    if ( use_cladogenetic_events == true )
+    {
+        getCladogeneticEventTable();
+    }
+    
+    // every thread needs its own integrator
+    while ( ode_integrators.size() < num_threads )
+    {
+        ode_integrators.push_back( ode_integrators[0] );
+        ode_integrators.back().resetStepCounts();
+    }
+    
+    std::vector< std::vector<const TopologyNode*> > nodes_by_height;
+    const TopologyNode &root = value->getRoot();
+    for (size_t i = 0; i < root.getNumberOfChildren(); ++i)
+    {
+        collectDirtyNodes( root.getChild(i), nodes_by_height );
+    }
+    
+    for (size_t h = 0; h < nodes_by_height.size(); ++h)
+    {
+        const std::vector<const TopologyNode*> &nodes = nodes_by_height[h];
+        size_t num_jobs = std::min( nodes.size(), num_threads );
+        
+        pool.parallelFor( num_jobs, [&](size_t job)
+        {
+            for (size_t i = job; i < nodes.size(); i += num_jobs)
             {
-                const TopologyNode          &left           = node.getChild(0);
-                size_t                      left_index      = left.getIndex();
-                const TopologyNode          &right          = node.getChild(1);
-                size_t                      right_index     = right.getIndex();
-                scaling_factors[node_index][active_likelihood[node_index]] += scaling_factors[left_index][active_likelihood[left_index]] + scaling_factors[right_index][active_likelihood[right_index]];
+                computeBranchProbability( *nodes[i], nodes[i]->getIndex(), ode_integrators[job] );
             }
-        }
+        });
+    }
+    
+}
+
+
+/**
+ * Add the dirty nodes of this subtree to the list of their height and mark them as computed.
+ * Returns the height of the node, i.e., 0 for a clean node.
+ */
+size_t TimeVaryingStateDependentSpeciationExtinctionProcess::collectDirtyNodes(const TopologyNode &node, std::vector< std::vector<const TopologyNode*> > &nodes_by_height) const
+{
+    
+    size_t node_index = node.getIndex();
+    if ( dirty_nodes[node_index] == false )
+    {
+        return 0;
+    }
+    dirty_nodes[node_index] = false;
+    
+    size_t height = 0;
+    for (size_t i = 0; i < node.getNumberOfChildren(); ++i)
+    {
+        height = std::max( height, collectDirtyNodes( node.getChild(i), nodes_by_height ) );
     }
     
+    if ( nodes_by_height.size() <= height )
+    {
+        nodes_by_height.resize( height + 1 );
+    }
+    nodes_by_height[height].push_back( &node );
+    
+    return height + 1;
 }
 
 
 double TimeVaryingStateDependentSpeciationExtinctionProcess::computeRootLikelihood( void ) const
 {
+    // compute the dirty subtrees in parallel (if we have several threads)
+    computeDirtyNodeProbabilities();
+    
     // get the likelihoods of descendant nodes
     const TopologyNode     &root            = value->getRoot();
     size_t                  node_index      = root.getIndex();
@@ -575,12 +778,12 @@ double TimeVaryingStateDependentSpeciationExtinctionProcess::computeRootLikeliho
     
     std::vector<double> &node_likelihood  = node_partial_likelihoods[node_index][active_likelihood[node_index]];
     
-    std::map<std::vector<unsigned>, double> eventMap;
+    const CladogeneticEventTable* event_table = NULL;
     std::vector<double> speciation_rates;
     if ( use_cladogenetic_events == true )
     {
-        // get cladogenesis event map (sparse speciation rate matrix)
-        eventMap = cladogenesis_matrix->getValue().getEventMap();
+        // get the compiled cladogenesis event map (sparse speciation rate matrix)
+        event_table = &getCladogeneticEventTable();
     }
     else
     {
@@ -603,16 +806,10 @@ double TimeVaryingStateDependentSpeciationExtinctionProcess::computeRootLikeliho
         {
             
             double like_sum = 0.0;
-            std::map<std::vector<unsigned>, double>::iterator it;
-            for (it = eventMap.begin(); it != eventMap.end(); it++)
+            for (size_t k = event_table->ancestor_offsets[i]; k < event_table->ancestor_offsets[i+1]; ++k)
             {
-                const std::vector<unsigned>& states = it->first;
-                double speciation_rate = it->second;
-                if (i == states[0])
-                {
-                    double likelihoods = left_likelihoods[num_states + states[1]] * right_likelihoods[num_states + states[2]];
-                    like_sum += speciation_rate * likelihoods;
-                }
+                double likelihoods = left_likelihoods[num_states + event_table->ancestor_daughter_1[k]] * right_likelihoods[num_states + event_table->ancestor_daughter_2[k]];
+                like_sum += event_table->ancestor_rate[k] * likelihoods;
             }
             node_likelihood[num_states + i] = like_sum;
             
@@ -1574,6 +1771,21 @@ RevLanguage::RevPtr<RevLanguage::RevVariable> TimeVaryingStateDependentSpeciatio
 }
 
 
+void TimeVaryingStateDependentSpeciationExtinctionProcess::executeMethod(const std::string &name, const std::vector<const DagNode *> &args, RbVector<long> &rv) const
+{
+    
+    if ( name == "numberODESteps" )
+    {
+        rv = getNumberOfODESteps();
+    }
+    else
+    {
+        throw RbException("The time-varying state dependent birth-death process does not have a member method called '" + name + "'.");
+    }
+    
+}
+
+
 void TimeVaryingStateDependentSpeciationExtinctionProcess::executeMethod(const std::string &name, const std::vector<const DagNode *> &args, RbVector<double> &rv) const
 {
     
@@ -1612,6 +1824,23 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::getAffected(RbOrdered
 }
 
 
+/**
+ * Get the compiled table of the cladogenetic events.
+ * We only compile the event map again if the cladogenesis matrix may have changed since the last time.
+ */
+const CladogeneticEventTable& TimeVaryingStateDependentSpeciationExtinctionProcess::getCladogeneticEventTable(void) const
+{
+
+    if ( clado_event_table_dirty == true )
+    {
+        clado_event_table.compile( cladogenesis_matrix->getValue().getEventMap(), num_states );
+        clado_event_table_dirty = false;
+    }
+
+    return clado_event_table;
+}
+
+
 /**
  * Get the event rate
  */
@@ -1649,6 +1878,24 @@ const RateGenerator& TimeVaryingStateDependentSpeciationExtinctionProcess::getEv
 }
 
 
+/**
+ * The number of accepted, rejected and implicit (stiff) steps of the ODE integrator during the last likelihood computation.
+ */
+RbVector<long> TimeVaryingStateDependentSpeciationExtinctionProcess::getNumberOfODESteps( void ) const
+{
+    
+    RbVector<long> steps( 3, 0 );
+    for (size_t i = 0; i < ode_integrators.size(); ++i)
+    {
+        steps[0] += long( ode_integrators[i].getNumberOfSteps() );
+        steps[1] += long( ode_integrators[i].getNumberOfRejectedSteps() );
+        steps[2] += long( ode_integrators[i].getNumberOfStiffSteps() );
+    }
+    
+    return steps;
+}
+
+
 double TimeVaryingStateDependentSpeciationExtinctionProcess::getOriginAge( void ) const
 {
     
@@ -1743,6 +1990,13 @@ double TimeVaryingStateDependentSpeciationExtinctionProcess::lnProbTreeShape(voi
 
 
 std::vector<double> TimeVaryingStateDependentSpeciationExtinctionProcess::pExtinction(double start, double end) const
+{
+    
+    return pExtinction(start, end, ode_integrators[0]);
+}
+
+
+std::vector<double> TimeVaryingStateDependentSpeciationExtinctionProcess::pExtinction(double start, double end, SSE_ODEIntegrator &integrator) const
 {
     
     double samplingProbability = rho->getValue();
@@ -1753,7 +2007,7 @@ std::vector<double> TimeVaryingStateDependentSpeciationExtinctionProcess::pExtin
         initial_state[num_states + i] = samplingProbability;
     }
     
-    numericallyIntegrateProcess(initial_state, start, end, true, false);
+    numericallyIntegrateProcess(initial_state, start, end, true, false, integrator);
     
     return initial_state;
 }
@@ -1805,6 +2059,13 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::redrawValue( void )
 void TimeVaryingStateDependentSpeciationExtinctionProcess::restoreSpecialization(const DagNode *affecter)
 {
     
+    // the cladogenetic events and the extinction probabilities change with any parameter except the tree
+    if ( affecter != this->dag_node )
+    {
+        clado_event_table_dirty = true;
+        extinction_probability_table.clear();
+    }
+    
     if ( affecter == process_age )
     {
         if ( use_origin == false )
@@ -1850,6 +2111,7 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::setCladogenesisMatrix
     
     // set the value
     cladogenesis_matrix = cm;
+    clado_event_table_dirty = true;
     
     // should we use the event map for the speciation rates?
     use_cladogenetic_events = true;
@@ -1914,6 +2176,18 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::setSpeciationRates(co
 }
 
 
+/**
+ * Set whether we solve the extinction probabilities once per likelihood computation and interpolate them along the branches.
+ */
+void TimeVaryingStateDependentSpeciationExtinctionProcess::setUseExtinctionProbabilityTable( bool tf )
+{
+    
+    use_extinction_probability_table = tf;
+    extinction_probability_table.clear();
+    
+}
+
+
 void TimeVaryingStateDependentSpeciationExtinctionProcess::setNumberOfTimeSlices( double n )
 {
     
@@ -2526,6 +2800,7 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::swapParameterInternal
     if ( oldP == cladogenesis_matrix )
     {
         cladogenesis_matrix = static_cast<const TypedDagNode<CladogeneticSpeciationRateMatrix>* >( newP );
+        clado_event_table_dirty = true;
     }
     
 }
@@ -2539,6 +2814,13 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::swapParameterInternal
 void TimeVaryingStateDependentSpeciationExtinctionProcess::touchSpecialization(const DagNode *affecter, bool touchAll)
 {
     
+    // the cladogenetic events and the extinction probabilities change with any parameter except the tree
+    if ( affecter != this->dag_node )
+    {
+        clado_event_table_dirty = true;
+        extinction_probability_table.clear();
+    }
+    
     if ( affecter == process_age )
     {
         if ( use_origin == false)
@@ -2578,6 +2860,16 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::touchSpecialization(c
  * Wrapper function for the ODE time stepper function.
  */
 void TimeVaryingStateDependentSpeciationExtinctionProcess::numericallyIntegrateProcess(std::vector< double > &likelihoods, double begin_age, double end_age, bool backward_time, bool extinction_only) const
+{
+    
+    numericallyIntegrateProcess(likelihoods, begin_age, end_age, backward_time, extinction_only, ode_integrators[0]);
+}
+
+
+/**
+ * Integrate the ODE with the given integrator, so that several threads can integrate different branches.
+ */
+void TimeVaryingStateDependentSpeciationExtinctionProcess::numericallyIntegrateProcess(std::vector< double > &likelihoods, double begin_age, double end_age, bool backward_time, bool extinction_only, SSE_ODEIntegrator &integrator) const
 {
     
     size_t index_epoch_begin = 0;
@@ -2592,6 +2884,8 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::numericallyIntegrateP
     double current_begin_age = begin_age;
     
     const RbVector< RbVector<double> > &extinction_rate_values = mu->getValue();
+    
+    bool use_table = ( backward_time == true && extinction_only == false && extinction_probability_table.covers( begin_age ) == true && extinction_probability_table.covers( end_age ) == true );
 
     for ( size_t index_epoch=index_epoch_begin; index_epoch<=index_epoch_end; ++index_epoch )
     {
@@ -2604,12 +2898,8 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::numericallyIntegrateP
         SSE_ODE ode = SSE_ODE(extinction_rates, &rg, getEventRate(), backward_time, extinction_only);
         if ( use_cladogenetic_events == true )
         {
-            cladogenesis_matrix->getValue(); // we must call getValue() to update the speciation and extinction rates in the event map
-        
-            // get cladogenesis event map (sparse speciation rate matrix)
-            std::map<std::vector<unsigned>, double> event_map = cladogenesis_matrix->getValue().getEventMap();
-        
-            ode.setEventMap( event_map );
+            // get the compiled cladogenesis event map (sparse speciation rate matrix)
+            ode.setEventTable( &getCladogeneticEventTable() );
         }
         else
         {
@@ -2623,8 +2913,21 @@ void TimeVaryingStateDependentSpeciationExtinctionProcess::numericallyIntegrateP
             ode.setSerialSamplingRate( serial_sampling_rates );
         }
     
-        typedef boost::numeric::odeint::runge_kutta_dopri5< std::vector< double > > stepper_type;
-        boost::numeric::odeint::integrate_adaptive( make_controlled( 1E-6 , 1E-6 , stepper_type() ) , ode , likelihoods , current_begin_age , current_end_age , dt );
+        if ( use_table == true )
+        {
+            // the extinction probabilities are the same on every branch, so we only integrate the observation probabilities
+            ode.setExtinctionProbabilities( &extinction_probability_table );
+            
+            std::vector<double> observation_probs( likelihoods.begin() + num_states, likelihoods.end() );
+            integrator.integrate( ode, observation_probs, current_begin_age, current_end_age, dt );
+            
+            extinction_probability_table.interpolate( current_end_age, &likelihoods[0] );
+            std::copy( observation_probs.begin(), observation_probs.end(), likelihoods.begin() + num_states );
+        }
+        else
+        {
+            integrator.integrate( ode, likelihoods, current_begin_age, current_end_age, dt );
+        }
     
         // catch negative extinction probabilities that can result from
         // rounding errors in the ODE stepper
@@ -8,6 +8,7 @@
 #include "RateMatrix_JC.h"
 #include "Simplex.h"
 #include "SSE_ODE.h"
+#include "SSE_ODEIntegrator.h"
 #include "Taxon.h"
 #include "Tree.h"
 #include "TreeChangeEventListener.h"
@@ -55,6 +56,7 @@ namespace RevBayesCore {
         double                                                          computeLnProbability(void);
         void                                                            fireTreeChangeEvent(const TopologyNode &n, const unsigned& m=0);                                                 //!< The tree has changed and we want to know which part.
         const AbstractHomologousDiscreteCharacterData&                  getCharacterData() const;
+        RbVector<long>                                                  getNumberOfODESteps(void) const;                                                                    //!< The number of ODE steps of the last likelihood computation
         double                                                          getOriginAge(void) const;
         std::vector<double>                                             getTimeInStates(void) const;
         double                                                          getRootAge(void) const;
@@ -64,6 +66,7 @@ namespace RevBayesCore {
         void                                                            setSampleCharacterHistory(bool sample_history);                                                     //!< Set whether or not we are sampling the character history along branches.
         void                                                            setSpeciationRates(const TypedDagNode< RbVector< RbVector<double> > > *r);
         void                                                            setNumberOfTimeSlices(double n);                                                                    //!< Set the number of time slices for the numerical ODE.
+        void                                                            setUseExtinctionProbabilityTable(bool tf);                                                          //!< Interpolate the extinction probabilities from one solution instead of integrating them on every branch.
         virtual void                                                    setValue(Tree *v, bool f=false);                                                                    //!< Set the current value, e.g. attach an observation (clamp)
         
         void                                                            drawJointConditionalAncestralStates(std::vector<size_t>& startStates, std::vector<size_t>& endStates);
@@ -71,11 +74,13 @@ namespace RevBayesCore {
         void                                                            drawStochasticCharacterMap(std::vector<std::string>& character_histories);
         void                                                            recursivelyDrawStochasticCharacterMap(const TopologyNode &node, size_t start_state, std::vector<std::string>& character_histories);
         void                                                            numericallyIntegrateProcess(std::vector< double > &likelihoods, double begin_age, double end_age, bool use_backward, bool extinction_only) const; //!< Wrapper function for the ODE time stepper function.
+        void                                                            numericallyIntegrateProcess(std::vector< double > &likelihoods, double begin_age, double end_age, bool use_backward, bool extinction_only, SSE_ODEIntegrator &integrator) const;
         void                                                            resizeVectors(size_t num_nodes);
         
     protected:
         
         double                                                          getEventRate(void) const;
+        const CladogeneticEventTable&                                   getCladogeneticEventTable(void) const;
         const RateGenerator&                                            getEventRateMatrix(double a=-1.0) const;
         std::vector<double>                                             getRootFrequencies(void) const;
         
@@ -90,6 +95,7 @@ namespace RevBayesCore {
         // Parameter management functions. You need to override both if you have additional parameters
         virtual void                                                    swapParameterInternal(const DagNode *oldP, const DagNode *newP);                                    //!< Swap a parameter
         void                                                            executeMethod(const std::string &n, const std::vector<const DagNode*> &args, RbVector<double> &rv) const;
+        void                                                            executeMethod(const std::string &n, const std::vector<const DagNode*> &args, RbVector<long> &rv) const;     //!< Map the member methods to internal function calls
         RevLanguage::RevPtr<RevLanguage::RevVariable>                   executeProcedure(const std::string &name, const std::vector<DagNode *> args, bool &found);
         
         // helper functions
@@ -99,9 +105,14 @@ namespace RevBayesCore {
         std::vector<double>                                             calculateExtinctionRatePerState(double a);
         size_t                                                          computeEpochIndex(double a) const;
         double                                                          computeEpochEnd(size_t i) const;
+        void                                                            computeExtinctionProbabilityTable(void) const;
+        void                                                            computeBranchProbability(const TopologyNode &n, size_t nIdx, SSE_ODEIntegrator &integrator) const;
+        void                                                            computeDirtyNodeProbabilities(void) const;
+        size_t                                                          collectDirtyNodes(const TopologyNode &n, std::vector< std::vector<const TopologyNode*> > &nodes_by_height) const;
         void                                                            computeNodeProbability(const TopologyNode &n, size_t nIdx) const;
         double                                                          computeRootLikelihood() const;
         std::vector<double>                                             pExtinction(double start, double end) const;                                                        //!< Compute the probability of extinction of the process (without incomplete taxon sampling).
+        std::vector<double>                                             pExtinction(double start, double end, SSE_ODEIntegrator &integrator) const;
         virtual double                                                  pSurvival(double start, double end) const;                                                          //!< Compute the probability of survival of the process (without incomplete taxon sampling).
         void                                                            recursivelyFlagNodeDirty(const TopologyNode& n);
         bool                                                            simulateTree(size_t attempts = 0);
@@ -118,6 +129,11 @@ namespace RevBayesCore {
         size_t                                                          num_states;
         mutable std::vector<std::vector<double> >                       scaling_factors;
         bool                                                            use_cladogenetic_events;                                                                            //!< do we use the speciation rates from the cladogenetic event map?
+        mutable CladogeneticEventTable                                  clado_event_table;                                                                                  //!< the compiled cladogenetic event map
+        mutable bool                                                    clado_event_table_dirty;                                                                            //!< do we need to compile the event map again?
+        bool                                                            use_extinction_probability_table;                                                                   //!< do we interpolate the extinction probabilities from a table?
+        mutable ExtinctionProbabilityTable                              extinction_probability_table;                                                                       //!< the extinction probabilities of the current parameters (empty if not computed)
+        mutable std::vector<SSE_ODEIntegrator>                          ode_integrators;                                                                                    //!< the integrators of the ODEs (one per thread), which keep their buffers between the branches
         bool                                                            use_origin;
         bool                                                            sample_character_history;                                                                           //!< are we sampling the character history along branches?
         std::vector<double>                                             average_speciation;
@@ -29,7 +29,9 @@ RbHelpSystem::RbHelpSystem( const RbHelpSystem &hs) :
     helpForMethods( hs.helpForMethods ),
     helpForTypes(  ),
     helpFunctionNames( hs.helpFunctionNames ),
-    helpTypeNames( hs.helpTypeNames )
+    helpTypeNames( hs.helpTypeNames ),
+    unbuiltHelpForFunctions( hs.unbuiltHelpForFunctions ),
+    unbuiltHelpForTypes( hs.unbuiltHelpForTypes )
 {
     
     
@@ -75,6 +77,8 @@ RbHelpSystem& RbHelpSystem::operator=( const RbHelpSystem &hs )
         helpForFunctions    = hs.helpForFunctions;
         helpTypeNames       = hs.helpTypeNames;
         helpForMethods      = hs.helpForMethods;
+        unbuiltHelpForFunctions = hs.unbuiltHelpForFunctions;
+        unbuiltHelpForTypes     = hs.unbuiltHelpForTypes;
         
         for ( std::map<std::string, RbHelpType*>::const_iterator it = hs.helpForTypes.begin(); it != hs.helpForTypes.end(); ++it)
         {
@@ -100,7 +104,7 @@ void RbHelpSystem::addHelpDistribution( RbHelpDistribution *h)
 //    }
 
     
-    if ( h != NULL && helpForTypes.find( h->getName() ) == helpForTypes.end() )
+    if ( h != NULL && helpForTypes.find( h->getName() ) == helpForTypes.end() && unbuiltHelpForTypes.find( h->getName() ) == unbuiltHelpForTypes.end() )
     {
         helpForTypes.insert( std::pair<std::string,RbHelpType*>( h->getName() , h ) );
         helpTypeNames.insert( h->getName() );
@@ -121,7 +125,7 @@ void RbHelpSystem::addHelpDistribution( RbHelpDistribution *h)
         const std::vector<std::string>& aliases = h->getAliases();
         for (std::vector<std::string>::const_iterator alias = aliases.begin(); alias != aliases.end(); ++alias)
         {
-            if ( helpForTypes.find(*alias ) == helpForTypes.end() )
+            if ( helpForTypes.find(*alias ) == helpForTypes.end() && unbuiltHelpForTypes.find( *alias ) == unbuiltHelpForTypes.end() )
             {
                 helpForTypes.insert( std::pair<std::string,RbHelpType*>( *alias , h->clone() ) );
                 helpForMethods.insert( std::pair<std::string, std::map<std::string,RbHelpFunction> >(*alias,methodsHelp) );
@@ -143,14 +147,20 @@ void RbHelpSystem::addHelpFunction( RbHelpFunction *h )
     
     if ( h != NULL )
     {
-        helpForFunctions.insert( std::pair<std::string,RbHelpFunction>( h->getName() , *h) );
+        if ( unbuiltHelpForFunctions.find( h->getName() ) == unbuiltHelpForFunctions.end() )
+        {
+            helpForFunctions.insert( std::pair<std::string,RbHelpFunction>( h->getName() , *h) );
+        }
         helpFunctionNames.insert( h->getName() );
     
         // also add all aliases
         const std::vector<std::string>& aliases = h->getAliases();
         for (std::vector<std::string>::const_iterator alias = aliases.begin(); alias != aliases.end(); ++alias)
         {
-            helpForFunctions.insert( std::pair<std::string,RbHelpFunction>( *alias , *h) );
+            if ( unbuiltHelpForFunctions.find( *alias ) == unbuiltHelpForFunctions.end() )
+            {
+                helpForFunctions.insert( std::pair<std::string,RbHelpFunction>( *alias , *h) );
+            }
         }
     }
     
@@ -160,11 +170,64 @@ void RbHelpSystem::addHelpFunction( RbHelpFunction *h )
 
 
 
+/**
+ * Add the help entry of a function without building it yet.
+ * The entry is built by the factory the first time it is requested under its name or one of its aliases.
+ * As for the entries added directly, the first entry added for a name (or alias) is kept.
+ */
+void RbHelpSystem::addHelpFunction( const std::string &n, const std::vector<std::string> &a, const std::function<RbHelpFunction*(void)> &f )
+{
+    
+    helpFunctionNames.insert( n );
+    
+    if ( helpForFunctions.find( n ) == helpForFunctions.end() )
+    {
+        unbuiltHelpForFunctions.insert( std::pair<std::string, std::function<RbHelpFunction*(void)> >( n, f ) );
+    }
+    
+    // also add all aliases
+    for (std::vector<std::string>::const_iterator alias = a.begin(); alias != a.end(); ++alias)
+    {
+        if ( helpForFunctions.find( *alias ) == helpForFunctions.end() )
+        {
+            unbuiltHelpForFunctions.insert( std::pair<std::string, std::function<RbHelpFunction*(void)> >( *alias, f ) );
+        }
+    }
+    
+}
+
+
+/**
+ * Add the help entry of a type (or distribution, move, monitor) without building it yet.
+ * The entry is built by the factory the first time it is requested under its name or one of its aliases.
+ */
+void RbHelpSystem::addHelpType( const std::string &n, const std::vector<std::string> &a, const std::function<RbHelpType*(void)> &f )
+{
+    
+    if ( helpForTypes.find( n ) == helpForTypes.end() && unbuiltHelpForTypes.find( n ) == unbuiltHelpForTypes.end() )
+    {
+        unbuiltHelpForTypes.insert( std::pair<std::string, std::function<RbHelpType*(void)> >( n, f ) );
+        helpTypeNames.insert( n );
+        
+        // also add all aliases
+        for (std::vector<std::string>::const_iterator alias = a.begin(); alias != a.end(); ++alias)
+        {
+            if ( helpForTypes.find( *alias ) == helpForTypes.end() )
+            {
+                unbuiltHelpForTypes.insert( std::pair<std::string, std::function<RbHelpType*(void)> >( *alias, f ) );
+            }
+        }
+        
+    }
+    
+}
+
+
 void RbHelpSystem::addHelpType( RbHelpType *h )
 {
     
     
-    if ( h != NULL && helpForTypes.find( h->getName() ) == helpForTypes.end() )
+    if ( h != NULL && helpForTypes.find( h->getName() ) == helpForTypes.end() && unbuiltHelpForTypes.find( h->getName() ) == unbuiltHelpForTypes.end() )
     {
         
         helpForTypes.insert( std::pair<std::string,RbHelpType*>( h->getName() , h ) );
@@ -186,8 +249,11 @@ void RbHelpSystem::addHelpType( RbHelpType *h )
         const std::vector<std::string>& aliases = h->getAliases();
         for (std::vector<std::string>::const_iterator alias = aliases.begin(); alias != aliases.end(); ++alias)
         {
-            helpForTypes.insert( std::pair<std::string,RbHelpType*>( *alias , h->clone() ) );
-            helpForMethods.insert( std::pair<std::string, std::map<std::string,RbHelpFunction> >(*alias,methodsHelp) );
+            if ( helpForTypes.find( *alias ) == helpForTypes.end() && unbuiltHelpForTypes.find( *alias ) == unbuiltHelpForTypes.end() )
+            {
+                helpForTypes.insert( std::pair<std::string,RbHelpType*>( *alias , h->clone() ) );
+                helpForMethods.insert( std::pair<std::string, std::map<std::string,RbHelpFunction> >(*alias,methodsHelp) );
+            }
         }
     
     }
@@ -213,10 +279,60 @@ const std::set<std::string>& RbHelpSystem::getTypeEntries( void ) const
 }
 
 
+/**
+ * Build the help entries that were registered with a factory for this query (if any).
+ * The entry is stored under the query only; the name and the other aliases are built when they are requested themselves.
+ */
+void RbHelpSystem::buildHelpEntry(const std::string &q)
+{
+    
+    std::map<std::string, std::function<RbHelpFunction*(void)> >::iterator itFunction = unbuiltHelpForFunctions.find( q );
+    if ( itFunction != unbuiltHelpForFunctions.end() )
+    {
+        std::function<RbHelpFunction*(void)> factory = itFunction->second;
+        unbuiltHelpForFunctions.erase( itFunction );
+        
+        RbHelpFunction *h = factory();
+        if ( h != NULL )
+        {
+            helpForFunctions.insert( std::pair<std::string,RbHelpFunction>( q , *h) );
+        }
+        delete h;
+    }
+    
+    std::map<std::string, std::function<RbHelpType*(void)> >::iterator itType = unbuiltHelpForTypes.find( q );
+    if ( itType != unbuiltHelpForTypes.end() )
+    {
+        std::function<RbHelpType*(void)> factory = itType->second;
+        unbuiltHelpForTypes.erase( itType );
+        
+        RbHelpType *h = factory();
+        if ( h != NULL )
+        {
+            helpForTypes.insert( std::pair<std::string,RbHelpType*>( q , h ) );
+            
+            // create a map for all methods for this type
+            std::map<std::string, RbHelpFunction> methodsHelp;
+            const std::vector<RbHelpFunction>& method = h->getMethods();
+            for (std::vector<RbHelpFunction>::const_iterator m = method.begin(); m != method.end(); ++m)
+            {
+                methodsHelp.insert( std::pair<std::string,RbHelpFunction>( m->getName() , *m) );
+            }
+            
+            // add the methods to our global map
+            helpForMethods.insert( std::pair<std::string, std::map<std::string,RbHelpFunction> >(q,methodsHelp) );
+        }
+    }
+    
+}
+
+
 /** Retrieve the help entry */
 const RbHelpEntry& RbHelpSystem::getHelp(const std::string &qs)
 {
     
+    buildHelpEntry( qs );
+    
     std::map<std::string, RbHelpFunction>::iterator itFunction = helpForFunctions.find( qs );
     std::map<std::string, RbHelpType*>::iterator itType = helpForTypes.find( qs );
     if ( itFunction != helpForFunctions.end() )
@@ -239,6 +355,8 @@ const RbHelpEntry& RbHelpSystem::getHelp(const std::string &qs)
 const RbHelpEntry& RbHelpSystem::getHelp(const std::string &baseQuery, const std::string &qs)
 {
     
+    buildHelpEntry( baseQuery );
+    
     // find the corresponding base type
     std::map<std::string, std::map<std::string, RbHelpFunction> >::iterator itMethods = helpForMethods.find( baseQuery );
     if ( itMethods != helpForMethods.end() )
@@ -338,12 +456,13 @@ void RbHelpSystem::addHelpEntry( void )
 bool RbHelpSystem::isHelpAvailableForQuery(const std::string &query)
 {
     // test if we have a help entry for this query string
-    return helpForFunctions.find( query ) != helpForFunctions.end() || helpForTypes.find( query ) != helpForTypes.end();
+    return helpForFunctions.find( query ) != helpForFunctions.end() || helpForTypes.find( query ) != helpForTypes.end() ||
+           unbuiltHelpForFunctions.find( query ) != unbuiltHelpForFunctions.end() || unbuiltHelpForTypes.find( query ) != unbuiltHelpForTypes.end();
 }
 
 
 bool RbHelpSystem::isHelpAvailableForQuery(const std::string &baseQuery, const std::string &query)
 {
     // test if we have a help entry for this query string
-    return helpForTypes.find( baseQuery ) != helpForTypes.end();
+    return helpForTypes.find( baseQuery ) != helpForTypes.end() || unbuiltHelpForTypes.find( baseQuery ) != unbuiltHelpForTypes.end();
 }
@@ -6,9 +6,11 @@
 #include "RbHelpFunction.h"
 #include "RbHelpType.h"
 
+#include <functional>
 #include <set>
 #include <string>
 #include <map>
+#include <vector>
 
 namespace RevBayesCore {
     
@@ -19,6 +21,10 @@ namespace RevBayesCore {
      * Our help system consists of several xml-files. Here we load in the files.
      * The help system will provide access to other classes to the help documentation.
      *
+     * Building the help entries of all functions and types is expensive, but almost no run ever looks at them.
+     * Therefore, entries can also be registered by their name (and aliases) together with a factory,
+     * and the entry is only built the first time it is requested.
+     *
      * \copyright (c) Copyright 2009-2013 (GPL version 3)
      * \author The RevBayes Development Core Team (Johan Dunfalk & Sebastian Hoehna)
      * \since Version 1.0, 2014-09-15
@@ -34,6 +40,8 @@ namespace RevBayesCore {
         void                                        addHelpDistribution( RbHelpDistribution *h );
         void                                        addHelpFunction( RbHelpFunction *h );
         void                                        addHelpType( RbHelpType *h );
+        void                                        addHelpFunction( const std::string &n, const std::vector<std::string> &a, const std::function<RbHelpFunction*(void)> &f );     //!< Add a help entry that is built on first use
+        void                                        addHelpType( const std::string &n, const std::vector<std::string> &a, const std::function<RbHelpType*(void)> &f );             //!< Add a help entry that is built on first use
         const std::set<std::string>&                getFunctionEntries(void) const;
         const std::set<std::string>&                getTypeEntries(void) const;
         const RbHelpEntry&                          getHelp(const std::string &qs);                                         //!< Format the help information for printing to the terminal
@@ -52,11 +60,15 @@ namespace RevBayesCore {
         RbHelpSystem(const RbHelpSystem&);                                                                                  //!< Copy constructor (hidden away as this is a singleton class)
         RbHelpSystem&                               operator=(const RbHelpSystem&);                                         //!< Assignment operator (hidden away as this is a singleton class)
         
+        void                                        buildHelpEntry(const std::string &q);                                   //!< Build the help entry for this query if it has not been built yet
+        
         std::map<std::string, RbHelpFunction>                           helpForFunctions;
         std::map<std::string, std::map<std::string, RbHelpFunction> >   helpForMethods;
         std::map<std::string, RbHelpType*>                              helpForTypes;
         std::set<std::string>                                           helpFunctionNames;                                  //!< Set of finction names without aliases
         std::set<std::string>                                           helpTypeNames;                                      //!< Set of finction names without aliases
+        std::map<std::string, std::function<RbHelpFunction*(void)> >    unbuiltHelpForFunctions;                            //!< Factories for the function entries that have not been built yet
+        std::map<std::string, std::function<RbHelpType*(void)> >        unbuiltHelpForTypes;                                //!< Factories for the type entries that have not been built yet
     
     };
     
@@ -0,0 +1,122 @@
+#ifndef BinaryTreeTraceFormat_H
+#define BinaryTreeTraceFormat_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cstring>
+#include <string>
+
+namespace RevBayesCore {
+
+    /**
+     * The binary tree-trace format.
+     *
+     * A file starts with a header (the magic "RBTTRACE", the format version and a byte-order mark),
+     * followed by records. Every record has a type and the length of its content:
+     *  - STRINGS: strings appended to the string table (taxon names, species names and annotation names).
+     *             The string table is written once and only extended if a later sample brings new names.
+     *  - BLOCK:   a number of samples. A block that is still being written has length 0 and extends to the end of the file.
+     *  - INDEX:   the offsets of all STRINGS and BLOCK records (with the first sample of each block), for random access.
+     * A closed file ends with a footer (the offset of the INDEX record and the magic "RBTINDEX").
+     * If the footer is missing (e.g., because the run was killed), the readers scan the records instead.
+     *
+     * Every sample starts with its length, followed by the generation, the flags of the tree and the nodes in preorder.
+     * Each node stores its index, its number of children, its name and species, its age or branch length,
+     * and its node and branch annotations. Numeric annotations are stored as doubles (and formatted as before when read),
+     * all other annotations as text. Integers are stored as variable-length integers, all numbers in the byte order of the writer.
+     */
+    namespace BinaryTreeTraceFormat {
+
+        const char                  MAGIC[8]                = { 'R', 'B', 'T', 'T', 'R', 'A', 'C', 'E' };
+        const char                  INDEX_MAGIC[8]          = { 'R', 'B', 'T', 'I', 'N', 'D', 'E', 'X' };
+        const uint32_t              VERSION                 = 1;
+        const uint32_t              BYTE_ORDER_MARK         = 0x01020304;
+        const size_t                HEADER_SIZE             = 16;
+        const size_t                RECORD_HEADER_SIZE      = 12;                   //!< uint32 type and uint64 length
+        const size_t                FOOTER_SIZE             = 16;                   //!< uint64 offset of the index and the magic
+        const size_t                SAMPLES_PER_BLOCK       = 256;
+
+        enum RecordType             { STRINGS = 1, BLOCK = 2, INDEX = 3 };
+
+        // the flags of a tree
+        const unsigned char         TREE_ROOTED             = 1;
+
+        // the flags of a node
+        const unsigned char         NODE_SAMPLED_ANCESTOR   = 1;
+        const unsigned char         NODE_USES_AGES          = 2;
+        const unsigned char         NODE_HAS_AGE            = 4;
+        const unsigned char         NODE_HAS_BRANCH_LENGTH  = 8;
+        const unsigned char         NODE_SPECIES_IS_NAME    = 16;
+
+        // the types of the annotations
+        enum AnnotationType         { NUMBER_SHORTEST = 1, NUMBER_FIXED = 2, TEXT = 3 };
+
+        const uint64_t              NO_STRING               = 0;                    //!< string ids are stored as id+1
+
+        inline void writeVarint(std::string &out, uint64_t v)
+        {
+            while ( v >= 0x80 )
+            {
+                out += char( (v & 0x7F) | 0x80 );
+                v >>= 7;
+            }
+            out += char( v );
+        }
+
+        template <class T>
+        inline void writeRaw(std::string &out, const T &v)
+        {
+            out.append( reinterpret_cast<const char*>( &v ), sizeof(T) );
+        }
+
+        inline void writeString(std::string &out, const std::string &s)
+        {
+            writeVarint( out, s.size() );
+            out += s;
+        }
+
+        /** Read a variable-length integer. Returns false if the data ends before the integer. */
+        inline bool readVarint(const char* &p, const char *end, uint64_t &v)
+        {
+            v = 0;
+            for (int shift = 0; p < end && shift < 64; shift += 7)
+            {
+                unsigned char c = static_cast<unsigned char>( *p++ );
+                v |= uint64_t( c & 0x7F ) << shift;
+                if ( (c & 0x80) == 0 )
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template <class T>
+        inline bool readRaw(const char* &p, const char *end, T &v)
+        {
+            if ( size_t( end - p ) < sizeof(T) )
+            {
+                return false;
+            }
+            memcpy( &v, p, sizeof(T) );
+            p += sizeof(T);
+            return true;
+        }
+
+        inline bool readString(const char* &p, const char *end, std::string &s)
+        {
+            uint64_t length = 0;
+            if ( readVarint( p, end, length ) == false || uint64_t( end - p ) < length )
+            {
+                return false;
+            }
+            s.assign( p, size_t( length ) );
+            p += length;
+            return true;
+        }
+
+    }
+
+}
+
+#endif
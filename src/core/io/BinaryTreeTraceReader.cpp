@@ -0,0 +1,527 @@
+#include "BinaryTreeTraceReader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "BinaryTreeTraceFormat.h"
+#include "RbException.h"
+#include "ThreadPool.h"
+#include "TopologyNode.h"
+#include "Tree.h"
+
+using namespace RevBayesCore;
+using namespace RevBayesCore::BinaryTreeTraceFormat;
+
+
+namespace {
+
+    /** Format a numeric annotation exactly as the writer received it. */
+    std::string formatNumber(double value, unsigned char type)
+    {
+
+        char buffer[64];
+        if ( type == NUMBER_FIXED )
+        {
+            snprintf( buffer, sizeof(buffer), "%f", value );
+            return buffer;
+        }
+
+        // the shortest representation that reads back as the same number
+        for (int precision = 1; precision <= 17; ++precision)
+        {
+            snprintf( buffer, sizeof(buffer), "%.*g", precision, value );
+            if ( strtod( buffer, NULL ) == value )
+            {
+                break;
+            }
+        }
+        return buffer;
+    }
+
+
+    /** Read the annotations of a node or of the branch leading to it. */
+    bool readAnnotations(const char* &p, const char *end, const std::vector<std::string> &strings, TopologyNode *node, bool branch)
+    {
+
+        uint64_t num_annotations = 0;
+        if ( readVarint( p, end, num_annotations ) == false )
+        {
+            return false;
+        }
+
+        std::string value;
+        for (uint64_t i = 0; i < num_annotations; ++i)
+        {
+            uint64_t key = 0;
+            unsigned char type = 0;
+            if ( readVarint( p, end, key ) == false || key >= strings.size() || readRaw( p, end, type ) == false )
+            {
+                return false;
+            }
+
+            if ( type == NUMBER_SHORTEST || type == NUMBER_FIXED )
+            {
+                double number = 0.0;
+                if ( readRaw( p, end, number ) == false )
+                {
+                    return false;
+                }
+                value = formatNumber( number, type );
+            }
+            else if ( type != TEXT || readString( p, end, value ) == false )
+            {
+                return false;
+            }
+
+            if ( branch == true )
+            {
+                node->addBranchParameter( strings[key], value );
+            }
+            else
+            {
+                node->addNodeParameter( strings[key], value );
+            }
+        }
+
+        return true;
+    }
+
+}
+
+
+BinaryTreeTraceReader::BinaryTreeTraceReader(const path &fn) :
+    filename( fn ),
+    file( fn ),
+    num_samples( 0 ),
+    end_of_data( HEADER_SIZE )
+{
+
+    const char *p = file.begin();
+    uint32_t version = 0;
+    uint32_t byte_order = 0;
+    if ( file.size() < HEADER_SIZE || memcmp( p, MAGIC, sizeof(MAGIC) ) != 0 )
+    {
+        throw RbException() << "The file " << filename << " is not a binary tree trace.";
+    }
+    memcpy( &version, p + 8, sizeof(version) );
+    memcpy( &byte_order, p + 12, sizeof(byte_order) );
+    if ( byte_order != BYTE_ORDER_MARK )
+    {
+        throw RbException() << "The binary tree trace " << filename << " was written on a computer with a different byte order. Please convert it to a Newick tree trace on that computer.";
+    }
+    if ( version > VERSION )
+    {
+        throw RbException() << "The binary tree trace " << filename << " was written by a newer version of RevBayes (format version " << version << ").";
+    }
+
+    // a closed file has an index, otherwise we need to look at every record
+    if ( readIndex() == false )
+    {
+        scanRecords();
+    }
+
+}
+
+
+/**
+ * Decode one sample.
+ * The nodes are stored in preorder with the number of their children, so the parent of each node is the last node
+ * before it that still misses children. We restore ages and branch lengths in the same order, so that the
+ * branch lengths that the tree derives from the ages are computed exactly as in the tree that was written.
+ */
+Tree* BinaryTreeTraceReader::decodeSample(const char *p, const char *end, unsigned long &gen) const
+{
+
+    uint64_t generation = 0;
+    unsigned char tree_flags = 0;
+    uint64_t num_nodes = 0;
+    if ( readVarint( p, end, generation ) == false || readRaw( p, end, tree_flags ) == false || readVarint( p, end, num_nodes ) == false || num_nodes == 0 )
+    {
+        throw RbException() << "The binary tree trace " << filename << " is corrupt.";
+    }
+    gen = (unsigned long)generation;
+
+    TopologyNode *root = NULL;
+    std::vector<std::pair<TopologyNode*, uint64_t> > open_nodes;
+    try
+    {
+        for (uint64_t i = 0; i < num_nodes; ++i)
+        {
+            uint64_t index = 0;
+            uint64_t num_children = 0;
+            unsigned char flags = 0;
+            uint64_t name = NO_STRING;
+            uint64_t species = NO_STRING;
+            double age = 0.0;
+            double branch_length = 0.0;
+            bool valid = readVarint( p, end, index ) && readVarint( p, end, num_children ) && readRaw( p, end, flags ) && readVarint( p, end, name );
+            valid = valid && ( (flags & NODE_SPECIES_IS_NAME) != 0 || readVarint( p, end, species ) );
+            valid = valid && ( (flags & NODE_HAS_AGE) == 0 || readRaw( p, end, age ) );
+            valid = valid && ( (flags & NODE_HAS_BRANCH_LENGTH) == 0 || readRaw( p, end, branch_length ) );
+            valid = valid && name <= strings.size() && species <= strings.size();
+            if ( valid == false || ( i > 0 && open_nodes.empty() == true ) )
+            {
+                throw RbException() << "The binary tree trace " << filename << " is corrupt.";
+            }
+
+            TopologyNode *node = new TopologyNode( size_t(index) );
+            if ( root == NULL )
+            {
+                root = node;
+            }
+            else
+            {
+                TopologyNode *parent = open_nodes.back().first;
+                parent->addChild( node );
+                node->setParent( parent );
+                if ( --open_nodes.back().second == 0 )
+                {
+                    open_nodes.pop_back();
+                }
+            }
+            if ( num_children > 0 )
+            {
+                open_nodes.push_back( std::make_pair( node, num_children ) );
+            }
+
+            if ( name != NO_STRING )
+            {
+                node->setName( strings[name - 1] );
+            }
+            if ( (flags & NODE_SPECIES_IS_NAME) == 0 )
+            {
+                node->setSpeciesName( species == NO_STRING ? "" : strings[species - 1] );
+            }
+            node->setSampledAncestor( (flags & NODE_SAMPLED_ANCESTOR) != 0 );
+            if ( (flags & NODE_USES_AGES) == 0 )
+            {
+                node->setUseAges( false, false );
+            }
+            if ( (flags & NODE_HAS_AGE) != 0 )
+            {
+                node->setAge( age, false );
+            }
+            if ( (flags & NODE_HAS_BRANCH_LENGTH) != 0 )
+            {
+                node->setBranchLength( branch_length, false );
+            }
+
+            if ( readAnnotations( p, end, strings, node, false ) == false || readAnnotations( p, end, strings, node, true ) == false )
+            {
+                throw RbException() << "The binary tree trace " << filename << " is corrupt.";
+            }
+        }
+
+        // every node must have received all its children
+        if ( open_nodes.empty() == false )
+        {
+            throw RbException() << "The binary tree trace " << filename << " is corrupt.";
+        }
+    }
+    catch (...)
+    {
+        delete root;
+        throw;
+    }
+
+    Tree *t = new Tree();
+    t->setRoot( root, false );
+    t->setRooted( (tree_flags & TREE_ROOTED) != 0 );
+
+    return t;
+}
+
+
+/** Find the i-th sample. We look up its block in the index and skip the samples before it in the block. */
+const char* BinaryTreeTraceReader::findSample(size_t i, const char* &sample_end) const
+{
+
+    if ( i >= num_samples )
+    {
+        throw RbException() << "The binary tree trace " << filename << " has only " << num_samples << " samples.";
+    }
+
+    // the last block that starts at or before sample i
+    size_t b = 0;
+    size_t lower = 0;
+    size_t upper = blocks.size();
+    while ( upper - lower > 1 )
+    {
+        size_t middle = (lower + upper) / 2;
+        if ( blocks[middle].first_sample <= i )
+        {
+            lower = middle;
+        }
+        else
+        {
+            upper = middle;
+        }
+    }
+    b = lower;
+
+    const char *p   = file.begin() + blocks[b].offset + RECORD_HEADER_SIZE;
+    const char *end = file.begin() + blocks[b].data_end;
+    for (size_t k = blocks[b].first_sample; ; ++k)
+    {
+        uint64_t length = 0;
+        if ( readVarint( p, end, length ) == false || uint64_t( end - p ) < length )
+        {
+            throw RbException() << "The binary tree trace " << filename << " is corrupt.";
+        }
+        if ( k == i )
+        {
+            sample_end = p + length;
+            return p;
+        }
+        p += length;
+    }
+
+}
+
+
+/**
+ * Read the index at the end of a closed file.
+ * Returns false if the file has no (valid) index.
+ */
+bool BinaryTreeTraceReader::readIndex( void )
+{
+
+    if ( file.size() < HEADER_SIZE + RECORD_HEADER_SIZE + FOOTER_SIZE )
+    {
+        return false;
+    }
+
+    const char *footer = file.end() - FOOTER_SIZE;
+    uint64_t index_offset = 0;
+    memcpy( &index_offset, footer, sizeof(index_offset) );
+    if ( memcmp( footer + 8, INDEX_MAGIC, sizeof(INDEX_MAGIC) ) != 0 || index_offset < HEADER_SIZE || index_offset + RECORD_HEADER_SIZE > file.size() - FOOTER_SIZE )
+    {
+        return false;
+    }
+
+    const char *p = file.begin() + index_offset;
+    uint32_t type = 0;
+    uint64_t length = 0;
+    readRaw( p, file.end(), type );
+    readRaw( p, file.end(), length );
+    const char *end = p + length;
+    if ( type != INDEX || end != footer )
+    {
+        return false;
+    }
+
+    std::vector<size_t> string_offsets;
+    std::vector<Block> index_blocks;
+    uint64_t n = 0;
+    bool valid = readVarint( p, end, n );
+    for (uint64_t i = 0; valid == true && i < n; ++i)
+    {
+        uint64_t offset = 0;
+        valid = readVarint( p, end, offset ) && offset + RECORD_HEADER_SIZE <= index_offset;
+        string_offsets.push_back( size_t(offset) );
+    }
+    valid = valid && readVarint( p, end, n );
+    for (uint64_t i = 0; valid == true && i < n; ++i)
+    {
+        uint64_t values[4] = { 0, 0, 0, 0 };
+        for (size_t j = 0; j < 4; ++j)
+        {
+            valid = valid && readVarint( p, end, values[j] );
+        }
+        Block block = { size_t(values[0]), size_t(values[1]), size_t(values[2]), size_t(values[3]) };
+        valid = valid && block.offset + RECORD_HEADER_SIZE <= block.data_end && block.data_end <= index_offset;
+        index_blocks.push_back( block );
+    }
+    if ( valid == false )
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < string_offsets.size(); ++i)
+    {
+        const char *record = file.begin() + string_offsets[i];
+        memcpy( &length, record + 4, sizeof(length) );
+        if ( length > index_offset - string_offsets[i] - RECORD_HEADER_SIZE )
+        {
+            throw RbException() << "The binary tree trace " << filename << " is corrupt.";
+        }
+        readStringRecord( record + RECORD_HEADER_SIZE, record + RECORD_HEADER_SIZE + length );
+    }
+
+    string_records = string_offsets;
+    blocks = index_blocks;
+    num_samples = ( blocks.empty() == true ? 0 : blocks.back().first_sample + blocks.back().num_samples );
+    end_of_data = size_t( index_offset );
+
+    return true;
+}
+
+
+void BinaryTreeTraceReader::readStringRecord(const char *p, const char *end)
+{
+
+    uint64_t num_strings = 0;
+    std::string s;
+    bool valid = readVarint( p, end, num_strings );
+    for (uint64_t i = 0; valid == true && i < num_strings; ++i)
+    {
+        valid = readString( p, end, s );
+        strings.push_back( s );
+    }
+    if ( valid == false )
+    {
+        throw RbException() << "The binary tree trace " << filename << " is corrupt.";
+    }
+
+}
+
+
+/**
+ * Find the records by reading their headers, and count the samples in the blocks.
+ * We stop at the first incomplete record or sample, which a killed run may have left at the end of the file.
+ */
+void BinaryTreeTraceReader::scanRecords( void )
+{
+
+    size_t offset = HEADER_SIZE;
+    while ( offset + RECORD_HEADER_SIZE <= file.size() )
+    {
+        const char *p = file.begin() + offset;
+        uint32_t type = 0;
+        uint64_t length = 0;
+        readRaw( p, file.end(), type );
+        readRaw( p, file.end(), length );
+
+        if ( type == BLOCK )
+        {
+            // a block that was not closed has length 0 and ends with the file
+            const char *end = ( length == 0 ? file.end() : p + std::min( length, uint64_t( file.end() - p ) ) );
+            Block block = { offset, size_t( p - file.begin() ), num_samples, 0 };
+            while ( p < end )
+            {
+                uint64_t sample_length = 0;
+                if ( readVarint( p, end, sample_length ) == false || uint64_t( end - p ) < sample_length )
+                {
+                    break;
+                }
+                p += sample_length;
+                block.data_end = size_t( p - file.begin() );
+                ++block.num_samples;
+            }
+            if ( block.num_samples > 0 )
+            {
+                blocks.push_back( block );
+                num_samples += block.num_samples;
+                end_of_data = block.data_end;
+            }
+            if ( length == 0 || block.data_end != offset + RECORD_HEADER_SIZE + length )
+            {
+                break;
+            }
+        }
+        else if ( type == STRINGS && length <= file.size() - offset - RECORD_HEADER_SIZE )
+        {
+            readStringRecord( p, p + length );
+            string_records.push_back( offset );
+            end_of_data = offset + RECORD_HEADER_SIZE + length;
+        }
+        else
+        {
+            // an incomplete record or the index of a file that was closed and then appended to
+            break;
+        }
+
+        offset = end_of_data;
+    }
+
+}
+
+
+Tree* BinaryTreeTraceReader::readTree(size_t i, unsigned long &gen) const
+{
+
+    const char *end = NULL;
+    const char *p = findSample( i, end );
+
+    return decodeSample( p, end, gen );
+}
+
+
+std::vector<Tree*> BinaryTreeTraceReader::readTrees(const std::vector<size_t> &samples, std::vector<unsigned long> &gens) const
+{
+
+    std::vector<Tree*> trees( samples.size(), NULL );
+    gens.resize( samples.size() );
+
+    ThreadPool &pool = ThreadPool::threadPoolInstance();
+    size_t num_blocks = std::min( samples.size(), pool.getNumberOfThreads() );
+    try
+    {
+        pool.parallelFor( num_blocks, [&](size_t block)
+        {
+            for (size_t k = block * samples.size() / num_blocks; k < (block + 1) * samples.size() / num_blocks; ++k)
+            {
+                trees[k] = readTree( samples[k], gens[k] );
+            }
+        });
+    }
+    catch (...)
+    {
+        for (size_t k = 0; k < trees.size(); ++k)
+        {
+            delete trees[k];
+        }
+        throw;
+    }
+
+    return trees;
+}
+
+
+/** Write the samples as a text tree trace with the columns Iteration and Tree. */
+void BinaryTreeTraceReader::writeNewickTrace(const path &fn, const std::string &delimiter) const
+{
+
+    createDirectoryForFile( fn );
+    std::ofstream out_stream( fn.string() );
+    if ( out_stream.is_open() == false )
+    {
+        throw RbException() << "Could not open file " << fn;
+    }
+
+    out_stream << "Iteration" << delimiter << "Tree" << std::endl;
+
+    const size_t BATCH_SIZE = 1000;
+    std::vector<size_t> batch;
+    std::vector<unsigned long> gens;
+    for (size_t batch_begin = 0; batch_begin < num_samples; batch_begin += BATCH_SIZE)
+    {
+        batch.clear();
+        for (size_t i = batch_begin; i < std::min( batch_begin + BATCH_SIZE, num_samples ); ++i)
+        {
+            batch.push_back( i );
+        }
+
+        std::vector<Tree*> trees = readTrees( batch, gens );
+        for (size_t k = 0; k < trees.size(); ++k)
+        {
+            out_stream << gens[k] << delimiter << *trees[k] << "\n";
+            delete trees[k];
+        }
+    }
+
+}
+
+
+bool BinaryTreeTraceReader::isBinaryTreeTrace(const path &fn)
+{
+
+    std::ifstream in_stream( fn.string(), std::ios::in | std::ios::binary );
+    char magic[ sizeof(MAGIC) ];
+    in_stream.read( magic, sizeof(magic) );
+
+    return in_stream.gcount() == std::streamsize( sizeof(magic) ) && memcmp( magic, MAGIC, sizeof(MAGIC) ) == 0;
+}
@@ -0,0 +1,67 @@
+#ifndef BinaryTreeTraceReader_H
+#define BinaryTreeTraceReader_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "RbFileManager.h"
+
+namespace RevBayesCore {
+
+    class Tree;
+
+    /**
+     * Reader of tree traces in the binary format (see BinaryTreeTraceFormat.h).
+     *
+     * The file is mapped into memory. We read the string table and the block index once
+     * (from the index record, or by scanning the records if the writer did not close the file),
+     * and then decode any sample on demand without reading the samples before it.
+     * Several samples are decoded in parallel.
+     */
+    class BinaryTreeTraceReader {
+
+    public:
+
+        struct Block {
+            size_t                                          offset;                                 //!< The offset of the record
+            size_t                                          data_end;                               //!< The end of the last sample in the block
+            size_t                                          first_sample;                           //!< The index of the first sample in the block
+            size_t                                          num_samples;
+        };
+
+        BinaryTreeTraceReader(const path &fn);
+
+        const std::vector<Block>&                           getBlocks(void) const { return blocks; }
+        size_t                                              getEndOfData(void) const { return end_of_data; }           //!< The end of the last complete record (where a writer would continue)
+        size_t                                              getNumberOfSamples(void) const { return num_samples; }
+        const std::vector<std::string>&                     getStrings(void) const { return strings; }
+        const std::vector<size_t>&                          getStringRecords(void) const { return string_records; }
+        Tree*                                               readTree(size_t i, unsigned long &gen) const;               //!< Decode the i-th sample
+        std::vector<Tree*>                                  readTrees(const std::vector<size_t> &samples, std::vector<unsigned long> &gens) const;     //!< Decode several samples in parallel
+        void                                                writeNewickTrace(const path &fn, const std::string &delimiter) const;               //!< Convert the file into a text tree trace
+
+        static bool                                         isBinaryTreeTrace(const path &fn);                          //!< Does the file start with the magic of the format?
+
+    private:
+        Tree*                                               decodeSample(const char *p, const char *end, unsigned long &gen) const;
+        const char*                                         findSample(size_t i, const char* &sample_end) const;
+        bool                                                readIndex(void);
+        void                                                readStringRecord(const char *p, const char *end);
+        void                                                scanRecords(void);
+
+        path                                                filename;
+        MappedFile                                          file;
+        std::vector<Block>                                  blocks;
+        std::vector<std::string>                            strings;
+        std::vector<size_t>                                 string_records;
+        size_t                                              num_samples;
+        size_t                                              end_of_data;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,464 @@
+#include "BinaryTreeTraceWriter.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <utility>
+
+#include "BinaryTreeTraceFormat.h"
+#include "MappedFile.h"
+#include "NewickConverter.h"
+#include "RbException.h"
+#include "RbConstants.h"
+#include "RbMathLogic.h"
+#include "TopologyNode.h"
+#include "Tree.h"
+
+using namespace RevBayesCore;
+using namespace RevBayesCore::BinaryTreeTraceFormat;
+
+
+namespace {
+
+    /**
+     * Check if the text of an annotation is a number that we can store as a double.
+     * We only do so if we can format the double back into exactly the same text,
+     * either as the shortest representation (e.g., values printed by the monitors) or with "%f" (e.g., TopologyNode::addNodeParameter).
+     */
+    bool encodeNumber(const std::string &text, double &value, unsigned char &type)
+    {
+
+        if ( text.empty() == true || text.size() > 32 )
+        {
+            return false;
+        }
+
+        char *number_end = NULL;
+        value = strtod( text.c_str(), &number_end );
+        if ( *number_end != '\0' || RbMath::isFinite( value ) == false )
+        {
+            return false;
+        }
+
+        char buffer[64];
+        snprintf( buffer, sizeof(buffer), "%f", value );
+        if ( text == buffer )
+        {
+            type = NUMBER_FIXED;
+            return true;
+        }
+
+        for (int precision = 1; precision <= 17; ++precision)
+        {
+            snprintf( buffer, sizeof(buffer), "%.*g", precision, value );
+            if ( strtod( buffer, NULL ) == value )
+            {
+                type = NUMBER_SHORTEST;
+                return text == buffer;
+            }
+        }
+
+        return false;
+    }
+
+}
+
+
+BinaryTreeTraceWriter::BinaryTreeTraceWriter(const path &fn, bool append) :
+    filename( fn ),
+    num_samples( 0 ),
+    block_open( false )
+{
+
+    createDirectoryForFile( filename );
+
+    if ( append == true && exists( filename ) == true && file_size( filename ) > 0 )
+    {
+        // continue the string table and the blocks of the existing file
+        size_t end_of_data = 0;
+        {
+            BinaryTreeTraceReader reader( filename );
+            const std::vector<std::string> &strings = reader.getStrings();
+            for (size_t i = 0; i < strings.size(); ++i)
+            {
+                string_ids.insert( std::make_pair( strings[i], i ) );
+            }
+            string_records = reader.getStringRecords();
+            blocks = reader.getBlocks();
+            num_samples = reader.getNumberOfSamples();
+            end_of_data = reader.getEndOfData();
+        }
+
+        // remove the index (and whatever a killed run left after the last complete sample)
+        resize_file( filename, end_of_data );
+        out_stream.open( filename.string(), std::fstream::in | std::fstream::out | std::fstream::binary );
+        if ( out_stream.is_open() == false )
+        {
+            throw RbException() << "Could not open file " << filename;
+        }
+
+        // the last block may not have been closed
+        if ( blocks.empty() == false )
+        {
+            block_open = true;
+            closeBlock();
+        }
+        out_stream.seekp( 0, std::ios::end );
+    }
+    else
+    {
+        out_stream.open( filename.string(), std::fstream::out | std::fstream::trunc | std::fstream::binary );
+        out_stream.close();
+        out_stream.open( filename.string(), std::fstream::in | std::fstream::out | std::fstream::binary );
+        if ( out_stream.is_open() == false )
+        {
+            throw RbException() << "Could not open file " << filename;
+        }
+
+        std::string header( MAGIC, sizeof(MAGIC) );
+        writeRaw( header, VERSION );
+        writeRaw( header, BYTE_ORDER_MARK );
+        out_stream.write( header.data(), header.size() );
+        out_stream.flush();
+    }
+
+}
+
+
+BinaryTreeTraceWriter::~BinaryTreeTraceWriter( void )
+{
+
+    close();
+
+}
+
+
+void BinaryTreeTraceWriter::close( void )
+{
+
+    if ( out_stream.is_open() == false )
+    {
+        return;
+    }
+
+    closeBlock();
+
+    std::string index;
+    writeVarint( index, string_records.size() );
+    for (size_t i = 0; i < string_records.size(); ++i)
+    {
+        writeVarint( index, string_records[i] );
+    }
+    writeVarint( index, blocks.size() );
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        writeVarint( index, blocks[i].offset );
+        writeVarint( index, blocks[i].data_end );
+        writeVarint( index, blocks[i].first_sample );
+        writeVarint( index, blocks[i].num_samples );
+    }
+
+    uint64_t index_offset = uint64_t( out_stream.tellp() );
+    writeRecordHeader( INDEX, index.size() );
+    out_stream.write( index.data(), index.size() );
+
+    std::string footer;
+    writeRaw( footer, index_offset );
+    footer.append( INDEX_MAGIC, sizeof(INDEX_MAGIC) );
+    out_stream.write( footer.data(), footer.size() );
+
+    out_stream.close();
+
+}
+
+
+/** Write the length of the current block into its header, so that readers know where the next record starts. */
+void BinaryTreeTraceWriter::closeBlock( void )
+{
+
+    if ( block_open == false )
+    {
+        return;
+    }
+
+    const BinaryTreeTraceReader::Block &block = blocks.back();
+    uint64_t length = block.data_end - block.offset - RECORD_HEADER_SIZE;
+    out_stream.seekp( block.offset + sizeof(uint32_t) );
+    out_stream.write( reinterpret_cast<const char*>( &length ), sizeof(length) );
+    out_stream.seekp( 0, std::ios::end );
+    block_open = false;
+
+}
+
+
+void BinaryTreeTraceWriter::encodeAnnotations(const std::vector<std::string> &annotations)
+{
+
+    writeVarint( sample, annotations.size() );
+    for (size_t i = 0; i < annotations.size(); ++i)
+    {
+        // the annotations are stored as "name=value"
+        size_t equal_sign = annotations[i].find( '=' );
+        std::string value = ( equal_sign == std::string::npos ? "" : annotations[i].substr( equal_sign + 1 ) );
+        writeVarint( sample, getStringId( annotations[i].substr( 0, equal_sign ) ) );
+
+        double number = 0.0;
+        unsigned char type = TEXT;
+        if ( encodeNumber( value, number, type ) == true )
+        {
+            writeRaw( sample, type );
+            writeRaw( sample, number );
+        }
+        else
+        {
+            type = TEXT;
+            writeRaw( sample, type );
+            writeString( sample, value );
+        }
+    }
+
+}
+
+
+/**
+ * Encode a node into the current sample.
+ * We only store the branch length if the reader cannot derive it from the ages.
+ */
+void BinaryTreeTraceWriter::encodeNode(const TopologyNode &node)
+{
+
+    const std::string &name = node.getName();
+    std::string species = node.getSpeciesName();
+    double age = node.getAge();
+    double branch_length = node.getBranchLength();
+    bool has_age = RbMath::isFinite( age );
+
+    // the branch length that TopologyNode::setAge computes from the ages
+    double derived_branch_length = RbConstants::Double::nan;
+    if ( has_age == true )
+    {
+        derived_branch_length = ( node.isRoot() == true ? 0.0 : node.getParent().getAge() - age );
+    }
+    bool has_branch_length = ( branch_length != derived_branch_length && ( branch_length == branch_length || derived_branch_length == derived_branch_length ) );
+
+    unsigned char flags = 0;
+    flags |= ( node.isSampledAncestor() == true ? NODE_SAMPLED_ANCESTOR : 0 );
+    flags |= ( node.doesUseAges() == true ? NODE_USES_AGES : 0 );
+    flags |= ( has_age == true ? NODE_HAS_AGE : 0 );
+    flags |= ( has_branch_length == true ? NODE_HAS_BRANCH_LENGTH : 0 );
+    flags |= ( species == name ? NODE_SPECIES_IS_NAME : 0 );
+
+    writeVarint( sample, node.getIndex() );
+    writeVarint( sample, node.getNumberOfChildren() );
+    writeRaw( sample, flags );
+    writeVarint( sample, name.empty() == true ? NO_STRING : getStringId( name ) + 1 );
+    if ( species != name )
+    {
+        writeVarint( sample, species.empty() == true ? NO_STRING : getStringId( species ) + 1 );
+    }
+    if ( has_age == true )
+    {
+        writeRaw( sample, age );
+    }
+    if ( has_branch_length == true )
+    {
+        writeRaw( sample, branch_length );
+    }
+
+    encodeAnnotations( node.getNodeParameters() );
+    encodeAnnotations( node.getBranchParameters() );
+
+}
+
+
+size_t BinaryTreeTraceWriter::getStringId(const std::string &s)
+{
+
+    std::unordered_map<std::string, size_t>::const_iterator it = string_ids.find( s );
+    if ( it != string_ids.end() )
+    {
+        return it->second;
+    }
+
+    size_t id = string_ids.size();
+    string_ids.insert( std::make_pair( s, id ) );
+    new_strings.push_back( s );
+
+    return id;
+}
+
+
+void BinaryTreeTraceWriter::writeRecordHeader(uint32_t type, uint64_t length)
+{
+
+    out_stream.write( reinterpret_cast<const char*>( &type ), sizeof(type) );
+    out_stream.write( reinterpret_cast<const char*>( &length ), sizeof(length) );
+
+}
+
+
+/**
+ * Append a sample.
+ * The nodes are written in preorder. If the tree has names that are not yet in the string table,
+ * we close the current block and extend the table first.
+ */
+void BinaryTreeTraceWriter::writeTree(unsigned long gen, const Tree &t)
+{
+
+    if ( out_stream.is_open() == false )
+    {
+        throw RbException() << "The binary tree trace " << filename << " is already closed.";
+    }
+
+    sample.clear();
+    new_strings.clear();
+
+    unsigned char tree_flags = ( t.isRooted() == true ? TREE_ROOTED : 0 );
+    writeVarint( sample, gen );
+    writeRaw( sample, tree_flags );
+    writeVarint( sample, t.getNumberOfNodes() );
+
+    std::vector<const TopologyNode*> stack( 1, &t.getRoot() );
+    while ( stack.empty() == false )
+    {
+        const TopologyNode *node = stack.back();
+        stack.pop_back();
+        encodeNode( *node );
+
+        const std::vector<TopologyNode*> &children = node->getChildren();
+        for (std::vector<TopologyNode*>::const_reverse_iterator it = children.rbegin(); it != children.rend(); ++it)
+        {
+            stack.push_back( *it );
+        }
+    }
+
+    if ( new_strings.empty() == false )
+    {
+        closeBlock();
+
+        std::string record;
+        writeVarint( record, new_strings.size() );
+        for (size_t i = 0; i < new_strings.size(); ++i)
+        {
+            writeString( record, new_strings[i] );
+        }
+        string_records.push_back( size_t( out_stream.tellp() ) );
+        writeRecordHeader( STRINGS, record.size() );
+        out_stream.write( record.data(), record.size() );
+    }
+
+    if ( block_open == true && blocks.back().num_samples >= SAMPLES_PER_BLOCK )
+    {
+        closeBlock();
+    }
+    if ( block_open == false )
+    {
+        // the length of an open block is 0, the reader then reads the samples until the end of the file
+        size_t offset = size_t( out_stream.tellp() );
+        writeRecordHeader( BLOCK, 0 );
+        BinaryTreeTraceReader::Block block = { offset, offset + RECORD_HEADER_SIZE, num_samples, 0 };
+        blocks.push_back( block );
+        block_open = true;
+    }
+
+    std::string length;
+    writeVarint( length, sample.size() );
+    out_stream.write( length.data(), length.size() );
+    out_stream.write( sample.data(), sample.size() );
+    out_stream.flush();
+
+    blocks.back().data_end += length.size() + sample.size();
+    ++blocks.back().num_samples;
+    ++num_samples;
+
+}
+
+
+/**
+ * Convert a text tree trace (e.g., of an ExtendedNewickTreeMonitor) into the binary format.
+ * As readTreeTrace, we take the iteration from the first column and the tree from the first column that is not
+ * the posterior, likelihood, prior or replicate.
+ */
+void BinaryTreeTraceWriter::convertNewickTrace(const path &newick_fn, const path &binary_fn, const std::string &delimiter)
+{
+
+    MappedFile file( newick_fn );
+    std::vector<const char*> line_begin;
+    std::vector<const char*> line_end;
+    file.findLines( line_begin, line_end );
+
+    BinaryTreeTraceWriter writer( binary_fn, false );
+    NewickConverter converter;
+
+    bool has_header_been_read = false;
+    size_t tree_column = 0;
+    std::vector<std::pair<const char*, const char*> > columns;
+    std::vector<std::pair<const char*, const char*> > newick_strings;
+    std::vector<unsigned long> gens;
+    for (size_t i = 0; i <= line_begin.size(); ++i)
+    {
+        // we convert the trees in batches on all threads
+        if ( newick_strings.size() == 1000 || ( i == line_begin.size() && newick_strings.empty() == false ) )
+        {
+            std::vector<Tree*> trees = converter.convertFromNewick( newick_strings );
+            try
+            {
+                for (size_t k = 0; k < trees.size(); ++k)
+                {
+                    writer.writeTree( gens[k], *trees[k] );
+                }
+            }
+            catch (...)
+            {
+                for (size_t k = 0; k < trees.size(); ++k)
+                {
+                    delete trees[k];
+                }
+                throw;
+            }
+            for (size_t k = 0; k < trees.size(); ++k)
+            {
+                delete trees[k];
+            }
+            newick_strings.clear();
+            gens.clear();
+        }
+
+        // skip empty lines and comments
+        if ( i == line_begin.size() || line_begin[i] == line_end[i] || *line_begin[i] == '#' )
+        {
+            continue;
+        }
+
+        MappedFile::splitLine( line_begin[i], line_end[i], delimiter, columns );
+        if ( has_header_been_read == false )
+        {
+            for (size_t j = 1; j < columns.size(); ++j)
+            {
+                std::string column_name( columns[j].first, columns[j].second );
+                if ( column_name != "Posterior" && column_name != "Likelihood" && column_name != "Prior" && column_name != "Replicate_ID" )
+                {
+                    tree_column = j;
+                    break;
+                }
+            }
+            if ( tree_column == 0 )
+            {
+                throw RbException() << "The file " << newick_fn << " has no tree column.";
+            }
+            has_header_been_read = true;
+            continue;
+        }
+
+        if ( tree_column >= columns.size() )
+        {
+            throw RbException() << "Line " << (i + 1) << " of the file " << newick_fn << " has no tree.";
+        }
+        gens.push_back( strtoul( std::string( columns[0].first, columns[0].second ).c_str(), NULL, 10 ) );
+        newick_strings.push_back( columns[tree_column] );
+    }
+
+    writer.close();
+
+}
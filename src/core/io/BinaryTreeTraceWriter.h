@@ -0,0 +1,60 @@
+#ifndef BinaryTreeTraceWriter_H
+#define BinaryTreeTraceWriter_H
+
+#include <stddef.h>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BinaryTreeTraceReader.h"
+#include "RbFileManager.h"
+
+namespace RevBayesCore {
+
+    class TopologyNode;
+    class Tree;
+
+    /**
+     * Writer of tree traces in the binary format (see BinaryTreeTraceFormat.h).
+     *
+     * Every sample is written and flushed immediately into the current block, so a killed run loses at most
+     * the sample that was being written. The block headers and the index are completed when a block is full or the
+     * writer is closed. When appending, we continue the string table and the blocks of the existing file.
+     */
+    class BinaryTreeTraceWriter {
+
+    public:
+        BinaryTreeTraceWriter(const path &fn, bool append);
+        ~BinaryTreeTraceWriter(void);
+
+        void                                                close(void);                                                //!< Complete the current block, write the index and close the file
+        void                                                writeTree(unsigned long gen, const Tree &t);                //!< Append a sample
+
+        static void                                         convertNewickTrace(const path &newick_fn, const path &binary_fn, const std::string &delimiter);    //!< Convert a text tree trace into the binary format
+
+    private:
+        BinaryTreeTraceWriter(const BinaryTreeTraceWriter &w);                                                          //!< No copies
+        BinaryTreeTraceWriter&                              operator=(const BinaryTreeTraceWriter &w);                  //!< No copies
+
+        void                                                closeBlock(void);
+        void                                                encodeNode(const TopologyNode &node);
+        void                                                encodeAnnotations(const std::vector<std::string> &annotations);
+        size_t                                              getStringId(const std::string &s);
+        void                                                writeRecordHeader(uint32_t type, uint64_t length);
+
+        path                                                filename;
+        std::fstream                                        out_stream;
+        std::vector<BinaryTreeTraceReader::Block>           blocks;
+        std::vector<size_t>                                 string_records;
+        std::unordered_map<std::string, size_t>             string_ids;
+        std::vector<std::string>                            new_strings;                        //!< The strings of the current sample that are not yet in the file
+        std::string                                         sample;                             //!< The buffer of the current sample
+        size_t                                              num_samples;
+        bool                                                block_open;
+
+    };
+
+}
+
+#endif
@@ -2,9 +2,12 @@
 
 #include <functional>
 #include <algorithm>
+#include <cctype>
 #include <string>
+#include <utility>
 #include <sstream> // IWYU pragma: keep
 
+#include "MappedFile.h"
 #include "RbFileManager.h"
 #include "RbException.h"
 #include "StringUtilities.h"
@@ -24,43 +27,37 @@ DelimitedDataReader::DelimitedDataReader(const path &fn, std::string d, size_t l
 void DelimitedDataReader::readData( size_t lines_to_skip )
 {
     
-    std::vector<std::string> tmpChars;
-    
-    // open file
-    std::ifstream readStream( filename.string() );
-    if ( not readStream )
-    {
-        throw RbException()<<"Could not open file "<<filename.make_preferred();
-    }
+    // the file is mapped into memory and we split the lines in place
+    MappedFile file( filename );
+    std::vector<const char*> line_begin;
+    std::vector<const char*> line_end;
+    file.findLines( line_begin, line_end );
     
     chars.clear();
+    chars.reserve( line_begin.size() );
     
-    // read file
-    // bool firstLine = true;
-    std::string read_line = "";
-    size_t lines_skipped = 0;
-    while (safeGetline(readStream,read_line))
+    std::vector<std::pair<const char*, const char*> > pieces;
+    for (size_t i = lines_to_skip; i < line_begin.size(); ++i)
     {
-        ++lines_skipped;
-        if ( lines_skipped <= lines_to_skip)
-        {
-            continue;
-        }
         
         // skip blank lines
-        std::string::iterator first_nonspace = std::find_if (read_line.begin(), read_line.end(), [](int c) {return not isspace(c);});
-        if (first_nonspace == read_line.end())
+        const char* first_nonspace = std::find_if (line_begin[i], line_end[i], [](int c) {return not isspace(c);});
+        if (first_nonspace == line_end[i])
         {
             continue;
         }
 
-        StringUtilities::stringSplit(read_line, delimiter, tmpChars, true);
+        MappedFile::splitLine(line_begin[i], line_end[i], delimiter, pieces, true);
 
-        chars.push_back(tmpChars);
-        tmpChars.clear();
-    };
+        std::vector<std::string> tmpChars;
+        tmpChars.reserve( pieces.size() );
+        for (size_t j = 0; j < pieces.size(); ++j)
+        {
+            tmpChars.push_back( std::string( pieces[j].first, pieces[j].second ) );
+        }
+        chars.push_back( std::move(tmpChars) );
+    }
     
-    readStream.close();
 }
 
 const std::vector<std::vector<std::string> >& DelimitedDataReader::getChars(void)
@@ -0,0 +1,245 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "RbException.h"
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+using namespace RevBayesCore;
+
+
+MappedFile::MappedFile(const path &fn) :
+    filename( fn ),
+    data( NULL ),
+    data_size( 0 ),
+    mapping( NULL ),
+    mapping_handle( NULL )
+{
+
+    // check that the file/path name has been correctly specified
+    if ( is_regular_file( filename ) == false )
+    {
+        std::string errorStr = "";
+        formatError( filename, errorStr );
+        throw RbException(errorStr);
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW( filename.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( file != INVALID_HANDLE_VALUE )
+    {
+        LARGE_INTEGER file_size;
+        if ( GetFileSizeEx( file, &file_size ) != 0 && file_size.QuadPart > 0 )
+        {
+            HANDLE handle = CreateFileMappingW( file, NULL, PAGE_READONLY, 0, 0, NULL );
+            if ( handle != NULL )
+            {
+                mapping = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 );
+                if ( mapping != NULL )
+                {
+                    mapping_handle = handle;
+                    data_size = size_t( file_size.QuadPart );
+                }
+                else
+                {
+                    CloseHandle( handle );
+                }
+            }
+        }
+        CloseHandle( file );
+    }
+#else
+    int file = open( filename.string().c_str(), O_RDONLY );
+    if ( file >= 0 )
+    {
+        struct stat file_status;
+        if ( fstat( file, &file_status ) == 0 && file_status.st_size > 0 )
+        {
+            void *region = mmap( NULL, size_t( file_status.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+            if ( region != MAP_FAILED )
+            {
+                mapping = region;
+                data_size = size_t( file_status.st_size );
+                // we read the file front to back
+                madvise( mapping, data_size, MADV_SEQUENTIAL );
+            }
+        }
+        close( file );
+    }
+#endif
+
+    if ( mapping != NULL )
+    {
+        data = static_cast<const char*>( mapping );
+        return;
+    }
+
+    // we could not map the file (or it is empty), so we simply read it
+    std::ifstream in_stream( filename.string(), std::ios::in | std::ios::binary );
+    if ( in_stream.is_open() == false )
+    {
+        throw RbException() << "Could not open file " << filename;
+    }
+    in_stream.seekg( 0, std::ios::end );
+    std::streamoff file_size = in_stream.tellg();
+    in_stream.seekg( 0, std::ios::beg );
+    if ( file_size > 0 )
+    {
+        buffer.resize( size_t( file_size ) );
+        in_stream.read( &buffer[0], file_size );
+        buffer.resize( size_t( in_stream.gcount() ) );
+    }
+
+    data_size = buffer.size();
+    data = ( data_size > 0 ? &buffer[0] : NULL );
+
+}
+
+
+MappedFile::~MappedFile( void )
+{
+
+    if ( mapping != NULL )
+    {
+#ifdef _WIN32
+        UnmapViewOfFile( mapping );
+        CloseHandle( static_cast<HANDLE>( mapping_handle ) );
+#else
+        munmap( mapping, data_size );
+#endif
+    }
+
+}
+
+
+/**
+ * Find the beginning and the end of each line.
+ * As in safeGetline, a line ends at "\n", "\r\n" or a lone "\r", the line ends exclude these terminators,
+ * and the last line does not need to end with a terminator.
+ * We use memchr to find the next '\n' and '\r', which scans many bytes at once. We remember where we found them,
+ * so that we scan the file only once even if it uses only one of the two characters.
+ */
+void MappedFile::findLines(std::vector<const char*> &line_begin, std::vector<const char*> &line_end) const
+{
+
+    line_begin.clear();
+    line_end.clear();
+
+    const char *p           = begin();
+    const char *e           = end();
+    const char *newline     = NULL;
+    const char *carriage    = NULL;
+    while ( p < e )
+    {
+        if ( newline == NULL || newline < p )
+        {
+            newline = static_cast<const char*>( memchr( p, '\n', e - p ) );
+            newline = ( newline == NULL ? e : newline );
+        }
+        if ( carriage == NULL || carriage < p )
+        {
+            carriage = static_cast<const char*>( memchr( p, '\r', e - p ) );
+            carriage = ( carriage == NULL ? e : carriage );
+        }
+
+        const char *terminator = std::min( newline, carriage );
+        const char *next = ( terminator == e ? e : terminator + 1 );
+        if ( terminator == carriage && next == newline && next < e )
+        {
+            // "\r\n" is a single terminator
+            ++next;
+        }
+
+        line_begin.push_back( p );
+        line_end.push_back( terminator );
+
+        p = next;
+    }
+
+}
+
+
+/**
+ * Split the line [line_begin, line_end) into the pieces between the delimiters.
+ * As in StringUtilities::stringSplit, an empty delimiter splits at runs of whitespace and ignores leading and trailing whitespace,
+ * and trim removes the whitespace around each piece.
+ */
+void MappedFile::splitLine(const char *line_begin, const char *line_end, const std::string &delim, std::vector<std::pair<const char*, const char*> > &results, bool trim)
+{
+
+    results.clear();
+
+    const char *p = line_begin;
+    const char *e = line_end;
+    if ( delim.empty() == true )
+    {
+        while ( p < e && isspace( *p ) != 0 )
+        {
+            ++p;
+        }
+        while ( e > p && isspace( e[-1] ) != 0 )
+        {
+            --e;
+        }
+    }
+
+    while ( true )
+    {
+        const char *cut = e;
+        if ( delim.empty() == true )
+        {
+            cut = std::find_if( p, e, [](char c) { return isspace(c) != 0; } );
+        }
+        else if ( delim.size() == 1 )
+        {
+            const char *found = static_cast<const char*>( memchr( p, delim[0], e - p ) );
+            cut = ( found == NULL ? e : found );
+        }
+        else
+        {
+            cut = std::search( p, e, delim.begin(), delim.end() );
+        }
+
+        const char *piece_begin = p;
+        const char *piece_end   = cut;
+        if ( trim == true )
+        {
+            while ( piece_begin < piece_end && isspace( *piece_begin ) != 0 )
+            {
+                ++piece_begin;
+            }
+            while ( piece_end > piece_begin && isspace( piece_end[-1] ) != 0 )
+            {
+                --piece_end;
+            }
+        }
+        results.push_back( std::make_pair( piece_begin, piece_end ) );
+
+        if ( cut == e )
+        {
+            break;
+        }
+
+        p = cut + ( delim.empty() == true ? 1 : delim.size() );
+        if ( delim.empty() == true )
+        {
+            while ( p < e && isspace( *p ) != 0 )
+            {
+                ++p;
+            }
+        }
+    }
+
+}
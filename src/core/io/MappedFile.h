@@ -0,0 +1,49 @@
+#ifndef MappedFile_H
+#define MappedFile_H
+
+#include <stddef.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RbFileManager.h"
+
+namespace RevBayesCore {
+
+
+    /**
+     * Read-only view of the complete content of a file.
+     *
+     * The file is mapped into memory (mmap or MapViewOfFile), so that the readers can parse it in place
+     * without copying lines into strings. The operating system loads the pages when we touch them,
+     * which makes a single sequential pass over a large file (e.g., a trace of a long run) cheap.
+     * If the file cannot be mapped, we read it into a buffer instead.
+     */
+    class MappedFile {
+
+    public:
+        MappedFile(const path &fn);
+        ~MappedFile(void);
+
+        const char*                                         begin(void) const { return data; }
+        const char*                                         end(void) const { return data + data_size; }
+        void                                                findLines(std::vector<const char*> &line_begin, std::vector<const char*> &line_end) const;   //!< The lines of the file without the line endings
+        size_t                                              size(void) const { return data_size; }
+
+        static void                                         splitLine(const char *line_begin, const char *line_end, const std::string &delim, std::vector<std::pair<const char*, const char*> > &results, bool trim = false);   //!< Split a line into pieces like StringUtilities::stringSplit, but without copying them
+
+    private:
+        MappedFile(const MappedFile &f);                                                    //!< No copies
+        MappedFile&                                         operator=(const MappedFile &f);         //!< No copies
+
+        path                                                filename;
+        const char*                                         data;
+        size_t                                              data_size;
+        void*                                               mapping;                            //!< The mapped region (NULL if we read the file into the buffer)
+        void*                                               mapping_handle;                     //!< The handle of the mapping (only on Windows)
+        std::vector<char>                                   buffer;
+
+    };
+
+}
+#endif
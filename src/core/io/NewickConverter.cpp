@@ -2,11 +2,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <vector>
 #include <string>
 
 #include "RbException.h"
+#include "ThreadPool.h"
 #include "TopologyNode.h"
 #include "Tree.h"
 
@@ -25,40 +28,128 @@ NewickConverter::~NewickConverter()
 
 
 
+namespace {
+
+    // we forget the interned taxa if there are more than this (e.g., because every internal node has a distinct label)
+    const size_t MAX_INTERNED_TAXA = 100000;
+
+    /** Parse a number of the Newick string, which is not terminated where the number ends. */
+    double parseNumber(const char *begin, const char *end)
+    {
+
+        char buffer[64];
+        size_t length = size_t( end - begin );
+        if ( length < sizeof(buffer) )
+        {
+            memcpy( buffer, begin, length );
+            buffer[length] = '\0';
+            return strtod( buffer, NULL );
+        }
+
+        return strtod( std::string( begin, end ).c_str(), NULL );
+    }
+
+}
+
+
 Tree* NewickConverter::convertFromNewick(std::string const &n, bool reindex)
 {
 
-    // create and allocate the tree object
-    Tree *t = new Tree();
+    return convertFromNewick( n.data(), n.data() + n.size(), reindex );
+}
 
-    std::vector<TopologyNode*> nodes;
-    std::vector<double> brlens;
 
-    // create a string-stream and throw the string into it
-    std::stringstream ss (std::stringstream::in | std::stringstream::out);
-    ss << n;
+Tree* NewickConverter::convertFromNewick(const char *begin, const char *end, bool reindex)
+{
 
     // ignore white spaces
-    std::string trimmed = "";
-    char c;
-    while ( ss.good() )
+    if ( std::find( begin, end, ' ' ) != end )
+    {
+        trimmed.clear();
+        std::remove_copy( begin, end, std::back_inserter( trimmed ), ' ' );
+        begin = trimmed.data();
+        end   = begin + trimmed.size();
+    }
+
+    // the initial character has to be '('
+    if ( begin == end || *begin != '(' )
     {
-        // check for EOF
-        int c_int = ss.get();
-        if (c_int != EOF)
+        throw RbException("Error while converting Newick tree. We expected an opening parenthesis, but didn't get one. Problematic string: " + std::string( begin, end ));
+    }
+
+    // a tree has at most one node per parenthesis or comma (plus the root)
+    size_t max_num_nodes = 1 + std::count_if( begin, end, [](char c) { return c == '(' || c == ','; } );
+    nodes.clear();
+    brlens.clear();
+    open_nodes.clear();
+    nodes.reserve( max_num_nodes );
+    brlens.reserve( max_num_nodes );
+
+    // construct the tree starting from the root
+    TopologyNode *root = new TopologyNode();
+    try
+    {
+        open_nodes.push_back( root );
+        const char *p = begin + 1;
+        while ( open_nodes.empty() == false )
         {
-            c = char( c_int );
-            if ( c != ' ')
+            if ( p == end || *p == ';' )
             {
-                trimmed += c;
+                throw RbException()<<"Not enough closing parentheses!";
             }
 
-        }
+            if ( *p == '(' )
+            {
+                // we received an internal node, and its first child follows
+                TopologyNode *node = new TopologyNode();
+                open_nodes.back()->addChild( node );
+                node->setParent( open_nodes.back() );
+                open_nodes.push_back( node );
+                ++p;
+                continue;
+            }
+            else if ( *p == ')' )
+            {
+                // we finished the innermost open node
+                ++p;
+                TopologyNode *node = open_nodes.back();
+                open_nodes.pop_back();
+                if (node->getNumberOfChildren() == 1)
+                {
+                    node->setSampledAncestor( true );
+                }
+                readLabel( p, end, node );
+                readComment( p, end, node, false );
+                readBranchLength( p, end, node );
+                readComment( p, end, node, true );
+            }
+            else
+            {
+                // we received a tip
+                TopologyNode *node = new TopologyNode();
+                open_nodes.back()->addChild( node );
+                node->setParent( open_nodes.back() );
+                readLabel( p, end, node );
+                readComment( p, end, node, false );
+                readBranchLength( p, end, node );
+                readComment( p, end, node, true );
+            }
 
+            // skip comma
+            if ( p < end && *p == ',' )
+            {
+                ++p;
+            }
+        }
+    }
+    catch (...)
+    {
+        delete root;
+        throw;
     }
 
-    // construct the tree starting from the root
-    TopologyNode *root = createNode( trimmed, nodes, brlens );
+    // create and allocate the tree object
+    Tree *t = new Tree();
 
     // set up the tree
     t->setRoot( root, reindex );
@@ -91,382 +182,172 @@ Tree* NewickConverter::convertFromNewick(std::string const &n, bool reindex)
 }
 
 
+/**
+ * Convert the Newick strings [n[i].first, n[i].second) into trees.
+ * The strings are split into one block per thread, and each thread uses its own converter.
+ */
+std::vector<Tree*> NewickConverter::convertFromNewick(const std::vector<std::pair<const char*, const char*> > &n, bool reindex)
+{
 
-TopologyNode* NewickConverter::createNode(const std::string &n, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens) {
-
-    // create a string-stream and throw the string into it
-    std::stringstream ss (std::stringstream::in | std::stringstream::out);
-    ss << n;
-
-    char c = ' ';
-    ss.get(c);
+    std::vector<Tree*> trees( n.size(), NULL );
 
-    // the initial character has to be '('
-    if ( c != '(')
+    ThreadPool &pool = ThreadPool::threadPoolInstance();
+    size_t num_blocks = std::min( n.size(), pool.getNumberOfThreads() );
+    try
     {
-        throw RbException("Error while converting Newick tree. We expected an opening parenthesis, but didn't get one. Problematic string: " + n);
+        pool.parallelFor( num_blocks, [&](size_t block)
+        {
+            // the first block can use our buffers and interned taxa
+            NewickConverter local_converter;
+            NewickConverter &converter = ( block == 0 ? *this : local_converter );
+            for (size_t i = block * n.size() / num_blocks; i < (block + 1) * n.size() / num_blocks; ++i)
+            {
+                trees[i] = converter.convertFromNewick( n[i].first, n[i].second, reindex );
+            }
+        });
     }
-
-    TopologyNode *node = new TopologyNode();
-    while ( ss.good() && ss.peek() != ')' )
+    catch (...)
     {
-
-        TopologyNode *childNode;
-        if (ss.peek() == '(' )
+        for (size_t i = 0; i < trees.size(); ++i)
         {
-            // we received an internal node
-            int depth = 0;
-            std::string child = "";
-            do
-            {
-                ss.get(c);
-                child += c;
-                if ( c == '(' )
-                {
-                    depth++;
-                }
-                else if ( c == ')' )
-                {
-                    depth--;
-                }
+            delete trees[i];
+        }
+        throw;
+    }
 
-            } while ( ss.good() && depth > 0 );
+    return trees;
+}
 
-            // construct the child node
-            childNode = createNode( child, nodes, brlens );
-        }
-        else
-        {
-            // construct the node
-            childNode = new TopologyNode();
-        }
 
-        // set the parent child relationship
-        node->addChild( childNode );
-        childNode->setParent( node );
+const Taxon& NewickConverter::getTaxon(const char *begin, const char *end)
+{
 
-        // read the optional label
-        std::string lbl = "";
-        while ( ss.good() && (c = char( ss.peek() ) ) != ':' && c != '[' && c != ';' && c != ',' && c != ')')
+    name_buffer.assign( begin, end );
+    std::unordered_map<std::string, Taxon>::const_iterator it = taxa.find( name_buffer );
+    if ( it == taxa.end() )
+    {
+        if ( taxa.size() >= MAX_INTERNED_TAXA )
         {
-            lbl += char( ss.get() );
+            taxa.clear();
         }
-        childNode->setName( lbl );
+        it = taxa.insert( std::make_pair( name_buffer, Taxon( name_buffer ) ) ).first;
+    }
 
-        // read the optional node parameters
-        if ( ss.peek() == '[' )
-        {
+    return it->second;
+}
 
-            do
-            {
 
-                ss.ignore();
-                // ignore the '&' before parameter name
-                if ( ss.peek() == '&')
-                {
-                    ss.ignore();
-                }
-
-                // read the parameter name
-                std::string paramName = "";
-                while ( ss.good() && (c = char( ss.peek() ) ) != '=' && c != ',' && c != ']')
-                {
-                    paramName += char( ss.get() );
-                }
+/** Read the optional branch length and add the node to the list of nodes (with branch length 0 if there is none). */
+void NewickConverter::readBranchLength(const char* &p, const char *end, TopologyNode *node)
+{
 
-                // ignore the equal sign between parameter name and value
-                if ( ss.peek() == '=')
-                {
-                    ss.ignore();
-                }
+    double brlen = 0.0;
+    if ( p < end && *p == ':' )
+    {
+        ++p;
+        const char *time_begin = p;
+        while ( p < end && *p != ';' && *p != ',' && *p != ')' && *p != '[' )
+        {
+            ++p;
+        }
+        brlen = parseNumber( time_begin, p );
+    }
 
-                // read the parameter name
-                std::string paramValue = "";
-                while ( ss.good() && (c = char( ss.peek() ) ) != ']' && c != ',' && c != ':')
-                {
-                    paramValue += char( ss.get() );
-                }
+    nodes.push_back( node );
+    brlens.push_back( brlen );
 
-				if (paramName == "index")
-                {
-					// subtract by 1 to correct RevLanguage 1-based indexing
-                    childNode->setIndex( atoi(paramValue.c_str()) - 1 );
+}
 
-                }
-                else if (paramName=="species")
-                {
-                    childNode->setSpeciesName(paramValue);
-				}
-                else
-                {
-                    childNode->addNodeParameter(paramName, paramValue);
-                }
 
-            } while ( (c = char( ss.peek() ) ) == ',' );
+/**
+ * Read the optional node (or branch) parameters, e.g., "[&rate=0.1,index=3]".
+ * The parameters "index" and "species" set the index and the species name of the node.
+ */
+void NewickConverter::readComment(const char* &p, const char *end, TopologyNode *node, bool branch)
+{
 
-            // ignore the final ']'
-            if ( (c = char( ss.peek( ) ) ) == ']' )
-            {
-                ss.ignore();
-            }
+    if ( p == end || *p != '[' )
+    {
+        return;
+    }
 
-        }
+    do
+    {
+        // ignore the '[' or the ',' before the parameter
+        ++p;
 
-        // read the optional branch length
-        if ( ss.peek() == ':' )
+        // ignore the '&' before parameter name
+        if ( p < end && *p == '&' )
         {
-            ss.ignore();
-            std::string time = "";
-            while ( ss.good() && (c = char( ss.peek( ) ) ) != ';' && c != ',' && c != ')' && c != '[' )
-            {
-                time += char( ss.get() );
-            }
-
-            std::istringstream stm;
-            stm.str(time);
-            double d;
-            stm >> d;
-            nodes.push_back( childNode );
-            brlens.push_back( d );
+            ++p;
         }
-        else
+
+        // read the parameter name
+        const char *name_begin = p;
+        while ( p < end && *p != '=' && *p != ',' && *p != ']' )
         {
-            nodes.push_back( childNode );
-            brlens.push_back( 0.0 );
+            ++p;
         }
+        std::string param_name( name_begin, p );
 
-        // read the optional branch parameters
-        if ( char( ss.peek() ) == '[' )
+        // ignore the equal sign between parameter name and value
+        if ( p < end && *p == '=' )
         {
-
-            do
-            {
-
-                ss.ignore();
-
-                // ignore the '&' before parameter name
-                if ( char( ss.peek() ) == '&')
-                {
-                    ss.ignore();
-                }
-
-                // read the parameter name
-                std::string paramName = "";
-                while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-                {
-                    paramName += char( ss.get() );
-                }
-
-                // ignore the equal sign between parameter name and value
-                if ( char( ss.peek() ) == '=')
-                {
-                    ss.ignore();
-                }
-
-                // read the parameter name
-                std::string paramValue = "";
-                while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-                {
-                    paramValue += char( ss.get() );
-                }
-
-                if (paramName=="index")
-                {
-                    // subtract by 1 to correct RevLanguage 1-based indexing
-                    childNode->setIndex( atoi(paramValue.c_str()) - 1 );
-                }
-                else if (paramName=="species")
-                {
-                    childNode->setSpeciesName(paramValue);
-                }
-                else
-                {
-                    childNode->addBranchParameter(paramName, paramValue);
-                }
-
-
-            } while ( (c = char( ss.peek() )) != ']' );
-
-            ss.ignore();
-
+            ++p;
         }
 
-
-        // skip comma
-        if ( char( ss.peek() ) == ',' )
+        // read the parameter value
+        const char *value_begin = p;
+        while ( p < end && *p != ']' && *p != ',' && *p != ':' )
         {
-            ss.ignore();
+            ++p;
         }
+        std::string param_value( value_begin, p );
 
-        // skip comma
-        if ( char( ss.peek() ) == ';' )
+        if ( param_name == "index" )
         {
-            // Avoid infinite loop.
-            throw RbException()<<"Not enough closing parentheses!";
+            // subtract by 1 to correct RevLanguage 1-based indexing
+            node->setIndex( atoi(param_value.c_str()) - 1 );
         }
-    }
-
-    if (node->getNumberOfChildren() == 1)
-    {
-        node->setSampledAncestor( true );
-    }
-
-    // remove closing parenthesis
-    ss.ignore();
-
-    // read the optional label, checking for EOF = '\377'
-    std::string lbl = "";
-    while ( ss.good() && (c = char( ss.peek() )) != ':' && c != ';' && c != ',' && c != '[' && c != '\377')
-    {
-        lbl += char( ss.get() );
-    }
-    node->setName( lbl );
-
-    // read the optional node parameters
-    if ( char( ss.peek() ) == '[' )
-    {
-
-        do
+        else if ( param_name == "species" )
         {
-
-            ss.ignore();
-
-            // ignore the '&' before parameter name
-            if ( char( ss.peek() ) == '&')
-            {
-                ss.ignore();
-            }
-
-            // read the parameter name
-            std::string paramName = "";
-            while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-            {
-                paramName += char( ss.get() );
-            }
-
-            // ignore the equal sign between parameter name and value
-            if ( char( ss.peek() ) == '=')
-            {
-                ss.ignore();
-            }
-
-            // read the parameter name
-            std::string paramValue = "";
-            while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-            {
-                paramValue += char( ss.get() );
-            }
-
-			if (paramName=="index")
-            {
-				// subtract by 1 to correct RevLanguage 1-based indexing
-				node->setIndex( atoi(paramValue.c_str()) - 1 );
-
-			}
-            else if (paramName=="species")
-            {
-				node->setSpeciesName(paramValue);
-            }
-            else
-            {
-                node->addNodeParameter(paramName, paramValue);
-            }
-
-
-        } while ( (c = char( ss.peek() )) == ',' );
-
-        // ignore the final ']'
-        if ( (c = char( ss.peek() )) == ']' )
+            node->setSpeciesName( param_value );
+        }
+        else if ( branch == true )
         {
-            ss.ignore();
+            node->addBranchParameter( param_name, param_value );
         }
-
-    }
-
-    // read the optional branch length
-    if ( char( ss.peek() ) == ':' )
-    {
-        ss.ignore();
-        std::string time = "";
-        while ( ss.good() && (c = char( ss.peek() )) != ';' && c != ',' && c != '[' )
+        else
         {
-            time += char( ss.get() );
+            node->addNodeParameter( param_name, param_value );
         }
 
-        std::istringstream stm;
-        stm.str(time);
-        double d;
-        stm >> d;
-        nodes.push_back( node );
-        brlens.push_back( d );
-    }
-    else
-    {
-        nodes.push_back( node );
-        brlens.push_back( 0.0 );
-    }
-
+    } while ( p < end && ( *p == ',' || ( branch == true && *p != ']' ) ) );
 
-
-    // read the optional branch parameters
-    if ( char( ss.peek() ) == '[' )
+    // ignore the final ']'
+    if ( p < end && *p == ']' )
     {
+        ++p;
+    }
 
-        do
-        {
-
-            ss.ignore();
-
-            // ignore the '&' before parameter name
-            if ( char( ss.peek() ) == '&')
-            {
-                ss.ignore();
-            }
-
-            // read the parameter name
-            std::string paramName = "";
-            while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-            {
-                paramName += char( ss.get() );
-            }
-
-            // ignore the equal sign between parameter name and value
-            if ( char( ss.peek() ) == '=')
-            {
-                ss.ignore();
-            }
-
-            // read the parameter name
-            std::string paramValue = "";
-            while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-            {
-                paramValue += char( ss.get() );
-            }
-
-            if (paramName=="index")
-            {
-                // subtract by 1 to correct RevLanguage 1-based indexing
-                node->setIndex( atoi(paramValue.c_str()) - 1 );
-
-            }
-            else if (paramName=="species")
-            {
-                node->setSpeciesName(paramValue);
-            }
-            else
-            {
-                node->addBranchParameter(paramName, paramValue);
-            }
-
+}
 
-        } while ( (c = char( ss.peek() )) != ']' );
 
-        ss.ignore();
+/** Read the optional label of the node. */
+void NewickConverter::readLabel(const char* &p, const char *end, TopologyNode *node)
+{
 
+    const char *label_begin = p;
+    while ( p < end && *p != ':' && *p != '[' && *p != ';' && *p != ',' && *p != ')' )
+    {
+        ++p;
     }
 
+    if ( p > label_begin )
+    {
+        node->setTaxon( getTaxon( label_begin, p ) );
+    }
 
-    return node;
 }
 
 
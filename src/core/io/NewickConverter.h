@@ -20,14 +20,28 @@
 #define NewickConverter_H
 
 
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
-#include <iosfwd>
+
+#include "Taxon.h"
 
 namespace RevBayesCore {
 
     class Tree;
     class TopologyNode;
 
+    /**
+     * Converter of Newick strings (with NHX/BEAST style comments) into trees.
+     *
+     * The parser makes a single pass over the string and keeps the open internal nodes on a stack,
+     * so it neither copies the subtrees nor recurses. The buffers of the parser and a table of the taxa
+     * seen so far live as long as the converter, so converting many trees with the same converter
+     * neither reallocates the buffers nor creates the same taxon names again.
+     * Many trees (e.g., the samples of a tree trace) can be converted on several threads at once.
+     */
     class NewickConverter {
 
     public:
@@ -35,10 +49,22 @@ namespace RevBayesCore {
         virtual                 ~NewickConverter();
     
         Tree*                   convertFromNewick(const std::string &n, bool reindex = true );
+        Tree*                   convertFromNewick(const char *begin, const char *end, bool reindex = true );
+        std::vector<Tree*>      convertFromNewick(const std::vector<std::pair<const char*, const char*> > &n, bool reindex = true );    //!< Convert many Newick strings in parallel, keeping their order
 //        AdmixtureTree*          getAdmixtureTreeFromNewick(const std::string &n);
 
     private:
-        TopologyNode*           createNode(const std::string &n, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens);
+        const Taxon&            getTaxon(const char *begin, const char *end);                                                       //!< The interned taxon with this name
+        void                    readBranchLength(const char* &p, const char *end, TopologyNode *node);
+        void                    readComment(const char* &p, const char *end, TopologyNode *node, bool branch);
+        void                    readLabel(const char* &p, const char *end, TopologyNode *node);
+
+        std::vector<TopologyNode*>                  nodes;                                                                          //!< The nodes of the current tree in post-order
+        std::vector<double>                         brlens;                                                                         //!< The branch lengths of these nodes
+        std::vector<TopologyNode*>                  open_nodes;                                                                     //!< The internal nodes whose closing parenthesis we have not reached yet
+        std::string                                 trimmed;                                                                        //!< The Newick string without spaces
+        std::string                                 name_buffer;
+        std::unordered_map<std::string, Taxon>      taxa;
     };
 
 }
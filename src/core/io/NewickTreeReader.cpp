@@ -1,7 +1,8 @@
-#include <fstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "MappedFile.h"
 #include "NewickConverter.h"
 #include "NewickTreeReader.h"
 #include "RbException.h"
@@ -29,36 +30,25 @@ NewickTreeReader::NewickTreeReader()
  */
 std::vector<Tree*>* NewickTreeReader::readBranchLengthTrees(const path& fn)
 {
-    /* Open file */
-    std::ifstream inFile( fn.string() );
-    
-    if ( !inFile )
-        throw RbException()<<"Could not open file "<<fn;
-    
-    /* Initialize */
-    std::vector<Tree*>* trees = new std::vector<Tree*>();
-    std::string commandLine;
-    
-    /* line-processing loop */
-    while ( inFile.good() ) 
+    // the file is mapped into memory and every non-empty line is a tree
+    MappedFile file( fn );
+    std::vector<const char*> line_begin;
+    std::vector<const char*> line_end;
+    file.findLines( line_begin, line_end );
+
+    std::vector<std::pair<const char*, const char*> > newick_strings;
+    for (size_t i = 0; i < line_begin.size(); ++i)
     {
-        
-        // Read a line
-        std::string line;
-        safeGetline( inFile, line );
-        
         // skip empty lines
-        if (line.length() == 0) 
+        if ( line_begin[i] != line_end[i] )
         {
-            continue;
+            newick_strings.push_back( std::make_pair( line_begin[i], line_end[i] ) );
         }
-                
-        
-        NewickConverter c;
-        Tree *blTree = c.convertFromNewick( line );
-        
-        trees->push_back( blTree );
     }
+
+    // convert the trees on all threads
+    NewickConverter c;
+    std::vector<Tree*>* trees = new std::vector<Tree*>( c.convertFromNewick( newick_strings ) );
     
     return trees;
 }
@@ -1,101 +1,234 @@
 #include <stddef.h>
-#include <ios>
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "MappedFile.h"
 #include "RbException.h"
 #include "RbFileManager.h"
-#include "StringUtilities.h"
+#include "ThreadPool.h"
 #include "TraceReader.h"
 #include "Trace.h"
+#include "TraceNumeric.h"
 
 using namespace RevBayesCore;
 
 
-/** Read Model Trace */
-std::vector<ModelTrace> TraceReader::readStochasticVariableTrace( const path &fn, const std::string &delimiter )
+namespace {
+
+    /**
+     * Find the lines of a trace file, skipping empty lines and comments.
+     * The first of the remaining lines is the header.
+     */
+    void findTraceLines(const MappedFile &file, std::vector<const char*> &line_begin, std::vector<const char*> &line_end)
+    {
+
+        file.findLines( line_begin, line_end );
+
+        size_t num_lines = 0;
+        for (size_t i = 0; i < line_begin.size(); ++i)
+        {
+            const char *first_nonspace = std::find_if( line_begin[i], line_end[i], [](char c) { return isspace(c) == 0; } );
+            if ( first_nonspace == line_end[i] || *line_begin[i] == '#' )
+            {
+                continue;
+            }
+            line_begin[num_lines] = line_begin[i];
+            line_end[num_lines]   = line_end[i];
+            ++num_lines;
+        }
+        line_begin.resize( num_lines );
+        line_end.resize( num_lines );
+
+    }
+
+
+    /** Parse a number of the mapped file, which (unlike the strings that strtod expects) is not terminated. */
+    double parseDouble(const char *begin, const char *end)
+    {
+
+        char buffer[64];
+        size_t length = size_t( end - begin );
+        if ( length < sizeof(buffer) )
+        {
+            memcpy( buffer, begin, length );
+            buffer[length] = '\0';
+            return strtod( buffer, NULL );
+        }
+
+        return strtod( std::string( begin, end ).c_str(), NULL );
+    }
+
+}
+
+
+/**
+ * Read the numeric traces of the columns column_names (or of all columns if column_names is empty).
+ *
+ * We keep every thinning-th sample. The burnin is the number of samples (or, if burnin is negative, the fraction of samples)
+ * after thinning that we either mark as burnin of the traces or, if discard_burnin is true, do not read at all.
+ * The last line of the file is ignored if it has fewer columns than the header, because it was probably being written when the run stopped.
+ */
+std::vector<TraceNumeric> TraceReader::readNumericTrace( const path &fn, const std::string &delimiter, const std::vector<std::string> &column_names, size_t thinning, long burnin, double burnin_fraction, bool discard_burnin )
 {
-    
-    // check that the file/path name has been correctly specified
-    if ( not is_regular_file(fn) )
-    {        
-        std::string errorStr = "";
-        formatError( fn, errorStr );
-        throw RbException(errorStr);
+
+    MappedFile file( fn );
+
+    std::vector<const char*> line_begin;
+    std::vector<const char*> line_end;
+    findTraceLines( file, line_begin, line_end );
+
+    std::vector<TraceNumeric> data;
+    if ( line_begin.empty() == true )
+    {
+        return data;
     }
-    
-    std::vector<ModelTrace> data;
-    
-    bool hasHeaderBeenRead = false;
-    
-    // Open file
-    std::ifstream inFile( fn.string() );
-        
-    if ( !inFile )
+
+    // we assume a header at the first line of the file
+    std::vector<std::pair<const char*, const char*> > header;
+    MappedFile::splitLine( line_begin[0], line_end[0], delimiter, header );
+    std::vector<std::string> header_names;
+    for (size_t j = 0; j < header.size(); ++j)
     {
-        throw RbException()<<"Could not open file "<<fn;
+        header_names.push_back( std::string( header[j].first, header[j].second ) );
     }
-        
-    // Initialize
-    std::string commandLine;
-//        RBOUT("Processing file \"" + *p + "\"");
-        
-    // Command-processing loop
-    while ( inFile.good() )
+
+    // the columns that we parse
+    std::vector<size_t> columns;
+    for (size_t j = 0; j < header_names.size(); ++j)
     {
-            
-        // Read a line
-        std::string line;
-        safeGetline( inFile, line );
-        
-        // skip empty lines
-        //line = stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-        if (line.length() == 0)
+        if ( column_names.empty() == true || std::find( column_names.begin(), column_names.end(), header_names[j] ) != column_names.end() )
         {
-            continue;
+            columns.push_back( j );
         }
-            
-            
-        // removing comments
-        if (line[0] == '#')
+    }
+    for (size_t i = 0; i < column_names.size(); ++i)
+    {
+        if ( std::find( header_names.begin(), header_names.end(), column_names[i] ) == header_names.end() )
         {
-            continue;
+            throw RbException() << "The trace file " << fn << " has no column '" << column_names[i] << "'.";
         }
-            
+    }
+
+    // drop an incomplete last line
+    size_t num_samples = line_begin.size() - 1;
+    std::vector<std::pair<const char*, const char*> > pieces;
+    if ( num_samples > 0 )
+    {
+        MappedFile::splitLine( line_begin.back(), line_end.back(), delimiter, pieces );
+        if ( pieces.size() < header_names.size() )
+        {
+            --num_samples;
+        }
+    }
+
+    // the samples that we keep after thinning and (maybe) removing the burnin
+    if ( thinning == 0 )
+    {
+        thinning = 1;
+    }
+    size_t num_thinned_samples = (num_samples + thinning - 1) / thinning;
+    size_t num_burnin = ( burnin >= 0 ? size_t( burnin ) : size_t( floor( num_thinned_samples * burnin_fraction ) ) );
+    num_burnin = std::min( num_burnin, num_thinned_samples );
+    size_t first_sample = ( discard_burnin == true ? num_burnin : 0 );
+    size_t num_kept_samples = num_thinned_samples - first_sample;
+
+    // parse the samples in parallel, each thread a contiguous block of samples
+    std::vector<std::vector<double> > values( columns.size(), std::vector<double>( num_kept_samples, 0.0 ) );
+    size_t max_column = ( columns.empty() == true ? 0 : columns.back() );
+    if ( num_kept_samples > 0 && columns.empty() == false )
+    {
+        ThreadPool &pool = ThreadPool::threadPoolInstance();
+        size_t num_blocks = std::min( num_kept_samples, pool.getNumberOfThreads() );
+        pool.parallelFor( num_blocks, [&](size_t block)
+        {
+            std::vector<std::pair<const char*, const char*> > block_pieces;
+            for (size_t k = block * num_kept_samples / num_blocks; k < (block + 1) * num_kept_samples / num_blocks; ++k)
+            {
+                // the header is the line 0
+                size_t sample = (first_sample + k) * thinning;
+                MappedFile::splitLine( line_begin[sample + 1], line_end[sample + 1], delimiter, block_pieces );
+                if ( block_pieces.size() <= max_column )
+                {
+                    throw RbException() << "Sample " << (sample + 1) << " of the trace file " << fn << " has only " << block_pieces.size() << " columns.";
+                }
+                for (size_t j = 0; j < columns.size(); ++j)
+                {
+                    const std::pair<const char*, const char*> &piece = block_pieces[ columns[j] ];
+                    values[j][k] = parseDouble( piece.first, piece.second );
+                }
+            }
+        });
+    }
+
+    data.resize( columns.size() );
+    for (size_t j = 0; j < columns.size(); ++j)
+    {
+        TraceNumeric &t = data[j];
+        t.setParameterName( header_names[ columns[j] ] );
+        t.setFileName( fn );
+        t.setValues( std::move( values[j] ) );
+        t.setBurnin( discard_burnin == true ? 0 : long( num_burnin ) );
+    }
+
+    return data;
+}
+
+
+/** Read Model Trace */
+std::vector<ModelTrace> TraceReader::readStochasticVariableTrace( const path &fn, const std::string &delimiter )
+{
+
+    MappedFile file( fn );
+
+    std::vector<const char*> line_begin;
+    std::vector<const char*> line_end;
+    findTraceLines( file, line_begin, line_end );
+
+    std::vector<ModelTrace> data;
+    std::vector<std::pair<const char*, const char*> > columns;
+    for (size_t i = 0; i < line_begin.size(); ++i)
+    {
         // splitting every line into its columns
-        std::vector<std::string> columns;
-        StringUtilities::stringSplit(line, delimiter, columns);
-            
+        MappedFile::splitLine( line_begin[i], line_end[i], delimiter, columns );
+
         // we assume a header at the first line of the file
-        if ( hasHeaderBeenRead == false )
+        if ( i == 0 )
         {
-                
+
             for (size_t j=0; j<columns.size(); ++j)
             {
                 ModelTrace t;
-                    
-                std::string parmName = columns[j];
+
+                std::string parmName = std::string( columns[j].first, columns[j].second );
                 t.setParameterName(parmName);
                 t.setFileName( fn );
-                    
+
                 data.push_back( t );
             }
-                
-            hasHeaderBeenRead = true;
-                
+
             continue;
         }
-            
+
+        if ( columns.size() > data.size() )
+        {
+            throw RbException() << "Sample " << i << " of the trace file " << fn << " has more columns than the header.";
+        }
+
         // adding values to the Tracess
         for (size_t j=0; j<columns.size(); ++j)
         {
             ModelTrace& t = data[j];
-            std::string tmp = columns[j];
-            t.addObject( tmp );
+            t.addObject( std::string( columns[j].first, columns[j].second ) );
         }
-            
+
     }
-    
+
     // return the vector of traces
     return data;
 }
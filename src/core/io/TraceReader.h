@@ -2,6 +2,7 @@
 #define TraceReader_H
 
 #include "Trace.h"
+#include "TraceNumeric.h"
 #include "RbFileManager.h"
 
 #include <vector>
@@ -15,6 +16,10 @@ namespace RevBayesCore {
      *
      * This reader is a reader of a trace files, e.g., tree-traces or stochastic variable traces.
      *
+     * The file is memory-mapped and parsed in place (see MappedFile), without reading it line by line into strings.
+     * Numeric traces are parsed directly into the value buffers of the traces, in parallel over the samples.
+     * We only parse the requested columns and drop the thinned (and, if requested, the burnin) samples before parsing them.
+     *
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -26,6 +31,7 @@ namespace RevBayesCore {
     public:
 //        TraceReader();
         
+        std::vector<TraceNumeric>           readNumericTrace( const path &fn, const std::string &delimiter, const std::vector<std::string> &column_names, size_t thinning, long burnin, double burnin_fraction, bool discard_burnin );
         std::vector<ModelTrace>             readStochasticVariableTrace( const path &fn, const std::string &delimiter );
 
         
@@ -1,268 +1,602 @@
 #include "DiscreteTaxonData.h"
 #include "VCFReader.h"
-#include "PoMoState4.h"
-#include "PoMoState.h"
+#include "RbException.h"
 #include "RbFileManager.h"
+#include "RlUserInterface.h"
+#include "StringUtilities.h"
+#include "ThreadPool.h"
 
-#include "RbConstants.h"
-
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
 #include <string>
 
+#ifdef RB_ZLIB
+#include <zlib.h>
+#endif
+
 
 using namespace RevBayesCore;
 
 
-VCFReader::VCFReader(const std::string &fn) : DelimitedDataReader(fn)
-{
-    filename = fn;
-    ploidy = DIPLOID;
-}
+namespace {
 
+    // the codes of the alleles
+    const unsigned char REFERENCE_ALLELE    = 0;
+    const unsigned char ALTERNATIVE_ALLELE  = 1;
+    const unsigned char MISSING_ALLELE      = 2;
 
-HomologousDiscreteCharacterData<BinaryState>* VCFReader::readBinaryMatrix( void )
-{
-    HomologousDiscreteCharacterData<BinaryState> *matrix = new HomologousDiscreteCharacterData<BinaryState> ();
-    
-    int start = 0;
-    // Skip comments.
-    while ( chars[start][0][0] == '#' )
+    // the code of a REF or ALT allele that is not a single base (e.g., an indel)
+    const char          NO_SINGLE_BASE      = '\0';
+
+    // we read the file in chunks of (at least) this many bytes
+    const size_t CHUNK_SIZE                 = 16 * 1024 * 1024;
+
+
+    /**
+     * Input stream of a plain or (if we have zlib) a gzip/bgzip compressed file.
+     * zlib reads uncompressed files transparently, and a bgzip file is simply a series of gzip members.
+     */
+    class VCFInputStream {
+
+    public:
+        VCFInputStream(const path &fn);
+        ~VCFInputStream(void);
+
+        size_t                      read(char *buffer, size_t n);                       //!< Read up to n bytes, returns 0 at the end of the file
+
+    private:
+        VCFInputStream(const VCFInputStream &s);                                        //!< No copies
+        VCFInputStream&             operator=(const VCFInputStream &s);                 //!< No copies
+
+        path                        file_name;
+#ifdef RB_ZLIB
+        gzFile                      gz_file;
+#else
+        std::ifstream               in_stream;
+#endif
+    };
+
+
+    VCFInputStream::VCFInputStream(const path &fn) :
+        file_name( fn )
     {
-        start = start + 1;
+
+        if ( is_regular_file( file_name ) == false )
+        {
+            std::string errorStr = "";
+            formatError( file_name, errorStr );
+            throw RbException(errorStr);
+        }
+
+#ifdef RB_ZLIB
+        gz_file = gzopen( file_name.string().c_str(), "rb" );
+        if ( gz_file == NULL )
+        {
+            throw RbException() << "Could not open file " << file_name;
+        }
+        gzbuffer( gz_file, 1 << 20 );
+#else
+        in_stream.open( file_name.string(), std::ios::in | std::ios::binary );
+        if ( in_stream.is_open() == false )
+        {
+            throw RbException() << "Could not open file " << file_name;
+        }
+
+        // check for the gzip magic number, because we cannot decompress without zlib
+        unsigned char magic[2] = { 0, 0 };
+        in_stream.read( reinterpret_cast<char*>(magic), 2 );
+        if ( in_stream.gcount() == 2 && magic[0] == 0x1f && magic[1] == 0x8b )
+        {
+            throw RbException() << "The file " << file_name << " is compressed, but this version of RevBayes was compiled without zlib.";
+        }
+        in_stream.clear();
+        in_stream.seekg( 0 );
+#endif
+
     }
-    
-    std::vector<std::string> sample_names;
-    size_t samples_start_column = 0;
-    const std::vector<std::string> &format_line = chars[start-1];
-    while ( format_line[samples_start_column] != "FORMAT" )
-    {
-        ++samples_start_column;
-    };
-    ++samples_start_column;
-    for (size_t j = samples_start_column; j < format_line.size(); ++j)
+
+
+    VCFInputStream::~VCFInputStream( void )
     {
-        sample_names.push_back( format_line[j] );
+
+#ifdef RB_ZLIB
+        gzclose( gz_file );
+#endif
     }
-    size_t NUM_SAMPLES = sample_names.size();
-    std::vector< DiscreteTaxonData<BinaryState> > taxa;
-    if ( ploidy == HAPLOID )
+
+
+    size_t VCFInputStream::read(char *buffer, size_t n)
     {
-        taxa = std::vector< DiscreteTaxonData<BinaryState> >( NUM_SAMPLES, DiscreteTaxonData<BinaryState>( Taxon("") ) );
-        for (size_t i=0; i<NUM_SAMPLES; ++i)
+
+#ifdef RB_ZLIB
+        int n_read = gzread( gz_file, buffer, unsigned(n) );
+        if ( n_read < 0 )
         {
-            Taxon this_taxon = Taxon( sample_names[i] + "" );
-            taxa[i] = DiscreteTaxonData<BinaryState>( this_taxon );
+            int error_code = 0;
+            throw RbException() << "Could not read file " << file_name << ": " << gzerror( gz_file, &error_code );
         }
+        return size_t( n_read );
+#else
+        in_stream.read( buffer, n );
+        return size_t( in_stream.gcount() );
+#endif
+    }
+
+
+    /** The columns of the VCF file that we need. */
+    struct VCFColumns {
+
+        size_t                      ref_index;
+        size_t                      alt_index;
+        size_t                      samples_start_column;
+        size_t                      num_samples;
+        size_t                      alleles_per_sample;
+    };
+
+
+    inline bool isDelimiter(char c)
+    {
+        return c == '\t' || c == ' ' || c == '\r';
     }
-     else if ( ploidy == DIPLOID )
+
+
+    unsigned char decodeAllele(const char *begin, const char *end)
     {
-        taxa = std::vector< DiscreteTaxonData<BinaryState> >( 2*NUM_SAMPLES, DiscreteTaxonData<BinaryState>( Taxon("") ) );
-        for (size_t i=0; i<NUM_SAMPLES; ++i)
+
+        if ( end - begin == 1 )
         {
-            Taxon this_taxon_A = Taxon( sample_names[i] + "_A" );
-            taxa[i] = DiscreteTaxonData<BinaryState>( this_taxon_A );
-            Taxon this_taxon_B = Taxon( sample_names[i] + "_B" );
-            taxa[i+NUM_SAMPLES] = DiscreteTaxonData<BinaryState>( this_taxon_B );
+            if ( *begin == '0' )
+            {
+                return REFERENCE_ALLELE;
+            }
+            else if ( *begin == '1' )
+            {
+                return ALTERNATIVE_ALLELE;
+            }
+            else if ( *begin == '.' )
+            {
+                return MISSING_ALLELE;
+            }
         }
+
+        throw RbException() << "Unknown scored character '" << std::string(begin, end) << "'!";
     }
-    else
+
+
+    /**
+     * Decode the base of the REF or ALT column.
+     * Only the first allele of a multi-allelic ALT column (e.g., "A,G") can be used, because we only accept the genotypes 0 and 1.
+     * A missing allele is coded as '.' and an allele that is not a single base as NO_SINGLE_BASE.
+     */
+    char decodeBase(const char *begin, const char *end)
     {
-        throw RbException("Currently we have only implementations for haploid and diploid organisms.");
+
+        const char *allele_end = std::find( begin, end, ',' );
+        if ( allele_end - begin != 1 )
+        {
+            return NO_SINGLE_BASE;
+        }
+
+        return *begin;
     }
-    
-    BinaryState missing_state = BinaryState("0");
-    missing_state.setMissingState( true );
-    
-    for (size_t i = start; i < chars.size(); ++i)
+
+
+    /**
+     * Decode the genotypes of a data line without creating any strings.
+     * The alleles are stored haplotype by haplotype, i.e., the allele of haplotype h at this line is alleles[h*num_lines + line],
+     * where the k-th allele of sample j belongs to haplotype k*num_samples + j.
+     */
+    void decodeLine(const char *begin, const char *end, const VCFColumns &columns, size_t line, size_t num_lines, unsigned char *alleles, char *ref_bases, char *alt_bases)
     {
-        
-        for (size_t j = 0; j < NUM_SAMPLES; ++j)
+
+        size_t column = 0;
+        size_t end_of_samples = columns.samples_start_column + columns.num_samples;
+        const char *p = begin;
+        while ( p < end && column < end_of_samples )
         {
-            
-            const std::string &this_char_read = chars[i][j+samples_start_column];
-            std::vector<std::string> format_tokens;
-            StringUtilities::stringSplit(this_char_read, ":", format_tokens);
-            
-            std::string this_alleles = format_tokens[0];
-            StringUtilities::replaceAllOccurrences(this_alleles, '/', '|');
-            std::vector<std::string> allele_tokens;
-            StringUtilities::stringSplit(this_alleles, "|", allele_tokens);
-            
-            if ( ploidy == DIPLOID )
+            while ( p < end && isDelimiter(*p) == true )
             {
-                // first allele
-                if ( allele_tokens[0] == "0")
-                {
-                    taxa[j].addCharacter( BinaryState("0") );
-                }
-                else if ( allele_tokens[0] == "1" )
-                {
-                    taxa[j].addCharacter( BinaryState("1") );
-                }
-                else if ( allele_tokens[0] == "." )
-                {
-                    taxa[j].addCharacter( missing_state );
-                }
-                else
-                {
-                    throw RbException("Unknown scored character!");
-                }
-                
-                // second allele
-                if ( allele_tokens[1] == "0")
-                {
-                    taxa[j+NUM_SAMPLES].addCharacter( BinaryState("0") );
-                }
-                else if ( allele_tokens[1] == "1" )
-                {
-                    taxa[j+NUM_SAMPLES].addCharacter( BinaryState("1") );
-                }
-                else if ( allele_tokens[1] == "." )
-                {
-                    taxa[j+NUM_SAMPLES].addCharacter( missing_state );
-                }
-                else
+                ++p;
+            }
+            if ( p == end )
+            {
+                break;
+            }
+            const char *token_end = p;
+            while ( token_end < end && isDelimiter(*token_end) == false )
+            {
+                ++token_end;
+            }
+
+            if ( column == columns.ref_index && ref_bases != NULL )
+            {
+                ref_bases[line] = decodeBase( p, token_end );
+            }
+            if ( column == columns.alt_index && alt_bases != NULL )
+            {
+                alt_bases[line] = decodeBase( p, token_end );
+            }
+
+            if ( column >= columns.samples_start_column )
+            {
+                size_t sample = column - columns.samples_start_column;
+
+                // the genotype is the first field of the sample, e.g., "0|1:35:..."
+                const char *genotype_end = std::find( p, token_end, ':' );
+                bool all_missing = ( genotype_end - p == 1 && *p == '.' );
+
+                const char *allele = p;
+                for (size_t k = 0; k < columns.alleles_per_sample; ++k)
                 {
-                    throw RbException("Unknown scored character!");
+                    unsigned char code = MISSING_ALLELE;
+                    if ( all_missing == false )
+                    {
+                        if ( allele >= genotype_end )
+                        {
+                            throw RbException() << "The genotype '" << std::string(p, genotype_end) << "' has fewer than " << columns.alleles_per_sample << " alleles.";
+                        }
+                        const char *allele_end = allele;
+                        while ( allele_end < genotype_end && *allele_end != '/' && *allele_end != '|' )
+                        {
+                            ++allele_end;
+                        }
+                        code = decodeAllele( allele, allele_end );
+                        allele = allele_end + 1;
+                    }
+                    alleles[(k * columns.num_samples + sample) * num_lines + line] = code;
                 }
             }
-            
+
+            ++column;
+            p = token_end;
         }
+
+        if ( column < end_of_samples )
+        {
+            throw RbException() << "The VCF line '" << std::string(begin, std::min(end, begin + 80)) << "' has fewer columns than the header.";
+        }
+
     }
-    
-    // We have finished all lines, we fill up the data matrix
-    for (size_t i=0; i<NUM_SAMPLES; ++i)
+
+
+    /** Find the columns of the header line "#CHROM POS ID REF ALT QUAL FILTER INFO FORMAT sample_1 ...". */
+    VCFColumns parseHeader(const std::string &header_line, size_t alleles_per_sample, std::vector<std::string> &sample_names)
     {
-        matrix->addTaxonData(taxa[i]);
-        if ( ploidy == DIPLOID )
+
+        std::vector<std::string> tokens;
+        StringUtilities::stringSplit( header_line, "", tokens );
+
+        VCFColumns columns;
+        columns.ref_index            = 0;
+        columns.alt_index            = 0;
+        columns.samples_start_column = 0;
+        columns.alleles_per_sample   = alleles_per_sample;
+        for (size_t j = 0; j < tokens.size(); ++j)
         {
-            matrix->addTaxonData( taxa[i+NUM_SAMPLES] );
+            if ( tokens[j] == "REF" )
+            {
+                columns.ref_index = j;
+            }
+            else if ( tokens[j] == "ALT" )
+            {
+                columns.alt_index = j;
+            }
+            else if ( tokens[j] == "FORMAT" )
+            {
+                columns.samples_start_column = j + 1;
+            }
         }
+
+        if ( columns.samples_start_column == 0 )
+        {
+            throw RbException("The VCF file has no header line with a FORMAT column.");
+        }
+
+        sample_names.assign( tokens.begin() + columns.samples_start_column, tokens.end() );
+        columns.num_samples = sample_names.size();
+
+        return columns;
     }
-    
-    return matrix;
+
 }
 
 
-HomologousDiscreteCharacterData<DnaState>* VCFReader::readDNAMatrix( void )
+VCFReader::VCFReader(const std::string &fn) :
+    filename( fn ),
+    ploidy( DIPLOID )
 {
-    HomologousDiscreteCharacterData<DnaState> *matrix = new HomologousDiscreteCharacterData<DnaState> ();
-    
-    int start = 0;
-    // Skip comments.
-    while ( chars[start][0][0] == '#' )
+
+}
+
+
+size_t VCFReader::getNumberOfAllelesPerSample( void ) const
+{
+
+    if ( ploidy == HAPLOID )
     {
-        start = start + 1;
+        return 1;
     }
-    
-    std::vector<std::string> sample_names;
-    size_t samples_start_column = 0;
-    const std::vector<std::string> &format_line = chars[start-1];
-    while ( format_line[samples_start_column] != "FORMAT" )
+    else if ( ploidy == DIPLOID )
     {
-        ++samples_start_column;
-    };
-    ++samples_start_column;
-    for (size_t j = samples_start_column; j < format_line.size(); ++j)
-    {
-        sample_names.push_back( format_line[j] );
+        return 2;
     }
-    size_t NUM_SAMPLES = sample_names.size();
-    std::vector< DiscreteTaxonData<DnaState> > taxa;
-    if ( ploidy == DIPLOID )
-    {
-        taxa = std::vector< DiscreteTaxonData<DnaState> >( 2*NUM_SAMPLES, DiscreteTaxonData<DnaState>( Taxon("") ) );
-    }
-    for (size_t i=0; i<NUM_SAMPLES; ++i)
+    else
     {
-        Taxon this_taxon_A = Taxon( sample_names[i] + "_A" );
-        taxa[i] = DiscreteTaxonData<DnaState>( this_taxon_A );
-        Taxon this_taxon_B = Taxon( sample_names[i] + "_B" );
-        taxa[i+NUM_SAMPLES] = DiscreteTaxonData<DnaState>( this_taxon_B );
+        throw RbException("Currently we have only implementations for haploid and diploid organisms.");
     }
-    
-    size_t ref_index = 0;
-    size_t alt_index = 0;
-    for (size_t j = 0; j < format_line.size(); ++j)
+
+}
+
+
+/**
+ * Stream through the file and decode the genotypes.
+ * We read the file chunk by chunk, decode the lines of a chunk in parallel and append their alleles to the alleles of each haplotype.
+ * If ref_bases (alt_bases) is not NULL, then we also store the base of the REF (ALT) column of each site (see decodeBase()).
+ */
+void VCFReader::readAlleles(std::vector<std::vector<unsigned char> > &alleles, std::vector<char> *ref_bases, std::vector<char> *alt_bases)
+{
+
+    VCFInputStream in( filename );
+
+    size_t alleles_per_sample = getNumberOfAllelesPerSample();
+
+    std::vector<char>           buffer( CHUNK_SIZE );
+    size_t                      buffer_size = 0;
+    bool                        end_of_file = false;
+    std::string                 header_line = "";
+    bool                        found_header = false;
+    VCFColumns                  columns;
+    std::vector<const char*>    line_begin;
+    std::vector<const char*>    line_end;
+    std::vector<unsigned char>  chunk_alleles;
+    std::vector<char>           chunk_ref_bases;
+    std::vector<char>           chunk_alt_bases;
+
+    while ( true )
     {
-        if ( format_line[j] == "REF" )
+        // fill the buffer (and make it larger if a single line does not fit)
+        if ( buffer_size == buffer.size() )
         {
-            ref_index = j;
+            buffer.resize( 2 * buffer.size() );
         }
-        if ( format_line[j] == "ALT" )
+        size_t num_read = in.read( &buffer[buffer_size], buffer.size() - buffer_size );
+        buffer_size += num_read;
+        end_of_file = ( num_read == 0 );
+
+        // find the complete lines of this chunk
+        line_begin.clear();
+        line_end.clear();
+        const char *p   = &buffer[0];
+        const char *end = p + buffer_size;
+        while ( p < end )
+        {
+            const char *newline = static_cast<const char*>( memchr( p, '\n', end - p ) );
+            if ( newline == NULL )
+            {
+                // the last line of the file does not need to end with a newline
+                if ( end_of_file == false )
+                {
+                    break;
+                }
+                newline = end;
+            }
+
+            const char *first_nonspace = std::find_if( p, newline, [](char c) { return isspace(c) == 0; } );
+            if ( first_nonspace == newline )
+            {
+                // skip blank lines
+            }
+            else if ( *p == '#' )
+            {
+                // the last comment line is the header with the column names
+                header_line.assign( p, newline );
+            }
+            else
+            {
+                if ( found_header == false )
+                {
+                    columns = parseHeader( header_line, alleles_per_sample, sample_names );
+                    alleles.assign( columns.num_samples * alleles_per_sample, std::vector<unsigned char>() );
+                    found_header = true;
+                }
+                line_begin.push_back( p );
+                line_end.push_back( newline );
+            }
+
+            p = ( newline < end ? newline + 1 : end );
+        }
+
+        // decode the lines of this chunk in parallel
+        size_t num_lines = line_begin.size();
+        if ( num_lines > 0 )
+        {
+            chunk_alleles.resize( alleles.size() * num_lines );
+            chunk_ref_bases.resize( num_lines );
+            chunk_alt_bases.resize( num_lines );
+            char *ref = ( ref_bases != NULL ? &chunk_ref_bases[0] : NULL );
+            char *alt = ( alt_bases != NULL ? &chunk_alt_bases[0] : NULL );
+
+            ThreadPool &pool = ThreadPool::threadPoolInstance();
+            size_t num_blocks = std::min( num_lines, pool.getNumberOfThreads() );
+            pool.parallelFor( num_blocks, [&](size_t block)
+            {
+                for (size_t line = block * num_lines / num_blocks; line < (block + 1) * num_lines / num_blocks; ++line)
+                {
+                    decodeLine( line_begin[line], line_end[line], columns, line, num_lines, &chunk_alleles[0], ref, alt );
+                }
+            });
+
+            for (size_t h = 0; h < alleles.size(); ++h)
+            {
+                const unsigned char *chunk = &chunk_alleles[h * num_lines];
+                alleles[h].insert( alleles[h].end(), chunk, chunk + num_lines );
+            }
+            if ( ref_bases != NULL )
+            {
+                ref_bases->insert( ref_bases->end(), chunk_ref_bases.begin(), chunk_ref_bases.end() );
+            }
+            if ( alt_bases != NULL )
+            {
+                alt_bases->insert( alt_bases->end(), chunk_alt_bases.begin(), chunk_alt_bases.end() );
+            }
+        }
+
+        if ( end_of_file == true )
         {
-            alt_index = j;
+            break;
         }
+
+        // keep the incomplete last line for the next chunk
+        size_t consumed = p - &buffer[0];
+        std::memmove( &buffer[0], &buffer[consumed], buffer_size - consumed );
+        buffer_size -= consumed;
     }
-    
-    for (size_t i = start; i < chars.size(); ++i)
+
+    if ( found_header == false )
     {
-        
-        DnaState reference_character = DnaState(chars[i][ref_index]);
-        DnaState alternative_character = DnaState(chars[i][alt_index]);
+        // a file without any sites still tells us the samples
+        parseHeader( header_line, alleles_per_sample, sample_names );
+        alleles.assign( sample_names.size() * alleles_per_sample, std::vector<unsigned char>() );
+    }
+
+}
+
+
+HomologousDiscreteCharacterData<BinaryState>* VCFReader::readBinaryMatrix( void )
+{
+
+    std::vector<std::vector<unsigned char> > alleles;
+    readAlleles( alleles, NULL, NULL );
+
+    size_t NUM_SAMPLES = sample_names.size();
+    size_t alleles_per_sample = getNumberOfAllelesPerSample();
+
+    BinaryState missing_state = BinaryState("0");
+    missing_state.setMissingState( true );
+    BinaryState reference_state   = BinaryState("0");
+    BinaryState alternative_state = BinaryState("1");
 
-        for (size_t j = 0; j < NUM_SAMPLES; ++j)
+    // we create the taxon data one haplotype at a time and free its packed alleles right away
+    HomologousDiscreteCharacterData<BinaryState> *matrix = new HomologousDiscreteCharacterData<BinaryState> ();
+    for (size_t i=0; i<NUM_SAMPLES; ++i)
+    {
+        for (size_t k=0; k<alleles_per_sample; ++k)
         {
-            
-            const std::string &this_char_read = chars[i][j+samples_start_column];
-            std::vector<std::string> format_tokens;
-            StringUtilities::stringSplit(this_char_read, ":", format_tokens);
-            
-            std::string this_alleles = format_tokens[0];
-            StringUtilities::replaceAllOccurrences(this_alleles, '/', '|');
-            std::vector<std::string> allele_tokens;
-            StringUtilities::stringSplit(this_alleles, "|", allele_tokens);
-            
+            std::string name = sample_names[i];
             if ( ploidy == DIPLOID )
             {
-                // first allele
-                if ( allele_tokens[0] == "0")
-                {
-                    taxa[j].addCharacter( reference_character );
-                }
-                else if ( allele_tokens[0] == "1" )
+                name += ( k == 0 ? "_A" : "_B" );
+            }
+
+            std::vector<unsigned char> &haplotype = alleles[k*NUM_SAMPLES + i];
+            DiscreteTaxonData<BinaryState> taxon = DiscreteTaxonData<BinaryState>( Taxon( name ) );
+            for (size_t s = 0; s < haplotype.size(); ++s)
+            {
+                if ( haplotype[s] == REFERENCE_ALLELE )
                 {
-                    taxa[j].addCharacter( reference_character );
+                    taxon.addCharacter( reference_state );
                 }
-                else if ( allele_tokens[0] == "." )
+                else if ( haplotype[s] == ALTERNATIVE_ALLELE )
                 {
-                    taxa[j].addCharacter( DnaState("?") );
+                    taxon.addCharacter( alternative_state );
                 }
                 else
                 {
-                    throw RbException("Unknown scored character!");
+                    taxon.addCharacter( missing_state );
                 }
-                
-                // second allele
-                if ( allele_tokens[1] == "0")
+            }
+            std::vector<unsigned char>().swap( haplotype );
+
+            matrix->addTaxonData( taxon );
+        }
+    }
+
+    return matrix;
+}
+
+
+HomologousDiscreteCharacterData<DnaState>* VCFReader::readDNAMatrix( void )
+{
+
+    std::vector<std::vector<unsigned char> > alleles;
+    std::vector<char> ref_bases;
+    std::vector<char> alt_bases;
+    readAlleles( alleles, &ref_bases, &alt_bases );
+
+    size_t NUM_SAMPLES = sample_names.size();
+    size_t alleles_per_sample = getNumberOfAllelesPerSample();
+    size_t num_sites = ref_bases.size();
+
+    DnaState missing_state = DnaState("?");
+
+    // we skip the sites whose alleles are not single bases (e.g., indels), because they cannot be coded as DNA characters
+    // a site without an alternative allele (ALT is '.') has only the reference base
+    std::vector<bool> use_site( num_sites, true );
+    size_t num_skipped_sites = 0;
+    std::vector<DnaState> reference_characters;
+    std::vector<DnaState> alternative_characters;
+    reference_characters.reserve( num_sites );
+    alternative_characters.reserve( num_sites );
+    for (size_t s = 0; s < num_sites; ++s)
+    {
+        if ( ref_bases[s] == NO_SINGLE_BASE || ref_bases[s] == '.' || alt_bases[s] == NO_SINGLE_BASE )
+        {
+            use_site[s] = false;
+            ++num_skipped_sites;
+            reference_characters.push_back( missing_state );
+            alternative_characters.push_back( missing_state );
+            continue;
+        }
+
+        reference_characters.push_back( DnaState( std::string(1, ref_bases[s]) ) );
+        alternative_characters.push_back( alt_bases[s] == '.' ? missing_state : DnaState( std::string(1, alt_bases[s]) ) );
+    }
+
+    // we create the taxon data one haplotype at a time and free its packed alleles right away
+    HomologousDiscreteCharacterData<DnaState> *matrix = new HomologousDiscreteCharacterData<DnaState> ();
+    for (size_t i=0; i<NUM_SAMPLES; ++i)
+    {
+        for (size_t k=0; k<alleles_per_sample; ++k)
+        {
+            std::string name = sample_names[i];
+            if ( ploidy == DIPLOID )
+            {
+                name += ( k == 0 ? "_A" : "_B" );
+            }
+
+            std::vector<unsigned char> &haplotype = alleles[k*NUM_SAMPLES + i];
+            DiscreteTaxonData<DnaState> taxon = DiscreteTaxonData<DnaState>( Taxon( name ) );
+            for (size_t s = 0; s < haplotype.size(); ++s)
+            {
+                if ( use_site[s] == false )
                 {
-                    taxa[j+NUM_SAMPLES].addCharacter( reference_character );
+                    continue;
                 }
-                else if ( allele_tokens[1] == "1" )
+                else if ( haplotype[s] == REFERENCE_ALLELE )
                 {
-                    taxa[j+NUM_SAMPLES].addCharacter( reference_character );
+                    taxon.addCharacter( reference_characters[s] );
                 }
-                else if ( allele_tokens[1] == "." )
+                else if ( haplotype[s] == ALTERNATIVE_ALLELE )
                 {
-                    taxa[j+NUM_SAMPLES].addCharacter( DnaState("?") );
+                    taxon.addCharacter( alternative_characters[s] );
                 }
                 else
                 {
-                    throw RbException("Unknown scored character!");
+                    taxon.addCharacter( missing_state );
                 }
             }
-            
+            std::vector<unsigned char>().swap( haplotype );
+
+            matrix->addTaxonData( taxon );
         }
     }
-    
-    // We have finished all lines, we fill up the data matrix
-    for (size_t i=0; i<NUM_SAMPLES; ++i)
+
+    if ( num_skipped_sites > 0 )
     {
-        matrix->addTaxonData(taxa[i]);
-        if ( ploidy == DIPLOID )
-        {
-            matrix->addTaxonData( taxa[i+NUM_SAMPLES] );
-        }
+        RBOUT( "Skipped " + std::to_string(num_skipped_sites) + " sites whose alleles are not single bases.\n" );
     }
-    
+
     return matrix;
 }
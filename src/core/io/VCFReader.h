@@ -1,21 +1,28 @@
 #ifndef VCFReader_H
 #define VCFReader_H
 
-#include "DelimitedDataReader.h"
 #include "AbstractHomologousDiscreteCharacterData.h"
 #include "HomologousDiscreteCharacterData.h"
 #include "BinaryState.h"
 #include "DnaState.h"
+#include "RbFileManager.h"
 
 #include <string>
 #include <vector>
 
 namespace RevBayesCore {
-    
-    
+
+
     /**
      * Reader for VCF files.
      *
+     * The reader streams through the file in large chunks and never holds more than one chunk of the text in memory.
+     * The genotypes of the lines of a chunk are decoded in parallel (see ThreadPool) into one byte per allele
+     * (reference, alternative or missing), which we append to the alleles of each haplotype.
+     * Only at the end do we create the character states of the matrix, one haplotype at a time,
+     * so the memory we need is proportional to the size of the resulting matrix.
+     *
+     * If RevBayes was compiled with zlib (RB_ZLIB), then the file may also be compressed with gzip or bgzip.
      *
      *
      * @copyright Copyright 2009-
@@ -23,24 +30,28 @@ namespace RevBayesCore {
      * @since 2015-03-03, version 1.0
      *
      */
-    class VCFReader : public DelimitedDataReader {
-        
+    class VCFReader {
+
         enum PLOIDY { HAPLOID, DIPLOID, POLYPLOID };
 
     public:
-        
+
         VCFReader(const std::string &fn);
-        
+
         HomologousDiscreteCharacterData<DnaState>*              readDNAMatrix( void );
         HomologousDiscreteCharacterData<BinaryState>*           readBinaryMatrix( void );
 
     protected:
-        
-        std::string                                             filename;
+
+        size_t                                                  getNumberOfAllelesPerSample(void) const;
+        void                                                    readAlleles(std::vector<std::vector<unsigned char> > &alleles, std::vector<char> *ref_bases, std::vector<char> *alt_bases); //!< Stream through the file and collect the alleles of every haplotype (and the bases of every site)
+
+        path                                                    filename;
         PLOIDY                                                  ploidy;
-        
+        std::vector<std::string>                                sample_names;
+
     };
-    
+
 }
 
 #endif
@@ -1,15 +1,25 @@
 #include "CholeskyDecomposition.h"
 
-#include <math.h>
+#include <cmath>
 
 #include "MatrixReal.h"
-#include "RbMathMatrix.h"
+#include "MatrixRealKernels.h"
 #include "RbException.h"
+#include "RbMathLogic.h"
 #include "RbVector.h"
 #include "RbVectorImpl.h"
 
 using namespace RevBayesCore;
 
+namespace {
+
+    // the number of rank-one modifications after which we decompose the matrix from scratch again,
+    // so that the rounding errors of the modifications do not accumulate
+    const size_t REFACTORIZATION_INTERVAL = 100;
+
+}
+
+
 /** Constructor from real matrix */
 CholeskyDecomposition::CholeskyDecomposition( const MatrixReal* m )
 {
@@ -23,6 +33,7 @@ CholeskyDecomposition::CholeskyDecomposition( const MatrixReal* m )
     
     is_positive_definite = true;
     is_positive_semidefinite = true;
+    num_rank_one_updates = 0;
     
     // set the pointer to the matrix
     qPtr = m;
@@ -39,27 +50,34 @@ CholeskyDecomposition::CholeskyDecomposition( const MatrixReal* m )
  
 }
 
+
+/** Constructor copying the decomposition of another matrix with the same values */
+CholeskyDecomposition::CholeskyDecomposition( const MatrixReal* m, const CholeskyDecomposition &d ) :
+    n( d.n ),
+    qPtr( m ),
+    L( d.L ),
+    inverseMatrix( d.inverseMatrix ),
+    is_positive_definite( d.is_positive_definite ),
+    is_positive_semidefinite( d.is_positive_semidefinite ),
+    num_rank_one_updates( d.num_rank_one_updates )
+{
+    
+}
+
+
 void CholeskyDecomposition::computeInverse( void )
 {
     
-    // first, invert the lower cholesky factor
+    // first, invert the lower cholesky factor (which is again lower triangular)
     MatrixReal inverseLowerFactor = MatrixReal(n, n, 0.0);
-    RbMath::matrixInverse(L, inverseLowerFactor);
-    //    MatrixReal inverseLowerFactor = L.computeInverse();
+    MatrixRealKernels::invertLowerTriangular( L.data(), inverseLowerFactor.data(), n );
     
-    // now, transpose the inverse lower factor
-    MatrixReal inverseLowerFactorTranspose(n, n, 0.0);
-    for (size_t r = 0; r < n; ++r)
+    // now, multiply the transposed inverse lower factor with the inverse lower factor
+    if ( inverseMatrix.getNumberOfRows() != n || inverseMatrix.getNumberOfColumns() != n )
     {
-        for (size_t c = 0; c <= r; ++c)
-        {
-            inverseLowerFactorTranspose[c][r] = inverseLowerFactor[r][c];
-        }
+        inverseMatrix = MatrixReal(n, n, 0.0);
     }
-    
-    // now, multiply the two matrices together
-    inverseMatrix = inverseLowerFactorTranspose * inverseLowerFactor;
-//    inverseMatrix.getLogDet(); // this is just for debugging purposes: I want to force the matrix to update
+    MatrixRealKernels::multiplyLowerTransposed( inverseLowerFactor.data(), inverseMatrix.data(), n );
     
 }
 
@@ -89,49 +107,164 @@ void CholeskyDecomposition::decomposeMatrix( void )
     // TODO: check sqrt(R+)
     // sometimes we might accidentally square root a small negative number
     
-    L.clear();
-    L.resize(n, n);
-
-    is_positive_definite = true;
-    is_positive_semidefinite = true;
+    // we factor the transpose of the lower triangle, Q^T = U^T U, so that the rows of U are contiguous.
+    // the lower factor is then L = U^T.
+    MatrixReal upper = MatrixReal(n, n, 0.0);
+    const double* q = qPtr->data();
+    double* u = upper.data();
+    for (size_t r = 0; r < n; ++r)
+    {
+        for (size_t c = 0; c <= r; ++c)
+        {
+            u[c*n+r] = q[r*n+c];
+        }
+    }
     
+    MatrixRealKernels::choleskyUpper( u, n, is_positive_definite, is_positive_semidefinite );
+    
+    L.resize(n, n);
+    double* l = L.data();
     for (size_t r = 0; r < n; ++r)
     {
         for (size_t c = 0; c <= r; ++c)
         {
-            if (c == r)
-            {
-                double sum = 0.0;
-                for (size_t j = 0; j < c; ++j)
-                {
-                    sum += L[c][j] * L[c][j];
-                }
-                L[c][c] = std::sqrt((*qPtr)[c][c] - sum);
-                if ( ((*qPtr)[c][c] - sum) < 0.0) {
-                    is_positive_semidefinite = false;
-                }
-                if ( ((*qPtr)[c][c] - sum) <= 0.0) {
-                    is_positive_definite = false;
-                }
-            }
-            else
-            {
-                double sum = 0.0;
-                for (size_t j = 0; j < c; ++j)
-                {
-                    sum += L[r][j] * L[c][j];
-                }
-                L[r][c] = 1.0 / L[c][c] * ( (*qPtr)[r][c] - sum );
-            }
+            l[r*n+c] = u[c*n+r];
         }
     }
 
 }
 
+/**
+ * Modify the decomposition for the change Q' = Q + alpha x x^T of the matrix.
+ * The matrix itself must already hold the new values.
+ *
+ * The factor is modified column by column with the usual sequence of rotations (see, e.g., Gill et al. 1974,
+ * Methods for modifying matrix factorizations), and the inverse with the Sherman-Morrison formula.
+ * Both cost O(n^2). If a downdate would make the matrix lose positive definiteness, or once too many
+ * modifications have been applied, we decompose the (new) matrix from scratch instead.
+ */
+void CholeskyDecomposition::rankOneUpdate(const std::vector<double> &x, double alpha)
+{
+    
+    if ( x.size() != n )
+    {
+        throw RbException() << "Cannot apply a rank-one update of dimension " << x.size() << " to a Cholesky decomposition of dimension " << n << ".";
+    }
+    
+    if ( alpha == 0.0 )
+    {
+        return;
+    }
+    
+    ++num_rank_one_updates;
+    if ( is_positive_definite == false || num_rank_one_updates >= REFACTORIZATION_INTERVAL )
+    {
+        update();
+        return;
+    }
+    
+    // the rows of the factor before the first non-zero element of x do not change
+    size_t first = 0;
+    while ( first < n && x[first] == 0.0 )
+    {
+        ++first;
+    }
+    if ( first == n )
+    {
+        return;
+    }
+    
+    // first, the factor: L' L'^T = L L^T + sign * w w^T with w = sqrt(|alpha|) x
+    double sign = ( alpha > 0.0 ? 1.0 : -1.0 );
+    double scale = std::sqrt( std::fabs( alpha ) );
+    std::vector<double> w = std::vector<double>(n, 0.0);
+    for (size_t i = first; i < n; ++i)
+    {
+        w[i] = scale * x[i];
+    }
+    
+    double* l = L.data();
+    for (size_t k = first; k < n; ++k)
+    {
+        double l_kk = l[k*n+k];
+        double r2 = l_kk * l_kk + sign * w[k] * w[k];
+        if ( r2 <= 0.0 || RbMath::isFinite( r2 ) == false )
+        {
+            // the downdated matrix is not positive definite (anymore)
+            update();
+            return;
+        }
+        
+        double r = std::sqrt( r2 );
+        double c = r / l_kk;
+        double s = w[k] / l_kk;
+        l[k*n+k] = r;
+        
+        for (size_t i = k+1; i < n; ++i)
+        {
+            double l_ik = ( l[i*n+k] + sign * s * w[i] ) / c;
+            w[i] = c * w[i] - s * l_ik;
+            l[i*n+k] = l_ik;
+        }
+    }
+    
+    // second, the inverse: (Q + alpha x x^T)^-1 = Q^-1 - alpha u u^T / (1 + alpha x^T u) with u = Q^-1 x
+    std::vector<size_t> non_zero;
+    for (size_t j = first; j < n; ++j)
+    {
+        if ( x[j] != 0.0 )
+        {
+            non_zero.push_back( j );
+        }
+    }
+    
+    double* inv = inverseMatrix.data();
+    std::vector<double> u = std::vector<double>(n, 0.0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double* inv_i = inv + i*n;
+        double tmp = 0.0;
+        for (size_t j : non_zero)
+        {
+            tmp += inv_i[j] * x[j];
+        }
+        u[i] = tmp;
+    }
+    
+    double denominator = 1.0;
+    for (size_t j : non_zero)
+    {
+        denominator += alpha * x[j] * u[j];
+    }
+    if ( denominator <= 0.0 || RbMath::isFinite( denominator ) == false )
+    {
+        update();
+        return;
+    }
+    
+    double factor = alpha / denominator;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double* inv_i = inv + i*n;
+        double f_u_i = factor * u[i];
+        for (size_t j = 0; j < n; ++j)
+        {
+            inv_i[j] -= f_u_i * u[j];
+        }
+    }
+    
+    is_positive_definite = true;
+    is_positive_semidefinite = true;
+    
+}
+
+
 void CholeskyDecomposition::update( void )
 {
     
     decomposeMatrix();
     computeInverse();
     
+    num_rank_one_updates = 0;
+    
 }
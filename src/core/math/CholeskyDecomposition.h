@@ -2,21 +2,32 @@
 #define CholeskyDecomposition_H
 
 #include <stddef.h>
+#include <vector>
 
 #include "MatrixReal.h"
 
 
 namespace RevBayesCore {
 
+    /**
+     * @brief Cholesky decomposition (Q = L L^T) and inverse of a symmetric matrix.
+     *
+     * Besides the full decomposition, we support rank-one modifications Q' = Q + alpha x x^T (updates for alpha > 0,
+     * downdates for alpha < 0), which adjust the factor and the inverse in O(n^2) instead of O(n^3).
+     * Because rounding errors accumulate over many modifications, the matrix is decomposed from scratch again
+     * after a fixed number of rank-one modifications, and whenever a downdate would lose positive definiteness.
+     */
     class CholeskyDecomposition {
 
     public:
                                                 CholeskyDecomposition(const MatrixReal* m);
+                                                CholeskyDecomposition(const MatrixReal* m, const CholeskyDecomposition &d);     //!< Copy the decomposition d, which belongs to a matrix with the same values as m
 
+        void                                    rankOneUpdate(const std::vector<double> &x, double alpha);                      //!< The matrix has changed by alpha x x^T
         void                                    update(void);
-        const MatrixReal                        getInverse(void) const { return inverseMatrix; }
+        const MatrixReal&                       getInverse(void) const { return inverseMatrix; }
         double                                  computeLogDet(void);
-        const MatrixReal                        getLowerCholeskyFactor(void) const { return L; }
+        const MatrixReal&                       getLowerCholeskyFactor(void) const { return L; }
         const bool                              checkPositiveDefinite(void) const { return is_positive_definite; }
         const bool                              checkPositiveSemidefinite(void) const { return is_positive_semidefinite; }
 
@@ -24,16 +35,17 @@ namespace RevBayesCore {
 
         void                                    computeInverse(void);
         void                                    decomposeMatrix(void);
-        
+
         size_t                                  n;                                              //!< Row and column dimension (square matrix)
         const MatrixReal*                       qPtr;                                           //!< A pointer to the matrix for this cholesky decomposition
         MatrixReal                              L;
         MatrixReal                              inverseMatrix;
         bool                                    is_positive_definite;
         bool                                    is_positive_semidefinite;
+        size_t                                  num_rank_one_updates;                           //!< The number of rank-one modifications since the last full decomposition
 
     };
-    
+
 }
 
 #endif
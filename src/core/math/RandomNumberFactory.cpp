@@ -6,6 +6,14 @@
 
 using namespace RevBayesCore;
 
+
+namespace {
+
+    // the random number object replacing the global one on the current thread (if any)
+    thread_local RandomNumberGenerator* thread_random_number_generator = NULL;
+
+}
+
 /** Default constructor */
 RandomNumberFactory::RandomNumberFactory(void)
 {
@@ -28,3 +36,32 @@ void RandomNumberFactory::deleteRandomNumberGenerator(RandomNumberGenerator* r)
     
     delete r;
 }
+
+
+/** Get the global random number object. If the calling thread has set its own random number object, then we return that one instead. */
+RandomNumberGenerator* RandomNumberFactory::getGlobalRandomNumberGenerator(void)
+{
+
+    if ( thread_random_number_generator != NULL )
+    {
+        return thread_random_number_generator;
+    }
+
+    return seedGenerator;
+}
+
+
+/** Get the random number object set by the calling thread, or NULL if the thread uses the global random number object. */
+RandomNumberGenerator* RandomNumberFactory::getThreadRandomNumberGenerator(void)
+{
+
+    return thread_random_number_generator;
+}
+
+
+/** Set the random number object used by the calling thread. Passing NULL restores the global random number object. */
+void RandomNumberFactory::setThreadRandomNumberGenerator(RandomNumberGenerator* r)
+{
+
+    thread_random_number_generator = r;
+}
@@ -20,6 +20,11 @@ namespace RevBayesCore {
      * class has two seeds it manages: one is a global seed and the other is
      * is a so called local seed.
      *
+     * A thread can temporarily replace the global random number object by its own
+     * (see setThreadRandomNumberGenerator). All calls to GLOBAL_RNG on that thread
+     * will then use the thread's random number object. This is used to give
+     * concurrently running computations, e.g. the chains of an MCMCMC analysis,
+     * their own independent random number streams.
      */
     class RandomNumberFactory {
 
@@ -30,7 +35,9 @@ namespace RevBayesCore {
                                                         return singleRandomNumberFactory;
                                                     }
 		void                                        deleteRandomNumberGenerator(RandomNumberGenerator* r);                                 //!< Return a random number object to the pool
-		RandomNumberGenerator*                      getGlobalRandomNumberGenerator(void) { return seedGenerator; }                         //!< Return a pointer to the global random number object
+		RandomNumberGenerator*                      getGlobalRandomNumberGenerator(void);                                                  //!< Return a pointer to the global random number object (or the one of the calling thread)
+		RandomNumberGenerator*                      getThreadRandomNumberGenerator(void);                                                  //!< Return the random number object of the calling thread (NULL if the thread uses the global one)
+		void                                        setThreadRandomNumberGenerator(RandomNumberGenerator* r);                              //!< Use r as the global random number object on the calling thread (NULL restores the global one)
 
 	private:
                                                     RandomNumberFactory(void);                                                             //!< Default constructor
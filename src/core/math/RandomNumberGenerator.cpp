@@ -1,5 +1,9 @@
 #include "RandomNumberGenerator.h"
 #include "RbConstants.h"
+#include "RbException.h"
+
+#include <limits>
+#include <sstream>
 
 #include "boost/date_time/posix_time/posix_time.hpp" // IWYU pragma: keep
 #include <boost/random.hpp>
@@ -47,6 +51,45 @@ unsigned int RandomNumberGenerator::getSeed( void ) const
 }
 
 
+/**
+ * Get the complete state of the random number generator.
+ * The state contains the seed, the state of the Mersenne twister and the last uniform draw,
+ * so that a generator restored with setState produces exactly the same sequence of numbers.
+ */
+std::string RandomNumberGenerator::getState( void ) const
+{
+
+    std::stringstream ss;
+    ss.precision( std::numeric_limits<double>::max_digits10 );
+    ss << seed << " " << last_u << " " << zeroone.base();
+
+    return ss.str();
+}
+
+
+/** Restore the state of the random number generator from a string created by getState */
+void RandomNumberGenerator::setState(const std::string &s)
+{
+
+    std::stringstream ss( s );
+
+    unsigned int new_seed = 0;
+    double new_last_u = 0.0;
+    boost::mt19937 rng;
+    ss >> new_seed >> new_last_u >> rng;
+
+    if ( ss.fail() )
+    {
+        throw RbException("Could not restore the state of the random number generator.");
+    }
+
+    seed = new_seed;
+    last_u = new_last_u;
+    zeroone = boost::uniform_01<boost::mt19937>(rng);
+
+}
+
+
 /** Set the seed of the random number generator */
 void RandomNumberGenerator::setSeed(unsigned int s)
 {
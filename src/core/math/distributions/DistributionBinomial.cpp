@@ -294,12 +294,12 @@ int RbStatistics::Binomial::rv(double nin, double pp, RevBayesCore::RandomNumber
 {
     /* FIXME: These should become THREAD_specific globals : */
     
-    static double c, fm, npq, p1, p2, p3, p4, qn;
-    static double xl, xll, xlr, xm, xr;
+    static thread_local double c, fm, npq, p1, p2, p3, p4, qn;
+    static thread_local double xl, xll, xlr, xm, xr;
     
-    static double psave = -1.0;
-    static int nsave = -1;
-    static int m;
+    static thread_local double psave = -1.0;
+    static thread_local int nsave = -1;
+    static thread_local int m;
     
     double f, f1, f2, u, v, w, w2, x, x1, x2, z, z2;
     double p, q, np, g, r, al, alv, amaxp, ffm, ynorm;
@@ -229,17 +229,23 @@ double RbStatistics::MultivariateNormal::lnPdfPrecision(const std::vector<double
     }
 
     size_t dim = x.size();
-    std::vector<double> tmp = std::vector<double>(dim,0.0);
+    std::vector<double> diff = std::vector<double>(dim,0.0);
+    for (size_t i=0; i<dim; i++)
+    {
+        diff[i] = x[i] - mu[i];
+    }
     
+    // the rows of the precision matrix are contiguous
     double s2 = 0;
     for (size_t i=0; i<dim; i++)
     {
+        const double* omega_row = omega[i].data();
         double tmp = 0;
         for (size_t j=0; j<dim; j++)
         {
-            tmp += omega[i][j] * (x[j] - mu[j]);
+            tmp += omega_row[j] * diff[j];
         }
-        s2 += (x[i] - mu[i]) * tmp;
+        s2 += diff[i] * tmp;
     }
     
     double lnProb = dim * logNormalize + 0.5 * (logDet - dim * log(scale) - s2 / scale);
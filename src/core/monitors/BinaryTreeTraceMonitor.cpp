@@ -0,0 +1,187 @@
+#include "BinaryTreeTraceMonitor.h"
+
+#include <stddef.h>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "BinaryTreeTraceReader.h"
+#include "BinaryTreeTraceWriter.h"
+#include "DagNode.h"
+#include "RbException.h"
+#include "StringUtilities.h"
+#include "TopologyNode.h"
+#include "Tree.h"
+#include "TypedDagNode.h"
+
+namespace RevBayesCore {
+
+BinaryTreeTraceMonitor::BinaryTreeTraceMonitor(TypedDagNode<Tree> *t, const std::vector<DagNode *> &n, bool np, unsigned long g,
+                                               const path &fname, bool ap) :
+    AbstractFileMonitor( t, g, fname, ap, false ),
+    isNodeParameter( np ),
+    tree( t ),
+    nodeVariables( n ),
+    writer( NULL )
+{
+    for (size_t i=0; i < nodeVariables.size(); ++i) {
+        DagNode* n = nodeVariables[i];
+        this->nodes.push_back( n );
+
+        // tell the node that we have a reference to it (avoids deletion)
+        n->incrementReferenceCount();
+    }
+}
+
+
+/** The copy does not share the open file with the original, it opens the file again (for appending) when it first writes a sample. */
+BinaryTreeTraceMonitor::BinaryTreeTraceMonitor(const BinaryTreeTraceMonitor &m) :
+    AbstractFileMonitor( m ),
+    isNodeParameter( m.isNodeParameter ),
+    tree( m.tree ),
+    nodeVariables( m.nodeVariables ),
+    writer( NULL )
+{
+
+}
+
+
+BinaryTreeTraceMonitor::~BinaryTreeTraceMonitor() {
+    delete writer;
+}
+
+
+BinaryTreeTraceMonitor* BinaryTreeTraceMonitor::clone() const {
+    return new BinaryTreeTraceMonitor(*this);
+}
+
+
+/** Closing the writer completes the block index of the file. */
+void BinaryTreeTraceMonitor::closeStream() {
+    delete writer;
+    writer = NULL;
+}
+
+
+/**
+ * Combine the files of the replicates "<file>_run_<i>" into the file of this monitor.
+ * As for the text traces, the samples are numbered consecutively in the combined file,
+ * either all samples of one replicate after the other (sequential) or alternating between the replicates (mixed).
+ */
+void BinaryTreeTraceMonitor::combineReplicates(size_t n_reps, MonteCarloAnalysisOptions::TraceCombinationTypes tc) {
+    if ( enabled == false ) return;
+
+    std::vector<BinaryTreeTraceReader*> readers;
+    try {
+        for (size_t i=0; i < n_reps; ++i) {
+            std::stringstream ss;
+            ss << "_run_" << (i+1);
+            path current_file_name = appendToStem(filename, ss.str());
+
+            if ( BinaryTreeTraceReader::isBinaryTreeTrace( current_file_name ) == false ) {
+                throw RbException() << "Could not open file " << current_file_name << " as a binary tree trace.";
+            }
+            readers.push_back( new BinaryTreeTraceReader( current_file_name ) );
+
+            if ( tc == MonteCarloAnalysisOptions::MIXED && readers[i]->getNumberOfSamples() != readers[0]->getNumberOfSamples() ) {
+                throw RbException("Cannot merge output trace files with unequal number of samples.");
+            }
+        }
+
+        BinaryTreeTraceWriter combined_writer( filename, false );
+        unsigned long sample_number = 0;
+        unsigned long gen = 0;
+        if ( tc == MonteCarloAnalysisOptions::SEQUENTIAL ) {
+            for (size_t i=0; i < n_reps; ++i) {
+                for (size_t j=0; j < readers[i]->getNumberOfSamples(); ++j) {
+                    std::unique_ptr<Tree> t( readers[i]->readTree( j, gen ) );
+                    combined_writer.writeTree( sample_number, *t );
+                    ++sample_number;
+                }
+            }
+        }
+        else if ( tc == MonteCarloAnalysisOptions::MIXED ) {
+            for (size_t j=0; j < readers[0]->getNumberOfSamples(); ++j) {
+                for (size_t i=0; i < n_reps; ++i) {
+                    std::unique_ptr<Tree> t( readers[i]->readTree( j, gen ) );
+                    combined_writer.writeTree( sample_number, *t );
+                    ++sample_number;
+                }
+            }
+        }
+        combined_writer.close();
+    }
+    catch (...) {
+        for (size_t i=0; i < readers.size(); ++i) delete readers[i];
+        throw;
+    }
+
+    for (size_t i=0; i < readers.size(); ++i) delete readers[i];
+}
+
+
+void BinaryTreeTraceMonitor::monitor(unsigned long gen) {
+    if ( !enabled || gen % printgen != 0 ) return;
+
+    if ( writer == NULL ) {
+        openStream( true );
+    }
+
+    tree->getValue().clearParameters();
+    for (size_t j=0; j < nodeVariables.size(); ++j) {
+        DagNode* n = nodeVariables[j];
+
+        const std::string &name = n->getName();
+        size_t numParams = n->getNumberOfElements();
+
+        std::stringstream ss;
+        n->printValue(ss,"\t", 0, true, false, true);
+        std::string concatenatedValues = ss.str();
+        std::vector<std::string> values;
+        StringUtilities::stringSplit(concatenatedValues, "\t", values);
+
+        for (size_t i = 0; i < numParams; ++i) {
+            TopologyNode &node = tree->getValue().getNode( i );
+            if ( isNodeParameter == true ) node.addNodeParameter( name, values[i]);
+            else node.addBranchParameter( name, values[i]);
+        }
+    }
+
+    writer->writeTree( gen, tree->getValue() );
+}
+
+
+/** Open the file with a binary tree-trace writer, which continues the samples of the file if we append or reopen it. */
+void BinaryTreeTraceMonitor::openStream(bool reopen) {
+    delete writer;
+    writer = NULL;
+    writer = new BinaryTreeTraceWriter( working_file_name, append == true || reopen == true );
+}
+
+
+/** The binary format has no header line; the writer starts a new file with the magic of the format. */
+void BinaryTreeTraceMonitor::printHeader() {
+
+}
+
+
+void BinaryTreeTraceMonitor::swapNode(DagNode *oldN, DagNode *newN) {
+
+    TypedDagNode< RbVector<double> >* nodeVar = dynamic_cast< TypedDagNode< RbVector<double> > *>(oldN);
+    if ( oldN == tree ) {
+        tree = static_cast< TypedDagNode< Tree > *>( newN );
+    }
+    else if ( nodeVar != nullptr ) {
+        std::vector<DagNode*>::iterator it = find(nodeVariables.begin(), nodeVariables.end(), nodeVar);
+        if (it == nodeVariables.end()) {
+            throw RbException("Cannot replace DAG node with name\"" + oldN->getName() + "\" in this binary tree-trace monitor because the monitor doesn't hold this DAG node.");
+        }
+        *it = static_cast< TypedDagNode< RbVector<double> > *>(newN);
+    }
+
+    // delegate to base class
+    AbstractFileMonitor::swapNode(oldN, newN);
+}
+
+} /* namespace RevBayesCore */
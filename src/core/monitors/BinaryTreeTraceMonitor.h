@@ -0,0 +1,49 @@
+#ifndef BinaryTreeTraceMonitor_H
+#define BinaryTreeTraceMonitor_H
+
+#include <vector>
+
+#include "AbstractFileMonitor.h"
+
+namespace RevBayesCore {
+class BinaryTreeTraceWriter;
+class DagNode;
+class Tree;
+template <class valueType> class TypedDagNode;
+
+/** @brief Monitor to output a distribution of trees in the binary tree-trace format.
+ * The provided branch- or node-specific variables will be stored on the trees as annotations.
+ *
+ * The file is written by a BinaryTreeTraceWriter instead of the text stream of the file monitor.
+ * readTreeTrace reads the files directly, and convertTreeTrace converts them to and from Newick tree traces.
+ *
+ * @see ExtendedNewickTreeMonitor for output in table format
+ * */
+class BinaryTreeTraceMonitor: public AbstractFileMonitor {
+public:
+    BinaryTreeTraceMonitor(TypedDagNode<Tree> *t, const std::vector<DagNode*> &n, bool np, unsigned long g, const path &fname, bool ap = false);
+    BinaryTreeTraceMonitor(const BinaryTreeTraceMonitor &m);
+    virtual ~BinaryTreeTraceMonitor(void);
+
+    BinaryTreeTraceMonitor* clone(void) const;
+
+    virtual void closeStream(void);
+    virtual void combineReplicates(size_t n_reps, MonteCarloAnalysisOptions::TraceCombinationTypes tc);
+    virtual void monitor(unsigned long gen);
+    virtual void openStream(bool reopen);
+    virtual void printHeader(void);
+    void swapNode(DagNode *oldN, DagNode *newN);
+
+protected:
+    bool isNodeParameter;  //!< whether data is on the nodes or branches
+    TypedDagNode<Tree>* tree;  //!< monitored tree
+    std::vector<DagNode*> nodeVariables;  //!< variables associated with the tree
+    BinaryTreeTraceWriter* writer;  //!< the writer of the open file (NULL if the file is closed)
+
+private:
+    BinaryTreeTraceMonitor& operator=(const BinaryTreeTraceMonitor &m);  //!< No assignment
+};
+
+} /* namespace RevBayesCore */
+
+#endif
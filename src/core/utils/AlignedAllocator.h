@@ -0,0 +1,77 @@
+#ifndef AlignedAllocator_H
+#define AlignedAllocator_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Allocator returning memory aligned to a given boundary (64 bytes by default, i.e., a cache line).
+     *
+     * We use this allocator for the contiguous buffers of numerical data (e.g., the elements of a MatrixReal),
+     * so that the rows start on a cache line and the vectorized kernels can use full-width loads.
+     */
+    template <class T, size_t Alignment = 64>
+    class AlignedAllocator {
+
+    public:
+        typedef T                                   value_type;
+
+        template <class U>
+        struct rebind {
+            typedef AlignedAllocator<U, Alignment>  other;
+        };
+
+        AlignedAllocator(void) {}
+        template <class U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment> &a) {}
+
+        T* allocate(size_t n)
+        {
+            if ( n == 0 )
+            {
+                return NULL;
+            }
+
+            void *p = NULL;
+#ifdef _WIN32
+            p = _aligned_malloc( n * sizeof(T), Alignment );
+#else
+            if ( posix_memalign( &p, Alignment, n * sizeof(T) ) != 0 )
+            {
+                p = NULL;
+            }
+#endif
+            if ( p == NULL )
+            {
+                throw std::bad_alloc();
+            }
+
+            return static_cast<T*>( p );
+        }
+
+        void deallocate(T *p, size_t n)
+        {
+#ifdef _WIN32
+            _aligned_free( p );
+#else
+            free( p );
+#endif
+        }
+
+        template <class U>
+        bool operator==(const AlignedAllocator<U, Alignment> &a) const { return true; }
+        template <class U>
+        bool operator!=(const AlignedAllocator<U, Alignment> &a) const { return false; }
+
+    };
+
+}
+
+#endif
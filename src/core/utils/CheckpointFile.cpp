@@ -0,0 +1,212 @@
+#include "CheckpointFile.h"
+
+#include <cstring>
+
+#include "RbException.h"
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // the first bytes of every checkpoint file
+    const char          CHECKPOINT_MAGIC[8]     = { 'R', 'B', 'C', 'K', 'P', 'T', '\0', '\n' };
+    const uint64_t      CHECKPOINT_VERSION      = 1;
+
+}
+
+
+/** Open the temporary file and write the header. */
+CheckpointFileWriter::CheckpointFileWriter(const path &fn) :
+    file_name( fn ),
+    tmp_file_name( fn.string() + ".tmp" ),
+    committed( false )
+{
+
+    createDirectoryForFile( file_name );
+
+    out_stream.open( tmp_file_name.string(), std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( out_stream.is_open() == false )
+    {
+        throw RbException() << "Could not open checkpoint file " << tmp_file_name << " for writing.";
+    }
+
+    out_stream.write( CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC) );
+    writeUnsigned( CHECKPOINT_VERSION );
+
+}
+
+
+CheckpointFileWriter::~CheckpointFileWriter( void )
+{
+
+    if ( committed == false )
+    {
+        out_stream.close();
+
+        boost::system::error_code ec;
+        boost::filesystem::remove( tmp_file_name, ec );
+    }
+
+}
+
+
+/**
+ * Close the temporary file and move it over the checkpoint file.
+ * The rename is atomic, so the checkpoint file is either the old or the new one.
+ */
+void CheckpointFileWriter::commit( void )
+{
+
+    out_stream.flush();
+    bool good = out_stream.good();
+    out_stream.close();
+
+    if ( good == false )
+    {
+        throw RbException() << "Could not write checkpoint file " << tmp_file_name << ".";
+    }
+
+    boost::filesystem::rename( tmp_file_name, file_name );
+    committed = true;
+
+}
+
+
+void CheckpointFileWriter::writeDouble(double x)
+{
+
+    out_stream.write( reinterpret_cast<const char*>(&x), sizeof(double) );
+}
+
+
+void CheckpointFileWriter::writeDoubles(const std::vector<double> &x)
+{
+
+    writeUnsigned( x.size() );
+    if ( x.empty() == false )
+    {
+        out_stream.write( reinterpret_cast<const char*>(x.data()), x.size() * sizeof(double) );
+    }
+
+}
+
+
+void CheckpointFileWriter::writeString(const std::string &s)
+{
+
+    writeUnsigned( s.size() );
+    out_stream.write( s.data(), s.size() );
+}
+
+
+void CheckpointFileWriter::writeUnsigned(uint64_t x)
+{
+
+    out_stream.write( reinterpret_cast<const char*>(&x), sizeof(uint64_t) );
+}
+
+
+
+/** Open the checkpoint file and check the magic string and the version. */
+CheckpointFileReader::CheckpointFileReader(const path &fn) :
+    file_name( fn )
+{
+
+    if ( is_regular_file( file_name ) == false )
+    {
+        std::string errorStr = "";
+        formatError( file_name, errorStr );
+        throw RbException(errorStr);
+    }
+
+    in_stream.open( file_name.string(), std::ios::in | std::ios::binary );
+    if ( in_stream.is_open() == false )
+    {
+        throw RbException() << "Could not open file " << file_name;
+    }
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    read( magic, sizeof(magic) );
+    if ( std::memcmp( magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC) ) != 0 )
+    {
+        throw RbException() << "The file " << file_name << " is not a RevBayes checkpoint file.";
+    }
+
+    uint64_t version = readUnsigned();
+    if ( version != CHECKPOINT_VERSION )
+    {
+        throw RbException() << "The checkpoint file " << file_name << " has version " << version << " but we can only read version " << CHECKPOINT_VERSION << ".";
+    }
+
+}
+
+
+bool CheckpointFileReader::isCheckpointFile(const path &fn)
+{
+
+    std::ifstream in( fn.string(), std::ios::in | std::ios::binary );
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    in.read( magic, sizeof(magic) );
+
+    return in.good() && std::memcmp( magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC) ) == 0;
+}
+
+
+void CheckpointFileReader::read(char *buffer, size_t n)
+{
+
+    in_stream.read( buffer, n );
+    if ( in_stream.gcount() != std::streamsize(n) )
+    {
+        throw RbException() << "The checkpoint file " << file_name << " ended unexpectedly.";
+    }
+
+}
+
+
+double CheckpointFileReader::readDouble( void )
+{
+
+    double x = 0.0;
+    read( reinterpret_cast<char*>(&x), sizeof(double) );
+
+    return x;
+}
+
+
+std::vector<double> CheckpointFileReader::readDoubles( void )
+{
+
+    std::vector<double> x( readUnsigned() );
+    if ( x.empty() == false )
+    {
+        read( reinterpret_cast<char*>(x.data()), x.size() * sizeof(double) );
+    }
+
+    return x;
+}
+
+
+std::string CheckpointFileReader::readString( void )
+{
+
+    std::string s( readUnsigned(), '\0' );
+    if ( s.empty() == false )
+    {
+        read( &s[0], s.size() );
+    }
+
+    return s;
+}
+
+
+uint64_t CheckpointFileReader::readUnsigned( void )
+{
+
+    uint64_t x = 0;
+    read( reinterpret_cast<char*>(&x), sizeof(uint64_t) );
+
+    return x;
+}
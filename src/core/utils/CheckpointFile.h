@@ -0,0 +1,73 @@
+#ifndef CheckpointFile_H
+#define CheckpointFile_H
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "RbFileManager.h"
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Writer for the binary checkpoint files of the samplers.
+     *
+     * A checkpoint file starts with a magic string and a format version, followed by the values
+     * written by the sampler (in the order it chooses). Numbers are stored in their binary representation,
+     * so that they are restored exactly, and strings are prefixed by their length.
+     *
+     * The data is first written into a temporary file next to the checkpoint file, which replaces
+     * the checkpoint file only in commit(). Thus, an interrupted write never destroys the previous checkpoint.
+     */
+    class CheckpointFileWriter {
+
+    public:
+                                                    CheckpointFileWriter(const path &fn);                       //!< Open a new checkpoint file
+                                                   ~CheckpointFileWriter(void);                                 //!< Removes the temporary file if we did not commit
+
+        void                                        commit(void);                                               //!< Close the file and atomically replace the checkpoint file
+        void                                        writeDouble(double x);
+        void                                        writeDoubles(const std::vector<double> &x);
+        void                                        writeString(const std::string &s);
+        void                                        writeUnsigned(uint64_t x);
+
+    private:
+                                                    CheckpointFileWriter(const CheckpointFileWriter &w);        //!< No copies
+        CheckpointFileWriter&                       operator=(const CheckpointFileWriter &w);                   //!< No copies
+
+        path                                        file_name;
+        path                                        tmp_file_name;
+        std::ofstream                               out_stream;
+        bool                                        committed;
+    };
+
+
+    /**
+     * @brief Reader for the binary checkpoint files of the samplers.
+     *
+     * The values have to be read in the same order as they were written.
+     * Reading beyond the end of the file or reading a file in a different format throws an exception.
+     */
+    class CheckpointFileReader {
+
+    public:
+                                                    CheckpointFileReader(const path &fn);                       //!< Open a checkpoint file and check the header
+
+        static bool                                 isCheckpointFile(const path &fn);                           //!< Is this a binary checkpoint file (as opposed to the old text format)?
+
+        double                                      readDouble(void);
+        std::vector<double>                         readDoubles(void);
+        std::string                                 readString(void);
+        uint64_t                                    readUnsigned(void);
+
+    private:
+        void                                        read(char *buffer, size_t n);
+
+        path                                        file_name;
+        std::ifstream                               in_stream;
+    };
+
+}
+
+#endif
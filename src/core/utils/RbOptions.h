@@ -15,10 +15,7 @@
 //#define TESTING
 
 /* Feature enabling switches */
-#ifndef RB_ARM
-#define SSE_ENABLED
-#endif
-//#define AVX_ENABLED
+/* Note, the SIMD instruction set of the likelihood kernels is chosen at runtime (see PhyloCTMCKernels). */
 
 
 /* Test whether we should use linenoise */
@@ -39,6 +39,12 @@ size_t RbSettings::getLineWidth( void ) const
     return lineWidth;
 }
 
+size_t RbSettings::getNumberOfThreads( void ) const
+{
+    // return the internal value
+    return numThreads;
+}
+
 size_t RbSettings::getScalingDensity( void ) const
 {
     // return the internal value
@@ -51,6 +57,12 @@ bool RbSettings::getUseScaling( void ) const
     return useScaling;
 }
 
+bool RbSettings::getUseScalingExponents( void ) const
+{
+    // return the internal value
+    return useScalingExponents;
+}
+
 bool RbSettings::getCollapseSampledAncestors( void ) const
 {
     // return the internal value
@@ -83,10 +95,18 @@ std::string RbSettings::getOption(const std::string &key) const
     {
         return StringUtilities::to_string(scalingDensity);
     }
+    else if ( key == "numThreads" )
+    {
+        return StringUtilities::to_string(numThreads);
+    }
     else if ( key == "useScaling" )
     {
         return useScaling ? "true" : "false";
     }
+    else if ( key == "useScalingExponents" )
+    {
+        return useScalingExponents ? "true" : "false";
+    }
     else if ( key == "collapseSampledAncestors" )
     {
         return collapseSampledAncestors ? "true" : "false";
@@ -127,7 +147,9 @@ void RbSettings::initializeUserSettings(void)
 {
     moduleDir = "modules";      // the default module directory
     useScaling = true;         // the default useScaling
+    useScalingExponents = false;    // by default we scale with per-site log factors
     scalingDensity = 1;         // the default scaling density
+    numThreads = 1;             // the default number of threads (serial computation)
     lineWidth = 160;            // the default line width
     tolerance = 10E-10;         // set default value for tolerance comparing doubles
     outputPrecision = 7;
@@ -169,7 +191,9 @@ void RbSettings::listOptions() const
     std::cout << "tolerance = " << tolerance << std::endl;
     std::cout << "linewidth = " << lineWidth << std::endl;
     std::cout << "useScaling = " << (useScaling ? "true" : "false") << std::endl;
+    std::cout << "useScalingExponents = " << (useScalingExponents ? "true" : "false") << std::endl;
     std::cout << "scalingDensity = " << scalingDensity << std::endl;
+    std::cout << "numThreads = " << numThreads << std::endl;
     std::cout << "collapseSampledAncestors = " << (collapseSampledAncestors ? "true" : "false") << std::endl;
 }
 
@@ -206,6 +230,15 @@ void RbSettings::setUseScaling(bool w)
     writeUserSettings();
 }
 
+void RbSettings::setUseScalingExponents(bool w)
+{
+    // replace the internal value with this new value
+    useScalingExponents = w;
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
 void RbSettings::setScalingDensity(size_t w)
 {
     // replace the internal value with this new value
@@ -216,6 +249,21 @@ void RbSettings::setScalingDensity(size_t w)
 }
 
 
+void RbSettings::setNumberOfThreads(size_t n)
+{
+    if ( n < 1 )
+    {
+        throw RbException("numThreads must be an integer greater than 0");
+    }
+    
+    // replace the internal value with this new value
+    numThreads = n;
+    
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
+
 void RbSettings::setCollapseSampledAncestors(bool w)
 {
     // replace the internal value with this new value
@@ -260,6 +308,10 @@ void RbSettings::setOption(const std::string &key, const std::string &v, bool wr
     {
         useScaling = value == "true";
     }
+    else if ( key == "useScalingExponents" )
+    {
+        useScalingExponents = value == "true";
+    }
     else if ( key == "scalingDensity" )
     {
         size_t w = atoi(value.c_str());
@@ -268,6 +320,14 @@ void RbSettings::setOption(const std::string &key, const std::string &v, bool wr
         
         scalingDensity = atoi(value.c_str());
     }
+    else if ( key == "numThreads" )
+    {
+        int n = atoi(value.c_str());
+        if (n < 1)
+            throw(RbException("numThreads must be an integer greater than 0"));
+        
+        numThreads = n;
+    }
     else if ( key == "collapseSampledAncestors" )
     {
         collapseSampledAncestors = value == "true";
@@ -328,7 +388,9 @@ void RbSettings::writeUserSettings( void )
     writeStream << "tolerance=" << tolerance << std::endl;
     writeStream << "linewidth=" << lineWidth << std::endl;
     writeStream << "useScaling=" << (useScaling ? "true" : "false") << std::endl;
+    writeStream << "useScalingExponents=" << (useScalingExponents ? "true" : "false") << std::endl;
     writeStream << "scalingDensity=" << scalingDensity << std::endl;
+    writeStream << "numThreads=" << numThreads << std::endl;
     writeStream << "collapseSampledAncestors=" << (collapseSampledAncestors ? "true" : "false") << std::endl;
     writeStream.close();
 
@@ -23,24 +23,28 @@ class RbSettings {
         bool                        getCollapseSampledAncestors(void) const;            //!< Retrieve the whether to should display sampled ancestors as 2-degree nodes when printing
         size_t                      getLineWidth(void) const;                           //!< Retrieve the line width that will be used for the screen width when printing
         const RevBayesCore::path&   getModuleDir(void) const;                           //!< Retrieve the module directory name
+        size_t                      getNumberOfThreads(void) const;                     //!< Retrieve the number of threads used for shared-memory parallel computations
         std::string                 getOption(const std::string &k) const;              //!< Retrieve a user option
         size_t                      getOutputPrecision(void) const;                     //!< Retrieve the default output precision width
         bool                        getPrintNodeIndex(void) const;                      //!< Retrieve the flag whether we should print node indices
         size_t                      getScalingDensity(void) const;                      //!< Retrieve the scaling density that determines how often to scale the likelihood in CTMC models
         double                      getTolerance(void) const;                           //!< Retrieve the tolerance for comparing doubles
         bool                        getUseScaling(void) const;                          //!< Retrieve the flag whether we should scale the likelihood in CTMC models
+        bool                        getUseScalingExponents(void) const;                 //!< Retrieve the flag whether CTMC likelihoods are scaled by powers of two (instead of per-site log factors)
         void                        listOptions(void) const;                            //!< Retrieve a list of all user options and their current values
 
         // setters
         void                        setCollapseSampledAncestors(bool);                  //!< Set whether to should display sampled ancestors as 2-degree nodes when printing
         void                        setLineWidth(size_t w);                             //!< Set the line width that will be used for the screen width when printing
         void                        setModuleDir(const RevBayesCore::path &md);         //!< Set the module directory name
+        void                        setNumberOfThreads(size_t n);                       //!< Set the number of threads used for shared-memory parallel computations (min 1)
         void                        setOutputPrecision(size_t p);                       //!< Set the default output precision width
         void                        setOption(const std::string &k, const std::string &v, bool write);  //!< Set the key value pair.
         void                        setPrintNodeIndex(bool tf);                         //!< Set the flag whether we should print node indices
         void                        setScalingDensity(size_t w);                        //!< Set the scaling density n, where CTMC likelihoods are scaled every n-th node (min 1)
         void                        setTolerance(double t);                             //!< Set the tolerance for comparing double
         void                        setUseScaling(bool s);                              //!< Set the flag whether we should scale the likelihood in CTMC models
+        void                        setUseScalingExponents(bool s);                     //!< Set the flag whether CTMC likelihoods are scaled by powers of two (instead of per-site log factors)
     
     private:
                                     RbSettings(void);                                   //!< Default constructor
@@ -55,11 +59,13 @@ class RbSettings {
         bool                        collapseSampledAncestors;
         size_t                      lineWidth;
         RevBayesCore::path          moduleDir;
+        size_t                      numThreads;                                         //!< Number of threads used for shared-memory parallel computations
         size_t                      outputPrecision;
         bool                        printNodeIndex;                                     //!< Should the node index of a tree be printed as a comment?
         size_t                      scalingDensity;
         double                      tolerance;                                          //!< Tolerance for comparison of doubles
         bool                        useScaling;
+        bool                        useScalingExponents;                                //!< Scale CTMC likelihoods only below a threshold and by powers of two?
 };
 
 #endif
@@ -0,0 +1,198 @@
+#include "ThreadPool.h"
+
+#include "RbSettings.h"
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // is the current thread executing a job of the thread pool?
+    thread_local bool inside_parallel_region = false;
+
+}
+
+
+/** Default constructor */
+ThreadPool::ThreadPool(void) :
+    current_job( NULL ),
+    num_jobs( 0 ),
+    next_job( 0 ),
+    num_finished_jobs( 0 ),
+    first_exception( nullptr ),
+    stopping( false )
+{
+
+}
+
+
+/** Destructor. We need to stop and join our workers. */
+ThreadPool::~ThreadPool(void)
+{
+
+    stopWorkers();
+}
+
+
+size_t ThreadPool::getNumberOfThreads(void) const
+{
+
+    return RbSettings::userSettings().getNumberOfThreads();
+}
+
+
+bool ThreadPool::isInsideParallelRegion(void) const
+{
+
+    return inside_parallel_region;
+}
+
+
+/**
+ * Execute the jobs 0,...,n-1 on the worker threads and the calling thread.
+ * The call blocks until all jobs have finished. The jobs are executed serially
+ * if only one thread is requested or if we are already inside a parallel region.
+ */
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)> &job)
+{
+
+    size_t n_threads = getNumberOfThreads();
+
+    // run serially if there is nothing to share or if we are nested inside another job
+    if ( n < 2 || n_threads < 2 || inside_parallel_region == true )
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            job( i );
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> dispatch_lock( dispatch_mutex );
+
+    // the calling thread works too, so we need one worker less than threads
+    if ( workers.size() != n_threads - 1 )
+    {
+        stopWorkers();
+        startWorkers( n_threads - 1 );
+    }
+
+    std::unique_lock<std::mutex> lock( job_mutex );
+    current_job         = &job;
+    num_jobs            = n;
+    next_job            = 0;
+    num_finished_jobs   = 0;
+    first_exception     = nullptr;
+    job_available.notify_all();
+
+    // help with the work until nothing is left to hand out
+    while ( runNextJob( lock ) == true ) {}
+
+    // now wait for the jobs still executed by the workers
+    jobs_finished.wait( lock, [this]{ return num_finished_jobs == num_jobs; } );
+
+    current_job = NULL;
+    std::exception_ptr e = first_exception;
+    first_exception = nullptr;
+    lock.unlock();
+
+    if ( e != nullptr )
+    {
+        std::rethrow_exception( e );
+    }
+
+}
+
+
+/**
+ * Take the next job and execute it. The lock is released while the job runs.
+ * Returns false if there was no job left.
+ */
+bool ThreadPool::runNextJob(std::unique_lock<std::mutex> &lock)
+{
+
+    if ( current_job == NULL || next_job >= num_jobs )
+    {
+        return false;
+    }
+
+    size_t index = next_job;
+    ++next_job;
+    const std::function<void(size_t)> *job = current_job;
+    lock.unlock();
+
+    std::exception_ptr e = nullptr;
+    bool was_inside = inside_parallel_region;
+    inside_parallel_region = true;
+    try
+    {
+        (*job)( index );
+    }
+    catch (...)
+    {
+        e = std::current_exception();
+    }
+    inside_parallel_region = was_inside;
+
+    lock.lock();
+    if ( e != nullptr && first_exception == nullptr )
+    {
+        first_exception = e;
+    }
+    ++num_finished_jobs;
+    if ( num_finished_jobs == num_jobs )
+    {
+        jobs_finished.notify_all();
+    }
+
+    return true;
+}
+
+
+void ThreadPool::startWorkers(size_t n)
+{
+
+    stopping = false;
+    for (size_t i = 0; i < n; ++i)
+    {
+        workers.push_back( std::thread( &ThreadPool::workerLoop, this ) );
+    }
+
+}
+
+
+void ThreadPool::stopWorkers(void)
+{
+
+    {
+        std::lock_guard<std::mutex> lock( job_mutex );
+        stopping = true;
+    }
+    job_available.notify_all();
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+
+}
+
+
+void ThreadPool::workerLoop(void)
+{
+
+    std::unique_lock<std::mutex> lock( job_mutex );
+    while ( true )
+    {
+        job_available.wait( lock, [this]{ return stopping == true || (current_job != NULL && next_job < num_jobs); } );
+
+        if ( stopping == true )
+        {
+            return;
+        }
+
+        runNextJob( lock );
+    }
+
+}
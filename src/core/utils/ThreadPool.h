@@ -0,0 +1,67 @@
+#ifndef ThreadPool_H
+#define ThreadPool_H
+
+#include <stddef.h>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief ThreadPool class declaration
+     * The class ThreadPool manages a set of worker threads for shared-memory parallel computations.
+     * A parallel region is a fixed number of independent jobs, indexed 0,...,n-1, which are handed
+     * out to the workers and the calling thread. The call returns only once all jobs have finished,
+     * so the caller can rely on the results being available afterwards.
+     *
+     * The number of threads is taken from the user setting 'numThreads' (see RbSettings) when a
+     * parallel region is entered. A job that itself asks for a parallel region runs the nested jobs
+     * serially on its own thread. This keeps the pool free of deadlocks when parallel code calls
+     * other parallel code (e.g. likelihood computations within concurrently running chains).
+     *
+     * If a job throws an exception, the remaining jobs are still executed and the first exception
+     * is rethrown in the calling thread.
+     */
+    class ThreadPool {
+
+    public:
+        static ThreadPool&                          threadPoolInstance(void)                                                //!< Return a reference to the singleton thread pool
+                                                    {
+                                                        static ThreadPool singleThreadPool;
+                                                        return singleThreadPool;
+                                                    }
+
+        size_t                                      getNumberOfThreads(void) const;                                         //!< The number of threads used for the next parallel region
+        bool                                        isInsideParallelRegion(void) const;                                     //!< Is the calling thread currently executing a job of this pool?
+        void                                        parallelFor(size_t n, const std::function<void(size_t)> &job);          //!< Execute job(0),...,job(n-1) in parallel and wait until all have finished
+
+    private:
+                                                    ThreadPool(void);                                                       //!< Default constructor
+                                                    ThreadPool(const ThreadPool&);                                          //!< Copy constructor
+                                                    ThreadPool& operator=(const ThreadPool&);                               //!< Assignment operator
+                                                   ~ThreadPool(void);                                                       //!< Destructor
+
+        bool                                        runNextJob(std::unique_lock<std::mutex> &lock);                         //!< Take the next job (if any) and execute it
+        void                                        startWorkers(size_t n);                                                 //!< Start n worker threads
+        void                                        stopWorkers(void);                                                      //!< Stop and join all worker threads
+        void                                        workerLoop(void);                                                       //!< The main loop of a worker thread
+
+        std::vector<std::thread>                    workers;                                                                //!< The worker threads (the calling thread is not included)
+        std::mutex                                  dispatch_mutex;                                                         //!< Only one parallel region can be active at any time
+        std::mutex                                  job_mutex;                                                              //!< Protects the job bookkeeping below
+        std::condition_variable                     job_available;                                                          //!< Signals the workers that there is new work (or that they should stop)
+        std::condition_variable                     jobs_finished;                                                          //!< Signals the calling thread that all jobs have finished
+        const std::function<void(size_t)>*          current_job;                                                            //!< The job of the currently active parallel region
+        size_t                                      num_jobs;                                                               //!< The number of jobs in the current parallel region
+        size_t                                      next_job;                                                               //!< The index of the next job to hand out
+        size_t                                      num_finished_jobs;                                                      //!< The number of jobs that have finished
+        std::exception_ptr                          first_exception;                                                        //!< The first exception thrown by a job
+        bool                                        stopping;                                                               //!< Flag telling the workers to quit
+    };
+}
+
+#endif
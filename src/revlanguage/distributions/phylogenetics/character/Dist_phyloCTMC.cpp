@@ -87,6 +87,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
     const std::string& code = static_cast<const RlString &>( coding->getRevObject() ).getValue();
     bool internal = static_cast<const RlBoolean &>( storeInternalNodes->getRevObject() ).getValue();
     bool gapmatch = static_cast<const RlBoolean &>( gapMatchClamped->getRevObject() ).getValue();
+    bool single_precision = static_cast<const RlString &>( precision->getRevObject() ).getValue() == "single";
 
     RevBayesCore::TypedDagNode< RevBayesCore::RbVector<double> >* site_ratesNode = NULL;
     if ( site_rates != NULL && site_rates->getRevObject() != RevNullObject::getInstance() )
@@ -188,6 +189,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
 
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -257,6 +259,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
 
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -328,6 +331,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
 
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -398,6 +402,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
         
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -468,6 +473,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
 
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -552,6 +558,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
 
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -664,6 +671,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
 
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -748,6 +756,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
 
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -893,6 +902,7 @@ RevBayesCore::TypedDistribution< RevBayesCore::AbstractHomologousDiscreteCharact
             dist->setClockRate( clockRate );
         }
         dist->setUseSiteMatrices(use_site_matrices, sp);
+        dist->setUseSinglePrecision( single_precision );
 
         // set the rate matrix
         if ( q->getRevObject().isType( ModelVector<RateGenerator>::getClassTypeSpec() ) )
@@ -1066,6 +1076,11 @@ const MemberRules& Dist_phyloCTMC::getParameterRules(void) const
         
         dist_member_rules.push_back( new ArgumentRule( "gapMatchClamped", RlBoolean::getClassTypeSpec(), "Should we set the simulated character to be gap or missing if the corresponding character in the clamped matrix is gap or missing?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean( true ) ) );
 
+        std::vector<std::string> precision_options;
+        precision_options.push_back( "double" );
+        precision_options.push_back( "single" );
+        dist_member_rules.push_back( new OptionRule( "precision", new RlString("double"), precision_options, "The precision in which the partial likelihoods are stored. Single precision needs half the memory but is less accurate, and its partial likelihoods are rescaled at every node, whatever useScaling and scalingDensity are." ) );
+
         rules_set = true;
     }
 
@@ -1223,6 +1238,10 @@ void Dist_phyloCTMC::setConstParameter(const std::string& name, const RevPtr<con
     {
         coding = var;
     }
+    else if ( name == "precision" )
+    {
+        precision = var;
+    }
     else
     {
         Distribution::setConstParameter(name, var);
@@ -69,6 +69,7 @@ class TypeSpec;
         RevPtr<const RevVariable>                       storeInternalNodes;
         RevPtr<const RevVariable>                       gapMatchClamped;
         RevPtr<const RevVariable>                       coding;
+        RevPtr<const RevVariable>                       precision;
 
     };
 
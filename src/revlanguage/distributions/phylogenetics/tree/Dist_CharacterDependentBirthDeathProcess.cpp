@@ -217,6 +217,10 @@ RevBayesCore::TypedDistribution<RevBayesCore::Tree>* Dist_CharacterDependentBirt
     double n = static_cast<const RealPos &>( num_time_slices->getRevObject() ).getValue();
     d->setNumberOfTimeSlices( n );
     
+    // interpolate the extinction probabilities instead of integrating them along every branch
+    bool interpolate = static_cast<const RlBoolean &>( interpolate_extinction->getRevObject() ).getValue();
+    d->setUseExtinctionProbabilityTable( interpolate );
+    
     RevBayesCore::TypedDagNode<RevBayesCore::RbVector<double> >* ps = NULL;
     if ( psi->getRevObject() != RevNullObject::getInstance() )
     {
@@ -309,6 +313,9 @@ MethodTable Dist_CharacterDependentBirthDeathProcess::getDistributionMethods( vo
     //    parentArgRules->push_back( new ArgumentRule( "node", Natural::getClassTypeSpec(), "The index of the node.", ArgumentRule::BY_CONSTANT_REFERENCE, ArgumentRule::ANY ) );
     methods.addFunction( new DistributionMemberFunction<Dist_CharacterDependentBirthDeathProcess, ModelVector<Natural> >( "numberEvents", variable, num_events_arg_rules   ) );
     
+    ArgumentRules* num_ode_steps_arg_rules = new ArgumentRules();
+    methods.addFunction( new DistributionMemberFunction<Dist_CharacterDependentBirthDeathProcess, ModelVector<Natural> >( "numberODESteps", variable, num_ode_steps_arg_rules   ) );
+    
     ArgumentRules* timeInStateArgRules = new ArgumentRules();
     methods.addFunction( new DistributionMemberFunction<Dist_CharacterDependentBirthDeathProcess, ModelVector<RealPos> >( "getTimeInState", variable, timeInStateArgRules   ) );
     
@@ -360,6 +367,7 @@ const MemberRules& Dist_CharacterDependentBirthDeathProcess::getParameterRules(v
         optionsCondition.push_back( "survival" );
         memberRules.push_back( new OptionRule( "condition"    , new RlString("time"), optionsCondition, "The condition of the birth-death process." ) );
         memberRules.push_back( new ArgumentRule("nTimeSlices", RealPos::getClassTypeSpec(), "The number of time slices for the numeric ODE.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(500.0) ) );
+        memberRules.push_back( new ArgumentRule("interpolateExtinction", RlBoolean::getClassTypeSpec(), "Should we solve the extinction probabilities once on a grid of nTimeSlices intervals and interpolate them along the branches?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(false) ) );
         std::vector<std::string> optionsSimulateCondition;
         optionsSimulateCondition.push_back("startTime");
         optionsSimulateCondition.push_back("numTips");
@@ -434,6 +442,10 @@ void Dist_CharacterDependentBirthDeathProcess::setConstParameter(const std::stri
     {
         num_time_slices = var;
     }
+    else if ( name == "interpolateExtinction" )
+    {
+        interpolate_extinction = var;
+    }
     else if ( name == "minNumLineages" )
     {
         min_lineages = var;
@@ -154,6 +154,10 @@ RevBayesCore::TypedDistribution<RevBayesCore::Tree>* Dist_TimeVaryingStateDepend
     double n = static_cast<const RealPos &>( num_time_slices->getRevObject() ).getValue();
     d->setNumberOfTimeSlices( n );
     
+    // interpolate the extinction probabilities instead of integrating them along every branch
+    bool interpolate = static_cast<const RlBoolean &>( interpolate_extinction->getRevObject() ).getValue();
+    d->setUseExtinctionProbabilityTable( interpolate );
+    
     RevBayesCore::TypedDagNode<RevBayesCore::RbVector< RevBayesCore::RbVector<double> > >* ps = NULL;
     if ( phi->getRevObject() != RevNullObject::getInstance() )
     {
@@ -241,6 +245,9 @@ MethodTable Dist_TimeVaryingStateDependentSpeciationExtinctionProcess::getDistri
     ArgumentRules* timeInStateArgRules = new ArgumentRules();
     methods.addFunction( new DistributionMemberFunction<Dist_TimeVaryingStateDependentSpeciationExtinctionProcess, ModelVector<RealPos> >( "getTimeInState", variable, timeInStateArgRules   ) );
     
+    ArgumentRules* num_ode_steps_arg_rules = new ArgumentRules();
+    methods.addFunction( new DistributionMemberFunction<Dist_TimeVaryingStateDependentSpeciationExtinctionProcess, ModelVector<Natural> >( "numberODESteps", variable, num_ode_steps_arg_rules   ) );
+    
     return methods;
 }
 
@@ -286,6 +293,7 @@ const MemberRules& Dist_TimeVaryingStateDependentSpeciationExtinctionProcess::ge
         optionsCondition.push_back( "survival" );
         memberRules.push_back( new OptionRule( "condition"    , new RlString("time"), optionsCondition, "The condition of the birth-death process." ) );
         memberRules.push_back( new ArgumentRule( "nTimeSlices",RealPos::getClassTypeSpec(),      "The number of time slices for the numeric ODE.",           ArgumentRule::BY_VALUE                , ArgumentRule::ANY, new RealPos(500.0) ) );
+        memberRules.push_back( new ArgumentRule( "interpolateExtinction", RlBoolean::getClassTypeSpec(),  "Should we solve the extinction probabilities once on a grid of nTimeSlices intervals and interpolate them along the branches?",       ArgumentRule::BY_VALUE                , ArgumentRule::ANY, new RlBoolean(false) ) );
         memberRules.push_back( new ArgumentRule( "minNumLineages", Natural::getClassTypeSpec(),  "The minimum number of lineages to simulate.",       ArgumentRule::BY_VALUE                , ArgumentRule::ANY, new Natural() ) );
         memberRules.push_back( new ArgumentRule( "maxNumLineages", Natural::getClassTypeSpec(),  "The maximum number of lineages to simulate.",       ArgumentRule::BY_VALUE                , ArgumentRule::ANY, new Natural(500) ) );
         memberRules.push_back( new ArgumentRule( "pruneExtinctLineages", RlBoolean::getClassTypeSpec(),  "When simulating should extinct lineages be pruned off?",       ArgumentRule::BY_VALUE                , ArgumentRule::ANY, new RlBoolean(true) ) );
@@ -355,6 +363,10 @@ void Dist_TimeVaryingStateDependentSpeciationExtinctionProcess::setConstParamete
     {
         num_time_slices = var;
     }
+    else if ( name == "interpolateExtinction" )
+    {
+        interpolate_extinction = var;
+    }
     else if ( name == "minNumLineages" )
     {
         min_lineages = var;
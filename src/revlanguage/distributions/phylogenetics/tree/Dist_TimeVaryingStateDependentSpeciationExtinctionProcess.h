@@ -51,6 +51,7 @@ namespace RevLanguage {
         RevPtr<const RevVariable>                                   rho;
         RevPtr<const RevVariable>                                   condition;                                                                              //!< The condition of the process (none/survival/#Taxa)
         RevPtr<const RevVariable>                                   num_time_slices;
+        RevPtr<const RevVariable>                                   interpolate_extinction;
         RevPtr<const RevVariable>                                   min_lineages;
         RevPtr<const RevVariable>                                   max_lineages;
         RevPtr<const RevVariable>                                   prune_extinct_lineages;
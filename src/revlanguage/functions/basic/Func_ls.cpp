@@ -523,9 +523,11 @@ void Func_ls::printFunctions( bool printAll, std::string filter ) const
     if ( printAll )
     {
         const FunctionTable& globalFuncs = Workspace::globalWorkspace().getFunctionTable();
+        globalFuncs.buildAllFunctions();
         functions.insert( globalFuncs.begin(), globalFuncs.end() );
     }
     const FunctionTable& userFuncs = env->getFunctionTable();
+    userFuncs.buildAllFunctions();
     functions.insert( userFuncs.begin(), userFuncs.end() );
 
     // generate string of filtered functions
@@ -0,0 +1,138 @@
+#include <string>
+
+#include "ArgumentRule.h"
+#include "ArgumentRules.h"
+#include "BinaryTreeTraceReader.h"
+#include "BinaryTreeTraceWriter.h"
+#include "Delimiter.h"
+#include "Func_convertTreeTrace.h"
+#include "RbException.h"
+#include "RbFileManager.h"
+#include "RevNullObject.h"
+#include "RevPtr.h"
+#include "RevVariable.h"
+#include "RlFunction.h"
+#include "RlString.h"
+#include "RlUserInterface.h"
+#include "TypeSpec.h"
+
+
+using namespace RevLanguage;
+
+/**
+ * The clone function is a convenience function to create proper copies of inherited objected.
+ * E.g. a.clone() will create a clone of the correct type even if 'a' is of derived type 'b'.
+ *
+ * \return A new copy of the process.
+ */
+Func_convertTreeTrace* Func_convertTreeTrace::clone( void ) const
+{
+
+    return new Func_convertTreeTrace( *this );
+}
+
+
+/** Execute function */
+RevPtr<RevVariable> Func_convertTreeTrace::execute( void )
+{
+
+    RevBayesCore::path fi = static_cast<const RlString&>( args[0].getVariable()->getRevObject() ).getValue();
+    RevBayesCore::path fo = static_cast<const RlString&>( args[1].getVariable()->getRevObject() ).getValue();
+    const std::string& delimiter = static_cast<const RlString&>( args[2].getVariable()->getRevObject() ).getValue();
+
+    if ( RevBayesCore::is_regular_file( fi ) == false )
+    {
+        std::string errorStr = "";
+        RevBayesCore::formatError( fi, errorStr );
+        throw RbException( errorStr );
+    }
+    if ( RevBayesCore::exists( fo ) == true && RevBayesCore::equivalent( fi, fo ) == true )
+    {
+        throw RbException() << "The converted tree trace cannot overwrite the input file " << fi << ".";
+    }
+
+    if ( RevBayesCore::BinaryTreeTraceReader::isBinaryTreeTrace( fi ) == true )
+    {
+        RBOUT( "Converting the binary tree trace \"" + fi.string() + "\" into a Newick tree trace." );
+        RevBayesCore::BinaryTreeTraceReader reader( fi );
+        reader.writeNewickTrace( fo, delimiter );
+    }
+    else
+    {
+        RBOUT( "Converting the Newick tree trace \"" + fi.string() + "\" into a binary tree trace." );
+        RevBayesCore::BinaryTreeTraceWriter::convertNewickTrace( fi, fo, delimiter );
+    }
+
+    return NULL;
+}
+
+
+/** Get argument rules */
+const ArgumentRules& Func_convertTreeTrace::getArgumentRules( void ) const
+{
+
+    static ArgumentRules argument_rules = ArgumentRules();
+    static bool rules_set = false;
+
+    if ( rules_set == false )
+    {
+        argument_rules.push_back( new ArgumentRule( "file"  , RlString::getClassTypeSpec(), "The tree trace to convert, either a binary or a Newick tree trace.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+        argument_rules.push_back( new ArgumentRule( "output", RlString::getClassTypeSpec(), "The name of the converted tree trace.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+        argument_rules.push_back( new Delimiter() );
+
+        rules_set = true;
+    }
+
+    return argument_rules;
+}
+
+
+/** Get Rev type of object */
+const std::string& Func_convertTreeTrace::getClassType(void)
+{
+
+    static std::string rev_type = "Func_convertTreeTrace";
+
+    return rev_type;
+}
+
+
+/** Get class type spec describing type of object */
+const TypeSpec& Func_convertTreeTrace::getClassTypeSpec(void)
+{
+
+    static TypeSpec rev_type_spec = TypeSpec( getClassType(), new TypeSpec( Function::getClassTypeSpec() ) );
+
+    return rev_type_spec;
+}
+
+
+/**
+ * Get the primary Rev name for this function.
+ */
+std::string Func_convertTreeTrace::getFunctionName( void ) const
+{
+    // create a name variable that is the same for all instance of this class
+    std::string f_name = "convertTreeTrace";
+
+    return f_name;
+}
+
+
+/** Get type spec */
+const TypeSpec& Func_convertTreeTrace::getTypeSpec( void ) const
+{
+
+    static TypeSpec type_spec = getClassTypeSpec();
+
+    return type_spec;
+}
+
+
+/** Get return type */
+const TypeSpec& Func_convertTreeTrace::getReturnType( void ) const
+{
+
+    static TypeSpec return_typeSpec = RevNullObject::getClassTypeSpec();
+    return return_typeSpec;
+}
@@ -0,0 +1,35 @@
+#ifndef Func_convertTreeTrace_H
+#define Func_convertTreeTrace_H
+
+#include "Procedure.h"
+
+#include <string>
+
+
+namespace RevLanguage {
+
+/**
+ * Convert a tree trace between the binary format (of the BinaryTreeTrace monitor) and a Newick tree trace (e.g., of the ExtNewick monitor).
+ * The direction is determined by the format of the input file.
+ */
+
+class Func_convertTreeTrace : public Procedure {
+
+    public:
+        // Basic utility functions
+        Func_convertTreeTrace*              clone(void) const;                                                      //!< Clone the object
+        static const std::string&           getClassType(void);                                                     //!< Get Rev type
+        static const TypeSpec&              getClassTypeSpec(void);                                                 //!< Get class type spec
+        std::string                         getFunctionName(void) const;                                            //!< Get the primary name of the function in Rev
+        const TypeSpec&                     getTypeSpec(void) const;                                                //!< Get language type of the object
+
+        // Regular functions
+        RevPtr<RevVariable>                 execute(void);                                                          //!< Execute function
+        const ArgumentRules&                getArgumentRules(void) const;                                           //!< Get argument rules
+        const TypeSpec&                     getReturnType(void) const;                                              //!< Get type of return value
+
+    };
+
+}
+
+#endif
@@ -20,6 +20,8 @@
 #include "Argument.h"
 #include "ArgumentRules.h"
 #include "Integer.h"
+#include "ModelVector.h"
+#include "RlBoolean.h"
 #include "Natural.h"
 #include "RbVector.h"
 #include "RbVectorImpl.h"
@@ -29,6 +31,7 @@
 #include "RlFunction.h"
 #include "Trace.h"
 #include "TraceNumeric.h"
+#include "TraceReader.h"
 #include "TypeSpec.h"
 #include "WorkspaceToCoreWrapperObject.h"
 
@@ -77,120 +80,44 @@ RevPtr<RevVariable> Func_readTrace::execute( void )
         vectorOfFileNames.push_back( trace_file_name );
     }
 
-        
-    std::vector<RevBayesCore::TraceNumeric> data;
-        
+
     long thinning = static_cast<const Natural&>( args[3].getVariable()->getRevObject() ).getValue();
 
-    // Set up a map with the file name to be read as the key and the file type as the value. Note that we may not
-    // read all of the files in the string called "vectorOfFileNames" because some of them may not be in a format
-    // that can be read.
+    // the columns we read (all if none are given)
+    const std::vector<std::string> &column_names = static_cast<const ModelVector<RlString>&>( args[4].getVariable()->getRevObject() ).getValue();
+    bool discard_burnin = static_cast<const RlBoolean&>( args[5].getVariable()->getRevObject() ).getValue();
 
-    for (auto& filename: vectorOfFileNames)
+    // the burnin is either a number of samples or a fraction of the samples (after thinning)
+    RevObject& b = args[2].getVariable()->getRevObject();
+    long burnin = -1;
+    double burnin_fraction = 0.0;
+    if ( b.isType( Integer::getClassTypeSpec() ) )
     {
-        bool hasHeaderBeenRead = false;
-        
-        /* Open file */
-        std::ifstream inFile( filename.string() );
-        
-        if ( !inFile )
-            throw RbException()<<"Could not open file "<<filename;
-            
-        /* Initialize */
-        std::string commandLine;
-        RBOUT("Processing file \"" + filename.string() + "\"");
-        size_t n_samples = 0;
-            
-        /* Command-processing loop */
-        while ( inFile.good() )
+        burnin = static_cast<const Integer &>(b).getValue();
+        if ( burnin < 0 )
         {
-                
-            // Read a line
-            std::string line;
-            RevBayesCore::safeGetline(inFile, line);
-                
-            // skip empty lines
-            //line = stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-            if (line.length() == 0)
-            {
-                continue;
-            }
-                
-                
-            // removing comments
-            if (line[0] == '#')
-            {
-                continue;
-            }
-                
-            // splitting every line into its columns
-            std::vector<std::string> columns;
-            StringUtilities::stringSplit(line, delimiter, columns);
-                
-            // we assume a header at the first line of the file
-            if (!hasHeaderBeenRead)
-            {
-                    
-                for (size_t j=0; j<columns.size(); j++)
-                {
-                    RevBayesCore::TraceNumeric t;
-                        
-                    std::string parmName = columns[j];
-                    t.setParameterName(parmName);
-                    t.setFileName( filename );
-                        
-                    data.push_back( t );
-                }
-                    
-                hasHeaderBeenRead = true;
-                    
-                continue;
-            }
-            
-            
-            // increase our sample counter
-            ++n_samples;
-            
-            // we need to check if we skip this sample in case of thinning.
-            if ( (n_samples-1) % thinning > 0 )
-            {
-                continue;
-            }
-            
-            // adding values to the Tracess
-            for (size_t j=0; j<columns.size(); j++)
-            {
-                RevBayesCore::TraceNumeric& t = static_cast<RevBayesCore::TraceNumeric&>( data[j] );
-                std::string tmp = columns[j];
-                double d = atof( tmp.c_str() );
-                t.addObject(d);
-            }
+            throw RbException("The burnin must not be negative.");
         }
     }
-    
-    RevObject& b = args[2].getVariable()->getRevObject();
+    else
+    {
+        burnin_fraction = static_cast<const Probability &>(b).getValue();
+    }
 
+    // the reader skips the thinned (and maybe the burnin) samples and only parses the requested columns
+    RevBayesCore::TraceReader reader;
     WorkspaceVector<Trace> *rv = new WorkspaceVector<Trace>();
-    for (std::vector<RevBayesCore::TraceNumeric>::iterator it = data.begin(); it != data.end(); ++it)
+    for (auto& filename: vectorOfFileNames)
     {
-        int burnin = 0;
+        RBOUT("Processing file \"" + filename.string() + "\"");
 
-        if ( b.isType( Integer::getClassTypeSpec() ) )
-        {
-            burnin = (int)static_cast<const Integer &>(b).getValue();
-        }
-        else
+        std::vector<RevBayesCore::TraceNumeric> data = reader.readNumericTrace( filename, delimiter, column_names, size_t(thinning), burnin, burnin_fraction, discard_burnin );
+        for (std::vector<RevBayesCore::TraceNumeric>::iterator it = data.begin(); it != data.end(); ++it)
         {
-            double burninFrac = static_cast<const Probability &>(b).getValue();
-            burnin = int( floor( it->size()*burninFrac ) );
-        }
-
-        it->computeStatistics();
+            it->computeStatistics();
 
-        Trace trace( *it );
-        trace.getValue().setBurnin(burnin);
-
-        rv->push_back( trace );
+            rv->push_back( Trace( *it ) );
+        }
     }
     
     // return the vector of traces
@@ -216,6 +143,8 @@ const ArgumentRules& Func_readTrace::getArgumentRules( void ) const
         burninTypes.push_back( Integer::getClassTypeSpec() );
         argumentRules.push_back( new ArgumentRule( "burnin"   , burninTypes     , "The fraction/number of samples to discard as burnin.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Probability(0.25) ) );
         argumentRules.push_back( new ArgumentRule( "thinning", Natural::getClassTypeSpec(), "The frequency of samples to read, i.e., we will only used every n-th sample where n is defined by this argument.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural( 1l ) ) );
+        argumentRules.push_back( new ArgumentRule( "columns", ModelVector<RlString>::getClassTypeSpec(), "The names of the columns to read. By default we read all columns.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new ModelVector<RlString>() ) );
+        argumentRules.push_back( new ArgumentRule( "discardBurnin", RlBoolean::getClassTypeSpec(), "Should we skip the burnin samples when reading the file instead of keeping them in the trace?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean( false ) ) );
 
         rules_set = true;
     }
@@ -2,15 +2,19 @@
 
 #include <math.h>
 #include <stddef.h>
+#include <algorithm>
 #include <map>
 #include <set>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "ArgumentRule.h"
+#include "BinaryTreeTraceReader.h"
 #include "Delimiter.h"
 #include "ConstantNode.h"
+#include "MappedFile.h"
 #include "ModelVector.h"
 #include "NclReader.h"
 #include "NewickConverter.h"
@@ -325,6 +329,67 @@ const TypeSpec& Func_readTreeTrace::getReturnType( void ) const
 }
 
 
+namespace {
+
+    /** Add a tree that we read to the trace, which takes over the tree. */
+    void addTreeToTrace(RevBayesCore::TraceTree &t, RevBayesCore::Tree *tree, bool clock, bool unroot_nonclock)
+    {
+
+        RevBayesCore::Tree *tau = tree;
+        if ( clock == true )
+        {
+            try
+            {
+                tau = RevBayesCore::TreeUtilities::convertTree( *tree );
+            }
+            catch (...)
+            {
+                delete tree;
+                throw;
+            }
+            delete tree;
+        }
+        else if (unroot_nonclock)
+        {
+            tau->removeRootIfDegree2();
+//          Perhaps we should mark the tree unrooted, since we have removed the old root,
+//            and chosen a neighbor as the now root.
+//          However, RevBayes has bugs with unrooted trees and may crash.
+//            tau->setRooted(false);
+        }
+
+        t.addObject( tau );
+    }
+
+
+    /**
+     * Add a batch of trees that we read to the trace, which takes over the trees.
+     * If we cannot add a tree, then we free the remaining trees of the batch before we pass on the exception.
+     */
+    void addTreesToTrace(RevBayesCore::TraceTree &t, const std::vector<RevBayesCore::Tree*> &trees, bool clock, bool unroot_nonclock, RevBayesCore::ProgressBar &progress, size_t num_previous_trees)
+    {
+
+        for (size_t k = 0; k < trees.size(); ++k)
+        {
+            try
+            {
+                addTreeToTrace( t, trees[k], clock, unroot_nonclock );
+            }
+            catch (...)
+            {
+                for (size_t j = k + 1; j < trees.size(); ++j)
+                {
+                    delete trees[j];
+                }
+                throw;
+            }
+            progress.update( num_previous_trees + k + 1 );
+        }
+    }
+
+}
+
+
 WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<RevBayesCore::path> &vector_of_file_names, const std::string &delimiter, const std::string& treetype, bool unroot_nonclock, long thinning, long offset)
 {
     bool clock = (treetype == "clock");
@@ -337,88 +402,74 @@ WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<RevB
     std::map<RevBayesCore::path,std::string> file_ap;
     for (auto& fn: vector_of_file_names)
     {
-        bool has_header_been_read = false;
-        
-        // let us quickly count the number of lines
-        size_t lines = 0;
-        std::ifstream tmp_in_file( fn.string() );
-        
-        if ( !tmp_in_file )
-        {
-            throw RbException()<<"Could not open file "<<fn;
-        }
-        while ( tmp_in_file.good() )
+        RBOUT( "Processing file \"" + fn.string() + "\"");
+
+        RevBayesCore::TraceTree t(clock);
+        t.setFileName(fn);
+
+        // the samples of a binary tree trace are decoded directly, without parsing any text
+        if ( RevBayesCore::BinaryTreeTraceReader::isBinaryTreeTrace( fn ) == true )
         {
-            // Read a line
-            std::string line;
-            RevBayesCore::safeGetline(tmp_in_file, line);
-            if (line.length() == 0 || line[0] == '#')
+            RevBayesCore::BinaryTreeTraceReader reader( fn );
+            t.setParameterName( "Tree" );
+
+            std::vector<size_t> samples;
+            for (size_t i = 0; i < reader.getNumberOfSamples(); ++i)
             {
-                continue;
+                // we need to check if we skip this sample in case of thinning.
+                if ( (i-offset) % thinning == 0 )
+                {
+                    samples.push_back( i );
+                }
             }
-            ++lines;
-        }
-        tmp_in_file.close();
-        
-        RevBayesCore::ProgressBar progress = RevBayesCore::ProgressBar( lines, 0 );
 
-        // now we actually process the input
-        
-        /* Open file */
-        std::ifstream in_file( fn.string() );
-        
-        if ( !in_file )
-        {
-            throw RbException()<<"Could not open file "<<fn;
+            RevBayesCore::ProgressBar progress = RevBayesCore::ProgressBar( samples.size(), 0 );
+            progress.start();
+
+            const size_t BATCH_SIZE = 1000;
+            std::vector<unsigned long> gens;
+            for (size_t batch_begin = 0; batch_begin < samples.size(); batch_begin += BATCH_SIZE)
+            {
+                size_t batch_end = std::min( batch_begin + BATCH_SIZE, samples.size() );
+                std::vector<size_t> batch( samples.begin() + batch_begin, samples.begin() + batch_end );
+                std::vector<RevBayesCore::Tree*> trees = reader.readTrees( batch, gens );
+
+                addTreesToTrace( t, trees, clock, unroot_nonclock, progress, batch_begin );
+            }
+
+            progress.finish();
+
+            data.push_back( TraceTree(t) );
+            continue;
         }
-        
-        /* Initialize */
-        std::string commandLine;
-        RBOUT( "Processing file \"" + fn.string() + "\"");
-        
+
+        // the file is mapped into memory, and we only split the lines of the samples we keep
+        RevBayesCore::MappedFile file( fn );
+        std::vector<const char*> line_begin;
+        std::vector<const char*> line_end;
+        file.findLines( line_begin, line_end );
+
+        bool has_header_been_read = false;
         size_t n_samples = 0;
         size_t index = 0;
-        progress.start();
-        
-        RevBayesCore::TraceTree t(clock);
-        t.setFileName(fn);
-
-        /* Command-processing loop */
-        while ( in_file.good() )
+        std::vector<std::pair<const char*, const char*> > columns;
+        std::vector<std::pair<const char*, const char*> > newick_strings;
+        for (size_t i = 0; i < line_begin.size(); ++i)
         {
-            
-            // Read a line
-            std::string line;
-            RevBayesCore::safeGetline(in_file, line);
-            
-            // skip empty lines
-            //line = StringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-            if (line.length() == 0)
-            {
-                continue;
-            }
-            
-            
-            // removing comments
-            if (line[0] == '#')
+            // skip empty lines and comments
+            if ( line_begin[i] == line_end[i] || *line_begin[i] == '#' )
             {
                 continue;
             }
-            
-            // splitting every line into its columns
-            std::vector<std::string> columns;
-            
-            // we should provide other delimiters too
-            StringUtilities::stringSplit(line, delimiter, columns);
-            
+
             // we assume a header at the first line of the file
             if ( has_header_been_read == false )
             {
-                
+                RevBayesCore::MappedFile::splitLine( line_begin[i], line_end[i], delimiter, columns );
                 for (size_t j=1; j<columns.size(); j++)
                 {
                     
-                    std::string parmName = columns[j];
+                    std::string parmName = std::string( columns[j].first, columns[j].second );
                     if ( parmName == "Posterior" || parmName == "Likelihood" || parmName == "Prior" || parmName == "Replicate_ID")
                     {
                         continue;
@@ -443,33 +494,29 @@ WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<RevB
             {
                 continue;
             }
-            
-            RevBayesCore::Tree *tau = NULL;
-            if ( clock == true )
-            {
-                RevBayesCore::NewickConverter c;
-                RevBayesCore::Tree *blTree = c.convertFromNewick( columns[index] );
-                tau = RevBayesCore::TreeUtilities::convertTree( *blTree );
-            }
-            else
+
+            RevBayesCore::MappedFile::splitLine( line_begin[i], line_end[i], delimiter, columns );
+            if ( index >= columns.size() )
             {
-                RevBayesCore::NewickConverter c;
-                tau = c.convertFromNewick( columns[index] );
-                if (unroot_nonclock)
-                {
-                    tau->removeRootIfDegree2();
-//                  Perhaps we should mark the tree unrooted, since we have removed the old root,
-//                    and chosen a neighbor as the now root.
-//                  However, RevBayes has bugs with unrooted trees and may crash.
-//                    tau->setRooted(false);
-                }
+                throw RbException() << "Sample " << n_samples << " of the file " << fn << " has no tree.";
             }
-            
-            t.addObject( tau );
-            progress.update( n_samples );
-            
+            newick_strings.push_back( columns[index] );
+        }
+
+        RevBayesCore::ProgressBar progress = RevBayesCore::ProgressBar( newick_strings.size(), 0 );
+        progress.start();
+
+        // we convert the trees in batches on all threads, so that we can still report the progress
+        const size_t BATCH_SIZE = 1000;
+        RevBayesCore::NewickConverter c;
+        for (size_t batch_begin = 0; batch_begin < newick_strings.size(); batch_begin += BATCH_SIZE)
+        {
+            size_t batch_end = std::min( batch_begin + BATCH_SIZE, newick_strings.size() );
+            std::vector<std::pair<const char*, const char*> > batch( newick_strings.begin() + batch_begin, newick_strings.begin() + batch_end );
+            std::vector<RevBayesCore::Tree*> trees = c.convertFromNewick( batch );
+
+            addTreesToTrace( t, trees, clock, unroot_nonclock, progress, batch_begin );
         }
-        in_file.close();
         
         progress.finish();
 
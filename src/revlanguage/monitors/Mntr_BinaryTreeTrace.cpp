@@ -0,0 +1,146 @@
+#include "Mntr_BinaryTreeTrace.h"
+
+#include <stddef.h>
+#include <algorithm>
+#include <ostream>
+#include <string>
+
+#include "BinaryTreeTraceMonitor.h"
+#include "Ellipsis.h"
+#include "IntegerPos.h"
+#include "RlBoolean.h"
+#include "RlString.h"
+#include "RlTimeTree.h"
+#include "ArgumentRule.h"
+#include "ArgumentRules.h"
+#include "Monitor.h"
+#include "RbBoolean.h"
+#include "TypeSpec.h"
+
+namespace RevBayesCore { class DagNode; }
+namespace RevBayesCore { class Tree; }
+namespace RevBayesCore { template <class valueType> class TypedDagNode; }
+
+namespace RevLanguage {
+
+Mntr_BinaryTreeTrace::Mntr_BinaryTreeTrace() : Monitor() {}
+
+Mntr_BinaryTreeTrace* Mntr_BinaryTreeTrace::clone(void) const {
+    return new Mntr_BinaryTreeTrace(*this);
+}
+
+
+void Mntr_BinaryTreeTrace::constructInternalObject( void ) {
+    // we free the memory first
+    delete value;
+
+    // now allocate a new monitor
+    const std::string& fn = static_cast<const RlString &>( filename->getRevObject() ).getValue();
+    unsigned int g = (int)static_cast<const IntegerPos &>( printgen->getRevObject() ).getValue();
+    RevBayesCore::TypedDagNode<RevBayesCore::Tree> *t = static_cast<const TimeTree &>( tree->getRevObject() ).getDagNode();
+
+    vars.erase( unique( vars.begin(), vars.end() ), vars.end() );
+    sort( vars.begin(), vars.end(), compareVarNames );
+    std::vector<RevBayesCore::DagNode *> n;
+    for (std::vector<RevPtr<const RevVariable> >::iterator i = vars.begin(); i != vars.end(); ++i)
+    {
+        RevBayesCore::DagNode* node = (*i)->getRevObject().getDagNode();
+        n.push_back( node );
+    }
+
+    bool np = static_cast<const RlBoolean &>( isNodeParameter->getRevObject() ).getValue();
+    bool ap = static_cast<const RlBoolean &>( append->getRevObject() ).getValue();
+
+    RevBayesCore::BinaryTreeTraceMonitor* m = new RevBayesCore::BinaryTreeTraceMonitor(t, n, np, size_t(g), fn, ap);
+    value = m;
+}
+
+
+const std::string& Mntr_BinaryTreeTrace::getClassType(void) {
+
+    static std::string rev_type = "Mntr_BinaryTreeTrace";
+    return rev_type;
+}
+
+
+const TypeSpec& Mntr_BinaryTreeTrace::getClassTypeSpec(void) {
+
+    static TypeSpec rev_type_spec = TypeSpec( getClassType(), new TypeSpec( Monitor::getClassTypeSpec() ) );
+    return rev_type_spec;
+}
+
+
+std::string Mntr_BinaryTreeTrace::getMonitorName( void ) const {
+    // create a constructor function name variable that is the same for all instance of this class
+    std::string c_name = "BinaryTreeTrace";
+    return c_name;
+}
+
+
+const MemberRules& Mntr_BinaryTreeTrace::getParameterRules(void) const {
+
+    static MemberRules memberRules;
+    static bool rules_set = false;
+
+    if ( !rules_set ) {
+
+        memberRules.push_back( new ArgumentRule("filename", RlString::getClassTypeSpec(), "The name of the file.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+        memberRules.push_back( new ArgumentRule("tree"    , TimeTree::getClassTypeSpec(), "The tree variable.", ArgumentRule::BY_CONSTANT_REFERENCE, ArgumentRule::ANY ) );
+        memberRules.push_back( new Ellipsis( "Variables at nodes or branches.", RevObject::getClassTypeSpec() ) );
+        memberRules.push_back( new ArgumentRule("isNodeParameter" , RlBoolean::getClassTypeSpec(), "Is this a node or branch parameter?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(true) ) );
+        memberRules.push_back( new ArgumentRule("append"    , RlBoolean::getClassTypeSpec(), "Should we append or overwrite if the file exists?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(false) ) );
+        memberRules.push_back( new ArgumentRule("printgen"  , IntegerPos::getClassTypeSpec()  , "The number of generations between stored samples.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new IntegerPos(1) ) );
+
+        rules_set = true;
+    }
+
+    return memberRules;
+}
+
+
+const TypeSpec& Mntr_BinaryTreeTrace::getTypeSpec( void ) const {
+
+    static TypeSpec type_spec = getClassTypeSpec();
+
+    return type_spec;
+}
+
+void Mntr_BinaryTreeTrace::printValue(std::ostream &o) const {
+
+    o << "Mntr_BinaryTreeTrace";
+}
+
+
+void Mntr_BinaryTreeTrace::setConstParameter(const std::string& name, const RevPtr<const RevVariable> &var) {
+
+    if ( name == "" )
+    {
+        vars.push_back(var);
+    }
+    else if ( name == "filename" )
+    {
+        filename = var;
+    }
+    else if ( name == "tree" )
+    {
+        tree = var;
+    }
+    else if ( name == "isNodeParameter" )
+    {
+        isNodeParameter = var;
+    }
+    else if ( name == "printgen" )
+    {
+        printgen = var;
+    }
+    else if ( name == "append" )
+    {
+        append = var;
+    }
+    else
+    {
+        Monitor::setConstParameter(name, var);
+    }
+}
+
+} /* namespace RevLanguage */
@@ -0,0 +1,49 @@
+#ifndef SRC_REVLANGUAGE_MONITORS_MNTRBINARYTREETRACE_H_
+#define SRC_REVLANGUAGE_MONITORS_MNTRBINARYTREETRACE_H_
+
+#include <iosfwd>
+#include <vector>
+
+#include "RlMonitor.h"
+#include "RevObject.h"
+#include "RevPtr.h"
+#include "RevVariable.h"
+
+namespace RevLanguage {
+class TypeSpec;
+
+/** @copybrief RevBayesCore::BinaryTreeTraceMonitor
+ * @see Mntr_ExtendedNewickFile for output in table format
+**/
+class Mntr_BinaryTreeTrace: public Monitor {
+
+public:
+
+    Mntr_BinaryTreeTrace();
+    virtual Mntr_BinaryTreeTrace*                     clone(void) const;
+    void                                        constructInternalObject(void);  //!< Build a new internal BinaryTreeTraceMonitor.
+
+    static const std::string&                   getClassType(void);
+    static const TypeSpec&                      getClassTypeSpec(void);
+    virtual const TypeSpec&                     getTypeSpec(void) const;
+
+    std::string                                 getMonitorName(void) const;
+    const MemberRules&                          getParameterRules(void) const;
+
+    virtual void                                printValue(std::ostream& o) const;
+
+protected:
+
+    void                                        setConstParameter(const std::string& name, const RevPtr<const RevVariable> &var);
+
+    std::vector<RevPtr<const RevVariable> >     vars; //!< data associated with the tree
+    RevPtr<const RevVariable>                   filename; //!< output file
+    RevPtr<const RevVariable>                   tree; //!< monitored tree
+    RevPtr<const RevVariable>                   isNodeParameter; //!< whether data is on the nodes or branches
+    RevPtr<const RevVariable>                   append; //!< whether to append to an existing file
+    RevPtr<const RevVariable>                   printgen; //!< print frequency
+};
+
+} /* namespace RevLanguage */
+
+#endif /* SRC_REVLANGUAGE_MONITORS_MNTRBINARYTREETRACE_H_ */
@@ -1,6 +1,9 @@
 #ifndef AddContinuousDistribution_h
 #define AddContinuousDistribution_h
 
+#include <memory>
+
+#include "AddDistribution.h"
 #include "RlContinuousDistribution.h"
 #include "DistributionFunctionCdf.h"
 #include "DistributionFunctionPdf.h"
@@ -21,11 +24,13 @@ template <typename T>
 void AddContinuousDistribution( RevLanguage::ContinuousDistribution *dist)
 {
     
+    std::shared_ptr<const RevLanguage::ContinuousDistribution> prototype( dist->clone() );
+    
     RevLanguage::Workspace::globalWorkspace().addDistribution( dist );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionPdf<T>( dist->clone() ) );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionCdf( dist->clone() ) );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionQuantileContinuous( dist->clone() ) );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionRv<T>( dist->clone() ) );
+    AddDistributionFunction< DistributionFunctionPdf<T> >( "d", prototype );
+    AddDistributionFunction< DistributionFunctionCdf >( "p", prototype );
+    AddDistributionFunction< DistributionFunctionQuantileContinuous >( "q", prototype );
+    AddDistributionFunction< DistributionFunctionRv<T> >( "r", prototype );
     
 }
 
@@ -38,11 +43,13 @@ template <typename T>
 void AddContinuousDistribution( RevLanguage::PositiveContinuousDistribution *dist)
 {
     
+    std::shared_ptr<const RevLanguage::PositiveContinuousDistribution> prototype( dist->clone() );
+    
     RevLanguage::Workspace::globalWorkspace().addDistribution( dist );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionPdf<T>( dist->clone() ) );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionCdf( dist->clone() ) );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionQuantilePositiveContinuous( dist->clone() ) );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionRv<T>( dist->clone() ) );
+    AddDistributionFunction< DistributionFunctionPdf<T> >( "d", prototype );
+    AddDistributionFunction< DistributionFunctionCdf >( "p", prototype );
+    AddDistributionFunction< DistributionFunctionQuantilePositiveContinuous >( "q", prototype );
+    AddDistributionFunction< DistributionFunctionRv<T> >( "r", prototype );
     
 }
 
@@ -1,12 +1,38 @@
 #ifndef AddDistribution_h
 #define AddDistribution_h
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "DistributionFunctionPdf.h"
 #include "DistributionFunctionRv.h"
 #include "RlTypedDistribution.h"
 #include "StringUtilities.h"
 #include "Workspace.h"
 
+/**
+ * Add a function of a distribution (e.g., its density or its random number generator) to the global workspace.
+ * The function is only constructed when it is used for the first time. Its name and aliases are those of the
+ * distribution with the prefix in front (see, e.g., DistributionFunctionPdf::getFunctionName).
+ * @param prefix The prefix of the function name, e.g., "d" for the density
+ * @param dist The distribution from which the function is constructed
+ */
+template <typename functionType, typename distributionType>
+void AddDistributionFunction( const std::string &prefix, const std::shared_ptr<const distributionType> &dist )
+{
+    
+    std::vector<std::string> aliases = dist->getDistributionFunctionAliases();
+    for (size_t i = 0; i < aliases.size(); ++i)
+    {
+        aliases[i] = prefix + aliases[i];
+    }
+    
+    RevLanguage::Workspace::globalWorkspace().addFunction( prefix + dist->getDistributionFunctionName(), aliases, [dist]() { return new functionType( dist->clone() ); } );
+    
+}
+
+
 /**
  * Generic function
  * @param value
@@ -16,9 +42,11 @@ template <typename T>
 void AddDistribution( RevLanguage::TypedDistribution<T> *dist )
 {
 
+    std::shared_ptr<const RevLanguage::TypedDistribution<T> > prototype( dist->clone() );
+    
     RevLanguage::Workspace::globalWorkspace().addDistribution( dist );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionPdf<T>( dist->clone() ) );
-    RevLanguage::Workspace::globalWorkspace().addFunction( new DistributionFunctionRv<T>( dist->clone() ) );
+    AddDistributionFunction< DistributionFunctionPdf<T> >( "d", prototype );
+    AddDistributionFunction< DistributionFunctionRv<T> >( "r", prototype );
 
 }
 
@@ -8,6 +8,7 @@
 #include "RlFunction.h"
 #include "RevVariable.h"
 #include "RbHelpFunction.h"
+#include "Workspace.h"
 
 namespace RevLanguage { class Argument; }
 namespace RevLanguage { class RevObject; }
@@ -134,15 +135,55 @@ bool Environment::addFunction( Function* func )
     
     // add the help entry for this function to the global help system instance
     // but only if this is not an internal function
+    // the entry is only built if somebody asks for it, from the function that is then looked up in the workspace
     if ( func->isInternal() == false )
     {
-        RevBayesCore::RbHelpSystem::getHelpSystem().addHelpFunction( static_cast<RevBayesCore::RbHelpFunction*>(func->getHelpEntry()) );
+        const std::string function_name = func->getFunctionName();
+        RevBayesCore::RbHelpSystem::getHelpSystem().addHelpFunction( function_name, func->getFunctionNameAliases(), [function_name]()
+            {
+                if ( Workspace::userWorkspace().existsFunction( function_name ) == false )
+                {
+                    return static_cast<RevBayesCore::RbHelpFunction*>( NULL );
+                }
+                Function* f = Workspace::userWorkspace().getFunctionTable().getFirstFunction( function_name );
+                RevBayesCore::RbHelpFunction* help = static_cast<RevBayesCore::RbHelpFunction*>( f->getHelpEntry() );
+                delete f;
+                return help;
+            } );
     }
 
     return true;
 }
 
 
+/**
+ * Add a function to the frame that is only constructed by the factory when it is looked up for the first time
+ * (see FunctionTable). The name and aliases must be those of the function that the factory creates.
+ * Internal functions cannot be added this way.
+ */
+bool Environment::addFunction( const std::string& function_name, const std::vector<std::string>& aliases, const FunctionFactory& factory )
+{
+    
+    if ( existsVariable( function_name ) )
+    {
+        throw RbException("There is already a variable named '" + function_name + "' in the workspace");
+    }
+    
+    function_table.addFunction( function_name, aliases, factory );
+    
+    // add the help entry for this function to the global help system instance
+    RevBayesCore::RbHelpSystem::getHelpSystem().addHelpFunction( function_name, aliases, [factory]()
+        {
+            Function* func = factory();
+            RevBayesCore::RbHelpFunction* help = static_cast<RevBayesCore::RbHelpFunction*>( func->getHelpEntry() );
+            delete func;
+            return help;
+        } );
+    
+    return true;
+}
+
+
 /** Add an empty (NULL) variable to frame. */
 void Environment::addNullVariable( const std::string& name )
 {
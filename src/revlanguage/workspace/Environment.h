@@ -54,6 +54,7 @@ class RevObject;
         // Regular functions
         void                                addAlias(const std::string& name, const RevPtr<RevVariable>& var);                          //!< Add alias of variable
         bool                                addFunction(Function* func);                                       //!< Add function
+        bool                                addFunction(const std::string& name, const std::vector<std::string>& aliases, const FunctionFactory& factory);  //!< Add function that is constructed on first use
         void                                addNullVariable(const std::string& name);                                                   //!< Add variable with null object
         void                                addReference(const std::string& name, const RevPtr<RevVariable>& var);                      //!< Add reference to variable
         void                                addVariable(const std::string& name, const RevPtr<RevVariable>& var);                       //!< Add variable
@@ -31,7 +31,8 @@ FunctionTable::FunctionTable(FunctionTable* parent) : std::multimap<std::string,
 
 
 /** Copy constructor */
-FunctionTable::FunctionTable(const FunctionTable& x)
+FunctionTable::FunctionTable(const FunctionTable& x) :
+    unbuiltFunctions( x.unbuiltFunctions )
 {
     
     for (std::multimap<std::string, Function *>::const_iterator it=x.begin(); it!=x.end(); ++it)
@@ -63,6 +64,7 @@ FunctionTable& FunctionTable::operator=(const FunctionTable& x)
         {
             insert(std::pair<std::string, Function *>((*i).first, ( (*i).second->clone() ) ) );
         }
+        unbuiltFunctions = x.unbuiltFunctions;
         
         parentTable = x.parentTable;
     }
@@ -92,6 +94,123 @@ void FunctionTable::addFunction( Function *func )
     
     name += func->getFunctionName();
     
+    // functions with the same name that were added before need to be in the table first
+    buildFunctions( name );
+    
+    // Test and insert the function
+    insertFunction( name, func );
+    
+    std::vector<std::string> aliases = func->getFunctionNameAliases();
+    for (size_t i=0; i < aliases.size(); ++i)
+    {
+        std::string a = aliases[i];
+        buildFunctions( a );
+        
+        // Insert the function
+        insert(std::pair<std::string, Function* >(a, func->clone() ));
+    }
+
+}
+
+
+/**
+ * Add a function that is only constructed when its name (or one of its aliases) is looked up.
+ * The name has to be the name under which the function would be added by addFunction(Function*),
+ * which is checked when the function is constructed. The same tests as for addFunction(Function*)
+ * are also only made when the function is constructed.
+ */
+void FunctionTable::addFunction( const std::string &name, const std::vector<std::string> &aliases, const FunctionFactory &factory )
+{
+    
+    UnbuiltFunction f;
+    f.factory = factory;
+    f.name    = name;
+    f.alias   = false;
+    
+    unbuiltFunctions.insert( std::pair<std::string, UnbuiltFunction>( name, f ) );
+    
+    f.alias   = true;
+    for (size_t i=0; i < aliases.size(); ++i)
+    {
+        unbuiltFunctions.insert( std::pair<std::string, UnbuiltFunction>( aliases[i], f ) );
+    }
+    
+}
+
+
+/**
+ * Construct all functions that have not been constructed yet,
+ * e.g., before listing all functions of the table.
+ */
+void FunctionTable::buildAllFunctions( void ) const
+{
+    
+    while ( unbuiltFunctions.empty() == false )
+    {
+        buildFunctions( unbuiltFunctions.begin()->first );
+    }
+    
+}
+
+
+/**
+ * Construct the functions that were added with a factory under this name (or alias), in the order in which they were added.
+ * Constructing the functions does not change which functions the table represents, so this is a const function
+ * although it inserts the new functions into the table.
+ */
+void FunctionTable::buildFunctions( const std::string &name ) const
+{
+    
+    std::pair<std::multimap<std::string, UnbuiltFunction>::iterator,
+              std::multimap<std::string, UnbuiltFunction>::iterator> range = unbuiltFunctions.equal_range( name );
+    
+    if ( range.first == range.second )
+    {
+        return;
+    }
+    
+    // remove the entries first so that the insertions below do not try to construct them again
+    std::vector<UnbuiltFunction> unbuilt;
+    for (std::multimap<std::string, UnbuiltFunction>::iterator it = range.first; it != range.second; ++it)
+    {
+        unbuilt.push_back( it->second );
+    }
+    unbuiltFunctions.erase( range.first, range.second );
+    
+    FunctionTable* table = const_cast<FunctionTable*>( this );
+    for (size_t i=0; i<unbuilt.size(); ++i)
+    {
+        Function* func = unbuilt[i].factory();
+        
+        // aliases are inserted without tests, just as in addFunction(Function*)
+        if ( unbuilt[i].alias == true )
+        {
+            table->insert( std::pair<std::string, Function* >( name, func ) );
+            continue;
+        }
+        
+        std::string function_name = ( func->isInternal() == true ? "_" : "" ) + func->getFunctionName();
+        if ( function_name != name )
+        {
+            // free memory
+            delete func;
+            
+            throw RbException( "The function added with the name '" + name + "' is named '" + function_name + "'." );
+        }
+        
+        table->insertFunction( name, func );
+    }
+    
+}
+
+
+/**
+ * Insert a function under its name. We do various tests to ensure that the
+ * function does not violate consistency rules (see addFunction).
+ */
+void FunctionTable::insertFunction( const std::string &name, Function *func )
+{
+    
     // Test function compliance with basic rules
     testFunctionValidity( name, func );
     
@@ -119,14 +238,6 @@ void FunctionTable::addFunction( Function *func )
 
     // Insert the function
     insert(std::pair<std::string, Function* >(name, func));
-    
-    std::vector<std::string> aliases = func->getFunctionNameAliases();
-    for (size_t i=0; i < aliases.size(); ++i)
-    {
-        std::string a = aliases[i];
-        // Insert the function
-        insert(std::pair<std::string, Function* >(a, func->clone() ));
-    }
 
 }
 
@@ -146,6 +257,7 @@ void FunctionTable::clear(void)
     }
     
     std::multimap<std::string, Function*>::clear();
+    unbuiltFunctions.clear();
     
 }
 
@@ -177,6 +289,8 @@ void FunctionTable::eraseFunction(const std::string& name)
     
     erase(ret_val.first, ret_val.second);
     
+    unbuiltFunctions.erase( name );
+    
 }
 
 
@@ -203,7 +317,7 @@ bool FunctionTable::existsFunction(std::string const &name) const
     const std::map<std::string, Function *>::const_iterator& it = find( name );
     
     // if this table doesn't contain the function, then we ask the parent table
-    if ( it == end() )
+    if ( it == end() && unbuiltFunctions.find( name ) == unbuiltFunctions.end() )
     {
         if ( parentTable != NULL ) 
         {
@@ -225,6 +339,8 @@ bool FunctionTable::existsFunction(std::string const &name) const
  */
 bool FunctionTable::existsFunctionInFrame( std::string const &name, const ArgumentRules& r ) const
 {
+    buildFunctions( name );
+    
     std::map<std::string, Function *>::const_iterator it = find( name );
     
     // If the name does not exist, the answer is no
@@ -258,6 +374,8 @@ std::vector<Function *> FunctionTable::findFunctions(const std::string& name) co
 
     std::vector<Function *>  the_functions;
 
+    buildFunctions( name );
+    
     size_t hits = count(name);
     if (hits == 0)
     {
@@ -293,6 +411,8 @@ const Function* FunctionTable::findFunction(const std::string& name, const std::
     std::pair<std::multimap<std::string, Function *>::const_iterator,
               std::multimap<std::string, Function *>::const_iterator> ret_val;
     
+    buildFunctions( name );
+    
     size_t hits = count(name);
     if (hits == 0)
     {
@@ -565,6 +685,11 @@ void FunctionTable::getFunctionNames(std::vector<std::string>& names) const
         names.push_back(s);
     }
     
+    for (std::multimap<std::string, UnbuiltFunction>::const_iterator i=unbuiltFunctions.begin(); i!=unbuiltFunctions.end(); i++)
+    {
+        names.push_back( i->second.name );
+    }
+    
     if ( parentTable != NULL)
     {
         parentTable->getFunctionNames(names);
@@ -652,6 +777,8 @@ bool FunctionTable::isDistinctFormal(const ArgumentRules& x, const ArgumentRules
  */
 bool FunctionTable::isProcedure(const std::string& name) const
 {
+    buildFunctions( name );
+    
     const std::map<std::string, Function *>::const_iterator& it = find( name );
     
     // If we have the function, we know the answer
@@ -677,6 +804,8 @@ bool FunctionTable::isProcedure(const std::string& name) const
 void FunctionTable::printValue(std::ostream& o, bool env) const
 {
     
+    buildAllFunctions();
+    
     for (std::multimap<std::string, Function *>::const_iterator i=begin(); i!=end(); i++)
     {
         std::ostringstream s("");
@@ -705,6 +834,8 @@ void FunctionTable::printValue(std::ostream& o, bool env) const
  */
 void FunctionTable::replaceFunction( const std::string& name, Function *func )
 {
+    buildFunctions( name );
+    
     // Test the function
     testFunctionValidity( name, func );
     
@@ -3,6 +3,7 @@
 
 #include "RevPtr.h"
 
+#include <functional>
 #include <map>
 #include <ostream>
 #include <string>
@@ -17,6 +18,8 @@ namespace RevLanguage {
     class RevObject;
     class RevVariable;
 
+    typedef std::function<Function*(void)> FunctionFactory;                                                                                 //!< Creates a new instance of a function
+
     /**
      * @brief FunctionTable: A multimap from function names to functions
      *
@@ -25,6 +28,12 @@ namespace RevLanguage {
      * is derived from. Function tables can be nested; each table defers
      * calls to its parent(s) when the task cannot be solved locally.
      *
+     * Functions can also be added by their name (and aliases) together with a factory. Such a function
+     * is only constructed when its name is looked up for the first time, at which point it is inserted
+     * like any other function. This keeps the thousands of builtin functions, most of which are never
+     * called in a given run, from being constructed at startup. Lookups of a name always construct all
+     * pending functions with that name first, so that overloads keep the order in which they were added.
+     *
      */
     class FunctionTable : public std::multimap<std::string, Function*> {
         
@@ -43,6 +52,8 @@ namespace RevLanguage {
 
         // FunctionTable functions
         virtual void                            addFunction(Function *func);                                       //!< Add function
+        void                                    addFunction(const std::string &name, const std::vector<std::string> &aliases, const FunctionFactory &factory);  //!< Add function that is constructed on first lookup
+        void                                    buildAllFunctions(void) const;                                                              //!< Construct all functions that have not been constructed yet
         void                                    clear(void);                                                                                //!< Clear table
 //        RevPtr<RevVariable>                        executeFunction(const std::string&           name,
 //                                                                const std::vector<Argument>& args);                                         //!< Evaluate function (once)
@@ -62,10 +73,19 @@ namespace RevLanguage {
 
     protected:
         
+        struct UnbuiltFunction {
+            FunctionFactory                     factory;                                                                                    //!< Creates the function
+            std::string                         name;                                                                                       //!< The primary name of the function
+            bool                                alias;                                                                                      //!< Is this entry for an alias of the function?
+        };
+        
+        void                                    buildFunctions(const std::string &name) const;                                              //!< Construct the functions that are registered with this name but not constructed yet
+        void                                    insertFunction(const std::string &name, Function *func);                                    //!< Test and insert a function under its name
         void                                    testFunctionValidity(const std::string& name, Function* func) const;                        //!< Test whether function can be added
         
         // Member variables
         const FunctionTable*                    parentTable;                                                                                //!< Enclosing table
+        mutable std::multimap<std::string, UnbuiltFunction> unbuiltFunctions;                                                               //!< Functions (by name and alias) that will be constructed on first lookup
 
 };
     
@@ -199,6 +199,7 @@
 #include "Func_annotateTree.h"
 #include "Func_characterMapTree.h"
 #include "Func_consensusTree.h"
+#include "Func_convertTreeTrace.h"
 #include "Func_convertToPhylowood.h"
 #include "Func_fileExists.h"
 #include "Func_listFiles.h"
@@ -521,6 +522,7 @@ void RevLanguage::Workspace::initializeBasicGlobalWorkspace(void)
         addFunction( new Func_annotateTree()                            );
 		addFunction( new Func_characterMapTree()                        );
         addFunction( new Func_consensusTree()                           );
+        addFunction( new Func_convertTreeTrace()                        );
         addFunction( new Func_convertToPhylowood()                      );
         addFunction( new Func_fileExists()                              );
         addFunction( new Func_listFiles()                               );
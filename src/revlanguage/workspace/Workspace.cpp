@@ -1,6 +1,7 @@
 #include <stddef.h>
 #include <sstream>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -106,45 +107,60 @@ Workspace::~Workspace(void)
 
 
 /**
- * Add a distribution to this workspace
+ * Add a distribution to this workspace.
+ * The constructor function and the help entry are only built when they are used for the first time.
  */
 bool Workspace::addDistribution( Distribution *dist )
 {
 
     if ( typeTable.find( dist->getDistributionFunctionName() ) != typeTable.end() )
     {
+        std::string type = dist->getType();
         delete dist;
-        throw RbException("There is already a type named '" + dist->getType() + "' in the workspace");
+        throw RbException("There is already a type named '" + type + "' in the workspace");
     }
     
-    function_table.addFunction( new ConstructorFunction( dist ) );
+    std::shared_ptr<const Distribution> prototype( dist );
+    
+    std::string name = dist->getConstructorFunctionName();
+    std::vector<std::string> aliases = dist->getConstructorFunctionAliases();
+    function_table.addFunction( name, aliases, [prototype]() { return new ConstructorFunction( prototype->clone() ); } );
     
     // add the help entry for this distribution to the global help system instance
-    RevBayesCore::RbHelpDistribution* entry = static_cast<RevBayesCore::RbHelpDistribution*>( dist->getHelpEntry() );
-    RevBayesCore::RbHelpSystem::getHelpSystem().addHelpDistribution( entry );
+    RevBayesCore::RbHelpSystem::getHelpSystem().addHelpType( name, aliases, [prototype]() { return static_cast<RevBayesCore::RbHelpDistribution*>( prototype->getHelpEntry() ); } );
 
     return true;
 }
 
 
 /** 
- * Add a type to the workspace
+ * Add a type to the workspace.
+ * The constructor function and the help entry are only built when they are used for the first time.
  */
 bool Workspace::addType( RevObject *templ )
 {
     std::string name = templ->getType();
+    std::string constructor_name = templ->getConstructorFunctionName();
+    std::vector<std::string> aliases = templ->getConstructorFunctionAliases();
+    
+    // the copy of the template from which the constructor function and the help entry are built
+    std::shared_ptr<const RevObject> prototype;
     
     // add the constructor function if there is one
     // (constructors can be overloaded)
-    if ( templ->getConstructorFunctionName() != "c_name" )
+    if ( constructor_name != "c_name" )
     {
-        function_table.addFunction( new ConstructorFunction(templ) );
+        prototype.reset( templ->clone() );
+        function_table.addFunction( constructor_name, aliases, [prototype]() { return new ConstructorFunction( prototype->clone() ); } );
 
         // only add the type to the table if the entry doesn't already exist
-        // add a clone of the  template for so as not to interfere with the constructor's copy
         if ( typeTable.find( name ) == typeTable.end() )
         {
-            typeTable.insert(std::pair<std::string, RevObject*>( name, templ->clone() ) );
+            typeTable.insert(std::pair<std::string, RevObject*>( name, templ ) );
+        }
+        else
+        {
+            delete templ;
         }
     }
     // or, if the type exists already, throw an error
@@ -158,11 +174,13 @@ bool Workspace::addType( RevObject *templ )
     // otherwise, add the template to the type table
     else
     {
+        prototype.reset( templ->clone() );
         typeTable.insert(std::pair<std::string, RevObject*>( name, templ ) );
     }
 
     // add the help entry for this type to the global help system instance
-    RevBayesCore::RbHelpSystem::getHelpSystem().addHelpType( static_cast<RevBayesCore::RbHelpType*>( templ->getHelpEntry() ) );
+    std::string help_name = ( constructor_name == "c_name" ? name : constructor_name );
+    RevBayesCore::RbHelpSystem::getHelpSystem().addHelpType( help_name, aliases, [prototype]() { return static_cast<RevBayesCore::RbHelpType*>( prototype->getHelpEntry() ); } );
 
     return true;
 }
@@ -48,6 +48,10 @@ namespace RevLanguage {
      * distribution. When addDistribution is called, the relevant distribution functions are added
      * to the function table.
      *
+     * The constructor functions of types and distributions, the distribution functions and all help
+     * entries are registered by name only and built when they are used for the first time, so that
+     * starting RevBayes does not construct thousands of objects that a typical script never uses.
+     *
      */
 
     class Workspace : public Environment {